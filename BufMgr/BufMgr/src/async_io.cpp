@@ -0,0 +1,417 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "async_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Number of times the completion ring is polled before blocking in the
+ * kernel for completions.
+ */
+const int kPollSpins = 64;
+
+/**
+ * Total length of the given buffers.
+ */
+std::uint64_t totalLength(const struct iovec* iov, const unsigned iovcnt) {
+  std::uint64_t length = 0;
+  for (unsigned i = 0; i < iovcnt; ++i) {
+    length += iov[i].iov_len;
+  }
+  return length;
+}
+
+/**
+ * Carries out a vectored read or write with preadv/pwritev, continuing after
+ * short transfers.
+ */
+void transferAll(const bool is_write, const int fd, std::uint64_t offset,
+                 const struct iovec* iov, const unsigned iovcnt) {
+  std::vector<struct iovec> rest(iov, iov + iovcnt);
+  std::size_t first = 0;
+  while (first < rest.size()) {
+    const int count = std::min<std::size_t>(rest.size() - first, IOV_MAX);
+    const ssize_t done =
+        is_write ? ::pwritev(fd, &rest[first], count, offset)
+                 : ::preadv(fd, &rest[first], count, offset);
+    if (done < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException(is_write ? "pwritev" : "preadv", errno);
+    }
+    if (done == 0) {
+      throw IoException(is_write ? "pwritev" : "preadv", 0);
+    }
+    offset += done;
+    std::size_t left = done;
+    while (first < rest.size() && left >= rest[first].iov_len) {
+      left -= rest[first].iov_len;
+      ++first;
+    }
+    if (left > 0) {
+      rest[first].iov_base = static_cast<char*>(rest[first].iov_base) + left;
+      rest[first].iov_len -= left;
+    }
+  }
+}
+
+}
+
+AsyncIo::AsyncIo(const unsigned queue_depth, const bool use_io_uring)
+    : queue_depth_(std::max(queue_depth, 1u)),
+      ring_fd_(-1),
+      sq_ring_(MAP_FAILED),
+      sq_ring_size_(0),
+      cq_ring_(MAP_FAILED),
+      cq_ring_size_(0),
+      sqes_(static_cast<struct io_uring_sqe*>(MAP_FAILED)),
+      sqes_size_(0),
+      sq_local_tail_(0),
+      queued_(0),
+      in_flight_(0),
+      first_error_(0),
+      short_transfer_(false),
+      registered_base_(NULL),
+      registered_length_(0),
+      registered_chunk_(0) {
+  if (!use_io_uring) {
+    return;
+  }
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ring_fd_ = ::syscall(__NR_io_uring_setup, queue_depth_, &params);
+  if (ring_fd_ < 0) {
+    // No io_uring in this kernel (or it is disabled); use preadv/pwritev.
+    ring_fd_ = -1;
+    return;
+  }
+  queue_depth_ = std::min(queue_depth_, params.sq_entries);
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = ::mmap(NULL, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cq_ring_ = sq_ring_;
+  } else if (sq_ring_ != MAP_FAILED) {
+    cq_ring_ = ::mmap(NULL, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+  }
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  if (cq_ring_ != MAP_FAILED) {
+    sqes_ = static_cast<struct io_uring_sqe*>(
+        ::mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+  }
+  if (sqes_ == MAP_FAILED) {
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      ::munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      ::munmap(sq_ring_, sq_ring_size_);
+    }
+    sq_ring_ = cq_ring_ = MAP_FAILED;
+    ::close(ring_fd_);
+    ring_fd_ = -1;
+    return;
+  }
+
+  char* sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+  sq_local_tail_ = *sq_tail_;
+  singles_.resize(queue_depth_);
+}
+
+AsyncIo::~AsyncIo() {
+  if (ring_fd_ < 0) {
+    return;
+  }
+  try {
+    wait();
+  } catch (...) {
+    // Nobody is left to report the error to.
+  }
+  ::munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    ::munmap(cq_ring_, cq_ring_size_);
+  }
+  ::munmap(sq_ring_, sq_ring_size_);
+  ::close(ring_fd_);
+}
+
+bool AsyncIo::registerBuffers(void* base, const std::size_t length,
+                              const std::size_t chunk) {
+  if (ring_fd_ < 0 || chunk == 0) {
+    return false;
+  }
+  wait();
+  if (registered_base_ != NULL) {
+    ::syscall(__NR_io_uring_register, ring_fd_, IORING_UNREGISTER_BUFFERS,
+              NULL, 0);
+    registered_base_ = NULL;
+  }
+  std::vector<struct iovec> pieces;
+  for (std::size_t done = 0; done < length; done += chunk) {
+    struct iovec piece;
+    piece.iov_base = static_cast<char*>(base) + done;
+    piece.iov_len = std::min(chunk, length - done);
+    pieces.push_back(piece);
+  }
+  if (pieces.empty() ||
+      ::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS,
+                &pieces[0], pieces.size()) < 0) {
+    return false;
+  }
+  registered_base_ = static_cast<char*>(base);
+  registered_length_ = length;
+  registered_chunk_ = chunk;
+  return true;
+}
+
+void AsyncIo::read(const int fd, const std::uint64_t offset,
+                   const struct iovec* iov, const unsigned iovcnt) {
+  if (ring_fd_ < 0) {
+    transferAll(false /* is_write */, fd, offset, iov, iovcnt);
+  } else {
+    prepareReadWrite(false /* is_write */, fd, offset, iov, iovcnt,
+                     false /* tagged */, 0);
+  }
+}
+
+void AsyncIo::submitRead(const int fd, const std::uint64_t offset,
+                         const struct iovec* iov, const unsigned iovcnt,
+                         const std::uint64_t tag) {
+  if (ring_fd_ >= 0) {
+    prepareReadWrite(false /* is_write */, fd, offset, iov, iovcnt,
+                     true /* tagged */, tag);
+    return;
+  }
+  Completion completion;
+  completion.tag = tag;
+  completion.error = 0;
+  try {
+    transferAll(false /* is_write */, fd, offset, iov, iovcnt);
+  } catch (IoException& e) {
+    completion.error = e.error() != 0 ? e.error() : EIO;
+  }
+  completed_.push_back(completion);
+}
+
+std::size_t AsyncIo::poll(std::vector<Completion>& completions,
+                          const bool block) {
+  if (ring_fd_ >= 0) {
+    submitAndReap(0);
+    while (block && completed_.empty() && in_flight_ > 0) {
+      submitAndReap(1);
+    }
+  }
+  const std::size_t count = completed_.size();
+  completions.insert(completions.end(), completed_.begin(), completed_.end());
+  completed_.clear();
+  return count;
+}
+
+void AsyncIo::write(const int fd, const std::uint64_t offset,
+                    const struct iovec* iov, const unsigned iovcnt) {
+  if (ring_fd_ < 0) {
+    transferAll(true /* is_write */, fd, offset, iov, iovcnt);
+  } else {
+    prepareReadWrite(true /* is_write */, fd, offset, iov, iovcnt,
+                     false /* tagged */, 0);
+  }
+}
+
+void AsyncIo::fsync(const int fd) {
+  if (ring_fd_ < 0) {
+    if (::fsync(fd) < 0) {
+      throw IoException("fsync", errno);
+    }
+    return;
+  }
+  struct io_uring_sqe* sqe = nextSqe();
+  sqe->opcode = IORING_OP_FSYNC;
+  // Do not start the sync before everything queued earlier has completed.
+  sqe->flags = IOSQE_IO_DRAIN;
+  sqe->fd = fd;
+  sqe->user_data = 0;
+}
+
+void AsyncIo::wait() {
+  if (ring_fd_ < 0) {
+    return;
+  }
+  submitAndReap(queued_ + in_flight_);
+  const int error = first_error_;
+  const bool short_transfer = short_transfer_;
+  first_error_ = 0;
+  short_transfer_ = false;
+  if (error != 0 || short_transfer) {
+    throw IoException("io_uring", error);
+  }
+}
+
+struct io_uring_sqe* AsyncIo::nextSqe() {
+  if (queued_ + in_flight_ >= queue_depth_) {
+    submitAndReap(1);
+  }
+  const unsigned index = sq_local_tail_ & *sq_mask_;
+  struct io_uring_sqe* sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sq_array_[index] = index;
+  ++sq_local_tail_;
+  ++queued_;
+  return sqe;
+}
+
+void AsyncIo::prepareReadWrite(const bool is_write, const int fd,
+                               const std::uint64_t offset,
+                               const struct iovec* iov,
+                               const unsigned iovcnt, const bool tagged,
+                               const std::uint64_t tag) {
+  struct io_uring_sqe* sqe = nextSqe();
+  const char* start = static_cast<const char*>(iov[0].iov_base);
+  bool fixed = iovcnt == 1 && registered_base_ != NULL &&
+      start >= registered_base_ &&
+      start + iov[0].iov_len <= registered_base_ + registered_length_;
+  std::size_t piece = 0;
+  if (fixed) {
+    piece = static_cast<std::size_t>(start - registered_base_) /
+        registered_chunk_;
+    fixed = start + iov[0].iov_len <=
+        registered_base_ + (piece + 1) * registered_chunk_;
+  }
+  if (fixed) {
+    sqe->opcode = is_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(start);
+    sqe->len = iov[0].iov_len;
+    sqe->buf_index = piece;
+  } else {
+    sqe->opcode = is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(iov);
+    sqe->len = iovcnt;
+  }
+  sqe->fd = fd;
+  sqe->off = offset;
+
+  Operation operation;
+  operation.length = totalLength(iov, iovcnt);
+  operation.tagged = tagged;
+  operation.tag = tag;
+  std::size_t index;
+  if (free_operations_.empty()) {
+    index = operations_.size();
+    operations_.push_back(operation);
+  } else {
+    index = free_operations_.back();
+    free_operations_.pop_back();
+    operations_[index] = operation;
+  }
+  if (!fixed && tagged && iovcnt == 1) {
+    // The caller's iovec may be gone by the time the entry is submitted.
+    singles_[index] = iov[0];
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&singles_[index]);
+  }
+  sqe->user_data = index + 1;
+}
+
+void AsyncIo::submitAndReap(const unsigned min_complete) {
+  __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+  while (queued_ > 0) {
+    const int submitted = ::syscall(__NR_io_uring_enter, ring_fd_, queued_, 0,
+                                    0, NULL, 0);
+    if (submitted < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        reap();
+        continue;
+      }
+      throw IoException("io_uring_enter", errno);
+    }
+    queued_ -= submitted;
+    in_flight_ += submitted;
+  }
+
+  const unsigned target = in_flight_ > min_complete ? in_flight_ - min_complete
+                                                     : 0;
+  for (int spin = 0; spin < kPollSpins && in_flight_ > target; ++spin) {
+    reap();
+  }
+  while (in_flight_ > target) {
+    if (::syscall(__NR_io_uring_enter, ring_fd_, 0, in_flight_ - target,
+                  IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) {
+      throw IoException("io_uring_enter", errno);
+    }
+    reap();
+  }
+}
+
+void AsyncIo::reap() {
+  unsigned head = *cq_head_;
+  const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    const struct io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+    if (cqe.user_data == 0) {
+      // An fsync.
+      if (cqe.res < 0 && first_error_ == 0) {
+        first_error_ = -cqe.res;
+      }
+    } else {
+      const std::size_t index = cqe.user_data - 1;
+      const Operation& operation = operations_[index];
+      const bool short_transfer =
+          cqe.res >= 0 &&
+          static_cast<std::uint64_t>(cqe.res) != operation.length;
+      if (operation.tagged) {
+        Completion completion;
+        completion.tag = operation.tag;
+        completion.error = cqe.res < 0 ? -cqe.res : short_transfer ? EIO : 0;
+        completed_.push_back(completion);
+      } else if (cqe.res < 0) {
+        if (first_error_ == 0) {
+          first_error_ = -cqe.res;
+        }
+      } else if (short_transfer) {
+        short_transfer_ = true;
+      }
+      free_operations_.push_back(index);
+    }
+    ++head;
+    --in_flight_;
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+}
+
+}
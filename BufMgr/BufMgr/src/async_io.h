@@ -0,0 +1,281 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <sys/uio.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace badgerdb {
+
+/**
+ * @brief Queue of asynchronous reads, writes and syncs on file descriptors.
+ *
+ * Operations are queued with read(), write() and fsync() and are all
+ * complete once wait() returns.  When the kernel supports io_uring, queued
+ * operations are handed to the kernel in batches of up to the queue depth
+ * and run concurrently; completions are polled from the shared completion
+ * ring before falling back to a blocking wait.  Memory registered with
+ * registerBuffers() (the buffer pool) is read into and written from without
+ * the kernel having to map it for every operation.
+ *
+ * Reads queued with submitRead() are not waited for as a group: each one's
+ * completion is reported by poll() under a tag chosen by the caller, so that
+ * a caller can go on with other work and pick up reads as they finish.
+ *
+ * If io_uring is not available at run time, or is not wanted, every
+ * operation is instead carried out with preadv/pwritev/fsync when it is
+ * queued.
+ *
+ * The iovec arrays and the memory they point to must stay valid until wait()
+ * returns.
+ *
+ * @warning This class is not threadsafe.
+ */
+class AsyncIo {
+ public:
+  /**
+   * @brief Completion of a read queued with submitRead().
+   */
+  struct Completion {
+    /**
+     * Tag the read was queued with.
+     */
+    std::uint64_t tag;
+
+    /**
+     * 0 if the read transferred everything, otherwise the errno value of the
+     * failure (EIO for a short transfer).
+     */
+    int error;
+  };
+
+  /**
+   * Creates a queue that keeps up to <queue_depth> operations in flight.
+   *
+   * @param queue_depth   Maximum number of operations in flight at once.
+   * @param use_io_uring  If false, always use the preadv/pwritev path.
+   */
+  explicit AsyncIo(const unsigned queue_depth, const bool use_io_uring = true);
+
+  /**
+   * Waits for all operations in flight and releases the ring.
+   */
+  ~AsyncIo();
+
+  /**
+   * Returns true if operations go through io_uring, false if they fall back
+   * to preadv/pwritev.
+   */
+  bool usingIoUring() const { return ring_fd_ >= 0; }
+
+  /**
+   * Returns the maximum number of operations in flight at once.
+   */
+  unsigned queueDepth() const { return queue_depth_; }
+
+  /**
+   * Registers a memory area as fixed buffers, so that single-buffer reads and
+   * writes inside it skip the per-operation page mapping in the kernel.  The
+   * area is registered in pieces of at most <chunk> bytes; operations must not
+   * cross a piece boundary to benefit.  Replaces any earlier registration.
+   *
+   * @param base    Start of the memory area.
+   * @param length  Length of the memory area in bytes.
+   * @param chunk   Size of the registered pieces in bytes.
+   * @return  True if the area is registered; false if the kernel refused (for
+   *          example because of RLIMIT_MEMLOCK) or io_uring is not in use.
+   */
+  bool registerBuffers(void* base, const std::size_t length,
+                       const std::size_t chunk);
+
+  /**
+   * Queues a vectored read from <fd> at <offset>.
+   *
+   * @throws  IoException  If the read fails (immediately on the fallback path,
+   *                       otherwise from a later wait()).
+   */
+  void read(const int fd, const std::uint64_t offset, const struct iovec* iov,
+            const unsigned iovcnt);
+
+  /**
+   * Queues a vectored write to <fd> at <offset>.
+   *
+   * @throws  IoException  If the write fails (immediately on the fallback
+   *                       path, otherwise from a later wait()).
+   */
+  void write(const int fd, const std::uint64_t offset,
+             const struct iovec* iov, const unsigned iovcnt);
+
+  /**
+   * Queues a vectored read from <fd> at <offset> whose completion is reported
+   * by poll() under <tag> rather than waited for by wait().  Failures are
+   * reported in the completion too.  A single-buffer <iov> need not stay
+   * valid after the call.
+   */
+  void submitRead(const int fd, const std::uint64_t offset,
+                  const struct iovec* iov, const unsigned iovcnt,
+                  const std::uint64_t tag);
+
+  /**
+   * Hands queued operations to the kernel and appends the completions of
+   * reads queued with submitRead() that have finished to <completions>.
+   *
+   * @param completions  Vector to append the completions to.
+   * @param block        If true and no read has finished yet, waits until one
+   *                     does (unless none is in flight).
+   * @return  The number of completions appended.
+   */
+  std::size_t poll(std::vector<Completion>& completions, const bool block);
+
+  /**
+   * Queues an fsync of <fd>.  It is ordered after all operations queued before
+   * it, which are waited for first.
+   *
+   * @throws  IoException  If the sync or an earlier operation fails.
+   */
+  void fsync(const int fd);
+
+  /**
+   * Submits all queued operations and waits until every one has completed.
+   *
+   * @throws  IoException  If any operation failed or transferred fewer bytes
+   *                       than requested.  All operations have completed
+   *                       before the exception is thrown.
+   */
+  void wait();
+
+ private:
+  /**
+   * Returns a free submission queue entry, submitting queued entries and
+   * reaping completions first if the queue depth is reached.
+   */
+  struct io_uring_sqe* nextSqe();
+
+  /**
+   * @brief Read or write in flight, found again from its entry's user data.
+   */
+  struct Operation {
+    /**
+     * Number of bytes to transfer.
+     */
+    std::uint64_t length;
+
+    /**
+     * True if the completion is reported by poll() under <tag>.
+     */
+    bool tagged;
+    std::uint64_t tag;
+  };
+
+  /**
+   * Fills in an entry for a read or write of the given buffers, using a fixed
+   * buffer operation if the single buffer lies in a registered area.
+   */
+  void prepareReadWrite(const bool is_write, const int fd,
+                        const std::uint64_t offset, const struct iovec* iov,
+                        const unsigned iovcnt, const bool tagged,
+                        const std::uint64_t tag);
+
+  /**
+   * Hands queued entries to the kernel and waits for at least <min_complete>
+   * completions, polling the completion ring before blocking.
+   */
+  void submitAndReap(const unsigned min_complete);
+
+  /**
+   * Consumes all available completions.
+   */
+  void reap();
+
+  /**
+   * Maximum number of operations in flight.
+   */
+  unsigned queue_depth_;
+
+  /**
+   * io_uring instance, or -1 on the fallback path.
+   */
+  int ring_fd_;
+
+  /**
+   * Mappings of the submission and completion rings and of the entry array.
+   */
+  void* sq_ring_;
+  std::size_t sq_ring_size_;
+  void* cq_ring_;
+  std::size_t cq_ring_size_;
+  struct io_uring_sqe* sqes_;
+  std::size_t sqes_size_;
+
+  /**
+   * Pointers into the ring mappings.
+   */
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  struct io_uring_cqe* cqes_;
+
+  /**
+   * Submission queue tail including entries not yet published to the kernel.
+   */
+  unsigned sq_local_tail_;
+
+  /**
+   * Entries filled in but not yet handed to the kernel.
+   */
+  unsigned queued_;
+
+  /**
+   * Operations handed to the kernel and not yet completed.
+   */
+  unsigned in_flight_;
+
+  /**
+   * First error seen since the last wait(), reported by wait().
+   */
+  int first_error_;
+  bool short_transfer_;
+
+  /**
+   * Operations in flight, indexed by entry user data - 1 (user data 0 is an
+   * fsync), and the indexes free for reuse.
+   */
+  std::vector<Operation> operations_;
+  std::vector<std::size_t> free_operations_;
+
+  /**
+   * Copies of the iovecs of single-buffer tagged reads, parallel to
+   * operations_; sized for every operation that can be in flight, so they
+   * never move.
+   */
+  std::vector<struct iovec> singles_;
+
+  /**
+   * Completions of tagged reads not yet returned by poll().
+   */
+  std::vector<Completion> completed_;
+
+  /**
+   * Registered buffer area, or NULL.
+   */
+  char* registered_base_;
+  std::size_t registered_length_;
+  std::size_t registered_chunk_;
+};
+
+}
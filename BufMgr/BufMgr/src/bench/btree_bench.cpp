@@ -0,0 +1,181 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * B+tree index benchmark.  Builds an index of random integer keys twice, by
+ * inserting them one by one and by bulk loading them sorted, then runs
+ * random lookups on 1, 2 and 4 threads sharing the buffer manager mutex, and
+ * finally scans the whole inserted index through a small pool with its file
+ * bypassing the OS page cache (CACHE_DIRECT) and asynchronous I/O enabled,
+ * with and without reading the next leaf ahead.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/btree_bench [keys] [lookups per thread] [scan frames]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "btree.h"
+#include "buffer.h"
+#include "file.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kInsertedName = "btree_bench_inserted.db";
+const char* const kLoadedName = "btree_bench_loaded.db";
+
+double since(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+void removeFile(const char* name) {
+  try {
+    File::remove(name);
+  } catch (FileNotFoundException&) {
+  }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t num_keys =
+      argc > 1 ? std::strtoul(argv[1], NULL, 10) : 200000;
+  const unsigned long lookups =
+      argc > 2 ? std::strtoul(argv[2], NULL, 10) : 200000;
+  const std::uint32_t scan_frames =
+      argc > 3 ? std::strtoul(argv[3], NULL, 10) : 64;
+  if (num_keys == 0 || scan_frames < 8) {
+    std::cerr << "Usage: " << argv[0]
+              << " [keys > 0] [lookups per thread] [scan frames >= 8]\n";
+    return 1;
+  }
+  removeFile(kInsertedName);
+  removeFile(kLoadedName);
+
+  std::mt19937_64 rng(5);
+  std::vector<std::pair<std::int64_t, RecordId> > entries(num_keys);
+  for (std::size_t k = 0; k < num_keys; ++k) {
+    entries[k].first = static_cast<std::int64_t>(rng() >> 1);
+    entries[k].second.page_number = static_cast<PageId>(k / 64 + 1);
+    entries[k].second.slot_number = static_cast<SlotId>(k % 64);
+  }
+  std::printf("%zu keys\n", num_keys);
+
+  std::mutex mutex;
+  {
+    File inserted = File::create(kInsertedName);
+    File loaded = File::create(kLoadedName);
+    // Large enough to hold both indexes
+    BufMgr buf_mgr(4096);
+
+    BTreeIndex insert_tree(buf_mgr, &inserted, mutex, BTREE_INT_KEYS);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t k = 0; k < num_keys; ++k) {
+      insert_tree.insert(entries[k].first, entries[k].second);
+    }
+    const double insert_time = since(start);
+    const BTreeStats stats = insert_tree.stats();
+    std::printf("  %-28s %10.3f s %12.0f keys/s  (height %u, %llu splits)\n",
+                "insert one by one", insert_time, num_keys / insert_time,
+                insert_tree.height(),
+                static_cast<unsigned long long>(stats.splits));
+
+    std::vector<std::pair<std::int64_t, RecordId> > sorted(entries);
+    start = std::chrono::steady_clock::now();
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<std::int64_t, RecordId>& a,
+                 const std::pair<std::int64_t, RecordId>& b) {
+                if (a.first != b.first) {
+                  return a.first < b.first;
+                }
+                return a.second.page_number != b.second.page_number
+                           ? a.second.page_number < b.second.page_number
+                           : a.second.slot_number < b.second.slot_number;
+              });
+    BTreeIndex load_tree(buf_mgr, &loaded, mutex, BTREE_INT_KEYS);
+    load_tree.bulkLoad(sorted);
+    const double load_time = since(start);
+    std::printf("  %-28s %10.3f s %12.0f keys/s  (height %u)\n",
+                "sort and bulk load", load_time, num_keys / load_time,
+                load_tree.height());
+
+    for (unsigned threads = 1; threads <= 4; threads *= 2) {
+      std::vector<std::thread> workers;
+      start = std::chrono::steady_clock::now();
+      for (unsigned t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&, t]() {
+          std::mt19937 pick(17 + t);
+          RecordId rid;
+          for (unsigned long l = 0; l < lookups; ++l) {
+            const std::size_t k = pick() % num_keys;
+            if (!load_tree.lookup(entries[k].first, rid)) {
+              std::fprintf(stderr, "key %zu not found\n", k);
+              std::exit(1);
+            }
+          }
+        }));
+      }
+      for (unsigned t = 0; t < threads; ++t) {
+        workers[t].join();
+      }
+      char name[32];
+      std::snprintf(name, sizeof(name), "lookups, %u thread%s", threads,
+                    threads > 1 ? "s" : "");
+      const double time = since(start);
+      std::printf("  %-28s %10.3f s %12.0f lookups/s\n", name, time,
+                  threads * lookups / time);
+    }
+    buf_mgr.flushFile(&inserted);
+    buf_mgr.flushFile(&loaded);
+  }
+
+  // The leaves of the inserted index are scattered over its file, so
+  // following their sibling links reads the file out of order
+  for (int prefetch = 0; prefetch < 2; ++prefetch) {
+    File inserted = File::open(kInsertedName);
+    inserted.setCacheMode(File::CACHE_DIRECT);
+    BufMgr buf_mgr(scan_frames);
+    buf_mgr.enableAsyncIo(8);
+    BTreeIndex tree(buf_mgr, &inserted, mutex, BTREE_INT_KEYS);
+    tree.setPrefetch(prefetch == 1);
+    buf_mgr.clearBufStats();
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t scanned = 0;
+    {
+      BTreeScan scan = tree.scan(INT64_MIN, INT64_MAX);
+      RecordId rid;
+      std::int64_t checksum = 0;
+      while (scan.next(rid)) {
+        checksum += scan.intKey() & 0xff;
+        ++scanned;
+      }
+      if (scanned != num_keys || checksum == 0) {
+        std::fprintf(stderr, "scan returned %zu keys\n", scanned);
+        return 1;
+      }
+    }
+    const double time = since(start);
+    std::printf("  %-28s %10.3f s %12.0f keys/s  (%d disk reads)\n",
+                prefetch ? "full scan, prefetch" : "full scan, no prefetch",
+                time, scanned / time, buf_mgr.getBufStats().diskreads);
+    buf_mgr.flushFile(&inserted);
+  }
+
+  File::remove(kInsertedName);
+  File::remove(kLoadedName);
+  return 0;
+}
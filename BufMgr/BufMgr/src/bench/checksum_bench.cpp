@@ -0,0 +1,172 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * Page checksum benchmark.  Times the CRC-32C of a Page::SIZE page with the
+ * CRC instructions of the processor (if it has them), with the slicing-by-8
+ * software version, and, for comparison, with the byte-at-a-time FNV-1a hash
+ * the log used before.  Then times writing and reading back a file of pages
+ * through File::writePages() and File::readPages() with checksums on and off,
+ * so the checksum cost can be set against that of the (page cache) I/O.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/checksum_bench [pages] [rounds]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "crc32c.h"
+#include "file.h"
+#include "page.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kFilename = "checksum_bench.db";
+
+/**
+ * Pages per File::writePages()/readPages() call.
+ */
+const std::uint32_t kRun = 32;
+
+std::uint32_t fnv1a(const void* data, const std::size_t length,
+                    const std::uint32_t) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  std::uint32_t hash = 2166136261u;
+  for (std::size_t i = 0; i < length; ++i) {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * Nanoseconds per page of <function> over <pages>, each checksummed <rounds>
+ * times.
+ */
+double timeChecksum(std::uint32_t (*function)(const void*, std::size_t,
+                                              std::uint32_t),
+                    const std::vector<Page>& pages, const unsigned rounds) {
+  std::uint32_t sink = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned r = 0; r < rounds; ++r) {
+    for (std::size_t p = 0; p < pages.size(); ++p) {
+      sink ^= function(&pages[p], Page::SIZE, 0);
+    }
+  }
+  const double secs = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  if (sink == 0x5eed) {
+    std::printf("  (sink %u)\n", sink);
+  }
+  return secs * 1e9 / (static_cast<double>(rounds) * pages.size());
+}
+
+/**
+ * Nanoseconds per page to write, then to read back, all pages of <file> in
+ * runs of kRun.
+ */
+void timeFile(File& file, std::vector<Page>& pages, const unsigned rounds,
+              double& write_ns, double& read_ns) {
+  std::vector<const Page*> sources(pages.size());
+  std::vector<Page*> targets(pages.size());
+  for (std::size_t p = 0; p < pages.size(); ++p) {
+    sources[p] = &pages[p];
+    targets[p] = &pages[p];
+  }
+  double write_secs = 0;
+  double read_secs = 0;
+  for (unsigned r = 0; r < rounds; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint32_t p = 0; p < pages.size(); p += kRun) {
+      file.writePages(p + 1, kRun, &sources[p]);
+    }
+    write_secs += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (std::uint32_t p = 0; p < pages.size(); p += kRun) {
+      file.readPages(p + 1, kRun, &targets[p]);
+    }
+    read_secs += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+  }
+  const double count = static_cast<double>(rounds) * pages.size();
+  write_ns = write_secs * 1e9 / count;
+  read_ns = read_secs * 1e9 / count;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  std::uint32_t num_pages = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1024;
+  const unsigned rounds = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 20;
+  num_pages -= num_pages % kRun;
+  if (num_pages == 0 || rounds == 0) {
+    std::cerr << "Usage: " << argv[0] << " [pages] [rounds]\n";
+    return 1;
+  }
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    std::vector<Page> pages;
+    std::mt19937 rng(7);
+    for (std::uint32_t p = 0; p < num_pages; ++p) {
+      Page page = file.allocatePage();
+      std::string record(200, ' ');
+      while (page.hasSpaceForRecord(record)) {
+        for (std::size_t c = 0; c < record.size(); ++c) {
+          record[c] = static_cast<char>('a' + rng() % 26);
+        }
+        page.insertRecord(record);
+      }
+      pages.push_back(page);
+    }
+
+    std::printf("Checksum of a %u byte page (%s CRC-32C in use)\n",
+                static_cast<unsigned>(Page::SIZE),
+                Crc32c::hardware() ? "hardware" : "software");
+    std::printf("  %-24s %12s %12s\n", "", "ns/page", "GB/s");
+    struct {
+      const char* name;
+      std::uint32_t (*function)(const void*, std::size_t, std::uint32_t);
+    } const versions[] = {{"CRC-32C", Crc32c::compute},
+                          {"CRC-32C slicing-by-8", Crc32c::computeSoftware},
+                          {"FNV-1a bytewise", fnv1a}};
+    for (std::size_t v = 0; v < sizeof(versions) / sizeof(versions[0]); ++v) {
+      const double ns = timeChecksum(versions[v].function, pages, rounds);
+      std::printf("  %-24s %12.1f %12.2f\n", versions[v].name, ns,
+                  Page::SIZE / ns);
+    }
+
+    std::printf("File::writePages()/readPages() of %u pages, runs of %u\n",
+                num_pages, kRun);
+    std::printf("  %-24s %12s %12s\n", "", "write ns/pg", "read ns/pg");
+    for (int on = 1; on >= 0; --on) {
+      file.setChecksums(on != 0);
+      double write_ns;
+      double read_ns;
+      timeFile(file, pages, 1, write_ns, read_ns);  // warm up
+      timeFile(file, pages, rounds, write_ns, read_ns);
+      std::printf("  %-24s %12.1f %12.1f\n",
+                  on ? "checksums on" : "checksums off", write_ns, read_ns);
+    }
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * Page compression benchmark.  Fills a plain file and a compressed one
+ * (File::createCompressed()) with the same pages of ASCII records through a
+ * buffer pool, then reads every page back through a fresh pool with the file
+ * dropped from the OS page cache, and reports for both formats the size of
+ * the file on disk, the write-back time and the read throughput.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/compression_bench [pages] [rounds]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kFilename = "compression_bench.db";
+
+/**
+ * Frames of the buffer pools, far fewer than pages, so reads go to the file.
+ */
+const std::uint32_t kFrames = 64;
+
+double since(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+void dropFromPageCache() {
+  const int fd = ::open(kFilename, O_RDONLY);
+  if (fd >= 0) {
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+/**
+ * Record of a few random words, like the rows of a table of text.
+ */
+std::string makeRecord(std::mt19937& rng) {
+  static const char* const kWords[] = {
+      "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf",
+      "hotel", "india", "juliet", "kilo", "lima", "mike", "november",
+      "oscar", "papa", "quebec", "romeo", "sierra", "tango", "uniform",
+      "victor", "whiskey", "xray", "yankee", "zulu"};
+  char number[16];
+  std::snprintf(number, sizeof(number), "%08u,",
+                static_cast<unsigned>(rng() % 100000000));
+  std::string record(number);
+  for (int w = 0; w < 8; ++w) {
+    record += kWords[rng() % (sizeof(kWords) / sizeof(kWords[0]))];
+    record += w < 7 ? ' ' : ',';
+  }
+  return record;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const PageId num_pages = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1024;
+  const unsigned rounds = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 5;
+  if (num_pages <= kFrames || rounds == 0) {
+    std::cerr << "Usage: " << argv[0] << " [pages > " << kFrames
+              << "] [rounds]\n";
+    return 1;
+  }
+
+  std::printf("%u pages of ASCII records, %u frames\n", num_pages, kFrames);
+  std::printf("  %-12s %14s %10s %12s %16s\n", "format", "bytes on disk",
+              "ratio", "write s", "cold reads/s");
+  double plain_bytes = 0;
+  for (int compressed = 0; compressed <= 1; ++compressed) {
+    try {
+      File::remove(kFilename);
+    } catch (FileNotFoundException&) {
+    }
+    std::vector<PageId> page_numbers;
+    double write_secs;
+    double bytes;
+    {
+      File file = compressed ? File::createCompressed(kFilename)
+                             : File::create(kFilename);
+      BufMgr buf_mgr(kFrames);
+      std::mt19937 rng(7);
+      const auto start = std::chrono::steady_clock::now();
+      for (PageId i = 0; i < num_pages; ++i) {
+        PageId page_number;
+        Page* page;
+        buf_mgr.allocPage(&file, page_number, page);
+        std::string record = makeRecord(rng);
+        while (page->hasSpaceForRecord(record)) {
+          page->insertRecord(record);
+          record = makeRecord(rng);
+        }
+        buf_mgr.unPinPage(&file, page_number, true);
+        page_numbers.push_back(page_number);
+      }
+      buf_mgr.flushFile(&file);
+      file.sync();
+      write_secs = since(start);
+      struct stat status;
+      ::stat(kFilename, &status);
+      bytes = static_cast<double>(status.st_size);
+    }
+    if (!compressed) {
+      plain_bytes = bytes;
+    }
+
+    double read_secs = 0;
+    for (unsigned r = 0; r < rounds; ++r) {
+      dropFromPageCache();
+      File file = File::open(kFilename);
+      BufMgr buf_mgr(kFrames);
+      const auto start = std::chrono::steady_clock::now();
+      for (std::size_t p = 0; p < page_numbers.size(); ++p) {
+        Page* page;
+        buf_mgr.readPage(&file, page_numbers[p], page);
+        buf_mgr.unPinPage(&file, page_numbers[p], false);
+      }
+      read_secs += since(start);
+    }
+    std::printf("  %-12s %14.0f %10.2f %12.3f %16.0f\n",
+                compressed ? "compressed" : "plain", bytes, plain_bytes / bytes,
+                write_secs, rounds * page_numbers.size() / read_secs);
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * Coroutine fetch benchmark.  Reads random pages of a file once with a
+ * blocking BufMgr::readPage() loop and once from many C++20 coroutines
+ * awaiting BufMgr::fetchAsync() on one thread, with a scheduler loop calling
+ * BufMgr::pollFetches(), and reports pages read per second for every number
+ * of coroutines.  With "cold", the file is dropped from the OS page cache
+ * before every measurement.
+ *
+ * Build with "make bench" from the top-level directory (needs a C++20
+ * compiler), then run:
+ *   $ ./src/fetch_bench [pages] [reads] [cold]
+ */
+
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kFilename = "fetch_bench.db";
+
+/**
+ * Frames of the measured buffer pools: enough for every coroutine to hold a
+ * page while the others wait for theirs.
+ */
+const std::uint32_t kFrames = 256;
+
+/**
+ * Coroutine started right away and destroyed when it finishes; nothing waits
+ * for it.
+ */
+struct Task {
+  struct promise_type {
+    Task get_return_object() { return Task(); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+/**
+ * Fetches every <step>th page of <pages>, starting at <first>.
+ */
+Task worker(BufMgr& buf_mgr, File* file, const std::vector<PageId>& pages,
+            const std::size_t first, const std::size_t step,
+            std::uint64_t& checksum) {
+  for (std::size_t i = first; i < pages.size(); i += step) {
+    PageGuard page = co_await buf_mgr.fetchAsync(file, pages[i]);
+    checksum += page->page_number();
+  }
+}
+
+void dropFromPageCache() {
+  const int fd = ::open(kFilename, O_RDONLY);
+  if (fd >= 0) {
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+void report(const char* name, const unsigned coroutines,
+            const std::size_t reads, const double secs) {
+  std::printf("  %-12s %10u %12.0f\n", name, coroutines, reads / secs);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const PageId num_pages = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 2000;
+  const std::uint32_t num_reads =
+      argc > 2 ? std::strtoul(argv[2], NULL, 10) : 20000;
+  const bool cold = argc > 3 && std::strcmp(argv[3], "cold") == 0;
+  if (num_pages <= kFrames || num_reads == 0) {
+    std::cerr << "Usage: " << argv[0] << " [pages > " << kFrames
+              << "] [reads] [cold]\n";
+    return 1;
+  }
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    {
+      BufMgr loader(64);
+      for (PageId i = 0; i < num_pages; ++i) {
+        PageId page_number;
+        Page* page;
+        loader.allocPage(&file, page_number, page);
+        loader.unPinPage(&file, page_number, true);
+      }
+    }
+
+    std::mt19937 rng(42);
+    std::vector<PageId> pages(num_reads);
+    for (std::uint32_t i = 0; i < num_reads; ++i) {
+      pages[i] = 1 + rng() % num_pages;
+    }
+
+    std::printf("Random reads of %u pages from a %u page file (%s cache)\n",
+                num_reads, num_pages, cold ? "cold" : "warm");
+    std::printf("  %-12s %10s %12s\n", "mode", "coroutines", "pages/s");
+
+    {
+      BufMgr buf_mgr(kFrames);
+      if (cold) {
+        dropFromPageCache();
+      }
+      const auto start = std::chrono::steady_clock::now();
+      for (std::uint32_t i = 0; i < num_reads; ++i) {
+        Page* page;
+        buf_mgr.readPage(&file, pages[i], page);
+        buf_mgr.unPinPage(&file, pages[i], false);
+      }
+      report("readPage", 1, num_reads,
+             std::chrono::duration<double>(
+                 std::chrono::steady_clock::now() - start).count());
+    }
+
+    const unsigned counts[] = {1, 4, 16, 64};
+    for (std::size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+      BufMgr buf_mgr(kFrames);
+      buf_mgr.enableAsyncIo(counts[c]);
+      std::uint64_t checksum = 0;
+      if (cold) {
+        dropFromPageCache();
+      }
+      const auto start = std::chrono::steady_clock::now();
+      for (unsigned w = 0; w < counts[c]; ++w) {
+        worker(buf_mgr, &file, pages, w, counts[c], checksum);
+      }
+      // Scheduler loop: resume coroutines as their reads finish.
+      while (buf_mgr.pendingFetches() > 0) {
+        buf_mgr.pollFetches(true);
+      }
+      report("fetchAsync", counts[c], num_reads,
+             std::chrono::duration<double>(
+                 std::chrono::steady_clock::now() - start).count());
+    }
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * Write-back throughput benchmark.  Dirties every page of a file in the buffer
+ * pool and measures how fast the pages reach the disk, once through a
+ * page-at-a-time File::writePage() loop (the way flushFile() used to work) and
+ * once through BufMgr::flushFile(), which sorts and coalesces the writes.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/flush_bench [pages] [dirty-percent]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kFilename = "flush_bench.db";
+
+/**
+ * Pins every page of the file, inserts a record into the chosen ones and
+ * unpins them dirty.  Returns the numbers of the dirtied pages.
+ */
+std::vector<PageId> dirtyPages(BufMgr& buf_mgr, File& file,
+                               const PageId num_pages, const int percent,
+                               std::mt19937& rng) {
+  std::vector<PageId> dirtied;
+  for (PageId page_number = 1; page_number <= num_pages; ++page_number) {
+    const bool dirty = static_cast<int>(rng() % 100) < percent;
+    Page* page;
+    buf_mgr.readPage(&file, page_number, page);
+    if (dirty) {
+      page->insertRecord("flush benchmark record");
+      dirtied.push_back(page_number);
+    }
+    buf_mgr.unPinPage(&file, page_number, dirty);
+  }
+  return dirtied;
+}
+
+void report(const char* name, const std::size_t pages, const double secs) {
+  const double mb = pages * static_cast<double>(Page::SIZE) / (1024 * 1024);
+  std::printf("  %-28s %8zu pages %9.3f s %10.1f MB/s\n", name, pages, secs,
+              secs > 0 ? mb / secs : 0.0);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const PageId num_pages = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 2000;
+  const int percent = argc > 2 ? std::atoi(argv[2]) : 100;
+  if (num_pages == 0 || percent <= 0 || percent > 100) {
+    std::cerr << "Usage: " << argv[0] << " [pages] [dirty-percent]\n";
+    return 1;
+  }
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    BufMgr buf_mgr(num_pages);
+    std::mt19937 rng(42);
+
+    for (PageId i = 0; i < num_pages; ++i) {
+      PageId page_number;
+      Page* page;
+      buf_mgr.allocPage(&file, page_number, page);
+      buf_mgr.unPinPage(&file, page_number, true);
+    }
+    buf_mgr.flushFile(&file);
+
+    std::cout << "Flushing " << percent << "% of " << num_pages << " pages ("
+              << num_pages * (Page::SIZE / 1024) << " KB file)\n";
+
+    // Page at a time, in frame order, each write followed by a flush.
+    std::vector<PageId> dirtied =
+        dirtyPages(buf_mgr, file, num_pages, percent, rng);
+    std::shuffle(dirtied.begin(), dirtied.end(), rng);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < dirtied.size(); ++i) {
+      Page* page;
+      buf_mgr.readPage(&file, dirtied[i], page);
+      file.writePage(*page);
+      buf_mgr.unPinPage(&file, dirtied[i], false);
+    }
+    file.sync();
+    report("File::writePage per page", dirtied.size(),
+           std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start).count());
+    buf_mgr.flushFile(&file);
+
+    // Grouped write-back.
+    dirtied = dirtyPages(buf_mgr, file, num_pages, percent, rng);
+    start = std::chrono::steady_clock::now();
+    buf_mgr.flushFile(&file);
+    report("BufMgr::flushFile", dirtied.size(),
+           std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start).count());
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
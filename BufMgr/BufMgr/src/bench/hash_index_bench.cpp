@@ -0,0 +1,205 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * Hash index benchmark.  Stores records with random integer keys in a heap
+ * file, indexes them with a HashIndex and a bulk loaded BTreeIndex, then
+ * looks random keys up three ways: through the hash index, through the
+ * B+tree, and by scanning the heap file for the record.  Each is run with a
+ * pool holding everything and with a small pool over files bypassing the OS
+ * page cache (CACHE_DIRECT).  Reported are the lookups per second, and the
+ * pages pinned and read from disk per lookup.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/hash_index_bench [keys] [lookups] [small pool frames]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "btree.h"
+#include "buffer.h"
+#include "file.h"
+#include "file_iterator.h"
+#include "hash_index.h"
+#include "page.h"
+#include "page_iterator.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kHeapName = "hash_index_bench_heap.db";
+const char* const kHashName = "hash_index_bench_hash.db";
+const char* const kTreeName = "hash_index_bench_tree.db";
+
+double since(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+void removeFile(const char* name) {
+  try {
+    File::remove(name);
+  } catch (FileNotFoundException&) {
+  }
+}
+
+std::string makeRecord(const std::int64_t key) {
+  char record[64];
+  std::snprintf(record, sizeof(record), "%lld,payload of the record",
+                static_cast<long long>(key));
+  return record;
+}
+
+/**
+ * Finds the page holding the record of a key by reading every page of the
+ * heap file.
+ */
+bool scanFor(BufMgr& buf_mgr, File& heap, const std::vector<PageId>& pages,
+             const std::int64_t key, PageId& page_number) {
+  char prefix[32];
+  const int length = std::snprintf(prefix, sizeof(prefix), "%lld,",
+                                   static_cast<long long>(key));
+  for (std::size_t p = 0; p < pages.size(); ++p) {
+    PageGuard page = buf_mgr.fetch(&heap, pages[p]);
+    for (PageIterator it = page->begin(); it != page->end(); ++it) {
+      if ((*it).compare(0, length, prefix) == 0) {
+        page_number = pages[p];
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t num_keys =
+      argc > 1 ? std::strtoul(argv[1], NULL, 10) : 100000;
+  const unsigned long lookups =
+      argc > 2 ? std::strtoul(argv[2], NULL, 10) : 100000;
+  const std::uint32_t small_frames =
+      argc > 3 ? std::strtoul(argv[3], NULL, 10) : 64;
+  if (num_keys == 0 || lookups == 0 || small_frames < 8) {
+    std::cerr << "Usage: " << argv[0]
+              << " [keys > 0] [lookups > 0] [small pool frames >= 8]\n";
+    return 1;
+  }
+  removeFile(kHeapName);
+  removeFile(kHashName);
+  removeFile(kTreeName);
+
+  std::mt19937_64 rng(3);
+  std::vector<std::int64_t> keys(num_keys);
+  std::vector<PageId> heap_pages;
+  std::mutex mutex;
+  {
+    File heap = File::create(kHeapName);
+    File hash_file = File::create(kHashName);
+    File tree_file = File::create(kTreeName);
+    BufMgr buf_mgr(8192);
+    HashIndex hash(buf_mgr, &hash_file, HASH_INT_KEYS);
+    std::vector<std::pair<std::int64_t, RecordId> > entries;
+    PageGuard page;
+    for (std::size_t k = 0; k < num_keys; ++k) {
+      keys[k] = static_cast<std::int64_t>(rng() >> 1);
+      const std::string record = makeRecord(keys[k]);
+      if (!page || !page->hasSpaceForRecord(record)) {
+        page = buf_mgr.allocate(&heap);
+        page.markDirty();
+        heap_pages.push_back(page.page_number());
+      }
+      const RecordId rid = page->insertRecord(record);
+      hash.insert(keys[k], rid);
+      entries.push_back(std::make_pair(keys[k], rid));
+    }
+    page.release();
+    std::sort(entries.begin(), entries.end(),
+              [](const std::pair<std::int64_t, RecordId>& a,
+                 const std::pair<std::int64_t, RecordId>& b) {
+                return a.first < b.first;
+              });
+    BTreeIndex tree(buf_mgr, &tree_file, mutex, BTREE_INT_KEYS);
+    tree.bulkLoad(entries);
+    std::printf("%zu keys: heap file of %zu pages, hash index of global "
+                "depth %u, B+tree of height %u\n", num_keys,
+                heap_pages.size(), hash.globalDepth(), tree.height());
+    buf_mgr.flushFile(&heap);
+    buf_mgr.flushFile(&hash_file);
+    buf_mgr.flushFile(&tree_file);
+  }
+
+  std::printf("  %-12s %-8s %14s %14s %14s\n", "lookup", "pool",
+              "lookups/s", "pins/lookup", "reads/lookup");
+  for (int pool = 0; pool < 2; ++pool) {
+    File heap = File::open(kHeapName);
+    File hash_file = File::open(kHashName);
+    File tree_file = File::open(kTreeName);
+    if (pool == 1) {
+      heap.setCacheMode(File::CACHE_DIRECT);
+      hash_file.setCacheMode(File::CACHE_DIRECT);
+      tree_file.setCacheMode(File::CACHE_DIRECT);
+    }
+    BufMgr buf_mgr(pool == 0 ? 8192 : small_frames);
+    HashIndex hash(buf_mgr, &hash_file, HASH_INT_KEYS);
+    BTreeIndex tree(buf_mgr, &tree_file, mutex, BTREE_INT_KEYS);
+    for (int method = 0; method < 3; ++method) {
+      // Scans read the whole heap file, so far fewer of them are run
+      const unsigned long count =
+          method == 2 ? std::max(1ul, lookups / 10000) : lookups;
+      std::mt19937 pick(23);
+      // Warm the pool up with a first round
+      for (int round = 0; round < 2; ++round) {
+        buf_mgr.clearBufStats();
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned long l = 0; l < count; ++l) {
+          const std::int64_t key = keys[pick() % num_keys];
+          RecordId rid;
+          bool found;
+          if (method == 0) {
+            found = hash.lookup(key, rid);
+          } else if (method == 1) {
+            found = tree.lookup(key, rid);
+          } else {
+            found = scanFor(buf_mgr, heap, heap_pages, key, rid.page_number);
+          }
+          if (!found) {
+            std::fprintf(stderr, "key %lld not found\n",
+                         static_cast<long long>(key));
+            return 1;
+          }
+        }
+        if (round == 1) {
+          const double time = since(start);
+          const BufStats& stats = buf_mgr.getBufStats();
+          static const char* const kMethods[] = {"hash index", "B+tree",
+                                                 "heap scan"};
+          std::printf("  %-12s %-8s %14.0f %14.2f %14.3f\n", kMethods[method],
+                      pool == 0 ? "large" : "small", count / time,
+                      double(stats.accesses) / count,
+                      double(stats.diskreads) / count);
+        }
+      }
+    }
+    buf_mgr.flushFile(&heap);
+    buf_mgr.flushFile(&hash_file);
+    buf_mgr.flushFile(&tree_file);
+  }
+
+  File::remove(kHeapName);
+  File::remove(kHashName);
+  File::remove(kTreeName);
+  return 0;
+}
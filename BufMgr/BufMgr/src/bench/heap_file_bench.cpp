@@ -0,0 +1,160 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * Free space map benchmark.  Inserts records of random sizes, deletes a
+ * share of them at random, then inserts as many again, three ways: with a
+ * HeapFile, finding a page with room from its free space map; by trying
+ * every page of the file in turn with Page::hasSpaceForRecord() (first
+ * fit); and by appending to the last page, allocating a new one when it is
+ * full.  Reported are the inserts per second and pages pinned per insert of
+ * the second round of inserts, and the pages holding records at the end.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/heap_file_bench [records] [deleted %]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "heap_file.h"
+#include "page.h"
+#include "page_guard.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kFilename = "heap_file_bench.db";
+
+double since(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+/**
+ * Stores records the way callers do without a free space map.
+ */
+class PlainHeap {
+ public:
+  PlainHeap(BufMgr& buf_mgr, File* file, const bool first_fit)
+      : buf_mgr_(buf_mgr), file_(file), first_fit_(first_fit) {}
+
+  RecordId insertRecord(const std::string& record) {
+    if (first_fit_) {
+      for (std::size_t p = 0; p < pages_.size(); ++p) {
+        PageGuard page = buf_mgr_.fetch(file_, pages_[p]);
+        if (page->hasSpaceForRecord(record)) {
+          page.markDirty();
+          return page->insertRecord(record);
+        }
+      }
+    } else if (!pages_.empty()) {
+      PageGuard page = buf_mgr_.fetch(file_, pages_.back());
+      if (page->hasSpaceForRecord(record)) {
+        page.markDirty();
+        return page->insertRecord(record);
+      }
+    }
+    PageGuard page = buf_mgr_.allocate(file_);
+    pages_.push_back(page.page_number());
+    page.markDirty();
+    return page->insertRecord(record);
+  }
+
+  void deleteRecord(const RecordId& rid) {
+    PageGuard page = buf_mgr_.fetch(file_, rid.page_number);
+    page->deleteRecord(rid);
+    page.markDirty();
+  }
+
+  std::size_t numDataPages() const { return pages_.size(); }
+
+ private:
+  BufMgr& buf_mgr_;
+  File* file_;
+  const bool first_fit_;
+  std::vector<PageId> pages_;
+};
+
+template <typename Heap>
+void run(const char* name, Heap& heap, BufMgr& buf_mgr,
+         const std::size_t records, const unsigned deleted_percent) {
+  std::mt19937 rng(29);
+  std::vector<RecordId> rids;
+  std::size_t live_bytes = 0;
+  std::vector<std::size_t> sizes;
+  for (std::size_t r = 0; r < records; ++r) {
+    const std::size_t size = 20 + rng() % 381;
+    rids.push_back(heap.insertRecord(std::string(size, 'a' + r % 26)));
+    sizes.push_back(size);
+    live_bytes += size;
+  }
+  for (std::size_t r = 0; r < records; ++r) {
+    if (rng() % 100 < deleted_percent) {
+      heap.deleteRecord(rids[r]);
+      live_bytes -= sizes[r];
+    }
+  }
+
+  buf_mgr.clearBufStats();
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t r = 0; r < records; ++r) {
+    const std::size_t size = 20 + rng() % 381;
+    heap.insertRecord(std::string(size, 'A' + r % 26));
+    live_bytes += size;
+  }
+  const double time = since(start);
+  const std::size_t pages = heap.numDataPages();
+  std::printf("  %-22s %12.0f %14.1f %10zu %9.1f%%\n", name, records / time,
+              double(buf_mgr.getBufStats().accesses) / records, pages,
+              100.0 * live_bytes / (pages * double(Page::DATA_SIZE)));
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t records =
+      argc > 1 ? std::strtoul(argv[1], NULL, 10) : 20000;
+  const unsigned deleted_percent =
+      argc > 2 ? std::strtoul(argv[2], NULL, 10) : 40;
+  if (records == 0 || deleted_percent > 100) {
+    std::cerr << "Usage: " << argv[0] << " [records > 0] [deleted % <= 100]\n";
+    return 1;
+  }
+
+  std::printf("%zu records of 20 to 400 bytes, %u%% deleted, %zu more "
+              "inserted\n", records, deleted_percent, records);
+  std::printf("  %-22s %12s %14s %10s %10s\n", "placement", "inserts/s",
+              "pins/insert", "pages", "fill");
+  for (int setup = 0; setup < 3; ++setup) {
+    try {
+      File::remove(kFilename);
+    } catch (FileNotFoundException&) {
+    }
+    File file = File::create(kFilename);
+    // Holds the whole file, so the scans cost CPU rather than I/O
+    BufMgr buf_mgr(4096);
+    if (setup == 0) {
+      HeapFile heap(buf_mgr, &file);
+      run("free space map", heap, buf_mgr, records, deleted_percent);
+    } else {
+      PlainHeap heap(buf_mgr, &file, setup == 1);
+      run(setup == 1 ? "first fit scan" : "append to last page", heap,
+          buf_mgr, records, deleted_percent);
+    }
+    buf_mgr.flushFile(&file);
+  }
+  File::remove(kFilename);
+  return 0;
+}
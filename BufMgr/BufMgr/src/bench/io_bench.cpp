@@ -0,0 +1,132 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * Queue depth scaling benchmark for the asynchronous I/O backend.  Reads
+ * random pages through BufMgr::readPages() in batches as large as the queue
+ * depth, once with io_uring and once with the preadv/pwritev fallback, and
+ * reports pages read per second for every depth.  With "cold", the file is
+ * dropped from the OS page cache before every measurement.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/io_bench [pages] [reads] [cold]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "async_io.h"
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kFilename = "io_bench.db";
+
+void dropFromPageCache() {
+  const int fd = ::open(kFilename, O_RDONLY);
+  if (fd >= 0) {
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const PageId num_pages = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 2000;
+  const std::uint32_t num_reads =
+      argc > 2 ? std::strtoul(argv[2], NULL, 10) : 50000;
+  const bool cold = argc > 3 && std::strcmp(argv[3], "cold") == 0;
+  if (num_pages < 128 || num_reads == 0) {
+    std::cerr << "Usage: " << argv[0] << " [pages >= 128] [reads] [cold]\n";
+    return 1;
+  }
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    {
+      BufMgr loader(64);
+      for (PageId i = 0; i < num_pages; ++i) {
+        PageId page_number;
+        Page* page;
+        loader.allocPage(&file, page_number, page);
+        loader.unPinPage(&file, page_number, true);
+      }
+    }
+
+    const unsigned depths[] = {1, 2, 4, 8, 16, 32, 64};
+    std::printf("Random reads of %u pages from a %u page file (%s cache)\n",
+                num_reads, num_pages, cold ? "cold" : "warm");
+    std::printf("  %-10s %6s %12s %10s\n", "backend", "depth", "pages/s",
+                "MB/s");
+    for (int uring = 1; uring >= 0; --uring) {
+      for (std::size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); ++d) {
+        const unsigned depth = depths[d];
+        BufMgr buf_mgr(depth);
+        buf_mgr.enableAsyncIo(depth, uring == 1);
+        AsyncIo probe(depth, uring == 1);
+        if (uring == 1 && !probe.usingIoUring()) {
+          std::printf("  io_uring not available, skipped\n");
+          break;
+        }
+
+        // Distinct random pages per batch, so every read goes to the file.
+        std::mt19937 rng(depth);
+        std::vector<PageId> all(num_pages);
+        for (PageId i = 0; i < num_pages; ++i) {
+          all[i] = i + 1;
+        }
+        std::vector<Page*> pages(depth);
+        if (cold) {
+          dropFromPageCache();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        std::uint32_t done = 0;
+        while (done < num_reads) {
+          const std::uint32_t batch = std::min(depth, num_reads - done);
+          std::shuffle(all.begin(), all.begin() + std::min<PageId>(
+              num_pages, batch * 8), rng);
+          std::rotate(all.begin(), all.begin() + batch, all.end());
+          buf_mgr.readPages(&file, &all[num_pages - batch], batch, &pages[0]);
+          for (std::uint32_t i = 0; i < batch; ++i) {
+            buf_mgr.unPinPage(&file, all[num_pages - batch + i], false);
+          }
+          buf_mgr.flushFile(&file);
+          done += batch;
+        }
+        const double secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        std::printf("  %-10s %6u %12.0f %10.1f\n",
+                    uring ? "io_uring" : "preadv", depth, num_reads / secs,
+                    num_reads * static_cast<double>(Page::SIZE) /
+                        (1024 * 1024) / secs);
+      }
+    }
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
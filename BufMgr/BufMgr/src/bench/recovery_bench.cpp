@@ -0,0 +1,150 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * Restart recovery benchmark.  Inserts records into random pages of a file
+ * through the write-ahead log, then puts back the file as it was before the
+ * inserts (as if the buffer pool had been lost in a crash) and times
+ * Recovery::run() redoing the log with 1, 2, 4 and 8 redo threads.  With
+ * "cold", the file is dropped from the OS page cache before every run.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/recovery_bench [pages] [inserts] [cold]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "recovery.h"
+#include "wal.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kFilename = "recovery_bench.db";
+const char* const kSnapshot = "recovery_bench.db.snapshot";
+const char* const kLogname = "recovery_bench.wal";
+
+/**
+ * Inserts per transaction.
+ */
+const std::uint32_t kTxnSize = 100;
+
+void copyFile(const char* from, const char* to) {
+  std::ifstream in(from, std::ios::binary);
+  std::ofstream out(to, std::ios::binary | std::ios::trunc);
+  out << in.rdbuf();
+}
+
+void dropFromPageCache() {
+  const int fd = ::open(kFilename, O_RDONLY);
+  if (fd >= 0) {
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const PageId num_pages = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 4000;
+  const std::uint32_t num_inserts =
+      argc > 2 ? std::strtoul(argv[2], NULL, 10) : 100000;
+  const bool cold = argc > 3 && std::strcmp(argv[3], "cold") == 0;
+  if (num_pages == 0 || num_inserts == 0) {
+    std::cerr << "Usage: " << argv[0] << " [pages] [inserts] [cold]\n";
+    return 1;
+  }
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+  std::remove(kLogname);
+
+  {
+    File file = File::create(kFilename);
+    {
+      BufMgr loader(64);
+      for (PageId i = 0; i < num_pages; ++i) {
+        PageId page_number;
+        Page* page;
+        loader.allocPage(&file, page_number, page);
+        loader.unPinPage(&file, page_number, true);
+      }
+    }
+    copyFile(kFilename, kSnapshot);
+
+    Wal wal(kLogname);
+    BufMgr buf_mgr(256);
+    buf_mgr.attachWal(&wal);
+    std::mt19937 rng(42);
+    const std::string record(64, 'r');
+    TxnId txn = wal.begin();
+    for (std::uint32_t i = 0; i < num_inserts; ++i) {
+      const PageId page_number = 1 + rng() % num_pages;
+      Page* page;
+      buf_mgr.readPage(&file, page_number, page);
+      if (page->hasSpaceForRecord(record)) {
+        wal.insertRecord(txn, &file, page, record);
+      }
+      buf_mgr.unPinPage(&file, page_number, true);
+      if ((i + 1) % kTxnSize == 0) {
+        wal.commit(txn);
+        txn = wal.begin();
+      }
+    }
+    wal.commit(txn);
+    buf_mgr.flushFile(&file);
+    std::printf("%u inserts into %u pages, %llu bytes of log\n", num_inserts,
+                num_pages,
+                static_cast<unsigned long long>(wal.stats().bytes));
+  }
+
+  std::printf("  %8s %10s %10s %12s\n", "threads", "pages", "redone",
+              "seconds");
+  const unsigned counts[] = {1, 2, 4, 8};
+  for (std::size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+    copyFile(kSnapshot, kFilename);
+    if (cold) {
+      dropFromPageCache();
+    }
+    Wal wal(kLogname);
+    BufMgr buf_mgr(1024);
+    buf_mgr.enableAsyncIo(64);
+    buf_mgr.attachWal(&wal);
+    const auto start = std::chrono::steady_clock::now();
+    RecoveryStats stats;
+    {
+      Recovery recovery(wal, buf_mgr);
+      stats = recovery.run(counts[c]);
+    }
+    const double secs = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    std::printf("  %8u %10llu %10llu %12.3f\n", stats.threads,
+                static_cast<unsigned long long>(stats.pages),
+                static_cast<unsigned long long>(stats.redone), secs);
+  }
+
+  File::remove(kFilename);
+  std::remove(kSnapshot);
+  std::remove(kLogname);
+  return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * SSD cache benchmark.  Fills a data file with pages of ASCII records, then
+ * reads random pages of it, with a skew towards a hot set larger than the
+ * buffer pool, with the data file bypassing the OS page cache (CACHE_DIRECT).
+ * Compares the pool alone with the pool backed by an SSD cache file
+ * (BufMgr::attachSsdCache()) in another directory, meant to be on a faster
+ * device than the data file, and reports the reads left for the data file,
+ * the pages read from and written to the cache, and the read throughput.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/ssd_cache_bench [data dir] [cache dir] [pages] [frames]
+ *                           [cache pages] [reads]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "ssd_cache.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+double since(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+/**
+ * Record of a few random words, like the rows of a table of text.
+ */
+std::string makeRecord(std::mt19937& rng) {
+  static const char* const kWords[] = {
+      "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf",
+      "hotel", "india", "juliet", "kilo", "lima", "mike", "november",
+      "oscar", "papa", "quebec", "romeo", "sierra", "tango", "uniform",
+      "victor", "whiskey", "xray", "yankee", "zulu"};
+  char number[16];
+  std::snprintf(number, sizeof(number), "%08u,",
+                static_cast<unsigned>(rng() % 100000000));
+  std::string record(number);
+  for (int w = 0; w < 8; ++w) {
+    record += kWords[rng() % (sizeof(kWords) / sizeof(kWords[0]))];
+    record += w < 7 ? ' ' : ',';
+  }
+  return record;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const std::string data_dir = argc > 1 ? argv[1] : ".";
+  const std::string cache_dir = argc > 2 ? argv[2] : ".";
+  const PageId num_pages = argc > 3 ? std::strtoul(argv[3], NULL, 10) : 4096;
+  const std::uint32_t frames =
+      argc > 4 ? std::strtoul(argv[4], NULL, 10) : 128;
+  const std::uint32_t cache_pages =
+      argc > 5 ? std::strtoul(argv[5], NULL, 10) : 2048;
+  const unsigned long reads =
+      argc > 6 ? std::strtoul(argv[6], NULL, 10) : 50000;
+  if (num_pages <= frames || frames == 0 || cache_pages < 2) {
+    std::cerr << "Usage: " << argv[0] << " [data dir] [cache dir] [pages] "
+              << "[frames < pages] [cache pages >= 2] [reads]\n";
+    return 1;
+  }
+  const std::string data_name = data_dir + "/ssd_cache_bench.db";
+  const std::string cache_name = cache_dir + "/ssd_cache_bench.cache";
+
+  try {
+    File::remove(data_name);
+  } catch (FileNotFoundException&) {
+  }
+  std::vector<PageId> page_numbers;
+  {
+    File file = File::create(data_name);
+    BufMgr buf_mgr(frames);
+    std::mt19937 rng(7);
+    for (PageId i = 0; i < num_pages; ++i) {
+      PageId page_number;
+      Page* page;
+      buf_mgr.allocPage(&file, page_number, page);
+      std::string record = makeRecord(rng);
+      while (page->hasSpaceForRecord(record)) {
+        page->insertRecord(record);
+        record = makeRecord(rng);
+      }
+      buf_mgr.unPinPage(&file, page_number, true);
+      page_numbers.push_back(page_number);
+    }
+    buf_mgr.flushFile(&file);
+  }
+
+  // 90% of the reads go to a hot set of a quarter of the pages
+  const std::size_t hot = page_numbers.size() / 4;
+  std::printf("%u pages (hot set %zu), %u frames, %u cache pages, %lu reads\n",
+              num_pages, hot, frames, cache_pages, reads);
+  std::printf("  %-20s %12s %12s %12s %14s\n", "setup", "data reads",
+              "cache hits", "cache writes", "reads/s");
+  for (int setup = 0; setup < 2; ++setup) {
+    File file = File::open(data_name);
+    file.setCacheMode(File::CACHE_DIRECT);
+    SsdCache* cache = NULL;
+    BufMgr buf_mgr(frames);
+    if (setup == 1) {
+      cache = new SsdCache(cache_name, cache_pages);
+      buf_mgr.attachSsdCache(cache);
+    }
+    std::mt19937 rng(11);
+    // Warm up the pool and the cache, then measure
+    for (int phase = 0; phase < 2; ++phase) {
+      buf_mgr.clearBufStats();
+      const std::uint64_t writes_before = cache ? cache->stats().writes : 0;
+      const auto start = std::chrono::steady_clock::now();
+      for (unsigned long r = 0; r < reads; ++r) {
+        const std::size_t p = rng() % 10 < 9 ? rng() % hot
+                                             : rng() % page_numbers.size();
+        Page* page;
+        buf_mgr.readPage(&file, page_numbers[p], page);
+        buf_mgr.unPinPage(&file, page_numbers[p], false);
+      }
+      if (phase == 1) {
+        const BufStats& stats = buf_mgr.getBufStats();
+        const std::uint64_t writes =
+            cache ? cache->stats().writes - writes_before : 0;
+        std::printf("  %-20s %12d %12d %12llu %14.0f\n",
+                    cache ? "pool + SSD cache" : "pool", stats.diskreads,
+                    stats.ssdhits, static_cast<unsigned long long>(writes),
+                    reads / since(start));
+      }
+    }
+    buf_mgr.flushFile(&file);
+    buf_mgr.attachSsdCache(NULL);
+    delete cache;
+  }
+
+  File::remove(data_name);
+  return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * TLB benchmark for the buffer pool memory.  Fills a buffer pool with every
+ * page of a file, then times random BufMgr::readPage() hits, once for every
+ * page size the pool memory can be backed with.  Where the kernel lets us,
+ * dTLB load misses are counted with perf_event_open(2) as well.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/tlb_bench [pages] [lookups]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "pool_memory.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kFilename = "tlb_bench.db";
+
+const char* pageSizeName(const PoolPageSize page_size) {
+  switch (page_size) {
+    case POOL_SMALL_PAGES:
+      return "small";
+    case POOL_TRANSPARENT_HUGE_PAGES:
+      return "transparent";
+    case POOL_HUGE_PAGES_2MB:
+      return "hugetlb 2MB";
+    case POOL_HUGE_PAGES_1GB:
+      return "hugetlb 1GB";
+  }
+  return "?";
+}
+
+/**
+ * Counter of dTLB load misses of this thread in user space, if available.
+ */
+class TlbMissCounter {
+ public:
+  TlbMissCounter() {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(
+        ::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+  ~TlbMissCounter() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  bool available() const { return fd_ >= 0; }
+
+  void start() {
+    if (fd_ >= 0) {
+      ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  std::uint64_t stop() {
+    std::uint64_t count = 0;
+    if (fd_ >= 0) {
+      ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (::read(fd_, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+    return count;
+  }
+
+ private:
+  int fd_;
+};
+
+}
+
+int main(int argc, char* argv[]) {
+  const PageId num_pages = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 2000;
+  const std::uint32_t num_lookups =
+      argc > 2 ? std::strtoul(argv[2], NULL, 10) : 2000000;
+  if (num_pages == 0 || num_lookups == 0) {
+    std::cerr << "Usage: " << argv[0] << " [pages] [lookups]\n";
+    return 1;
+  }
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    {
+      BufMgr loader(64);
+      for (PageId i = 0; i < num_pages; ++i) {
+        PageId page_number;
+        Page* page;
+        loader.allocPage(&file, page_number, page);
+        loader.unPinPage(&file, page_number, true);
+      }
+    }
+
+    std::vector<PageId> lookups(num_lookups);
+    std::mt19937 rng(7);
+    for (std::uint32_t i = 0; i < num_lookups; ++i) {
+      lookups[i] = rng() % num_pages + 1;
+    }
+
+    TlbMissCounter counter;
+    std::printf("Random readPage() hits on a %u page (%u MB) pool\n",
+                num_pages, static_cast<unsigned>(
+                    num_pages * (Page::SIZE / 1024) / 1024));
+    std::printf("  %-12s %-12s %12s %16s\n", "requested", "backing",
+                "ns/lookup", "dTLB miss/lookup");
+    const PoolPageSize sizes[] = {POOL_SMALL_PAGES,
+                                  POOL_TRANSPARENT_HUGE_PAGES,
+                                  POOL_HUGE_PAGES_2MB, POOL_HUGE_PAGES_1GB};
+    for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+      BufMgr buf_mgr(num_pages, sizes[s]);
+      for (PageId i = 1; i <= num_pages; ++i) {
+        Page* page;
+        buf_mgr.readPage(&file, i, page);
+        buf_mgr.unPinPage(&file, i, false);
+      }
+
+      PageId checksum = 0;
+      counter.start();
+      const auto start = std::chrono::steady_clock::now();
+      for (std::uint32_t i = 0; i < num_lookups; ++i) {
+        Page* page;
+        buf_mgr.readPage(&file, lookups[i], page);
+        checksum += page->page_number();
+        buf_mgr.unPinPage(&file, lookups[i], false);
+      }
+      const double secs = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
+      const std::uint64_t misses = counter.stop();
+      if (checksum == 0) {
+        std::printf("  (checksum %u)\n", checksum);
+      }
+
+      char miss_text[32] = "n/a";
+      if (counter.available()) {
+        std::snprintf(miss_text, sizeof(miss_text), "%.3f",
+                      misses / static_cast<double>(num_lookups));
+      }
+      std::printf("  %-12s %-12s %12.1f %16s\n", pageSizeName(sizes[s]),
+                  pageSizeName(buf_mgr.poolPageSize()),
+                  secs * 1e9 / num_lookups, miss_text);
+    }
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
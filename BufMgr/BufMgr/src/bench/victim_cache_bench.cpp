@@ -0,0 +1,159 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * Victim cache benchmark.  Fills a file with pages of ASCII records, then
+ * reads random pages of it, with a skew towards a hot set larger than the
+ * buffer pool, with the file bypassing the OS page cache (CACHE_DIRECT).
+ * Three setups are compared: the pool alone, the pool plus a victim cache
+ * (BufMgr::enableVictimCache()), and a pool grown by as many frames as the
+ * victim cache's memory would hold uncompressed.  Reported are the share of
+ * the pool's misses served by the victim cache, the disk reads, and the
+ * read throughput.
+ *
+ * Build with "make bench" from the top-level directory, then run:
+ *   $ ./src/victim_cache_bench [pages] [frames] [cache MB] [reads]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const kFilename = "victim_cache_bench.db";
+
+double since(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+/**
+ * Record of a few random words, like the rows of a table of text.
+ */
+std::string makeRecord(std::mt19937& rng) {
+  static const char* const kWords[] = {
+      "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf",
+      "hotel", "india", "juliet", "kilo", "lima", "mike", "november",
+      "oscar", "papa", "quebec", "romeo", "sierra", "tango", "uniform",
+      "victor", "whiskey", "xray", "yankee", "zulu"};
+  char number[16];
+  std::snprintf(number, sizeof(number), "%08u,",
+                static_cast<unsigned>(rng() % 100000000));
+  std::string record(number);
+  for (int w = 0; w < 8; ++w) {
+    record += kWords[rng() % (sizeof(kWords) / sizeof(kWords[0]))];
+    record += w < 7 ? ' ' : ',';
+  }
+  return record;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const PageId num_pages = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 4096;
+  const std::uint32_t frames =
+      argc > 2 ? std::strtoul(argv[2], NULL, 10) : 128;
+  const std::size_t cache_bytes =
+      (argc > 3 ? std::strtoul(argv[3], NULL, 10) : 4) << 20;
+  const unsigned long reads =
+      argc > 4 ? std::strtoul(argv[4], NULL, 10) : 50000;
+  if (num_pages <= frames || frames == 0 || cache_bytes == 0) {
+    std::cerr << "Usage: " << argv[0]
+              << " [pages] [frames < pages] [cache MB > 0] [reads]\n";
+    return 1;
+  }
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+  std::vector<PageId> page_numbers;
+  {
+    File file = File::create(kFilename);
+    BufMgr buf_mgr(frames);
+    std::mt19937 rng(7);
+    for (PageId i = 0; i < num_pages; ++i) {
+      PageId page_number;
+      Page* page;
+      buf_mgr.allocPage(&file, page_number, page);
+      std::string record = makeRecord(rng);
+      while (page->hasSpaceForRecord(record)) {
+        page->insertRecord(record);
+        record = makeRecord(rng);
+      }
+      buf_mgr.unPinPage(&file, page_number, true);
+      page_numbers.push_back(page_number);
+    }
+    buf_mgr.flushFile(&file);
+  }
+
+  // 90% of the reads go to a hot set of a quarter of the pages
+  const std::size_t hot = page_numbers.size() / 4;
+  const std::uint32_t extra_frames =
+      static_cast<std::uint32_t>(cache_bytes / Page::SIZE);
+  std::printf("%u pages (hot set %zu), %u frames, %zu MB victim cache, "
+              "%lu reads\n", num_pages, hot, frames, cache_bytes >> 20, reads);
+  std::printf("  %-24s %12s %12s %14s\n", "setup", "victim hits",
+              "disk reads", "reads/s");
+  for (int setup = 0; setup < 3; ++setup) {
+    File file = File::open(kFilename);
+    file.setCacheMode(File::CACHE_DIRECT);
+    BufMgr buf_mgr(setup == 2 ? frames + extra_frames : frames);
+    if (setup == 1) {
+      buf_mgr.enableVictimCache(cache_bytes);
+    }
+    std::mt19937 rng(11);
+    // Warm up the pool and the cache, then measure
+    for (int phase = 0; phase < 2; ++phase) {
+      buf_mgr.clearBufStats();
+      const auto start = std::chrono::steady_clock::now();
+      for (unsigned long r = 0; r < reads; ++r) {
+        const std::size_t p = rng() % 10 < 9 ? rng() % hot
+                                             : rng() % page_numbers.size();
+        Page* page;
+        buf_mgr.readPage(&file, page_numbers[p], page);
+        buf_mgr.unPinPage(&file, page_numbers[p], false);
+      }
+      if (phase == 1) {
+        const BufStats& stats = buf_mgr.getBufStats();
+        char name[64];
+        if (setup == 0) {
+          std::snprintf(name, sizeof(name), "pool %u", frames);
+        } else if (setup == 1) {
+          std::snprintf(name, sizeof(name), "pool %u + victim cache",
+                        frames);
+        } else {
+          std::snprintf(name, sizeof(name), "pool %u", frames + extra_frames);
+        }
+        const double misses = stats.victimhits + stats.victimmisses;
+        char hits[32];
+        if (misses > 0) {
+          std::snprintf(hits, sizeof(hits), "%.1f%%",
+                        100.0 * stats.victimhits / misses);
+        } else {
+          std::snprintf(hits, sizeof(hits), "-");
+        }
+        std::printf("  %-24s %12s %12d %14.0f\n", name, hits, stats.diskreads,
+                    reads / since(start));
+      }
+    }
+    buf_mgr.flushFile(&file);
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,448 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ *
+ * YCSB-style load driver for the buffer manager.  Loads a table of fixed-size
+ * records into a heap file through BufMgr and then runs one of the standard
+ * YCSB core workloads (A-F) against it from several client threads, reporting
+ * throughput, latency percentiles per operation type and buffer statistics.
+ * Clients share the buffer manager through one mutex held for each whole
+ * operation, so they run one at a time; latencies count only the time an
+ * operation holds it.
+ *
+ * Build with "make ycsb" from the top-level directory, then run for example:
+ *   $ ./src/ycsb --workload=A --records=200000 --pool=1000 --threads=4
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+/**
+ * Kinds of operations issued by the workloads.
+ */
+enum OpType { OP_READ = 0, OP_UPDATE, OP_INSERT, OP_SCAN, OP_RMW, NUM_OPS };
+
+const char* const kOpNames[NUM_OPS] = {"READ", "UPDATE", "INSERT", "SCAN",
+                                       "READ-MODIFY-WRITE"};
+
+/**
+ * Run-time options of the driver.
+ */
+struct Options {
+  char workload;
+  std::uint64_t records;
+  std::uint64_t ops;
+  std::uint32_t record_size;
+  std::uint32_t pool;
+  std::uint32_t threads;
+  std::uint32_t max_scan;
+  double theta;
+  std::string filename;
+
+  Options()
+      : workload('A'), records(100000), ops(200000), record_size(100),
+        pool(1000), threads(4), max_scan(100), theta(0.99),
+        filename("ycsb.db") {}
+};
+
+/**
+ * Operation mix of a workload, as fractions adding up to one.
+ */
+struct Mix {
+  double read, update, insert, scan, rmw;
+  bool latest;  // Request distribution skewed towards recent inserts (D).
+};
+
+Mix workloadMix(const char workload) {
+  switch (workload) {
+    case 'A': return {0.50, 0.50, 0.00, 0.00, 0.00, false};
+    case 'B': return {0.95, 0.05, 0.00, 0.00, 0.00, false};
+    case 'C': return {1.00, 0.00, 0.00, 0.00, 0.00, false};
+    case 'D': return {0.95, 0.00, 0.05, 0.00, 0.00, true};
+    case 'E': return {0.00, 0.00, 0.05, 0.95, 0.00, false};
+    case 'F': return {0.50, 0.00, 0.00, 0.00, 0.50, false};
+  }
+  std::cerr << "Unknown workload " << workload << " (expected A-F)\n";
+  std::exit(1);
+}
+
+/**
+ * Zipfian generator over [0, n) following Gray et al., "Quickly Generating
+ * Billion-Record Synthetic Databases".  Item 0 is the most popular one.
+ */
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(const std::uint64_t n, const double theta)
+      : n_(n), theta_(theta) {
+    zeta2_ = zeta(2);
+    zetan_ = zeta(n_);
+    alpha_ = 1.0 / (1.0 - theta_);
+    eta_ = (1.0 - std::pow(2.0 / n_, 1.0 - theta_)) / (1.0 - zeta2_ / zetan_);
+  }
+
+  std::uint64_t next(std::mt19937_64& rng) const {
+    const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    const double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + std::pow(0.5, theta_)) {
+      return 1;
+    }
+    const std::uint64_t value = static_cast<std::uint64_t>(
+        n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return std::min(value, n_ - 1);
+  }
+
+ private:
+  double zeta(const std::uint64_t n) const {
+    double sum = 0;
+    for (std::uint64_t i = 1; i <= n; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i), theta_);
+    }
+    return sum;
+  }
+
+  std::uint64_t n_;
+  double theta_;
+  double zeta2_;
+  double zetan_;
+  double alpha_;
+  double eta_;
+};
+
+/**
+ * Spreads the popular Zipfian items over the whole key space, as YCSB's
+ * scrambled Zipfian generator does, so hot keys do not all share one page.
+ */
+std::uint64_t fnvHash(std::uint64_t value) {
+  std::uint64_t hash = 0xCBF29CE484222325ULL;
+  for (int i = 0; i < 8; ++i) {
+    hash ^= value & 0xFF;
+    hash *= 0x100000001B3ULL;
+    value >>= 8;
+  }
+  return hash;
+}
+
+/**
+ * Shared state of a run.  BufMgr is not threadsafe, so every call into it
+ * (and every access to the key directory) is serialized through <mutex>.
+ */
+struct Table {
+  BufMgr* buf_mgr;
+  File* file;
+  std::uint32_t record_size;
+  std::mutex mutex;
+
+  /**
+   * Record id of every key; keys are dense and assigned in insert order.
+   */
+  std::vector<RecordId> rids;
+
+  /**
+   * Page currently receiving inserts.
+   */
+  PageId insert_page;
+};
+
+std::string makeRecord(const std::uint64_t key, const std::uint32_t size,
+                       const std::uint64_t version) {
+  char prefix[64];
+  std::snprintf(prefix, sizeof(prefix), "user%020llu:%llu:",
+                static_cast<unsigned long long>(key),
+                static_cast<unsigned long long>(version));
+  std::string record(prefix);
+  record.resize(std::max<std::size_t>(size, record.size()),
+                static_cast<char>('a' + key % 26));
+  return record;
+}
+
+/**
+ * Appends a record for a new key.  Caller must hold the table mutex.
+ */
+void insertLocked(Table& table, const std::uint64_t key) {
+  const std::string record = makeRecord(key, table.record_size, 0);
+  Page* page;
+  if (table.insert_page != Page::INVALID_NUMBER) {
+    table.buf_mgr->readPage(table.file, table.insert_page, page);
+    if (page->hasSpaceForRecord(record)) {
+      table.rids.push_back(page->insertRecord(record));
+      table.buf_mgr->unPinPage(table.file, table.insert_page, true);
+      return;
+    }
+    table.buf_mgr->unPinPage(table.file, table.insert_page, false);
+  }
+  table.buf_mgr->allocPage(table.file, table.insert_page, page);
+  table.rids.push_back(page->insertRecord(record));
+  table.buf_mgr->unPinPage(table.file, table.insert_page, true);
+}
+
+/**
+ * Per-thread results: latency samples in nanoseconds for every op type.
+ */
+struct ThreadResult {
+  std::vector<std::uint64_t> latencies[NUM_OPS];
+};
+
+void runClient(Table& table, const Options& options, const Mix& mix,
+               const ZipfianGenerator& zipf, const std::uint64_t num_ops,
+               const unsigned seed, ThreadResult& result) {
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> coin(0.0, 1.0);
+  std::uniform_int_distribution<std::uint32_t> scan_len(1, options.max_scan);
+
+  for (std::uint64_t n = 0; n < num_ops; ++n) {
+    const double p = coin(rng);
+    OpType op;
+    if (p < mix.read) {
+      op = OP_READ;
+    } else if (p < mix.read + mix.update) {
+      op = OP_UPDATE;
+    } else if (p < mix.read + mix.update + mix.insert) {
+      op = OP_INSERT;
+    } else if (p < mix.read + mix.update + mix.insert + mix.scan) {
+      op = OP_SCAN;
+    } else {
+      op = OP_RMW;
+    }
+
+    // Operations hold the table mutex throughout, so clients run one at a
+    // time; the latency is the time spent holding it, not waiting for it
+    std::chrono::steady_clock::duration elapsed;
+    {
+      std::lock_guard<std::mutex> lock(table.mutex);
+      const auto start = std::chrono::steady_clock::now();
+      const std::uint64_t num_keys = table.rids.size();
+      const std::uint64_t rank = zipf.next(rng) % num_keys;
+      const std::uint64_t key =
+          mix.latest ? num_keys - 1 - rank : fnvHash(rank) % num_keys;
+      Page* page;
+
+      switch (op) {
+        case OP_READ: {
+          const RecordId& rid = table.rids[key];
+          table.buf_mgr->readPage(table.file, rid.page_number, page);
+          page->getRecord(rid);
+          table.buf_mgr->unPinPage(table.file, rid.page_number, false);
+          break;
+        }
+        case OP_UPDATE:
+        case OP_RMW: {
+          const RecordId& rid = table.rids[key];
+          table.buf_mgr->readPage(table.file, rid.page_number, page);
+          std::uint64_t version = n + 1;
+          if (op == OP_RMW) {
+            version += std::strtoull(
+                page->getRecord(rid).c_str() + 25, NULL, 10);
+          }
+          page->updateRecord(rid, makeRecord(key, table.record_size, version));
+          table.buf_mgr->unPinPage(table.file, rid.page_number, true);
+          break;
+        }
+        case OP_INSERT:
+          insertLocked(table, num_keys);
+          break;
+        case OP_SCAN: {
+          // Keys are laid out in insert order, so a key range is a run of
+          // consecutive record ids.  Only one page is pinned at a time.
+          const std::uint64_t end =
+              std::min<std::uint64_t>(num_keys, key + scan_len(rng));
+          PageId pinned = Page::INVALID_NUMBER;
+          for (std::uint64_t k = key; k < end; ++k) {
+            const RecordId& rid = table.rids[k];
+            if (rid.page_number != pinned) {
+              if (pinned != Page::INVALID_NUMBER) {
+                table.buf_mgr->unPinPage(table.file, pinned, false);
+              }
+              table.buf_mgr->readPage(table.file, rid.page_number, page);
+              pinned = rid.page_number;
+            }
+            page->getRecord(rid);
+          }
+          if (pinned != Page::INVALID_NUMBER) {
+            table.buf_mgr->unPinPage(table.file, pinned, false);
+          }
+          break;
+        }
+        default:
+          break;
+      }
+      elapsed = std::chrono::steady_clock::now() - start;
+    }
+    result.latencies[op].push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+}
+
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted,
+                         const double pct) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const std::size_t index = static_cast<std::size_t>(
+      std::ceil(pct / 100.0 * sorted.size())) - 1;
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void usage(const char* prog) {
+  std::cerr << "Usage: " << prog << " [options]\n"
+            << "  --workload=A|B|C|D|E|F  YCSB core workload (default A)\n"
+            << "  --records=N             records loaded before the run\n"
+            << "  --ops=N                 operations in the run phase\n"
+            << "  --record-size=BYTES     size of every record\n"
+            << "  --pool=FRAMES           buffer pool size in frames\n"
+            << "  --threads=N             client threads\n"
+            << "  --max-scan=N            longest scan in workload E\n"
+            << "  --theta=T               Zipfian skew (0 < T < 1)\n"
+            << "  --file=NAME             data file (removed afterwards)\n";
+  std::exit(1);
+}
+
+Options parseOptions(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const std::size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+      usage(argv[0]);
+    }
+    const std::string name = arg.substr(2, eq - 2);
+    const std::string value = arg.substr(eq + 1);
+    if (name == "workload" && value.size() == 1) {
+      options.workload = static_cast<char>(std::toupper(value[0]));
+    } else if (name == "records") {
+      options.records = std::strtoull(value.c_str(), NULL, 10);
+    } else if (name == "ops") {
+      options.ops = std::strtoull(value.c_str(), NULL, 10);
+    } else if (name == "record-size") {
+      options.record_size = std::strtoul(value.c_str(), NULL, 10);
+    } else if (name == "pool") {
+      options.pool = std::strtoul(value.c_str(), NULL, 10);
+    } else if (name == "threads") {
+      options.threads = std::strtoul(value.c_str(), NULL, 10);
+    } else if (name == "max-scan") {
+      options.max_scan = std::strtoul(value.c_str(), NULL, 10);
+    } else if (name == "theta") {
+      options.theta = std::strtod(value.c_str(), NULL);
+    } else if (name == "file") {
+      options.filename = value;
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (options.records == 0 || options.threads == 0 || options.max_scan == 0 ||
+      options.pool < options.threads || options.record_size == 0 ||
+      options.record_size > Page::DATA_SIZE / 2 ||
+      options.theta <= 0 || options.theta >= 1) {
+    usage(argv[0]);
+  }
+  return options;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const Options options = parseOptions(argc, argv);
+  const Mix mix = workloadMix(options.workload);
+
+  try {
+    File::remove(options.filename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    File file = File::create(options.filename);
+    BufMgr buf_mgr(options.pool);
+
+    Table table;
+    table.buf_mgr = &buf_mgr;
+    table.file = &file;
+    table.record_size = options.record_size;
+    table.insert_page = Page::INVALID_NUMBER;
+    table.rids.reserve(options.records + options.ops);
+
+    // Load phase.
+    const auto load_start = std::chrono::steady_clock::now();
+    for (std::uint64_t key = 0; key < options.records; ++key) {
+      insertLocked(table, key);
+    }
+    const double load_secs = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - load_start).count();
+    std::cout << "Loaded " << options.records << " records of "
+              << options.record_size << " bytes into " << table.insert_page
+              << " pages (" << options.pool << " frames) in " << load_secs
+              << " s\n";
+
+    // Run phase.
+    buf_mgr.clearBufStats();
+    const ZipfianGenerator zipf(options.records, options.theta);
+    std::vector<ThreadResult> results(options.threads);
+    std::vector<std::thread> clients;
+    const auto run_start = std::chrono::steady_clock::now();
+    for (std::uint32_t t = 0; t < options.threads; ++t) {
+      const std::uint64_t share = options.ops / options.threads +
+          (t < options.ops % options.threads ? 1 : 0);
+      clients.push_back(std::thread(runClient, std::ref(table),
+                                    std::cref(options), std::cref(mix),
+                                    std::cref(zipf), share, 1000 + t,
+                                    std::ref(results[t])));
+    }
+    for (std::size_t t = 0; t < clients.size(); ++t) {
+      clients[t].join();
+    }
+    const double run_secs = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - run_start).count();
+
+    std::cout << "Workload " << options.workload << ": " << options.ops
+              << " ops, " << options.threads
+              << " threads (serialized by one mutex), " << run_secs
+              << " s, " << options.ops / run_secs << " ops/sec\n";
+    for (int op = 0; op < NUM_OPS; ++op) {
+      std::vector<std::uint64_t> all;
+      for (std::size_t t = 0; t < results.size(); ++t) {
+        all.insert(all.end(), results[t].latencies[op].begin(),
+                   results[t].latencies[op].end());
+      }
+      if (all.empty()) {
+        continue;
+      }
+      std::sort(all.begin(), all.end());
+      std::printf("  %-18s count=%-9zu p50=%8.1fus p95=%8.1fus "
+                  "p99=%8.1fus p99.9=%8.1fus max=%8.1fus\n",
+                  kOpNames[op], all.size(), percentile(all, 50) / 1e3,
+                  percentile(all, 95) / 1e3, percentile(all, 99) / 1e3,
+                  percentile(all, 99.9) / 1e3, all.back() / 1e3);
+    }
+    const BufStats& stats = buf_mgr.getBufStats();
+    std::cout << "  BufStats accesses=" << stats.accesses
+              << " diskreads=" << stats.diskreads
+              << " diskwrites=" << stats.diskwrites << "\n";
+  }
+
+  File::remove(options.filename);
+  return 0;
+}
@@ -0,0 +1,866 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "btree.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "file_iterator.h"
+#include "exceptions/bad_index_exception.h"
+#include "exceptions/buffer_exceeded_exception.h"
+
+namespace badgerdb {
+
+const std::size_t BTreeIndex::MAX_KEY_LENGTH;
+
+namespace {
+
+const std::uint32_t kMetaMagic = 0x42545245;  // "BTRE"
+const std::uint32_t kNodeMagic = 0x42544e44;  // "BTND"
+
+/**
+ * Contents of the first page of the index file.
+ */
+struct MetaHeader {
+  std::uint32_t magic;
+  std::uint32_t key_type;
+  PageId root;
+  std::uint32_t height;
+};
+
+/**
+ * Start of every node page, followed by the slot array.
+ */
+struct NodeHeader {
+  std::uint32_t magic;
+
+  /**
+   * Distance from the leaves, 0 for a leaf.
+   */
+  std::uint16_t level;
+
+  /**
+   * Number of slots, and where the cells start.
+   */
+  std::uint16_t count;
+  std::uint16_t cell_start;
+
+  /**
+   * Bytes of removed cells between cell_start and the end of the node.
+   */
+  std::uint16_t garbage;
+
+  /**
+   * Right sibling of a leaf, and child below the first separator of an
+   * internal node.
+   */
+  PageId right;
+  PageId leftmost;
+};
+
+/**
+ * Record ID sorting before all others, to look up the first entry of a key.
+ */
+const RecordId kMinRid = {0, 0};
+
+const std::size_t kRidSize = sizeof(PageId) + sizeof(SlotId);
+
+/**
+ * Bytes of a node filled by bulk loading.
+ */
+const std::size_t kBulkFill = Page::DATA_SIZE * 9 / 10;
+
+/**
+ * Cell of a node, pointing into the page.
+ */
+struct Cell {
+  const char* key;
+  std::uint16_t key_length;
+  RecordId rid;
+  PageId child;
+};
+
+/**
+ * Cell copied out of a node, to split or bulk load it.
+ */
+struct Entry {
+  std::string key;
+  RecordId rid;
+  PageId child;
+};
+
+MetaHeader* metaHeader(char* data) {
+  return reinterpret_cast<MetaHeader*>(data);
+}
+
+NodeHeader* header(char* node) { return reinterpret_cast<NodeHeader*>(node); }
+
+std::uint16_t* slots(char* node) {
+  return reinterpret_cast<std::uint16_t*>(node + sizeof(NodeHeader));
+}
+
+bool isLeaf(char* node) { return header(node)->level == 0; }
+
+std::size_t cellSize(const std::size_t key_length, const bool internal) {
+  return sizeof(std::uint16_t) + key_length + kRidSize +
+         (internal ? sizeof(PageId) : 0);
+}
+
+std::size_t freeSpace(char* node) {
+  return header(node)->cell_start -
+         (sizeof(NodeHeader) + header(node)->count * sizeof(std::uint16_t));
+}
+
+void initNode(char* node, const std::uint16_t level) {
+  NodeHeader* h = header(node);
+  h->magic = kNodeMagic;
+  h->level = level;
+  h->count = 0;
+  h->cell_start = static_cast<std::uint16_t>(Page::DATA_SIZE);
+  h->garbage = 0;
+  h->right = Page::INVALID_NUMBER;
+  h->leftmost = Page::INVALID_NUMBER;
+}
+
+Cell cellAt(char* node, const std::size_t slot) {
+  const char* p = node + slots(node)[slot];
+  Cell cell;
+  std::memcpy(&cell.key_length, p, sizeof(cell.key_length));
+  cell.key = p + sizeof(cell.key_length);
+  p = cell.key + cell.key_length;
+  std::memcpy(&cell.rid.page_number, p, sizeof(PageId));
+  std::memcpy(&cell.rid.slot_number, p + sizeof(PageId), sizeof(SlotId));
+  cell.child = Page::INVALID_NUMBER;
+  if (!isLeaf(node)) {
+    std::memcpy(&cell.child, p + kRidSize, sizeof(PageId));
+  }
+  return cell;
+}
+
+int compareKeys(const char* a, const std::size_t a_length, const char* b,
+                const std::size_t b_length) {
+  const int c = std::memcmp(a, b, std::min(a_length, b_length));
+  if (c != 0) {
+    return c;
+  }
+  return a_length < b_length ? -1 : (a_length > b_length ? 1 : 0);
+}
+
+int compare(const Cell& cell, const std::string& key, const RecordId& rid) {
+  const int c = compareKeys(cell.key, cell.key_length, key.data(), key.size());
+  if (c != 0) {
+    return c;
+  }
+  if (cell.rid.page_number != rid.page_number) {
+    return cell.rid.page_number < rid.page_number ? -1 : 1;
+  }
+  if (cell.rid.slot_number != rid.slot_number) {
+    return cell.rid.slot_number < rid.slot_number ? -1 : 1;
+  }
+  return 0;
+}
+
+bool entryLess(const std::string& a_key, const RecordId& a_rid,
+               const std::string& b_key, const RecordId& b_rid) {
+  const int c = compareKeys(a_key.data(), a_key.size(), b_key.data(),
+                            b_key.size());
+  if (c != 0) {
+    return c < 0;
+  }
+  if (a_rid.page_number != b_rid.page_number) {
+    return a_rid.page_number < b_rid.page_number;
+  }
+  return a_rid.slot_number < b_rid.slot_number;
+}
+
+/**
+ * Returns the first slot whose entry is not below (key, rid), or, with
+ * <upper>, above it.
+ */
+std::size_t search(char* node, const std::string& key, const RecordId& rid,
+                   const bool upper) {
+  std::size_t low = 0;
+  std::size_t high = header(node)->count;
+  while (low < high) {
+    const std::size_t middle = (low + high) / 2;
+    const int c = compare(cellAt(node, middle), key, rid);
+    if (c < 0 || (upper && c == 0)) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+std::size_t lowerBound(char* node, const std::string& key,
+                       const RecordId& rid) {
+  return search(node, key, rid, false);
+}
+
+/**
+ * Returns the child of an internal node that (key, rid) belongs in.
+ */
+PageId childFor(char* node, const std::string& key, const RecordId& rid) {
+  const std::size_t slot = search(node, key, rid, true);
+  return slot == 0 ? header(node)->leftmost : cellAt(node, slot - 1).child;
+}
+
+/**
+ * Adds a cell at <slot>; the node must have room for it and its slot.
+ */
+void appendCell(char* node, const std::size_t slot, const std::string& key,
+                const RecordId& rid, const PageId child) {
+  NodeHeader* h = header(node);
+  const std::uint16_t key_length = static_cast<std::uint16_t>(key.size());
+  h->cell_start = static_cast<std::uint16_t>(
+      h->cell_start - cellSize(key.size(), !isLeaf(node)));
+  char* p = node + h->cell_start;
+  std::memcpy(p, &key_length, sizeof(key_length));
+  p += sizeof(key_length);
+  std::memcpy(p, key.data(), key.size());
+  p += key.size();
+  std::memcpy(p, &rid.page_number, sizeof(PageId));
+  std::memcpy(p + sizeof(PageId), &rid.slot_number, sizeof(SlotId));
+  if (!isLeaf(node)) {
+    std::memcpy(p + kRidSize, &child, sizeof(PageId));
+  }
+  std::uint16_t* s = slots(node);
+  std::memmove(s + slot + 1, s + slot,
+               (h->count - slot) * sizeof(std::uint16_t));
+  s[slot] = h->cell_start;
+  ++h->count;
+}
+
+/**
+ * Rewrites the cells of a node next to each other, reclaiming the room of
+ * removed ones.
+ */
+void compact(char* node) {
+  std::vector<char> copy(node, node + Page::DATA_SIZE);
+  NodeHeader* h = header(node);
+  std::uint16_t* s = slots(node);
+  h->cell_start = static_cast<std::uint16_t>(Page::DATA_SIZE);
+  h->garbage = 0;
+  for (std::size_t slot = 0; slot < h->count; ++slot) {
+    std::uint16_t key_length;
+    std::memcpy(&key_length, &copy[s[slot]], sizeof(key_length));
+    const std::size_t size = cellSize(key_length, !isLeaf(node));
+    h->cell_start = static_cast<std::uint16_t>(h->cell_start - size);
+    std::memcpy(node + h->cell_start, &copy[s[slot]], size);
+    s[slot] = h->cell_start;
+  }
+}
+
+/**
+ * Adds a cell at <slot>, compacting the node if need be.
+ *
+ * @return  False if the node has no room for it.
+ */
+bool insertCell(char* node, const std::size_t slot, const std::string& key,
+                const RecordId& rid, const PageId child) {
+  const std::size_t needed =
+      cellSize(key.size(), !isLeaf(node)) + sizeof(std::uint16_t);
+  if (freeSpace(node) < needed) {
+    if (freeSpace(node) + header(node)->garbage < needed) {
+      return false;
+    }
+    compact(node);
+  }
+  appendCell(node, slot, key, rid, child);
+  return true;
+}
+
+void removeCell(char* node, const std::size_t slot) {
+  NodeHeader* h = header(node);
+  h->garbage = static_cast<std::uint16_t>(
+      h->garbage + cellSize(cellAt(node, slot).key_length, !isLeaf(node)));
+  std::uint16_t* s = slots(node);
+  std::memmove(s + slot, s + slot + 1,
+               (h->count - slot - 1) * sizeof(std::uint16_t));
+  --h->count;
+}
+
+/**
+ * Replaces the cells of a node by entries [begin, end).
+ */
+void fill(char* node, const std::vector<Entry>& entries,
+          const std::size_t begin, const std::size_t end) {
+  NodeHeader* h = header(node);
+  h->count = 0;
+  h->cell_start = static_cast<std::uint16_t>(Page::DATA_SIZE);
+  h->garbage = 0;
+  for (std::size_t e = begin; e < end; ++e) {
+    appendCell(node, h->count, entries[e].key, entries[e].rid,
+               entries[e].child);
+  }
+}
+
+}
+
+BTreeIndex::Node& BTreeIndex::Node::operator=(Node&& other) {
+  release();
+  guard_ = std::move(other.guard_);
+  mutex_ = other.mutex_;
+  return *this;
+}
+
+void BTreeIndex::Node::release() {
+  if (!guard_) {
+    return;
+  }
+  guard_.unlatch();
+  std::lock_guard<std::mutex> lock(*mutex_);
+  guard_.release();
+}
+
+BTreeIndex::BTreeIndex(BufMgr& buf_mgr, File* file, std::mutex& buf_mgr_mutex,
+                       const BTreeKeyType key_type)
+    : buf_mgr_(buf_mgr),
+      file_(file),
+      buf_mgr_mutex_(buf_mgr_mutex),
+      key_type_(key_type),
+      meta_page_(Page::INVALID_NUMBER),
+      prefetch_(true),
+      inserts_(0),
+      removes_(0),
+      splits_(0),
+      pessimistic_inserts_(0),
+      prefetches_(0) {
+  {
+    std::lock_guard<std::mutex> lock(buf_mgr_mutex_);
+    if (file_->begin() != file_->end()) {
+      meta_page_ = (*file_->begin()).page_number();
+    }
+  }
+  if (meta_page_ == Page::INVALID_NUMBER) {
+    Node meta = allocateNode();
+    Node root = allocateNode();
+    initNode(root.data(), 0);
+    root.guard().markDirty();
+    MetaHeader* m = metaHeader(meta.data());
+    m->magic = kMetaMagic;
+    m->key_type = key_type_;
+    m->root = root.page_number();
+    m->height = 1;
+    meta.guard().markDirty();
+    meta_page_ = meta.page_number();
+    return;
+  }
+  Node meta = pin(meta_page_, LATCH_SHARED);
+  const MetaHeader* m = metaHeader(meta.data());
+  if (m->magic != kMetaMagic) {
+    throw BadIndexException(file_->filename(), "not a B+tree index");
+  }
+  if (m->key_type != static_cast<std::uint32_t>(key_type_)) {
+    throw BadIndexException(file_->filename(), "index of another key type");
+  }
+}
+
+void BTreeIndex::insert(const std::int64_t key, const RecordId& rid) {
+  insertEncoded(encode(key), rid);
+}
+
+void BTreeIndex::insert(const std::string& key, const RecordId& rid) {
+  insertEncoded(encode(key), rid);
+}
+
+bool BTreeIndex::lookup(const std::int64_t key, RecordId& rid) {
+  return lookupEncoded(encode(key), rid);
+}
+
+bool BTreeIndex::lookup(const std::string& key, RecordId& rid) {
+  return lookupEncoded(encode(key), rid);
+}
+
+bool BTreeIndex::remove(const std::int64_t key, const RecordId& rid) {
+  return removeEncoded(encode(key), rid);
+}
+
+bool BTreeIndex::remove(const std::string& key, const RecordId& rid) {
+  return removeEncoded(encode(key), rid);
+}
+
+void BTreeIndex::bulkLoad(
+    const std::vector<std::pair<std::int64_t, RecordId> >& entries) {
+  std::vector<std::pair<std::string, RecordId> > encoded;
+  encoded.reserve(entries.size());
+  for (std::size_t e = 0; e < entries.size(); ++e) {
+    encoded.push_back(std::make_pair(encode(entries[e].first),
+                                     entries[e].second));
+  }
+  bulkLoadEncoded(encoded);
+}
+
+void BTreeIndex::bulkLoad(
+    const std::vector<std::pair<std::string, RecordId> >& entries) {
+  for (std::size_t e = 0; e < entries.size(); ++e) {
+    encode(entries[e].first);
+  }
+  bulkLoadEncoded(entries);
+}
+
+BTreeScan BTreeIndex::scan(const std::int64_t low, const std::int64_t high) {
+  const std::string low_key = encode(low);
+  const std::string high_key = encode(high);
+  BTreeScan scan(this, high_key);
+  if (low <= high) {
+    Node leaf = descend(low_key, kMinRid, LATCH_SHARED);
+    scan.load(leaf, lowerBound(leaf.data(), low_key, kMinRid));
+  }
+  return scan;
+}
+
+BTreeScan BTreeIndex::scan(const std::string& low, const std::string& high) {
+  const std::string low_key = encode(low);
+  const std::string high_key = encode(high);
+  BTreeScan scan(this, high_key);
+  if (compareKeys(low_key.data(), low_key.size(), high_key.data(),
+                  high_key.size()) <= 0) {
+    Node leaf = descend(low_key, kMinRid, LATCH_SHARED);
+    scan.load(leaf, lowerBound(leaf.data(), low_key, kMinRid));
+  }
+  return scan;
+}
+
+std::uint32_t BTreeIndex::height() {
+  Node meta = pin(meta_page_, LATCH_SHARED);
+  return metaHeader(meta.data())->height;
+}
+
+BTreeStats BTreeIndex::stats() const {
+  BTreeStats stats;
+  stats.inserts = inserts_.load();
+  stats.removes = removes_.load();
+  stats.splits = splits_.load();
+  stats.pessimistic_inserts = pessimistic_inserts_.load();
+  stats.prefetches = prefetches_.load();
+  return stats;
+}
+
+BTreeIndex::Node BTreeIndex::pin(const PageId page_number,
+                                 const LatchMode mode) {
+  PageGuard guard;
+  {
+    std::lock_guard<std::mutex> lock(buf_mgr_mutex_);
+    guard = buf_mgr_.fetch(file_, page_number);
+  }
+  // Latched with the mutex let go of, as the holder may need it to finish
+  Node node(std::move(guard), &buf_mgr_mutex_);
+  node.guard().latch(mode);
+  return node;
+}
+
+BTreeIndex::Node BTreeIndex::allocateNode() {
+  PageGuard guard;
+  {
+    std::lock_guard<std::mutex> lock(buf_mgr_mutex_);
+    guard = buf_mgr_.allocate(file_);
+  }
+  Node node(std::move(guard), &buf_mgr_mutex_);
+  node.guard().latch(LATCH_EXCLUSIVE);
+  return node;
+}
+
+std::string BTreeIndex::encode(const std::int64_t key) const {
+  if (key_type_ != BTREE_INT_KEYS) {
+    throw BadIndexException(file_->filename(),
+                            "integer key for an index of string keys");
+  }
+  // Flipping the sign bit makes negative keys sort first as unsigned bytes
+  const std::uint64_t bits =
+      static_cast<std::uint64_t>(key) ^ (std::uint64_t(1) << 63);
+  std::string encoded(sizeof(bits), '\0');
+  for (std::size_t b = 0; b < sizeof(bits); ++b) {
+    encoded[b] = static_cast<char>(bits >> (8 * (sizeof(bits) - 1 - b)));
+  }
+  return encoded;
+}
+
+std::string BTreeIndex::encode(const std::string& key) const {
+  if (key_type_ != BTREE_STRING_KEYS) {
+    throw BadIndexException(file_->filename(),
+                            "string key for an index of integer keys");
+  }
+  if (key.size() > MAX_KEY_LENGTH) {
+    throw BadIndexException(file_->filename(), "key too long");
+  }
+  return key;
+}
+
+void BTreeIndex::insertEncoded(const std::string& key, const RecordId& rid) {
+  Node leaf = descend(key, rid, LATCH_EXCLUSIVE);
+  char* data = leaf.data();
+  if (insertCell(data, lowerBound(data, key, rid), key, rid,
+                 Page::INVALID_NUMBER)) {
+    leaf.guard().markDirty();
+  } else {
+    leaf.release();
+    insertPessimistic(key, rid);
+  }
+  ++inserts_;
+}
+
+bool BTreeIndex::lookupEncoded(const std::string& key, RecordId& rid) {
+  Node leaf = descend(key, kMinRid, LATCH_SHARED);
+  for (;;) {
+    char* data = leaf.data();
+    const std::size_t slot = lowerBound(data, key, kMinRid);
+    if (slot < header(data)->count) {
+      const Cell cell = cellAt(data, slot);
+      if (compareKeys(cell.key, cell.key_length, key.data(), key.size()) != 0) {
+        return false;
+      }
+      rid = cell.rid;
+      return true;
+    }
+    // The entries of the key may start in the right sibling
+    const PageId right = header(data)->right;
+    if (right == Page::INVALID_NUMBER) {
+      return false;
+    }
+    Node next = pin(right, LATCH_SHARED);
+    leaf = std::move(next);
+  }
+}
+
+bool BTreeIndex::removeEncoded(const std::string& key, const RecordId& rid) {
+  Node leaf = descend(key, rid, LATCH_EXCLUSIVE);
+  char* data = leaf.data();
+  const std::size_t slot = lowerBound(data, key, rid);
+  if (slot == header(data)->count || compare(cellAt(data, slot), key, rid) != 0) {
+    return false;
+  }
+  removeCell(data, slot);
+  leaf.guard().markDirty();
+  ++removes_;
+  return true;
+}
+
+void BTreeIndex::bulkLoadEncoded(
+    const std::vector<std::pair<std::string, RecordId> >& entries) {
+  for (std::size_t e = 1; e < entries.size(); ++e) {
+    if (entryLess(entries[e].first, entries[e].second, entries[e - 1].first,
+                  entries[e - 1].second)) {
+      throw BadIndexException(file_->filename(),
+                              "bulk load entries are not sorted");
+    }
+  }
+  Node meta = pin(meta_page_, LATCH_EXCLUSIVE);
+  MetaHeader* m = metaHeader(meta.data());
+  Node node = pin(m->root, LATCH_EXCLUSIVE);
+  if (m->height != 1 || header(node.data())->count != 0) {
+    throw BadIndexException(file_->filename(),
+                            "bulk load into a non-empty index");
+  }
+  if (entries.empty()) {
+    return;
+  }
+
+  // Fill the leaves left to right, starting with the empty root, noting the
+  // first entry of each for the level above
+  std::vector<Entry> children;
+  initNode(node.data(), 0);
+  Entry first = {entries[0].first, entries[0].second, node.page_number()};
+  children.push_back(first);
+  for (std::size_t e = 0; e < entries.size(); ++e) {
+    char* data = node.data();
+    const std::size_t needed =
+        cellSize(entries[e].first.size(), false) + sizeof(std::uint16_t);
+    if (header(data)->count > 0 &&
+        Page::DATA_SIZE - freeSpace(data) + needed > kBulkFill) {
+      Node next = allocateNode();
+      initNode(next.data(), 0);
+      header(data)->right = next.page_number();
+      node.guard().markDirty();
+      Entry child = {entries[e].first, entries[e].second, next.page_number()};
+      children.push_back(child);
+      node = std::move(next);
+      data = node.data();
+    }
+    appendCell(data, header(data)->count, entries[e].first, entries[e].second,
+               Page::INVALID_NUMBER);
+  }
+  node.guard().markDirty();
+  node.release();
+
+  // Build each level above from the first entries of the one below; the
+  // first child of a node is its leftmost, whose entry moves up a level
+  std::uint16_t level = 1;
+  while (children.size() > 1) {
+    std::vector<Entry> parents;
+    node = allocateNode();
+    initNode(node.data(), level);
+    header(node.data())->leftmost = children[0].child;
+    Entry first = {children[0].key, children[0].rid, node.page_number()};
+    parents.push_back(first);
+    for (std::size_t c = 1; c < children.size(); ++c) {
+      char* data = node.data();
+      const std::size_t needed =
+          cellSize(children[c].key.size(), true) + sizeof(std::uint16_t);
+      if (Page::DATA_SIZE - freeSpace(data) + needed > kBulkFill) {
+        node.guard().markDirty();
+        Node next = allocateNode();
+        initNode(next.data(), level);
+        header(next.data())->leftmost = children[c].child;
+        Entry parent = {children[c].key, children[c].rid, next.page_number()};
+        parents.push_back(parent);
+        node = std::move(next);
+        continue;
+      }
+      appendCell(data, header(data)->count, children[c].key, children[c].rid,
+                 children[c].child);
+    }
+    node.guard().markDirty();
+    node.release();
+    children.swap(parents);
+    ++level;
+  }
+  m->root = children[0].child;
+  m->height = level;
+  meta.guard().markDirty();
+  inserts_ += entries.size();
+}
+
+BTreeIndex::Node BTreeIndex::descend(const std::string& key,
+                                     const RecordId& rid,
+                                     const LatchMode leaf_mode) {
+  Node meta = pin(meta_page_, LATCH_SHARED);
+  const MetaHeader* m = metaHeader(meta.data());
+  Node node = pin(m->root, m->height == 1 ? leaf_mode : LATCH_SHARED);
+  meta.release();
+  while (!isLeaf(node.data())) {
+    char* data = node.data();
+    Node child = pin(childFor(data, key, rid),
+                     header(data)->level == 1 ? leaf_mode : LATCH_SHARED);
+    node = std::move(child);
+  }
+  return node;
+}
+
+void BTreeIndex::insertPessimistic(const std::string& key,
+                                   const RecordId& rid) {
+  ++pessimistic_inserts_;
+  // Latch the path exclusively, letting go of the nodes above one that
+  // cannot split, as a split stops there
+  std::vector<Node> path;
+  path.push_back(pin(meta_page_, LATCH_EXCLUSIVE));
+  MetaHeader* m = metaHeader(path.front().data());
+  path.reserve(m->height + 1);
+  PageId page_number = m->root;
+  for (;;) {
+    Node node = pin(page_number, LATCH_EXCLUSIVE);
+    char* data = node.data();
+    if (freeSpace(data) + header(data)->garbage >= maxCellSpace()) {
+      path.clear();
+    }
+    const bool leaf = isLeaf(data);
+    if (!leaf) {
+      page_number = childFor(data, key, rid);
+    }
+    path.push_back(std::move(node));
+    if (leaf) {
+      break;
+    }
+  }
+
+  // Insert from the leaf up, each split handing a separator to its parent
+  std::string entry_key = key;
+  RecordId entry_rid = rid;
+  PageId entry_child = Page::INVALID_NUMBER;
+  for (std::size_t i = path.size(); i-- > 0;) {
+    Node& node = path[i];
+    if (node.page_number() == meta_page_) {
+      // The root split: a new root holds it and its new sibling
+      Node root = allocateNode();
+      initNode(root.data(), static_cast<std::uint16_t>(m->height));
+      header(root.data())->leftmost = m->root;
+      appendCell(root.data(), 0, entry_key, entry_rid, entry_child);
+      root.guard().markDirty();
+      m->root = root.page_number();
+      ++m->height;
+      node.guard().markDirty();
+      return;
+    }
+    char* data = node.data();
+    const std::size_t slot = lowerBound(data, entry_key, entry_rid);
+    if (insertCell(data, slot, entry_key, entry_rid, entry_child)) {
+      node.guard().markDirty();
+      return;
+    }
+
+    // Split the cells, with the new one, by bytes
+    std::vector<Entry> entries(header(data)->count);
+    for (std::size_t s = 0; s < entries.size(); ++s) {
+      const Cell cell = cellAt(data, s);
+      entries[s].key.assign(cell.key, cell.key_length);
+      entries[s].rid = cell.rid;
+      entries[s].child = cell.child;
+    }
+    Entry added = {entry_key, entry_rid, entry_child};
+    entries.insert(entries.begin() + slot, added);
+    const bool leaf = isLeaf(data);
+    std::size_t total = 0;
+    for (std::size_t e = 0; e < entries.size(); ++e) {
+      total += cellSize(entries[e].key.size(), !leaf) + sizeof(std::uint16_t);
+    }
+    std::size_t middle = 0;
+    for (std::size_t bytes = 0; middle < entries.size() && bytes < total / 2;
+         ++middle) {
+      bytes += cellSize(entries[middle].key.size(), !leaf) +
+               sizeof(std::uint16_t);
+    }
+    middle = std::max<std::size_t>(1, std::min(middle, entries.size() - 1));
+
+    Node right = allocateNode();
+    char* right_data = right.data();
+    initNode(right_data, header(data)->level);
+    if (leaf) {
+      header(right_data)->right = header(data)->right;
+      header(data)->right = right.page_number();
+      fill(data, entries, 0, middle);
+      fill(right_data, entries, middle, entries.size());
+    } else {
+      // The middle separator moves up, its child becoming the leftmost
+      header(right_data)->leftmost = entries[middle].child;
+      fill(data, entries, 0, middle);
+      fill(right_data, entries, middle + 1, entries.size());
+    }
+    node.guard().markDirty();
+    right.guard().markDirty();
+    ++splits_;
+    entry_key = entries[middle].key;
+    entry_rid = entries[middle].rid;
+    entry_child = right.page_number();
+  }
+}
+
+std::size_t BTreeIndex::maxCellSpace() const {
+  const std::size_t key_length =
+      key_type_ == BTREE_INT_KEYS ? sizeof(std::int64_t) : MAX_KEY_LENGTH;
+  return cellSize(key_length, true) + sizeof(std::uint16_t);
+}
+
+BTreeScan::BTreeScan(BTreeIndex* index, const std::string& high)
+    : index_(index),
+      high_(high),
+      position_(0),
+      next_leaf_(Page::INVALID_NUMBER) {}
+
+BTreeScan::BTreeScan(BTreeScan&& other)
+    : index_(other.index_),
+      high_(std::move(other.high_)),
+      entries_(std::move(other.entries_)),
+      position_(other.position_),
+      next_leaf_(other.next_leaf_),
+      prefetched_(std::move(other.prefetched_)) {
+  other.next_leaf_ = Page::INVALID_NUMBER;
+}
+
+BTreeScan::~BTreeScan() { dropPrefetched(); }
+
+bool BTreeScan::next(RecordId& rid) {
+  while (position_ >= entries_.size()) {
+    if (next_leaf_ == Page::INVALID_NUMBER) {
+      return false;
+    }
+    BTreeIndex::Node leaf = prefetched_
+                                ? takePrefetched()
+                                : index_->pin(next_leaf_, LATCH_NONE);
+    leaf.guard().latch(LATCH_SHARED);
+    entries_.clear();
+    position_ = 0;
+    load(leaf, 0);
+  }
+  rid = entries_[position_].second;
+  ++position_;
+  return true;
+}
+
+std::int64_t BTreeScan::intKey() const {
+  const std::string& key = entries_[position_ - 1].first;
+  std::uint64_t bits = 0;
+  for (std::size_t b = 0; b < key.size(); ++b) {
+    bits = (bits << 8) | static_cast<unsigned char>(key[b]);
+  }
+  return static_cast<std::int64_t>(bits ^ (std::uint64_t(1) << 63));
+}
+
+std::string BTreeScan::stringKey() const {
+  return entries_[position_ - 1].first;
+}
+
+void BTreeScan::load(BTreeIndex::Node& leaf, std::size_t position) {
+  char* data = leaf.data();
+  for (; position < header(data)->count; ++position) {
+    const Cell cell = cellAt(data, position);
+    if (compareKeys(cell.key, cell.key_length, high_.data(), high_.size()) > 0) {
+      next_leaf_ = Page::INVALID_NUMBER;
+      return;
+    }
+    entries_.push_back(
+        std::make_pair(std::string(cell.key, cell.key_length), cell.rid));
+  }
+  next_leaf_ = header(data)->right;
+  if (next_leaf_ == Page::INVALID_NUMBER || !index_->prefetch_) {
+    return;
+  }
+
+  std::shared_ptr<Prefetch> prefetch(new Prefetch);
+  try {
+    std::lock_guard<std::mutex> lock(index_->buf_mgr_mutex_);
+    index_->buf_mgr_.fetchAsync(
+        index_->file_, next_leaf_,
+        [prefetch](PageGuard guard, std::exception_ptr error) {
+          prefetch->guard = std::move(guard);
+          prefetch->error = error;
+          prefetch->done = true;
+        });
+    // Hand the read to the kernel now rather than when the leaf is needed
+    index_->buf_mgr_.pollFetches(false);
+  } catch (BufferExceededException&) {
+    // No frame to read ahead into; the leaf is read when it is reached.
+    return;
+  }
+  prefetched_ = prefetch;
+  ++index_->prefetches_;
+}
+
+BTreeIndex::Node BTreeScan::takePrefetched() {
+  std::shared_ptr<Prefetch> prefetch;
+  prefetch.swap(prefetched_);
+  PageGuard guard;
+  {
+    std::lock_guard<std::mutex> lock(index_->buf_mgr_mutex_);
+    while (!prefetch->done && index_->buf_mgr_.pendingFetches() > 0) {
+      index_->buf_mgr_.pollFetches(true);
+    }
+    guard = std::move(prefetch->guard);
+  }
+  if (prefetch->error) {
+    std::rethrow_exception(prefetch->error);
+  }
+  if (!guard) {
+    return index_->pin(next_leaf_, LATCH_NONE);
+  }
+  return BTreeIndex::Node(std::move(guard), &index_->buf_mgr_mutex_);
+}
+
+void BTreeScan::dropPrefetched() {
+  if (!prefetched_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(index_->buf_mgr_mutex_);
+  while (!prefetched_->done && index_->buf_mgr_.pendingFetches() > 0) {
+    index_->buf_mgr_.pollFetches(true);
+  }
+  prefetched_->guard.release();
+  prefetched_.reset();
+}
+
+}
@@ -0,0 +1,381 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "page_guard.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BTreeScan;
+
+/**
+ * @brief Kind of keys a B+tree index holds.
+ */
+enum BTreeKeyType {
+  /**
+   * Signed 64-bit integers.
+   */
+  BTREE_INT_KEYS = 1,
+
+  /**
+   * Byte strings of up to BTreeIndex::MAX_KEY_LENGTH bytes, in memcmp order.
+   */
+  BTREE_STRING_KEYS = 2
+};
+
+/**
+ * @brief Counters of a B+tree index.
+ */
+struct BTreeStats {
+  /**
+   * Entries inserted (one at a time or by bulk loading) and removed.
+   */
+  std::uint64_t inserts;
+  std::uint64_t removes;
+
+  /**
+   * Nodes split by inserts, and inserts that had to latch their path
+   * exclusively from the root down because the leaf was full.
+   */
+  std::uint64_t splits;
+  std::uint64_t pessimistic_inserts;
+
+  /**
+   * Leaves a scan started reading before it got to them.
+   */
+  std::uint64_t prefetches;
+};
+
+/**
+ * @brief B+tree index from keys to record IDs, stored in a File of its own
+ *        and accessed through the buffer pool.
+ *
+ * The first page of the file holds the key type, the root page and the
+ * height of the tree.  Every other page is a node: a slot array of offsets
+ * to cells, sorted by key, growing up from the node header, and the cells,
+ * growing down from the end of the page.  A leaf cell holds a key and a
+ * record ID, and leaves are linked to their right siblings for range scans.
+ * An internal cell holds a separator key and record ID and the child with
+ * the entries from there on; the entries below the first separator are in
+ * the node's leftmost child.  Entries are ordered by key and then record ID,
+ * so a key may map to any number of records.  Integer keys are stored as 8
+ * big-endian bytes with the sign bit flipped, so that both kinds of keys
+ * compare with memcmp.
+ *
+ * Lookups, inserts and scans may run on any number of threads at once.  They
+ * latch their way down with latch crabbing: a node's latch (its frame's
+ * FrameLatch) is let go of only once the child's is held.  Lookups and scans
+ * latch shared.  An insert first goes down the same way and latches only the
+ * leaf exclusively; if the leaf has no room, it starts again from the root
+ * with exclusive latches, keeping those of the nodes a split could reach.
+ * Removes leave nodes as they are, however empty: their room is reused by
+ * later inserts.
+ *
+ * The buffer manager is not threadsafe: the index locks the mutex it is
+ * given around every call it makes, never while waiting for a latch, and all
+ * other users of the buffer manager must hold the same mutex around theirs.
+ * Changes to the index are not logged to the write-ahead log.
+ */
+class BTreeIndex {
+ public:
+  /**
+   * Longest key of a BTREE_STRING_KEYS index.
+   */
+  static const std::size_t MAX_KEY_LENGTH = 1024;
+
+  /**
+   * Opens the index stored in <file>, or creates an empty one if the file has
+   * no pages.
+   *
+   * @param buf_mgr         Buffer manager the pages are read through.
+   * @param file            File of the index.  Must outlive the index.
+   * @param buf_mgr_mutex   Mutex held around every call to <buf_mgr>.
+   * @param key_type        Kind of keys.
+   * @throws  BadIndexException  If the file holds something else, or an index
+   *                             of another key type.
+   */
+  BTreeIndex(BufMgr& buf_mgr, File* file, std::mutex& buf_mgr_mutex,
+             const BTreeKeyType key_type);
+
+  /**
+   * Returns the kind of keys of the index.
+   */
+  BTreeKeyType keyType() const { return key_type_; }
+
+  /**
+   * Adds an entry.  An entry for the same key and record may be added twice.
+   *
+   * @throws  BadIndexException  If the key is of the other type, or too long.
+   */
+  void insert(const std::int64_t key, const RecordId& rid);
+  void insert(const std::string& key, const RecordId& rid);
+
+  /**
+   * Finds a record with the given key (the first by record ID if there are
+   * several).
+   *
+   * @return  False if no entry has the key.
+   */
+  bool lookup(const std::int64_t key, RecordId& rid);
+  bool lookup(const std::string& key, RecordId& rid);
+
+  /**
+   * Removes the entry for a key and record.
+   *
+   * @return  False if there is no such entry.
+   */
+  bool remove(const std::int64_t key, const RecordId& rid);
+  bool remove(const std::string& key, const RecordId& rid);
+
+  /**
+   * Fills an empty index with entries sorted by key and then record ID,
+   * packing the nodes to about 90%, much faster than inserting them one by
+   * one.  Other threads must not use the index meanwhile.
+   *
+   * @throws  BadIndexException  If the index is not empty, or the entries are
+   *                             not sorted.
+   */
+  void bulkLoad(const std::vector<std::pair<std::int64_t, RecordId> >& entries);
+  void bulkLoad(const std::vector<std::pair<std::string, RecordId> >& entries);
+
+  /**
+   * Starts a scan of the entries with keys from <low> to <high>, both
+   * included, in key order.
+   */
+  BTreeScan scan(const std::int64_t low, const std::int64_t high);
+  BTreeScan scan(const std::string& low, const std::string& high);
+
+  /**
+   * Makes scans read the next leaf ahead with BufMgr::fetchAsync() when they
+   * start on a leaf, so that the read overlaps the processing of the entries
+   * of the leaf (the default).  Only useful with asynchronous I/O enabled.
+   */
+  void setPrefetch(const bool enable) { prefetch_ = enable; }
+
+  /**
+   * Returns the number of levels of the tree, 1 for a tree of a single leaf.
+   */
+  std::uint32_t height();
+
+  /**
+   * Returns the counters of the index.
+   */
+  BTreeStats stats() const;
+
+ private:
+  friend class BTreeScan;
+
+  /**
+   * @brief Page pinned through the index: its guard, unlatched and unpinned
+   *        under the buffer manager mutex when the node goes out of scope.
+   */
+  class Node {
+   public:
+    Node() : mutex_(NULL) {}
+    Node(PageGuard guard, std::mutex* mutex)
+        : guard_(std::move(guard)), mutex_(mutex) {}
+    Node(Node&& other)
+        : guard_(std::move(other.guard_)), mutex_(other.mutex_) {}
+    Node& operator=(Node&& other);
+    ~Node() { release(); }
+
+    /**
+     * Lets go of the latch and the pin.
+     */
+    void release();
+
+    PageGuard& guard() { return guard_; }
+    PageId page_number() const { return guard_.page_number(); }
+
+    /**
+     * The node within its page.
+     */
+    char* data() const { return BTreeIndex::nodeData(guard_.get()); }
+
+   private:
+    Node(const Node&);
+    Node& operator=(const Node&);
+
+    PageGuard guard_;
+    std::mutex* mutex_;
+  };
+
+  BTreeIndex(const BTreeIndex&);
+  BTreeIndex& operator=(const BTreeIndex&);
+
+  /**
+   * Returns where nodes and the header live in a page.
+   */
+  static char* nodeData(Page* page) { return page->data_; }
+
+  /**
+   * Pins a page and latches it in <mode>, the latch taken with the mutex let
+   * go of.
+   */
+  Node pin(const PageId page_number, const LatchMode mode);
+
+  /**
+   * Allocates a page, pinned and latched exclusively.
+   */
+  Node allocateNode();
+
+  /**
+   * Turns a key into its stored form, checking that it fits the index.
+   */
+  std::string encode(const std::int64_t key) const;
+  std::string encode(const std::string& key) const;
+
+  /**
+   * The operations on stored keys.
+   */
+  void insertEncoded(const std::string& key, const RecordId& rid);
+  bool lookupEncoded(const std::string& key, RecordId& rid);
+  bool removeEncoded(const std::string& key, const RecordId& rid);
+  void bulkLoadEncoded(
+      const std::vector<std::pair<std::string, RecordId> >& entries);
+
+  /**
+   * Goes down from the root to the leaf where (<key>, <rid>) belongs,
+   * latching the leaf in <leaf_mode> and the nodes above shared, and
+   * returns the leaf.
+   */
+  Node descend(const std::string& key, const RecordId& rid,
+               const LatchMode leaf_mode);
+
+  /**
+   * Inserts with exclusive latches from the root down, splitting nodes as
+   * needed.
+   */
+  void insertPessimistic(const std::string& key, const RecordId& rid);
+
+  /**
+   * Largest room an insert can take in a node, with its slot: a node with at
+   * least that much room cannot split on an insert.
+   */
+  std::size_t maxCellSpace() const;
+
+  BufMgr& buf_mgr_;
+  File* file_;
+  std::mutex& buf_mgr_mutex_;
+  BTreeKeyType key_type_;
+
+  /**
+   * Page holding the key type, root and height.
+   */
+  PageId meta_page_;
+
+  bool prefetch_;
+
+  std::atomic<std::uint64_t> inserts_;
+  std::atomic<std::uint64_t> removes_;
+  std::atomic<std::uint64_t> splits_;
+  std::atomic<std::uint64_t> pessimistic_inserts_;
+  std::atomic<std::uint64_t> prefetches_;
+};
+
+/**
+ * @brief Range scan of a B+tree index, started by BTreeIndex::scan().
+ *
+ * The scan copies the matching entries of a leaf at a time, under its latch,
+ * and holds no latch between calls to next().  Entries inserted into the
+ * range meanwhile may or may not be returned.  With prefetching on, the next
+ * leaf is requested with BufMgr::fetchAsync() as soon as a leaf is reached,
+ * and stays pinned, unlatched, until the scan gets to it.
+ */
+class BTreeScan {
+ public:
+  BTreeScan(BTreeScan&& other);
+
+  /**
+   * Lets go of the leaf read ahead, if any.
+   */
+  ~BTreeScan();
+
+  /**
+   * Moves to the next entry.
+   *
+   * @param rid   Record ID of the entry, returned via this reference.
+   * @return  False once there are no more entries in the range.
+   */
+  bool next(RecordId& rid);
+
+  /**
+   * Returns the key of the entry next() last moved to.
+   */
+  std::int64_t intKey() const;
+  std::string stringKey() const;
+
+ private:
+  friend class BTreeIndex;
+
+  /**
+   * @brief Leaf read ahead, filled in by the fetchAsync() callback.
+   */
+  struct Prefetch {
+    Prefetch() : done(false) {}
+    bool done;
+    PageGuard guard;
+    std::exception_ptr error;
+  };
+
+  /**
+   * Constructs a scan with no entries read yet, up to the stored key <high>.
+   */
+  BTreeScan(BTreeIndex* index, const std::string& high);
+
+  BTreeScan(const BTreeScan&);
+  BTreeScan& operator=(const BTreeScan&);
+
+  /**
+   * Copies the entries of a latched leaf from <position> on up to the high
+   * key, and starts reading the next leaf if the range goes on.
+   */
+  void load(BTreeIndex::Node& leaf, std::size_t position);
+
+  /**
+   * Waits for the leaf read ahead and returns it, pinned and unlatched.
+   */
+  BTreeIndex::Node takePrefetched();
+
+  /**
+   * Lets go of the leaf read ahead, waiting for its read if need be.
+   */
+  void dropPrefetched();
+
+  BTreeIndex* index_;
+  std::string high_;
+
+  /**
+   * Entries copied from the current leaf, and the one next() is at.
+   */
+  std::vector<std::pair<std::string, RecordId> > entries_;
+  std::size_t position_;
+
+  /**
+   * Leaf to go on with once entries_ is used up, or Page::INVALID_NUMBER.
+   */
+  PageId next_leaf_;
+
+  /**
+   * Read of next_leaf_ started ahead, or NULL.
+   */
+  std::shared_ptr<Prefetch> prefetched_;
+};
+
+}
@@ -19,16 +19,39 @@
 
 namespace badgerdb {
 
+namespace {
+  // Old buckets moved by every operation while a resize is in progress
+  const int MIGRATE_STEP = 4;
+
+  void deleteChains(hashBucket** table, const int size)
+  {
+    for(int i = 0; i < size; i++) {
+      hashBucket* tmpBuf = table[i];
+      while (table[i]) {
+        tmpBuf = table[i];
+        table[i] = table[i]->next;
+        delete tmpBuf;
+      }
+    }
+    delete [] table;
+  }
+}
+
 int BufHashTbl::hash(const File* file, const PageId pageNo)
+{
+  return hash(file, pageNo, HTSIZE);
+}
+
+int BufHashTbl::hash(const File* file, const PageId pageNo, const int size)
 {
   int tmp, value;
   tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
+  value = (tmp + pageNo) % size;
   return value;
 }
 
 BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+	: HTSIZE(htSize), OLD_HTSIZE(0), oldHt(NULL), migrateIndex(0)
 {
   // allocate an array of pointers to hashBuckets
   ht = new hashBucket* [htSize];
@@ -38,29 +61,21 @@ BufHashTbl::BufHashTbl(int htSize)
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
-    }
-  }
-  delete [] ht;
+  deleteChains(ht, HTSIZE);
+  if (oldHt)
+    deleteChains(oldHt, OLD_HTSIZE);
 }
 
 void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
 {
-  int index = hash(file, pageNo);
+  migrate(MIGRATE_STEP);
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
-  }
+  FrameId present;
+  if (search(file, pageNo, present))
+  	throw HashAlreadyPresentException(file->filename(), pageNo, present);
 
-  tmpBuc = new hashBucket;
+  int index = hash(file, pageNo);
+  hashBucket* tmpBuc = new hashBucket;
   if (!tmpBuc)
   	throw HashTableException();
 
@@ -73,24 +88,102 @@ void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId fra
 
 void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
+  if (!find(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
+
+bool BufHashTbl::find(const File* file, const PageId pageNo, FrameId &frameNo)
+{
+  migrate(MIGRATE_STEP);
+
+  return search(file, pageNo, frameNo);
+}
+
+void BufHashTbl::remove(const File* file, const PageId pageNo) {
+
+  migrate(MIGRATE_STEP);
+
+  if (removeFrom(ht, hash(file, pageNo), file, pageNo))
+    return;
+  // Entries in buckets of an old table that have not been moved yet are still there
+  if (oldHt) {
+    int oldIndex = hash(file, pageNo, OLD_HTSIZE);
+    if (oldIndex >= migrateIndex && removeFrom(oldHt, oldIndex, file, pageNo))
+      return;
+  }
+
+  throw HashNotFoundException(file->filename(), pageNo);
+}
+
+void BufHashTbl::resize(const int htSize)
+{
+  // Finish any earlier resize first, so that there are never more than two tables
+  migrate(OLD_HTSIZE);
+
+  oldHt = ht;
+  OLD_HTSIZE = HTSIZE;
+  migrateIndex = 0;
+
+  HTSIZE = htSize;
+  ht = new hashBucket* [htSize];
+  for(int i=0; i < HTSIZE; i++)
+    ht[i] = NULL;
+}
+
+bool BufHashTbl::search(const File* file, const PageId pageNo, FrameId &frameNo)
+{
+  hashBucket* tmpBuc = ht[hash(file, pageNo)];
   while (tmpBuc) {
     if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
     {
       frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
+      return true;
     }
     tmpBuc = tmpBuc->next;
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  if (oldHt) {
+    int oldIndex = hash(file, pageNo, OLD_HTSIZE);
+    if (oldIndex >= migrateIndex) {
+      for (tmpBuc = oldHt[oldIndex]; tmpBuc; tmpBuc = tmpBuc->next) {
+        if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+        {
+          frameNo = tmpBuc->frameNo;
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
 }
 
-void BufHashTbl::remove(const File* file, const PageId pageNo) {
+void BufHashTbl::migrate(const int buckets)
+{
+  if (!oldHt)
+    return;
+
+  for (int moved = 0; moved < buckets && migrateIndex < OLD_HTSIZE; moved++, migrateIndex++) {
+    while (oldHt[migrateIndex]) {
+      // Relink the entry into its bucket of the current table
+      hashBucket* tmpBuc = oldHt[migrateIndex];
+      oldHt[migrateIndex] = tmpBuc->next;
+      int index = hash(tmpBuc->file, tmpBuc->pageNo);
+      tmpBuc->next = ht[index];
+      ht[index] = tmpBuc;
+    }
+  }
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
+  if (migrateIndex == OLD_HTSIZE) {
+    delete [] oldHt;
+    oldHt = NULL;
+    OLD_HTSIZE = 0;
+  }
+}
+
+bool BufHashTbl::removeFrom(hashBucket** table, const int index, const File* file, const PageId pageNo) {
+
+  hashBucket* tmpBuc = table[index];
   hashBucket* prevBuc = NULL;
 
   while (tmpBuc)
@@ -100,10 +193,10 @@ void BufHashTbl::remove(const File* file, const PageId pageNo) {
       if(prevBuc) 
 				prevBuc->next = tmpBuc->next;
       else
-				ht[index] = tmpBuc->next;
+				table[index] = tmpBuc->next;
 
       delete tmpBuc;
-      return;
+      return true;
     }
 		else
 		{
@@ -112,7 +205,7 @@ void BufHashTbl::remove(const File* file, const PageId pageNo) {
     }
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  return false;
 }
 
 }
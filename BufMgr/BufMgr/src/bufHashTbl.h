@@ -54,6 +54,17 @@ class BufHashTbl
 	 */
   hashBucket**  ht;
 
+	/**
+	 *	Size of the hash table before the last resize(), while its entries are still being moved, and the table itself
+	 */
+  int OLD_HTSIZE;
+  hashBucket**  oldHt;
+
+	/**
+	 * Next bucket of oldHt whose entries are to be moved to ht
+	 */
+  int migrateIndex;
+
 	/**
 	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
 	 *
@@ -63,6 +74,31 @@ class BufHashTbl
 	 */
   int	 hash(const File* file, const PageId pageNo);
 
+	/**
+	 * returns hash value between 0 and size-1 computed using file and pageNo
+	 */
+  static int hash(const File* file, const PageId pageNo, const int size);
+
+	/**
+	 * Moves the entries of up to <buckets> buckets of the old table after a resize() to the current one, and frees
+	 * the old table once it is empty
+	 */
+  void migrate(const int buckets);
+
+	/**
+	 * Looks (file, pageNo) up in the current table and in the part of an old table not moved yet
+	 *
+	 * @return False if the page is not in the hash table
+	 */
+  bool search(const File* file, const PageId pageNo, FrameId &frameNo);
+
+	/**
+	 * Deletes entry (file, pageNo) from bucket <index> of <table>
+	 *
+	 * @return False if the entry is not in that bucket
+	 */
+  static bool removeFrom(hashBucket** table, const int index, const File* file, const PageId pageNo);
+
  public:
 	/**
    * Constructor of BufHashTbl class
@@ -96,6 +132,17 @@ class BufHashTbl
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Check if (file, pageNo) is in the hash table, as lookup() does, without throwing when it is not; for callers
+   * whose lookups mostly miss.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, set if the page is found
+   * @return False if the page entry is not found in the hash table
+	 */
+  bool find(const File* file, const PageId pageNo, FrameId &frameNo);
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
@@ -104,6 +151,20 @@ class BufHashTbl
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
   void remove(const File* file, const PageId pageNo);  
+
+	/**
+   * Change the number of buckets of the hash table.  Entries are moved to the new buckets a few at a time by the
+   * following insert(), lookup() and remove() calls, so that no single call pays for rehashing the whole table;
+   * until they are all moved, both the old and the new buckets are searched.
+	 *
+	 * @param htSize 	New number of buckets
+	 */
+  void resize(const int htSize);
+
+	/**
+   * Returns the number of buckets.
+	 */
+  int size() const { return HTSIZE; }
 };
 
 }
@@ -13,34 +13,84 @@
 
 #include <memory>
 #include <iostream>
+#include <new>
+#include <algorithm>
+#include <vector>
 #include "buffer.h"
+#include "async_io.h"
+#include "numa.h"
+#include "wal.h"
+#include "double_write.h"
+#include "victim_cache.h"
+#include "ssd_cache.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
+#include "exceptions/read_only_file_exception.h"
+#include "exceptions/pool_resize_exception.h"
+#include "exceptions/io_exception.h"
 
 namespace badgerdb {
 
+	namespace {
+		/**
+		 * NUMA node set for the calling thread with BufMgr::setThreadNode(), or -1
+		 */
+		thread_local int threadNode = -1;
+
+		/**
+		 * Number of frames address space is reserved for when the constructor is not told (128 GB of frames)
+		 */
+		const std::uint32_t defaultMaxBufs = std::uint32_t(1) << 24;
+	}
+
 	/**
 	 * Constructor of BufMgr class
+	 * The frames and the BufDesc table each get a memory area with address space for maxBufs entries reserved, so
+	 * that resize() can grow them in place; both are backed by huge pages if asked for
+	 * 缓冲池和BufDesc表各自预留可扩展到maxBufs的地址空间，可选用大页
+	 *
+	 * @param bufs    Number of frames
+	 * @param pageSize    Largest virtual memory page size wanted for the buffer pool
+	 * @param maxBufs    Number of frames the pool may grow to, 0 for the default
 	 */
-	BufMgr::BufMgr(std::uint32_t bufs)
-		: numBufs(bufs) {
-		bufDescTable = new BufDesc[bufs];
+	BufMgr::BufMgr(std::uint32_t bufs, const PoolPageSize pageSize, const std::uint32_t maxBufs)
+		: numBufs(bufs), poolBufs(bufs) {
+		std::uint32_t maxFrames = maxBufs == 0 ? defaultMaxBufs : maxBufs;
+		if (maxFrames < bufs) {
+			maxFrames = bufs;
+		}
+		// The areas start on at least 4 KB boundaries, so O_DIRECT files read and write frames without a bounce
+		// buffer. The descriptors are small enough that 1 GB pages would mostly be wasted.
+		poolMemory = new PoolMemory(bufs * sizeof(Page), pageSize, std::size_t(maxFrames) * sizeof(Page));
+		descMemory = new PoolMemory(bufs * sizeof(BufDesc), pageSize == POOL_HUGE_PAGES_1GB ? POOL_HUGE_PAGES_2MB : pageSize,
+			std::size_t(maxFrames) * sizeof(BufDesc));
+		bufPool = static_cast<Page*>(poolMemory->base());
+		bufDescTable = static_cast<BufDesc*>(descMemory->base());
 
 		for (FrameId i = 0; i < bufs; i++)
 		{
+			new (&bufPool[i]) Page();
+			new (&bufDescTable[i]) BufDesc();
 			bufDescTable[i].frameNo = i;
 			bufDescTable[i].valid = false;
 		}
 
-		bufPool = new Page[bufs];
-
-		int htsize = ((((int)(bufs * 1.2)) * 2) / 2) + 1;
-		hashTable = new BufHashTbl(htsize); // allocate the buffer hash table
-
-		clockHand = bufs - 1;
+		// A single partition holding every frame until enableNuma() is called
+		nodeFrames.push_back(0);
+		nodeFrames.push_back(bufs);
+		clockHands.push_back(bufs - 1);
+		hashTables.push_back(new BufHashTbl(hashTableSize())); // allocate the buffer hash table
+		asyncIo = NULL;
+		wal = NULL;
+		doubleWrite = NULL;
+		evictionBatch = 1;
+		policy = REPLACE_CLOCK;
+		useClock = 0;
+		victimCache = NULL;
+		ssdCache = NULL;
 	}
 
 	/**
@@ -51,32 +101,222 @@ namespace badgerdb {
 	 * @return
 	 */
 	BufMgr::~BufMgr() {
-		for (FrameId i = 0; i < numBufs; i++) {
+		while (!pendingReads.empty()) {
+			pollFetches(true);
+		}
+		std::vector<FrameId> dirtyFrames;
+		for (FrameId i = 0; i < poolBufs; i++) {
 			if (bufDescTable[i].dirty) {
-				bufDescTable[i].file->writePage(bufPool[i]);
-				bufDescTable[i].dirty = false;
+				dirtyFrames.push_back(i);
 			}
 		}
-		delete hashTable; // Deallocate the buffer hash table
-		delete[] bufDescTable; // Deallocate the bufDesc table
-		delete[] bufPool; // Deallocate the buﬀer pool
+		writeBack(dirtyFrames);
+		delete asyncIo;
+		delete victimCache;
+		for (std::size_t n = 0; n < hashTables.size(); n++) {
+			delete hashTables[n]; // Deallocate the buffer hash table partitions
+		}
+		delete poolMemory; // Deallocate the buﬀer pool and the bufDesc table (neither needs destruction)
+		delete descMemory;
 	}
 
 	/**
-	 * Advance clock to next frame in the buﬀer pool and ensure no overflow
-	 * 时钟移动函数，使时钟移动到下一个帧。用取余的方式来防止overflow
+	 * Switch batched reads and write-backs to an asynchronous I/O queue
+	 * The buffer pool is registered with the queue so single pages are read straight into their frames
+	 * 启用异步I/O队列，批量读写时同时提交多个请求
 	 *
-	 * @parameter
-	 * @return
+	 * @param queueDepth    Maximum number of reads or writes in flight at once
+	 * @param useIoUring    If false, use the preadv/pwritev path even if io_uring is available
+	 */
+	void BufMgr::enableAsyncIo(const unsigned queueDepth, const bool useIoUring)
+	{
+		// Reads started by fetchAsync() complete on the old queue
+		while (!pendingReads.empty()) {
+			pollFetches(true);
+		}
+		delete asyncIo;
+		asyncIo = new AsyncIo(queueDepth, useIoUring);
+		registerPool();
+	}
+
+	/**
+	 * Keep evicted pages compressed in memory, in a victim cache of the given size
+	 * 启用受害者缓存：被替换出的页面以LZ4压缩形式保存在内存中
+	 *
+	 * @param bytes    Memory for the compressed pages, 0 to drop the cache
+	 */
+	void BufMgr::enableVictimCache(const std::size_t bytes)
+	{
+		delete victimCache;
+		victimCache = NULL;
+		if (bytes > 0) {
+			victimCache = new VictimCache(bytes);
+		}
+	}
+
+	/**
+	 * Write clean evicted pages to a cache file on a fast device, and read misses from it first
+	 * 挂接SSD二级缓存：被替换出的干净页面异步写入本地快速设备上的缓存文件
+	 *
+	 * @param cache    SSD cache, NULL to detach it
+	 */
+	void BufMgr::attachSsdCache(SsdCache* cache)
+	{
+		ssdCache = cache;
+		if (ssdCache != NULL) {
+			// Whatever it holds may have changed in its files since
+			ssdCache->eraseFile(NULL);
+		}
+	}
+
+	/**
+	 * Fill a frame with a page missing from the buffer pool from the victim cache, else the SSD cache, counting hits
+	 * and misses
+	 *
+	 * @param file    File object
+	 * @param pageNo    Page number
+	 * @param frame    Frame the page is put in
+	 * @return    False if the page must be read from its file (also if there is no cache)
 	 */
-	void BufMgr::advanceClock()
+	bool BufMgr::readFromCaches(const File* file, const PageId pageNo, Page* frame)
 	{
-		clockHand = (clockHand + 1) % numBufs;
+		if (victimCache != NULL) {
+			if (victimCache->take(file, pageNo, frame)) {
+				bufStats.victimhits++;
+				return true;
+			}
+			bufStats.victimmisses++;
+		}
+		if (ssdCache != NULL) {
+			if (ssdCache->read(file, pageNo, frame)) {
+				bufStats.ssdhits++;
+				return true;
+			}
+			bufStats.ssdmisses++;
+		}
+		return false;
+	}
+
+	/**
+	 * Register the frames backed by memory with the asynchronous I/O queue
+	 * Called again whenever that memory changes, as the kernel keeps hold of the pages registered
+	 */
+	void BufMgr::registerPool()
+	{
+		if (asyncIo == NULL) {
+			return;
+		}
+		// Register the pool in pieces of whole frames well below the kernel's 1 GB limit per buffer
+		const std::size_t chunkFrames = (std::size_t(1) << 29) / sizeof(Page);
+		asyncIo->registerBuffers(bufPool, poolBufs * sizeof(Page), chunkFrames * sizeof(Page));
+	}
+
+	/**
+	 * Largest number of frames the buffer pool can grow to
+	 */
+	std::uint32_t BufMgr::capacity() const
+	{
+		const std::size_t frames = std::min(poolMemory->capacity() / sizeof(Page), descMemory->capacity() / sizeof(BufDesc));
+		return frames > UINT32_MAX ? UINT32_MAX : (std::uint32_t)frames;
+	}
+
+	/**
+	 * Change the number of frames while the buffer pool is in use
+	 * The pool and the BufDesc table grow and shrink in place, so pinned pages never move. Frames past the new size
+	 * that are unpinned are evicted right away, writing dirty ones back together; pinned ones stay readable and are
+	 * evicted by unPinPage() when their last pin goes. The hash table is resized incrementally
+	 * 在线调整缓冲池大小：扩大时增加帧，缩小时淘汰尾部的帧，被固定的帧在解除固定后再释放
+	 *
+	 * @param frames    New number of frames
+	 * @throws PoolResizeException    If frames is 0 or more than capacity()
+	 * @throws std::bad_alloc    If no memory can be had for the new frames
+	 */
+	void BufMgr::resize(const std::uint32_t frames)
+	{
+		if (frames == 0 || frames > capacity()) {
+			throw PoolResizeException(frames, capacity());
+		}
+		if (frames > poolBufs) {
+			if (!poolMemory->resize(std::size_t(frames) * sizeof(Page))) {
+				throw std::bad_alloc();
+			}
+			if (!descMemory->resize(std::size_t(frames) * sizeof(BufDesc))) {
+				poolMemory->resize(std::size_t(poolBufs) * sizeof(Page));
+				throw std::bad_alloc();
+			}
+			for (FrameId i = poolBufs; i < frames; i++) {
+				new (&bufPool[i]) Page();
+				new (&bufDescTable[i]) BufDesc();
+				bufDescTable[i].frameNo = i;
+			}
+			poolBufs = frames;
+			registerPool();
+		}
+		else {
+			std::vector<FrameId> evicted;
+			std::vector<FrameId> dirtyFrames;
+			for (FrameId k = frames; k < poolBufs; k++) {
+				if (bufDescTable[k].valid && bufDescTable[k].pinCnt == 0) {
+					evicted.push_back(k);
+					if (bufDescTable[k].dirty) {
+						dirtyFrames.push_back(k);
+					}
+				}
+			}
+			writeBack(dirtyFrames);
+			for (std::size_t f = 0; f < evicted.size(); f++) {
+				BufDesc& desc = bufDescTable[evicted[f]];
+				hashPartition(desc.file, desc.pageNo)->remove(desc.file, desc.pageNo);
+				desc.Clear();
+			}
+		}
+
+		numBufs = frames;
+		partitionFrames(std::min<std::size_t>(clockHands.size(), numBufs));
+		for (std::size_t n = 0; n < hashTables.size(); n++) {
+			hashTables[n]->resize(hashTableSize());
+		}
+		releaseRetiredFrames();
+	}
+
+	/**
+	 * Hand the memory of the unused frames at the end of the pool, past numBufs, back to the kernel
+	 */
+	void BufMgr::releaseRetiredFrames()
+	{
+		FrameId end = poolBufs;
+		while (end > numBufs && !bufDescTable[end - 1].valid) {
+			end--;
+		}
+		if (end == poolBufs) {
+			return;
+		}
+		poolBufs = end;
+		// Unregister the frames before their memory goes
+		registerPool();
+		poolMemory->resize(std::size_t(poolBufs) * sizeof(Page));
+		descMemory->resize(std::size_t(poolBufs) * sizeof(BufDesc));
+	}
+
+	/**
+	 * Advance the clock of a node to the next frame of its partition and ensure no overflow
+	 * 时钟移动函数，使该节点的时钟移动到它的下一个帧，到分区末尾时回到分区开头
+	 *
+	 * @param node    NUMA node whose clock is advanced
+	 */
+	void BufMgr::advanceClock(const unsigned node)
+	{
+		clockHands[node]++;
+		if (clockHands[node] == nodeFrames[node + 1]) {
+			clockHands[node] = nodeFrames[node];
+		}
 	}
 
 	/**
 	 * Allocates a free frame using the clock algorithm, if necessary, writing a dirty page back to disk.
-	 * 使用时钟算法分配空闲帧
+	 * In NUMA mode the partition of the requesting thread's node is swept first; the other nodes' partitions are only
+	 * used when every frame of the local one is pinned
+	 * 使用时钟算法分配空闲帧，NUMA模式下优先使用本节点的帧
 	 * 
 	 * @parameter frame    Frame reference, frame ID of allocated frame returned via this variable
 	 * @return
@@ -84,14 +324,39 @@ namespace badgerdb {
 	 */
 	void BufMgr::allocBuf(FrameId & frame) 
 	{
+		const unsigned local = requestingNode();
+		for (unsigned n = 0; n < clockHands.size(); n++) {
+			if (allocBufOnNode((local + n) % clockHands.size(), frame)) {
+				return;
+			}
+		}
+		//当所有的页面都被占用时，抛出异常
+		throw BufferExceededException();
+	}
+
+	/**
+	 * Runs the replacement policy over the frames of one node's partition: the clock algorithm, unless the pool
+	 * evicts its most recently used page (REPLACE_MRU)
+	 *
+	 * @param node    NUMA node whose partition is swept
+	 * @param frame    Frame reference, frame ID of allocated frame returned via this variable
+	 * @return    False if every frame of the partition is pinned
+	 */
+	bool BufMgr::allocBufOnNode(const unsigned node, FrameId & frame)
+	{
+		if (policy == REPLACE_MRU) {
+			return allocMruOnNode(node, frame);
+		}
+		const FrameId size = nodeFrames[node + 1] - nodeFrames[node];
+		FrameId& clockHand = clockHands[node];
 		while (true) {
-			for (int i = 0; i != (signed)numBufs; i++) {
-				advanceClock();
+			for (FrameId i = 0; i != size; i++) {
+				advanceClock(node);
 				//当某个帧的valid位为false时，说明这个页面不可用，
 				//它就可以被清理掉从而腾出需要的空闲帧，函数返回
 				if (!bufDescTable[clockHand].valid) {
 					frame = clockHand;
-					return;
+					return true;
 				}
 				//当某个帧的refbit位为true时，说明这个页面最近被使用过并且未被替换，
 				//因此该位置不是空闲帧，进入下一次循环
@@ -103,34 +368,226 @@ namespace badgerdb {
 				if (bufDescTable[clockHand].pinCnt > 0) {
 					continue;
 				}
-				//当某个帧的dirty位为true时，说明这个页面是脏的，应当将该页面写回磁盘
-				if (bufDescTable[clockHand].dirty) {
-					bufDescTable[clockHand].file->writePage(bufPool[clockHand]);
-				}            
-				try {
-					if (bufDescTable[clockHand].file) {
-						hashTable->remove(bufDescTable[clockHand].file, 
-						bufDescTable[clockHand].pageNo);
-						bufDescTable[clockHand].Clear();
-					}                  
-				}catch (HashNotFoundException &e) {
-					}
+				evictFrame(node, clockHand);
 				frame = clockHand;
-				return;                
+				return true;                
 			}
 
-			//当所有的页面都被占用时，抛出异常
+			//当本分区所有的页面都被占用时，返回false
 			bool allPinned = false;
-			for (int i = 0; i < (signed)numBufs; i++) {
-				if (!bufDescTable[i].pinCnt) {
+			for (FrameId k = nodeFrames[node]; k < nodeFrames[node + 1]; k++) {
+				if (!bufDescTable[k].pinCnt) {
 					allPinned = true;
 					break;
 				}
 			}
 			if (!allPinned) {
-				throw BufferExceededException();
+				return false;
+			}
+		}
+	}
+
+	/**
+	 * Pick the most recently used unpinned frame of one NUMA node's partition, after any free one (REPLACE_MRU)
+	 * 选择最近使用过的未固定帧作为替换对象，适合扫描为主的缓冲池
+	 *
+	 * @param node    Node whose frames are considered
+	 * @param frame   Frame reference, frame ID of allocated frame returned via this variable
+	 * @return    False if every frame of the partition is pinned
+	 */
+	bool BufMgr::allocMruOnNode(const unsigned node, FrameId & frame)
+	{
+		bool found = false;
+		FrameId victim = 0;
+		for (FrameId k = nodeFrames[node]; k < nodeFrames[node + 1]; k++) {
+			if (!bufDescTable[k].valid) {
+				frame = k;
+				return true;
+			}
+			if (bufDescTable[k].pinCnt == 0 && (!found || bufDescTable[k].lastUsed > bufDescTable[victim].lastUsed)) {
+				victim = k;
+				found = true;
+			}
+		}
+		if (!found) {
+			return false;
+		}
+		evictFrame(node, victim);
+		frame = victim;
+		return true;
+	}
+
+	/**
+	 * Empty an unpinned frame chosen for eviction: write it back if dirty, offer it to the victim and SSD caches and
+	 * remove it from the hash table
+	 * 清空被选中替换的帧：脏页写回磁盘，并从hash表中删除
+	 *
+	 * @param node    Node whose partition holds the frame
+	 * @param victim  Frame to empty
+	 */
+	void BufMgr::evictFrame(const unsigned node, const FrameId victim)
+	{
+		const FrameId size = nodeFrames[node + 1] - nodeFrames[node];
+		//当某个帧的dirty位为true时，说明这个页面是脏的，应当将该页面写回磁盘
+		const bool wasDirty = bufDescTable[victim].dirty;
+		const std::uint32_t batchSize = doubleWrite != NULL ? doubleWrite->capacity() : evictionBatch;
+		if (bufDescTable[victim].dirty && (doubleWrite != NULL || batchSize > 1)) {
+			// Clean the dirty unpinned frames following the victim along with it, so that a batch shares the
+			// syncs of the double-write buffer and of the files
+			std::vector<FrameId> batch(1, victim);
+			for (FrameId i = 1; i < size && batch.size() < batchSize; i++) {
+				const FrameId k = nodeFrames[node] + (victim - nodeFrames[node] + i) % size;
+				if (bufDescTable[k].valid && bufDescTable[k].dirty && bufDescTable[k].pinCnt == 0) {
+					batch.push_back(k);
+				}
+			}
+			writeBack(batch);
+		}
+		else if (bufDescTable[victim].dirty) {
+			forceLog(bufPool[victim].page_lsn());
+			bufDescTable[victim].file->writePage(bufPool[victim]);
+			bufStats.diskwrites++;
+		}            
+		try {
+			if (bufDescTable[victim].file) {
+				// The page is clean by now, so the copy kept is the same as in its file
+				if (victimCache != NULL) {
+					victimCache->insert(bufDescTable[victim].file, bufDescTable[victim].pageNo,
+						bufPool[victim]);
+				}
+				// A page changed since it was cached was dropped from the SSD cache when written back
+				if (ssdCache != NULL && (wasDirty ||
+						!ssdCache->contains(bufDescTable[victim].file, bufDescTable[victim].pageNo))) {
+					ssdCache->insert(bufDescTable[victim].file, bufDescTable[victim].pageNo,
+						bufPool[victim]);
+				}
+				hashPartition(bufDescTable[victim].file, bufDescTable[victim].pageNo)->remove(
+					bufDescTable[victim].file, bufDescTable[victim].pageNo);
+				bufDescTable[victim].Clear();
+			}                  
+		}catch (HashNotFoundException &e) {
+			}
+	}
+
+	/**
+	 * Split the buffer pool into one partition per NUMA node
+	 * Each node gets an equal, contiguous share of the frames and of the BufDesc table, bound to its memory, its own
+	 * clock hand and a hash table partition built while running on it. Pages are spread over the hash partitions by
+	 * hash value; frames for new pages come from the requesting thread's node while it has unpinned frames.
+	 * Nodes the machine does not have are simulated: their memory is not bound, and threads pick a node with
+	 * setThreadNode()
+	 * 按NUMA节点划分缓冲池：每个节点有自己的帧、BufDesc、时钟和hash分区
+	 *
+	 * @param nodes    Number of nodes, 0 for as many as the machine has
+	 * @throws PagePinnedException    If any page is pinned (the pool is flushed first)
+	 */
+	void BufMgr::enableNuma(const unsigned nodes)
+	{
+		flushAll();
+
+		unsigned count = nodes == 0 ? NumaTopology::nodeCount() : nodes;
+		if (count > numBufs) {
+			count = numBufs;
+		}
+		if (count == 0) {
+			count = 1;
+		}
+		partitionFrames(count);
+
+		for (std::size_t n = 0; n < hashTables.size(); n++) {
+			delete hashTables[n];
+		}
+		hashTables.clear();
+		for (unsigned node = 0; node < count; node++) {
+			// First touch of the partition's buckets from the node itself
+			NodeAffinity onNode(node);
+			hashTables.push_back(new BufHashTbl(hashTableSize()));
+		}
+	}
+
+	/**
+	 * Split the frames into count equal, contiguous partitions with their own clock hands, binding the frames and
+	 * BufDesc entries of each to its node's memory
+	 *
+	 * @param count    Number of partitions
+	 */
+	void BufMgr::partitionFrames(const unsigned count)
+	{
+		nodeFrames.clear();
+		clockHands.clear();
+		for (unsigned node = 0; node < count; node++) {
+			const FrameId first = (FrameId)((std::uint64_t)numBufs * node / count);
+			const FrameId last = (FrameId)((std::uint64_t)numBufs * (node + 1) / count);
+			nodeFrames.push_back(first);
+			clockHands.push_back(last - 1);
+			for (FrameId f = first; f < last; f++) {
+				bufDescTable[f].node = node;
+			}
+			if (count > 1) {
+				NumaTopology::bindMemory(&bufPool[first], (last - first) * sizeof(Page), node);
+				NumaTopology::bindMemory(&bufDescTable[first], (last - first) * sizeof(BufDesc), node);
 			}
 		}
+		nodeFrames.push_back(numBufs);
+	}
+
+	/**
+	 * Number of buckets of each hash table partition: 1.2 per frame of a node's share of the pool
+	 */
+	int BufMgr::hashTableSize() const
+	{
+		return (int)(numBufs / clockHands.size() * 1.2) + 1;
+	}
+
+	/**
+	 * Set the NUMA node the calling thread counts as running on, overriding the node of its CPU
+	 * 设置当前线程所属的（模拟）NUMA节点
+	 *
+	 * @param node    Node number, or -1 to use the node of the CPU again
+	 */
+	void BufMgr::setThreadNode(const int node)
+	{
+		threadNode = node;
+	}
+
+	/**
+	 * Node whose partition the calling thread allocates frames from
+	 */
+	unsigned BufMgr::requestingNode() const
+	{
+		if (clockHands.size() == 1) {
+			return 0;
+		}
+		const unsigned node = threadNode >= 0 ? (unsigned)threadNode : NumaTopology::currentNode();
+		return node % clockHands.size();
+	}
+
+	/**
+	 * Count an access to a frame as local or remote to the requesting thread (NUMA mode only)
+	 */
+	void BufMgr::countAccess(const FrameId frame)
+	{
+		bufDescTable[frame].lastUsed = ++useClock;
+		if (clockHands.size() == 1) {
+			return;
+		}
+		if (bufDescTable[frame].node == requestingNode()) {
+			bufStats.localaccesses++;
+		}
+		else {
+			bufStats.remoteaccesses++;
+		}
+	}
+
+	/**
+	 * Hash table partition holding the given page
+	 */
+	BufHashTbl* BufMgr::hashPartition(const File* file, const PageId pageNo)
+	{
+		if (hashTables.size() == 1) {
+			return hashTables[0];
+		}
+		return hashTables[(reinterpret_cast<std::uintptr_t>(file) / sizeof(void*) + pageNo) % hashTables.size()];
 	}
 
 	/**
@@ -146,24 +603,177 @@ namespace badgerdb {
 	void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 	{
 		FrameId id;
+		page = pinPage(file, pageNo, id);
+	}
+
+	/**
+	 * Pin the given page, reading it into a frame if it is not in the buffer pool, and return it
+	 * 固定给定页面（必要时读入帧），并返回页面和帧号
+	 *
+	 * @param file    File object
+	 * @param pageNo    Page number in the file to be read
+	 * @param id    Frame holding the page, returned via this reference (left alone for mapped files)
+	 * @return    Pointer to the page
+	 */
+	Page* BufMgr::pinPage(File* file, const PageId pageNo, FrameId& id)
+	{
+		bufStats.accesses++;
+		if (file->isMapped()) {
+			// Pages of mapped files are not copied into frames; the page is a view into the mapping
+			std::vector<std::uint32_t>& pins = mappedPins[file];
+			Page* page = const_cast<Page*>(file->mappedPage(pageNo));
+			if (pins.size() <= pageNo) {
+				pins.resize(pageNo + 1);
+			}
+			pins[pageNo]++;
+			return page;
+		}
+		awaitFetch(file, pageNo);
 		try {
 			// Page is in the buffer pool
-			hashTable->lookup(file, pageNo, id);
+			hashPartition(file, pageNo)->lookup(file, pageNo, id);
 			bufDescTable[id].pinCnt++;
 		}
 		catch (HashNotFoundException e) {
 			// Page is not in the buffer pool.
 			// Allocate a buffer frame. Read the page from disk
 			// Insert the page into the hashtable. Set the frame
-			Page pageTemp = file->readPage(pageNo);
+			// The page is read straight into the frame; if the read fails the frame is left free
 			this->allocBuf(id);
-			bufPool[id] = pageTemp;
-			hashTable->insert(file, pageNo, id);
-			bufDescTable[id].Set(file, pageNo);
+			Page* frame = &bufPool[id];
+			if (!readFromCaches(file, pageNo, frame)) {
+				file->readPages(pageNo, 1, &frame);
+				bufStats.diskreads++;
+			}
+			hashPartition(file, pageNo)->insert(file, pageNo, id);
+			bufDescTable[id].Set(file, pageNo, logEnd());
 		}
+		countAccess(id);
 		bufDescTable[id].refbit = true;
 		// Return a pointer to the frame containing the page
-		page = &bufPool[id];
+		return &bufPool[id];
+	}
+
+	/**
+	 * Read several pages of a file into the buffer pool at once and return pointers to all of them, pinned
+	 * Hits are pinned in one pass over the hash table, frames for all misses are taken from one clock sweep and
+	 * the misses are read in page number order, coalescing runs of consecutive pages into one read each
+	 * 批量读取页面：先一次查找hash表，再一次分配所有需要的帧，最后按页号排序合并连续页面读取
+	 *
+	 * @param file    File object
+	 * @param pageNos    Array of page numbers in the file to be read
+	 * @param count    Number of entries in pageNos
+	 * @param pages    Array of page pointers, pointer to the frame holding pageNos[i] is returned in pages[i]
+	 * @throws BufferExceededException    If not enough frames can be allocated for the missing pages
+	 * @throws InvalidPageException    If any of the pages does not exist in the file
+	 */
+	void BufMgr::readPages(File* file, const PageId* pageNos, const std::uint32_t count, Page** pages)
+	{
+		if (file->isMapped()) {
+			// Nothing to read, so no batching to do
+			std::uint32_t i = 0;
+			try {
+				for (; i < count; i++) {
+					readPage(file, pageNos[i], pages[i]);
+				}
+			}
+			catch (...) {
+				while (i > 0) {
+					i--;
+					unPinPage(file, pageNos[i], false);
+				}
+				throw;
+			}
+			return;
+		}
+
+		// Pages found in the buffer pool, and (page number, position in pageNos) of those that were not
+		std::vector<FrameId> hits;
+		std::vector<std::pair<PageId, std::uint32_t> > misses;
+		for (std::uint32_t i = 0; i < count; i++) {
+			FrameId id;
+			bufStats.accesses++;
+			awaitFetch(file, pageNos[i]);
+			try {
+				hashPartition(file, pageNos[i])->lookup(file, pageNos[i], id);
+				bufDescTable[id].pinCnt++;
+				bufDescTable[id].refbit = true;
+				countAccess(id);
+				pages[i] = &bufPool[id];
+				hits.push_back(id);
+			}
+			catch (HashNotFoundException&) {
+				misses.push_back(std::make_pair(pageNos[i], i));
+			}
+		}
+		std::sort(misses.begin(), misses.end());
+
+		// Frames assigned to the distinct missing pages, in page number order
+		std::vector<FrameId> frames;
+		std::vector<PageId> framePages;
+		try {
+			for (std::size_t m = 0; m < misses.size(); m++) {
+				const PageId pageNo = misses[m].first;
+				if (!framePages.empty() && framePages.back() == pageNo) {
+					// Same page requested again, pin it once more
+					bufDescTable[frames.back()].pinCnt++;
+				}
+				else {
+					FrameId id;
+					allocBuf(id);
+					hashPartition(file, pageNo)->insert(file, pageNo, id);
+					bufDescTable[id].Set(file, pageNo, logEnd());
+					frames.push_back(id);
+					framePages.push_back(pageNo);
+				}
+				countAccess(frames.back());
+				pages[misses[m].second] = &bufPool[frames.back()];
+			}
+
+			// Pages kept in the victim or SSD cache need no read
+			std::vector<FrameId> readFrames;
+			std::vector<PageId> readPageNos;
+			for (std::size_t f = 0; f < frames.size(); f++) {
+				if (!readFromCaches(file, framePages[f], &bufPool[frames[f]])) {
+					readFrames.push_back(frames[f]);
+					readPageNos.push_back(framePages[f]);
+				}
+			}
+
+			if (asyncIo != NULL && !readFrames.empty()) {
+				// All runs in flight at once
+				std::vector<Page*> framePtrs;
+				for (std::size_t f = 0; f < readFrames.size(); f++) {
+					framePtrs.push_back(&bufPool[readFrames[f]]);
+				}
+				file->readPages(*asyncIo, &readPageNos[0], readFrames.size(), &framePtrs[0]);
+				bufStats.diskreads += readFrames.size();
+			}
+			else {
+				// Read the missing pages, one File::readPages() call per run of consecutive page numbers
+				std::vector<Page*> run;
+				for (std::size_t f = 0; f < readFrames.size(); f += run.size()) {
+					run.clear();
+					do {
+						run.push_back(&bufPool[readFrames[f + run.size()]]);
+					} while (f + run.size() < readFrames.size() &&
+							readPageNos[f + run.size()] == readPageNos[f] + run.size());
+					file->readPages(readPageNos[f], run.size(), &run[0]);
+					bufStats.diskreads += run.size();
+				}
+			}
+		}
+		catch (...) {
+			// Leave nothing pinned: release the frames taken for misses and the pins on hits
+			for (std::size_t f = 0; f < frames.size(); f++) {
+				hashPartition(file, framePages[f])->remove(file, framePages[f]);
+				bufDescTable[frames[f]].Clear();
+			}
+			for (std::size_t h = 0; h < hits.size(); h++) {
+				bufDescTable[hits[h]].pinCnt--;
+			}
+			throw;
+		}
 	}
 
 	/**
@@ -177,26 +787,326 @@ namespace badgerdb {
 	 */
 	void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
 	{
+		if (file->isMapped()) {
+			std::map<const File*, std::vector<std::uint32_t> >::iterator pins = mappedPins.find(file);
+			if (pins == mappedPins.end() || pins->second.size() <= pageNo || pins->second[pageNo] == 0) {
+				// The page has no frame, which numBufs stands for
+				throw PageNotPinnedException(file->filename(), pageNo, numBufs);
+			}
+			pins->second[pageNo]--;
+			if (dirty) {
+				throw ReadOnlyFileException(file->filename());
+			}
+			return;
+		}
 		// the frame number of the page
 		FrameId frameId;
 		try {
-			hashTable->lookup(file, pageNo, frameId);
+			hashPartition(file, pageNo)->lookup(file, pageNo, frameId);
 		}
 		catch (HashNotFoundException e) {
 			return; // Throw HashNotFoundException if page is not found in the hash table lookup but nothing needs to do
 		}
+		unPinFrame(frameId, dirty);
+	}
+
+	/**
+	 * Unpin the page held by a frame, without looking the page up in the hash table
+	 * 按帧号解除固定，不需要再查找hash表
+	 *
+	 * @param frameId    Frame holding the page
+	 * @param dirty    True if the page needs to be marked dirty
+	 * @throws PageNotPinnedException    If the page is not already pinned
+	 */
+	void BufMgr::unPinFrame(const FrameId frameId, const bool dirty)
+	{
+		BufDesc& desc = bufDescTable[frameId];
 		// Throw PageNotPinnedException if the pin count is already 0
-		if (bufDescTable[frameId].pinCnt == 0) {
-			throw PageNotPinnedException(file->filename(), pageNo, frameId);
+		if (desc.pinCnt == 0) {
+			throw PageNotPinnedException(desc.file->filename(), desc.pageNo, frameId);
 		}
-		bufDescTable[frameId].pinCnt--;
+		desc.pinCnt--;
 		if (dirty) {
-			bufDescTable[frameId].dirty = true; // If dirty is true, set the dirty bit
+			desc.dirty = true; // If dirty is true, set the dirty bit
+		}
+		else if (desc.pinCnt == 0 && !desc.dirty && wal != NULL) {
+			// Unpinned and unchanged: any change from now on is logged after the current end of the log
+			desc.recLsn = wal->endLsn();
+		}
+		if (frameId >= numBufs && desc.pinCnt == 0) {
+			// Last pin of a frame the pool shrank past: write it back and let its memory go
+			if (desc.dirty) {
+				std::vector<FrameId> retired(1, frameId);
+				writeBack(retired);
+			}
+			hashPartition(desc.file, desc.pageNo)->remove(desc.file, desc.pageNo);
+			desc.Clear();
+			releaseRetiredFrames();
+		}
+	}
+
+	/**
+	 * End of the write-ahead log, 0 without one
+	 */
+	Lsn BufMgr::logEnd() const
+	{
+		return wal != NULL ? wal->endLsn() : 0;
+	}
+
+	/**
+	 * Flush the write-ahead log, if one is attached, far enough that the record of the given page LSN is durable
+	 * 写回脏页之前，先把日志刷到该页面LSN为止（先写日志原则）
+	 *
+	 * @param pageLsn    Highest page LSN of the pages about to be written
+	 */
+	void BufMgr::forceLog(const Lsn pageLsn)
+	{
+		if (wal == NULL || pageLsn == 0 || pageLsn < wal->flushedLsn()) {
+			return;
+		}
+		wal->flush(pageLsn);
+		bufStats.logflushes++;
+	}
+
+	/**
+	 * Write the given dirty frames back to disk as a group and clear their dirty bits
+	 * Frames are sorted by (file, page number) so that runs of consecutive pages go out in one write,
+	 * and each file is synced once at the end instead of after every page
+	 * Pinned frames may be in use, so a copy of the page is taken and written instead of the frame itself
+	 * 分组写回脏页：按文件和页号排序，连续的页面合并为一次写操作，最后每个文件只同步一次
+	 *
+	 * @param frames    Frames to write back, reordered by this call
+	 */
+	void BufMgr::writeBack(std::vector<FrameId> & frames)
+	{
+		const BufDesc* desc = bufDescTable;
+		std::sort(frames.begin(), frames.end(), [desc](FrameId a, FrameId b) {
+			if (desc[a].file != desc[b].file) {
+				return desc[a].file < desc[b].file;
+			}
+			return desc[a].pageNo < desc[b].pageNo;
+		});
+
+		// Changes made after the pages are taken below are logged after this
+		const Lsn written = logEnd();
+		// Pinned frames may be changed by their holders at any time, so they are copied under a shared latch, and
+		// the latch version is kept to tell later whether a writer got in after the copy. A frame latched
+		// exclusively is skipped and stays dirty: callers hold the BufMgr mutex here, and by the threading rule of
+		// the class a latch holder may be waiting for that mutex, so waiting for its latch could deadlock.
+		std::vector<FrameId> taken;
+		std::vector<const Page*> images;
+		std::vector<std::uint64_t> versions;
+		std::vector<Page> copies;
+		copies.reserve(frames.size());
+		for (std::size_t f = 0; f < frames.size(); f++) {
+			FrameLatch& latch = bufDescTable[frames[f]].latch;
+			if (!latch.tryLockShared()) {
+				continue;
+			}
+			if (bufDescTable[frames[f]].pinCnt > 0) {
+				copies.push_back(bufPool[frames[f]]);
+				images.push_back(&copies.back());
+			}
+			else {
+				images.push_back(&bufPool[frames[f]]);
+			}
+			versions.push_back(latch.readVersion());
+			latch.unlockShared();
+			taken.push_back(frames[f]);
+		}
+		frames.swap(taken);
+
+		// One log flush covers the whole group
+		Lsn maxLsn = 0;
+		for (std::size_t f = 0; f < images.size(); f++) {
+			maxLsn = std::max(maxLsn, images[f]->page_lsn());
+		}
+		forceLog(maxLsn);
+		if (ssdCache != NULL) {
+			// The copies kept are out of date once the pages are written
+			for (std::size_t f = 0; f < frames.size(); f++) {
+				ssdCache->erase(bufDescTable[frames[f]].file, bufDescTable[frames[f]].pageNo);
+			}
+		}
+		if (doubleWrite != NULL) {
+			writeBackDoubled(frames, images, versions, written);
+			return;
+		}
+
+		std::size_t count;
+		for (std::size_t f = 0; f < frames.size(); f += count) {
+			// Pages of one file, in page number order
+			File* file = bufDescTable[frames[f]].file;
+			count = 0;
+			while (f + count < frames.size() && bufDescTable[frames[f + count]].file == file) {
+				count++;
+			}
+			const Page* const* pages = &images[f];
+
+			if (asyncIo != NULL) {
+				file->writePages(*asyncIo, pages, count);
+			}
+			else {
+				// One File::writePages() call per run of consecutive page numbers
+				std::size_t run;
+				for (std::size_t r = 0; r < count; r += run) {
+					run = 1;
+					while (r + run < count && pages[r + run]->page_number() == pages[r]->page_number() + run) {
+						run++;
+					}
+					file->writePages(pages[r]->page_number(), run, &pages[r]);
+				}
+			}
+			bufStats.diskwrites += count;
+			file->sync();
+			for (std::size_t r = f; r < f + count; r++) {
+				markWritten(frames[r], versions[r], written);
+			}
 		}
 	}
 
 	/**
-	 * Write out all dirty pages of the file to disk
+	 * Mark a frame written back clean, unless a writer latched it since its image was taken
+	 * 若取页面映像后没有写者修改该帧，则将其标记为干净
+	 *
+	 * @param frame    Frame written back
+	 * @param version    Latch version when its image was taken
+	 * @param written    Recovery LSN of the frame once written
+	 */
+	void BufMgr::markWritten(const FrameId frame, const std::uint64_t version, const Lsn written)
+	{
+		if (bufDescTable[frame].latch.validate(version)) {
+			bufDescTable[frame].dirty = false;
+			bufDescTable[frame].recLsn = written;
+		}
+	}
+
+	/**
+	 * Write the given dirty frames back through the double-write buffer, a batch of its capacity at a time
+	 * Each batch is laid out in the buffer as it will be on disk, written to the double-write file and synced, and
+	 * only then written home, so a crash leaves every page whole in one place or the other
+	 * 经由双写缓冲区分批写回脏页：先顺序写入双写文件并同步，再写回各页面原位置，防止页面写坏
+	 *
+	 * @param frames    Frames to write back, sorted by file and page number
+	 * @param images    Pages to write for the frames, copies for pinned ones
+	 * @param versions    Latch versions of the frames when their images were taken
+	 * @param written    Recovery LSN of the frames once written
+	 */
+	void BufMgr::writeBackDoubled(const std::vector<FrameId> & frames, const std::vector<const Page*> & images,
+			const std::vector<std::uint64_t> & versions, const Lsn written)
+	{
+		struct Run {
+			File* file;
+			PageId first;
+			std::uint32_t count;
+			const char* raw;
+		};
+		std::vector<Run> runs;
+		std::vector<File*> files;
+		for (std::size_t f = 0; f < frames.size();) {
+			// Lay out a batch of runs of consecutive pages in the double-write buffer
+			doubleWrite->clear();
+			runs.clear();
+			std::size_t end = f;
+			while (end < frames.size() && doubleWrite->size() < doubleWrite->capacity()) {
+				const BufDesc& first = bufDescTable[frames[end]];
+				std::uint32_t count = 1;
+				while (end + count < frames.size() && doubleWrite->size() + count < doubleWrite->capacity() &&
+						bufDescTable[frames[end + count]].file == first.file &&
+						bufDescTable[frames[end + count]].pageNo == first.pageNo + count) {
+					count++;
+				}
+				char* raw = doubleWrite->add(first.file, first.pageNo, count);
+				first.file->assemblePages(first.pageNo, count, &images[end], raw);
+				const Run run = {first.file, first.pageNo, count, raw};
+				runs.push_back(run);
+				end += count;
+			}
+			doubleWrite->write();
+
+			// Then home
+			files.clear();
+			for (std::size_t r = 0; r < runs.size(); r++) {
+				runs[r].file->writeAssembled(runs[r].first, runs[r].count, runs[r].raw);
+				if (files.empty() || files.back() != runs[r].file) {
+					files.push_back(runs[r].file);
+				}
+			}
+			for (std::size_t k = 0; k < files.size(); k++) {
+				files[k]->sync();
+			}
+			for (std::size_t r = f; r < end; r++) {
+				markWritten(frames[r], versions[r], written);
+			}
+			bufStats.diskwrites += end - f;
+			doubleWrite->clear();
+			f = end;
+		}
+	}
+
+	/**
+	 * Write out all dirty pages of a file, or of all files, to disk and evict their frames from the buffer pool
+	 * All the frames need to be unpinned before this function be successfully called, otherwise error
+	 * and nothing is written
+	 *
+	 * @param file    File object, NULL for all files
+	 * @throws PagePinnedException    If any of the frames is pinned
+	 * @throws BadBufferException    If any of the frames is invalid
+	 */
+	void BufMgr::flushFrames(const File* file)
+	{
+		std::vector<FrameId> frames;
+		std::vector<FrameId> dirtyFrames;
+		for (FrameId k = 0; k < poolBufs; k++) {
+			if (bufDescTable[k].file == NULL || (file != NULL && bufDescTable[k].file != file)) {
+				continue;
+			}
+			if (bufDescTable[k].pinCnt > 0) {
+				throw PagePinnedException(bufDescTable[k].file->filename(), bufDescTable[k].pageNo, k);
+			}
+			else if (!bufDescTable[k].valid) {
+				throw BadBufferException(k, bufDescTable[k].dirty, bufDescTable[k].valid, bufDescTable[k].refbit);
+			}
+			frames.push_back(k);
+			if (bufDescTable[k].dirty) {
+				dirtyFrames.push_back(k);
+			}
+		}
+		// Pinned pages of mapped files count too, though they have no frame (numBufs stands for it)
+		for (std::map<const File*, std::vector<std::uint32_t> >::iterator it = mappedPins.begin(); it != mappedPins.end(); ++it) {
+			if (file != NULL && it->first != file) {
+				continue;
+			}
+			for (PageId p = 0; p < it->second.size(); p++) {
+				if (it->second[p] > 0) {
+					throw PagePinnedException(it->first->filename(), p, numBufs);
+				}
+			}
+		}
+
+		writeBack(dirtyFrames);
+		// The File object may be gone, and its address reused, once its pages are flushed
+		if (victimCache != NULL) {
+			victimCache->eraseFile(file);
+		}
+		if (ssdCache != NULL) {
+			ssdCache->eraseFile(file);
+		}
+		if (file == NULL) {
+			mappedPins.clear();
+		}
+		else {
+			mappedPins.erase(file);
+		}
+		for (std::size_t f = 0; f < frames.size(); f++) {
+			hashPartition(bufDescTable[frames[f]].file, bufDescTable[frames[f]].pageNo)->remove(
+				bufDescTable[frames[f]].file, bufDescTable[frames[f]].pageNo);
+			bufDescTable[frames[f]].Clear();
+		}
+	}
+
+	/**
+	 * Write out all dirty pages of the file to disk and evict the file's pages from the buffer pool
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function be successfully called
 	 * Otherwise error
 	 * 将文件中的所有脏页写回到磁盘。
@@ -205,25 +1115,118 @@ namespace badgerdb {
 	 */
 	void BufMgr::flushFile(const File* file)
 	{
-		// Flush file to disk
-		for (FrameId k = 0; k < numBufs; k++) {
-			if (bufDescTable[k].file == file) {
-				if (bufDescTable[k].pinCnt > 0) {
-					throw PagePinnedException(file->filename(), bufDescTable[k].pageNo, k);
-				}
-				else if (!bufDescTable[k].valid) {
-					throw BadBufferException(k, bufDescTable[k].dirty, bufDescTable[k].valid, bufDescTable[k].refbit);
-				}
-				else {
-					if (bufDescTable[k].dirty) {
-						bufDescTable[k].file->writePage(bufPool[k]);
-						bufDescTable[k].dirty = false;
-					}
-					hashTable->remove(file, bufDescTable[k].pageNo);
-					bufDescTable[k].Clear();
-				}
+		flushFrames(file);
+	}
+
+	/**
+	 * Write out all dirty pages in the buffer pool to disk and evict every page
+	 * 将缓冲池中的所有脏页写回到磁盘。
+	 */
+	void BufMgr::flushAll()
+	{
+		flushFrames(NULL);
+	}
+
+	/**
+	 * Write out all dirty pages of a file, or of all files, to disk and keep them in the buffer pool
+	 * Pinned pages are written as well
+	 *
+	 * @param file    File object, NULL for all files
+	 */
+	void BufMgr::checkpointFrames(const File* file)
+	{
+		std::vector<FrameId> dirtyFrames;
+		for (FrameId k = 0; k < poolBufs; k++) {
+			if (bufDescTable[k].valid && bufDescTable[k].dirty &&
+					(file == NULL || bufDescTable[k].file == file)) {
+				dirtyFrames.push_back(k);
 			}
 		}
+		writeBack(dirtyFrames);
+	}
+
+	/**
+	 * Write out all dirty pages of the file to disk without evicting them from the buffer pool
+	 * 将文件中的所有脏页写回到磁盘，但页面仍保留在缓冲池中。
+	 *
+	 * @param file    File object
+	 */
+	void BufMgr::checkpoint(const File* file)
+	{
+		checkpointFrames(file);
+	}
+
+	/**
+	 * Write out all dirty pages in the buffer pool to disk without evicting them
+	 * 将缓冲池中的所有脏页写回到磁盘，但页面仍保留在缓冲池中。
+	 */
+	void BufMgr::checkpointAll()
+	{
+		checkpointFrames(NULL);
+	}
+
+	/**
+	 * Oldest recovery LSN of the dirty frames, and of the pinned ones, which their holders may have changed without
+	 * unpinning them yet
+	 * 脏页（及已固定、可能正被修改的页）中最早的恢复LSN，崩溃恢复的重做可以从这里开始
+	 *
+	 * @return    Oldest recovery LSN, 0 if no frame is dirty or pinned
+	 */
+	Lsn BufMgr::minRecLsn() const
+	{
+		Lsn oldest = 0;
+		bool found = false;
+		for (FrameId k = 0; k < poolBufs; k++) {
+			const BufDesc& desc = bufDescTable[k];
+			if (desc.valid && (desc.dirty || desc.pinCnt > 0) && (!found || desc.recLsn < oldest)) {
+				oldest = desc.recLsn;
+				found = true;
+			}
+		}
+		return oldest;
+	}
+
+	/**
+	 * Number of dirty frames whose recovery LSN is below lsn
+	 */
+	std::uint32_t BufMgr::dirtyBefore(const Lsn lsn) const
+	{
+		std::uint32_t count = 0;
+		for (FrameId k = 0; k < poolBufs; k++) {
+			if (bufDescTable[k].valid && bufDescTable[k].dirty && bufDescTable[k].recLsn < lsn) {
+				count++;
+			}
+		}
+		return count;
+	}
+
+	/**
+	 * Write back the dirty frames first dirtied before lsn, oldest first, up to maxFrames of them, leaving them in
+	 * the buffer pool
+	 * 按恢复LSN从旧到新写回脏页（不淘汰），供模糊检查点分批使用
+	 *
+	 * @param lsn    Frames whose recovery LSN is below this are written
+	 * @param maxFrames    Largest number of frames to write
+	 * @return    Number of frames written
+	 */
+	std::uint32_t BufMgr::writeOldest(const Lsn lsn, const std::uint32_t maxFrames)
+	{
+		std::vector<FrameId> dirtyFrames;
+		for (FrameId k = 0; k < poolBufs; k++) {
+			// Frames a writer holds are left for a later batch, so that they do not crowd out the next oldest
+			if (bufDescTable[k].valid && bufDescTable[k].dirty && bufDescTable[k].recLsn < lsn &&
+					!bufDescTable[k].latch.heldExclusive()) {
+				dirtyFrames.push_back(k);
+			}
+		}
+		if (dirtyFrames.size() > maxFrames) {
+			const BufDesc* desc = bufDescTable;
+			std::nth_element(dirtyFrames.begin(), dirtyFrames.begin() + maxFrames, dirtyFrames.end(),
+				[desc](FrameId a, FrameId b) { return desc[a].recLsn < desc[b].recLsn; });
+			dirtyFrames.resize(maxFrames);
+		}
+		writeBack(dirtyFrames);
+		return dirtyFrames.size();
 	}
 
 	/**
@@ -237,17 +1240,201 @@ namespace badgerdb {
 	void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 	{
 		FrameId frameId;
-		// Allocate an empty page in the specified file and obtain a buffer pool
-		PageId newPageId = file->allocatePage().page_number();
+		page = newPage(file, pageNo, frameId);
+	}
+
+	/**
+	 * Allocate a new, empty page in the file in a pinned frame
+	 * 在文件中分配新页面并放入一个被固定的帧
+	 *
+	 * @param file    File object
+	 * @param pageNo    Number of the new page, returned via this reference
+	 * @param frameId    Frame holding the page, returned via this reference
+	 * @return    Pointer to the page
+	 */
+	Page* BufMgr::newPage(File* file, PageId &pageNo, FrameId &frameId)
+	{
+		// Obtain a frame first, so that the file does not grow when the buffer pool is full,
+		// then allocate an empty page in the specified file
 		allocBuf(frameId);
+		PageId newPageId = file->allocatePage().page_number();
+		bufStats.accesses++;
+		bufStats.diskreads++;
 
 		// Set the hash table and frame.
 		bufPool[frameId] = file->readPage(newPageId);
-		hashTable->insert(file, newPageId, frameId);
-		bufDescTable[frameId].Set(file, newPageId);
+		hashPartition(file, newPageId)->insert(file, newPageId, frameId);
+		bufDescTable[frameId].Set(file, newPageId, logEnd());
+		countAccess(frameId);
 
 		pageNo = newPageId;
-		page = &bufPool[frameId];
+		return &bufPool[frameId];
+	}
+
+	/**
+	 * Pin the given page, as readPage() does, and return a guard unpinning it when it goes out of scope
+	 * 固定页面并返回PageGuard，离开作用域时自动解除固定
+	 *
+	 * @param file    File object
+	 * @param pageNo    Page number in the file to be read
+	 * @param mode    Latch to take on the frame
+	 * @return    Guard holding the pinned page
+	 */
+	PageGuard BufMgr::fetch(File* file, const PageId pageNo, const LatchMode mode)
+	{
+		FrameId frameId = 0;
+		Page* page = pinPage(file, pageNo, frameId);
+		PageGuard guard(this, file, pageNo, frameId, page);
+		guard.latch(mode);
+		return guard;
+	}
+
+	/**
+	 * Pin a page and hand it to a callback: right away if it is in the buffer pool, otherwise once pollFetches() finds
+	 * the read started here finished. The frame is claimed and the page entered in the hash table before the read is
+	 * started, so fetches of the page while it is read share the read
+	 * 异步固定页面：命中时立即回调，否则启动异步读，读完成后由pollFetches()回调；同一页面的并发请求共享一次读
+	 *
+	 * @param file    File object
+	 * @param pageNo    Page number in the file to be read
+	 * @param done    Called with the guard of the pinned page, or an empty guard and the exception of a failed read
+	 * @return    True if done was called before returning
+	 * @throws BufferExceededException    If no frame can be claimed for the page
+	 * @throws InvalidPageException    If the page does not exist in the file
+	 */
+	bool BufMgr::fetchAsync(File* file, const PageId pageNo, const FetchCallback& done)
+	{
+		if (asyncIo == NULL || file->isMapped() || file->isCompressed()) {
+			// Nothing to overlap the read with, or a read that has to be decompressed
+			done(fetch(file, pageNo), std::exception_ptr());
+			return true;
+		}
+
+		FrameId id;
+		bufStats.accesses++;
+		try {
+			hashPartition(file, pageNo)->lookup(file, pageNo, id);
+		}
+		catch (HashNotFoundException&) {
+			// The frame is left free if the read cannot be started
+			allocBuf(id);
+			if (readFromCaches(file, pageNo, &bufPool[id])) {
+				hashPartition(file, pageNo)->insert(file, pageNo, id);
+				bufDescTable[id].Set(file, pageNo, logEnd());
+				countAccess(id);
+				done(PageGuard(this, file, pageNo, id, &bufPool[id]), std::exception_ptr());
+				return true;
+			}
+			file->startReadPage(*asyncIo, pageNo, &bufPool[id], id);
+			hashPartition(file, pageNo)->insert(file, pageNo, id);
+			bufDescTable[id].Set(file, pageNo, logEnd());
+			countAccess(id);
+			pendingReads[id].push_back(done);
+			return false;
+		}
+		bufDescTable[id].pinCnt++;
+		bufDescTable[id].refbit = true;
+		countAccess(id);
+		std::map<FrameId, std::vector<FetchCallback> >::iterator pending = pendingReads.find(id);
+		if (pending != pendingReads.end()) {
+			// Being read already: wait for the same read
+			pending->second.push_back(done);
+			return false;
+		}
+		done(PageGuard(this, file, pageNo, id, &bufPool[id]), std::exception_ptr());
+		return true;
+	}
+
+	/**
+	 * Hand the pages of finished reads started by fetchAsync() to their callbacks
+	 * A frame whose read failed is freed, and its callbacks get the error
+	 * 处理已完成的异步读，调用等待该页面的回调函数
+	 *
+	 * @param wait    If true and no read has finished yet, wait for one
+	 * @return    Number of callbacks called
+	 */
+	std::size_t BufMgr::pollFetches(const bool wait)
+	{
+		if (pendingReads.empty()) {
+			return 0;
+		}
+		std::vector<AsyncIo::Completion> completions;
+		asyncIo->poll(completions, wait);
+
+		std::size_t called = 0;
+		for (std::size_t c = 0; c < completions.size(); c++) {
+			const FrameId id = (FrameId)completions[c].tag;
+			std::vector<FetchCallback> waiters;
+			waiters.swap(pendingReads[id]);
+			pendingReads.erase(id);
+
+			BufDesc& desc = bufDescTable[id];
+			File* file = desc.file;
+			const PageId pageNo = desc.pageNo;
+			std::exception_ptr error;
+			if (completions[c].error != 0) {
+				error = std::make_exception_ptr(IoException("read", completions[c].error));
+			}
+			else {
+				try {
+					file->finishReadPage(pageNo, &bufPool[id]);
+					bufStats.diskreads++;
+				}
+				catch (...) {
+					error = std::current_exception();
+				}
+			}
+			if (error) {
+				hashPartition(file, pageNo)->remove(file, pageNo);
+				desc.Clear();
+			}
+			// Every waiter holds one of the frame's pins
+			for (std::size_t w = 0; w < waiters.size(); w++) {
+				if (error) {
+					waiters[w](PageGuard(), error);
+				}
+				else {
+					waiters[w](PageGuard(this, file, pageNo, id, &bufPool[id]), std::exception_ptr());
+				}
+			}
+			called += waiters.size();
+		}
+		return called;
+	}
+
+	/**
+	 * Wait until the page is no longer being read by fetchAsync()
+	 */
+	void BufMgr::awaitFetch(const File* file, const PageId pageNo)
+	{
+		while (!pendingReads.empty()) {
+			FrameId id;
+			try {
+				hashPartition(file, pageNo)->lookup(file, pageNo, id);
+			}
+			catch (HashNotFoundException&) {
+				return;
+			}
+			if (pendingReads.count(id) == 0) {
+				return;
+			}
+			pollFetches(true);
+		}
+	}
+
+	/**
+	 * Allocate a new page, as allocPage() does, and return a guard unpinning it when it goes out of scope
+	 * 分配新页面并返回PageGuard
+	 *
+	 * @param file    File object
+	 * @return    Guard holding the new, pinned page; PageGuard::page_number() tells its number
+	 */
+	PageGuard BufMgr::allocate(File* file)
+	{
+		PageId pageNo;
+		FrameId frameId;
+		Page* page = newPage(file, pageNo, frameId);
+		return PageGuard(this, file, pageNo, frameId, page);
 	}
 
 	/**
@@ -259,15 +1446,22 @@ namespace badgerdb {
 	void BufMgr::disposePage(File* file, const PageId PageNo)
 	{
 		FrameId frameId;
+		awaitFetch(file, PageNo);
 		try {
 			// Makes sure that if the page to be deleted is allocated a frame in the buffer pool, that frame
 			// is freed and correspondingly entry from hash table is also removed.
-			hashTable->lookup(file, PageNo, frameId);
+			hashPartition(file, PageNo)->lookup(file, PageNo, frameId);
 			bufDescTable[frameId].Clear();
-			hashTable->remove(file, PageNo);
+			hashPartition(file, PageNo)->remove(file, PageNo);
 		}
 		catch (HashNotFoundException e) {
 		}
+		if (victimCache != NULL) {
+			victimCache->erase(file, PageNo);
+		}
+		if (ssdCache != NULL) {
+			ssdCache->erase(file, PageNo);
+		}
 
 		file->deletePage(PageNo);
 	}
@@ -277,7 +1471,7 @@ namespace badgerdb {
 		BufDesc* tmpbuf;
 		int validFrames = 0;
 
-		for (std::uint32_t i = 0; i < numBufs; i++)
+		for (std::uint32_t i = 0; i < poolBufs; i++)
 		{
 			tmpbuf = &(bufDescTable[i]);
 			std::cout << "FrameNo:" << i << " ";
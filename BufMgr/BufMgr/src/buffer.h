@@ -7,8 +7,17 @@
 
 #pragma once
 
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <vector>
+
 #include "file.h"
 #include "bufHashTbl.h"
+#include "pool_memory.h"
+#include "page_guard.h"
+#include "frame_latch.h"
 
 namespace badgerdb {
 
@@ -16,6 +25,28 @@ namespace badgerdb {
 * forward declaration of BufMgr class 
 */
 class BufMgr;
+class AsyncIo;
+class FetchAwaitable;
+class Wal;
+class DoubleWriteBuffer;
+class VictimCache;
+class SsdCache;
+
+/**
+ * @brief How a buffer pool picks the page to evict.
+ */
+enum ReplacementPolicy {
+  /**
+   * Clock: the first unpinned frame not referenced since the hand last passed it.
+   */
+  REPLACE_CLOCK,
+
+  /**
+   * Most recently used unpinned frame. A page read once by a scan makes room for the next page of the scan, so
+   * pages used before the scan stay in the pool.
+   */
+  REPLACE_MRU
+};
 
 /**
 * @brief Class for maintaining information about buffer pool frames
@@ -40,6 +71,11 @@ class BufDesc {
 	 */
   FrameId	frameNo;
 
+	/**
+   * NUMA node whose partition the frame belongs to (0 unless BufMgr::enableNuma() was called)
+	 */
+  unsigned node;
+
 	/**
    * Number of times this page has been pinned
 	 */
@@ -60,6 +96,23 @@ class BufDesc {
 	 */
   bool refbit;
 
+	/**
+   * Value of the buffer manager's access counter when the frame was last accessed (REPLACE_MRU)
+	 */
+  std::uint64_t lastUsed;
+
+	/**
+   * Shared/exclusive latch on the frame's contents and their version, in one word
+	 */
+  FrameLatch latch;
+
+	/**
+   * Recovery LSN. While the page is dirty: no log record before it changed the page since it was last written, so
+   * redo after a crash can start there. While clean: the log end when the frame was last known to match the page on
+   * disk, which becomes the recovery LSN when the page is dirtied. 0 without a write-ahead log.
+	 */
+  Lsn recLsn;
+
 	/**
    * Initialize buffer frame for a new user
 	 */
@@ -70,7 +123,9 @@ class BufDesc {
 		pageNo = Page::INVALID_NUMBER;
     dirty = false;
     refbit = false;
+		lastUsed = 0;
 		valid = false;
+		recLsn = 0;
   };
 
 	/**
@@ -79,11 +134,13 @@ class BufDesc {
 	 *
 	 * @param filePtr	File object
 	 * @param pageNum	Page number in the file
+	 * @param lsn		End of the write-ahead log as the page is read, or 0 without a log
 	 */
-  void Set(File* filePtr, PageId pageNum)
+  void Set(File* filePtr, PageId pageNum, Lsn lsn)
 	{ 
 		file = filePtr;
     pageNo = pageNum;
+    recLsn = lsn;
     pinCnt = 1;
     dirty = false;
     valid = true;
@@ -103,6 +160,7 @@ class BufDesc {
 		std::cout << "valid:" << valid << " ";
 		std::cout << "pinCnt:" << pinCnt << " ";
 		std::cout << "dirty:" << dirty << " ";
+		std::cout << "recLsn:" << recLsn << " ";
 		std::cout << "refbit:" << refbit << "\n";
   }
 
@@ -111,6 +169,7 @@ class BufDesc {
 	 */
   BufDesc()
 	{
+		node = 0;
   	Clear();
   }
 };
@@ -136,12 +195,44 @@ struct BufStats
 	 */
   int diskwrites;
 
+	/**
+   * Number of times a write-back had to flush the write-ahead log first
+	 */
+  int logflushes;
+
+	/**
+   * Accesses to frames on the requesting thread's NUMA node (NUMA mode only)
+	 */
+  int localaccesses;
+
+	/**
+   * Accesses to frames on another NUMA node than the requesting thread's (NUMA mode only)
+	 */
+  int remoteaccesses;
+
+	/**
+   * Pages missing from the buffer pool found in the victim cache, and not found there (victim cache enabled only)
+	 */
+  int victimhits;
+  int victimmisses;
+
+	/**
+   * Pages missing from the buffer pool (and victim cache) read from the SSD cache, and not found there (SSD cache
+   * attached only)
+	 */
+  int ssdhits;
+  int ssdmisses;
+
 	/**
    * Clear all values 
 	 */
   void clear()
   {
 		accesses = diskreads = diskwrites = 0;
+		logflushes = 0;
+		localaccesses = remoteaccesses = 0;
+		victimhits = victimmisses = 0;
+		ssdhits = ssdmisses = 0;
   }
       
 	/**
@@ -156,39 +247,121 @@ struct BufStats
 
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* @warning This class is not threadsafe.  Callers sharing it between threads serialize every call with one mutex, and
+*          take page latches (PageGuard::latch(), PageLatch) only after letting go of that mutex: a latch holder may
+*          be waiting for the mutex.  Pin pages to be latched with fetch() and LATCH_NONE.
 */
 class BufMgr 
 {
+	friend class PageGuard;
+
  private:
 	/**
-   * Current position of clockhand in our buffer pool
+   * Current position of the clockhand of every NUMA node's partition of the buffer pool (a single one outside NUMA mode)
 	 */
-  FrameId clockHand;
+  std::vector<FrameId> clockHands;
+
+	/**
+   * First frame of every NUMA node's partition, followed by numBufs
+	 */
+  std::vector<FrameId> nodeFrames;
 
 	/**
    * Number of frames in the buffer pool
 	 */
   std::uint32_t numBufs;
+
+	/**
+   * Number of frames backed by memory: numBufs, plus frames past numBufs that were still pinned when the pool
+   * shrank and are released once unpinned
+	 */
+  std::uint32_t poolBufs;
 	
 	/**
-   * Hash table mapping (File, page) to frame
+   * Hash table mapping (File, page) to frame, split into one partition per NUMA node
 	 */
-  BufHashTbl *hashTable;
+  std::vector<BufHashTbl*> hashTables;
 
 	/**
    * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
 	 */
   BufDesc *bufDescTable;
 
+	/**
+   * Memory area holding bufPool
+	 */
+  PoolMemory *poolMemory;
+
+	/**
+   * Memory area holding bufDescTable
+	 */
+  PoolMemory *descMemory;
+
 	/**
    * Maintains Buffer pool usage statistics 
 	 */
   BufStats bufStats;
 
 	/**
-   * Advance clock to next frame in the buffer pool
+   * Queue used for batched reads and write-backs, or NULL to use blocking File I/O
+	 */
+  AsyncIo* asyncIo;
+
+	/**
+   * Write-ahead log whose records must be durable before the pages they changed are written, or NULL
+	 */
+  Wal* wal;
+
+	/**
+   * Double-write buffer pages go through on their way to their files, or NULL
+	 */
+  DoubleWriteBuffer* doubleWrite;
+
+	/**
+   * Largest number of pages written back when a dirty page is evicted, without a double-write buffer
+	 */
+  std::uint32_t evictionBatch;
+
+	/**
+   * Policy choosing the page to evict, and the access counter frames are stamped with
+	 */
+  ReplacementPolicy policy;
+  std::uint64_t useClock;
+
+	/**
+   * Compressed copies of clean pages evicted from the pool, or NULL
+	 */
+  VictimCache* victimCache;
+
+	/**
+   * Cache file on a fast local device that clean evicted pages are written to, or NULL
+	 */
+  SsdCache* ssdCache;
+
+	/**
+   * Pin counts of pages of memory-mapped files, indexed by page number.  Such pages are handed out as views
+   * into the mapping and never occupy a frame.
+	 */
+  std::map<const File*, std::vector<std::uint32_t> > mappedPins;
+
+	/**
+   * Callbacks waiting for the reads started by fetchAsync(), by the frame read into
+	 */
+  std::map<FrameId, std::vector<std::function<void(PageGuard, std::exception_ptr)> > > pendingReads;
+
+	/**
+   * Advance the clock of a NUMA node to the next frame of its partition
+	 */
+  void advanceClock(const unsigned node);
+
+	/**
+	 * Fills a frame with a page missing from the buffer pool from the victim cache or the SSD cache, counting hits
+	 * and misses
+	 *
+	 * @return False if the page must be read from its file
 	 */
-  void advanceClock();
+  bool readFromCaches(const File* file, const PageId pageNo, Page* frame);
 
 	/**
 	 * Allocate a free frame.  
@@ -198,16 +371,199 @@ class BufMgr
 	 */
   void allocBuf(FrameId & frame);
 
+	/**
+	 * Run the replacement policy over one NUMA node's partition.
+	 *
+	 * @param node   	Node whose frames are considered
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @return False if every frame of the partition is pinned
+	 */
+  bool allocBufOnNode(const unsigned node, FrameId & frame);
+
+	/**
+	 * Pick the most recently used unpinned frame of one NUMA node's partition, after any free one (REPLACE_MRU).
+	 *
+	 * @param node   	Node whose frames are considered
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @return False if every frame of the partition is pinned
+	 */
+  bool allocMruOnNode(const unsigned node, FrameId & frame);
+
+	/**
+	 * Empty an unpinned frame chosen for eviction: write it back if dirty, offer it to the victim and SSD caches and
+	 * remove it from the hash table.
+	 *
+	 * @param node   	Node whose partition holds the frame
+	 * @param victim   	Frame to empty
+	 */
+  void evictFrame(const unsigned node, const FrameId victim);
+
+	/**
+	 * NUMA node of the calling thread, as set with setThreadNode() or else of the CPU it runs on
+	 */
+  unsigned requestingNode() const;
+
+	/**
+	 * Count an access to a frame in the local or remote access statistics (NUMA mode only), and stamp the frame
+	 * with the access counter.
+	 */
+  void countAccess(const FrameId frame);
+
+	/**
+	 * Hash table partition holding the entry of the given page.
+	 */
+  BufHashTbl* hashPartition(const File* file, const PageId pageNo);
+
+	/**
+	 * Pin a page, reading it into a frame if needed, as readPage() does.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @param frame		Frame holding the page, returned via this reference; left alone for pages of mapped files
+	 * @return Pointer to the pinned page
+	 */
+  Page* pinPage(File* file, const PageId pageNo, FrameId & frame);
+
+	/**
+	 * Allocate a new page in a pinned frame, as allocPage() does.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Number of the new page, returned via this reference
+	 * @param frame		Frame holding the page, returned via this reference
+	 * @return Pointer to the pinned page
+	 */
+  Page* newPage(File* file, PageId & pageNo, FrameId & frame);
+
+	/**
+	 * Unpin the page held by a frame, as unPinPage() does once it has found the frame.
+	 *
+	 * @param frame		Frame holding the page
+	 * @param dirty		True if the page needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not pinned
+	 */
+  void unPinFrame(const FrameId frame, const bool dirty);
+
+	/**
+	 * Wait until the page, if it is being read by fetchAsync(), has been read.
+	 */
+  void awaitFetch(const File* file, const PageId pageNo);
+
+	/**
+	 * Latch of a frame
+	 */
+  FrameLatch& frameLatch(const FrameId frame)
+  {
+		return bufDescTable[frame].latch;
+  }
+
+	/**
+	 * Split the frames evenly into contiguous per-node partitions and bind each partition's memory to its node.
+	 * The hash table partitions are left alone.
+	 *
+	 * @param count		Number of partitions
+	 */
+  void partitionFrames(const unsigned count);
+
+	/**
+	 * Size of the hash table partitions for the current number of frames and NUMA nodes
+	 */
+  int hashTableSize() const;
+
+	/**
+	 * Release the memory of unused frames past numBufs, left behind by resize() while they were pinned.
+	 */
+  void releaseRetiredFrames();
+
+	/**
+	 * Register the frames backed by memory with the asynchronous I/O queue, if there is one.
+	 */
+  void registerPool();
+
+	/**
+	 * End of the write-ahead log, or 0 if none is attached: every change logged from now on has an LSN at least this
+	 */
+  Lsn logEnd() const;
+
+	/**
+	 * Write-ahead rule: make the log durable up to the given page LSN before a page carrying it is written.
+	 *
+	 * @param pageLsn	Highest page LSN of the pages about to be written
+	 */
+  void forceLog(const Lsn pageLsn);
+
+	/**
+	 * Write the given dirty frames back to disk as a group and clear their dirty bits.
+	 * Frames are sorted by file and page number, each run of consecutive pages is written with a single
+	 * File::writePages() call, and every file written to is synced once at the end.
+	 * Pinned frames are copied under a shared latch and the copy is written; a pinned frame changed after the copy
+	 * stays dirty. Frames latched exclusively at the time are not written and stay dirty.
+	 * With a write-ahead log attached, the log is flushed once, up to the highest page LSN of the group, first.
+	 *
+	 * @param frames	Frames to write back; reordered by this call, and left holding the frames written
+	 */
+  void writeBack(std::vector<FrameId> & frames);
+
+	/**
+	 * Mark a frame writeBack() wrote clean, unless a writer latched it after its image was taken.
+	 *
+	 * @param frame		Frame written
+	 * @param version	Latch version of the frame when its image was taken
+	 * @param written	Recovery LSN of the frame once written
+	 */
+  void markWritten(const FrameId frame, const std::uint64_t version, const Lsn written);
+
+	/**
+	 * writeBack() through the double-write buffer: batches of up to its capacity are laid out in it, written to
+	 * the double-write file and synced, then written home, each file written to being synced once per batch.
+	 *
+	 * @param frames	Frames to write back, sorted by file and page number
+	 * @param images	Pages to write for the frames, copies for pinned ones
+	 * @param versions	Latch versions of the frames when their images were taken
+	 * @param written	Recovery LSN of the frames once written
+	 */
+  void writeBackDoubled(const std::vector<FrameId> & frames, const std::vector<const Page*> & images,
+			const std::vector<std::uint64_t> & versions, const Lsn written);
+
+	/**
+	 * Write out all dirty pages of a file, or of all files, and evict their frames from the buffer pool.
+	 * Nothing is written if any of the frames is pinned or invalid.
+	 *
+	 * @param file   	File whose frames are flushed, or NULL to flush the frames of all files
+   * @throws  PagePinnedException If any of the frames is pinned
+   * @throws BadBufferException If any of the frames is found to be invalid
+	 */
+  void flushFrames(const File* file);
+
+	/**
+	 * Write out all dirty pages of a file, or of all files, leaving them in the buffer pool.
+	 *
+	 * @param file   	File whose frames are written, or NULL to write the frames of all files
+	 */
+  void checkpointFrames(const File* file);
+
  public:
 	/**
-   * Actual buffer pool from which frames are allocated
+	 * Function a page fetched with fetchAsync() is handed to: the guard of the pinned page and no exception, or an
+	 * empty guard and the exception the read failed with.
+	 */
+  typedef std::function<void(PageGuard, std::exception_ptr)> FetchCallback;
+
+	/**
+   * Actual buffer pool from which frames are allocated, aligned to File::BLOCK_SIZE
 	 */
   Page* bufPool;
 
 	/**
    * Constructor of BufMgr class
-	 */
-  BufMgr(std::uint32_t bufs);
+	 *
+	 * @param bufs   	Number of frames in the buffer pool
+	 * @param pageSize	Largest virtual memory page size wanted for the frames and their descriptors. Huge pages
+	 *                  shrink the page tables and the TLB misses of a large pool; if the kernel has none reserved,
+	 *                  smaller ones or transparent huge pages are used instead (see poolPageSize()).
+	 * @param maxBufs	Number of frames the pool may grow to with resize(), or 0 for a large default. Only address
+	 *                  space is reserved for them up front.
+	 */
+  BufMgr(std::uint32_t bufs, const PoolPageSize pageSize = POOL_SMALL_PAGES, const std::uint32_t maxBufs = 0);
 	
 	/**
    * Destructor of BufMgr class
@@ -218,6 +574,8 @@ class BufMgr
 	 * Reads the given page from the file into a frame and returns the pointer to page.
 	 * If the requested page is already present in the buffer pool pointer to that frame is returned
 	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 * For a file opened with File::openMapped() no frame is used: the page returned is a read-only view into the
+	 * mapping, pinned and unpinned like a frame.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
@@ -225,6 +583,23 @@ class BufMgr
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+	/**
+	 * Reads several pages of a file into the buffer pool at once and returns pointers to all of them, pinned.
+	 * Pages already in the buffer pool are found in a single pass over the hash table. Frames for the remaining
+	 * pages are allocated in one clock sweep, and the missing pages are read from disk in page number order, with
+	 * runs of consecutive pages read by a single call to File::readPages(). A page number may appear more than once,
+	 * in which case the page is pinned once per occurrence.
+	 * If any page cannot be read, no page is left pinned by this call. Pages of mapped files are views, as for readPage().
+	 *
+	 * @param file   	File object
+	 * @param pageNos Array of page numbers in the file to be read
+	 * @param count  	Number of entries in pageNos
+	 * @param pages  	Array of count page pointers. The pointer to the frame holding pageNos[i] is returned in pages[i].
+	 * @throws BufferExceededException If not enough frames can be allocated for the missing pages
+	 * @throws InvalidPageException If any of the pages does not exist in the file
+	 */
+  void readPages(File* file, const PageId* pageNos, const std::uint32_t count, Page** pages);
+
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
 	 *
@@ -232,6 +607,7 @@ class BufMgr
 	 * @param PageNo  Page number
 	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
    * @throws  PageNotPinnedException If the page is not already pinned
+   * @throws  ReadOnlyFileException If the page is of a mapped file and dirty is true (the page is still unpinned)
 	 */
   void unPinPage(File* file, const PageId PageNo, const bool dirty);
 
@@ -242,11 +618,81 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
 	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 * @throws BufferExceededException If every frame is pinned; the file is then left unchanged
 	 */
   void allocPage(File* file, PageId &PageNo, Page*& page); 
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
+	 * Pins a page as readPage() does and returns a guard for it. The guard remembers the frame, so it unpins the page
+	 * without a second hash table lookup, and does so when it is destroyed, including when an exception unwinds
+	 * the stack.
+	 *
+	 * With a latch mode, the guard also holds the frame's latch in that mode until it lets go of the page; pages of
+	 * mapped files are never written, so they are not latched.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @param mode		Latch to take on the frame once the page is pinned
+	 * @return Guard holding the pinned page
+	 */
+  PageGuard fetch(File* file, const PageId pageNo, const LatchMode mode = LATCH_NONE);
+
+	/**
+	 * Pins a page without waiting for it to be read. If the page is in the buffer pool, done is called with its guard
+	 * before fetchAsync() returns. Otherwise a frame is claimed, a read into it is started on the asynchronous I/O
+	 * queue (see enableAsyncIo()), and done is called from pollFetches() once the read has finished. Fetches of a
+	 * page being read, including by readPage(), wait for the same read.
+	 * Without an asynchronous I/O queue, and for mapped files, the page is read right away.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @param done		Called with the guard of the pinned page, or with an empty guard and the exception if the read
+	 *                  failed
+	 * @return True if done was called before fetchAsync() returned
+	 * @throws BufferExceededException If no frame can be claimed for the page
+	 * @throws InvalidPageException If the page does not exist in the file
+	 */
+  bool fetchAsync(File* file, const PageId pageNo, const FetchCallback& done);
+
+#ifdef __cpp_impl_coroutine
+	/**
+	 * Fetches a page as fetchAsync() does, for use with co_await in C++20 coroutines: the coroutine goes on at once
+	 * if the page is in the buffer pool, and is otherwise resumed from pollFetches() with the page's guard. The
+	 * exceptions of fetchAsync() and of a failed read are thrown from the co_await. See fetch_awaitable.h.
+	 */
+  FetchAwaitable fetchAsync(File* file, const PageId pageNo);
+#endif
+
+	/**
+	 * Calls the callbacks of the fetchAsync() reads that have finished. The loop driving fetches calls this
+	 * while pendingFetches() is not 0.
+	 *
+	 * @param wait		If true and no read has finished yet, waits for one
+	 * @return Number of callbacks called
+	 */
+  std::size_t pollFetches(const bool wait);
+
+	/**
+	 * Number of fetchAsync() reads not yet finished
+	 */
+  std::size_t pendingFetches() const
+  {
+		return pendingReads.size();
+  }
+
+	/**
+	 * Allocates a new page as allocPage() does and returns a guard for it, as fetch() does.
+	 *
+	 * @param file   	File object
+	 * @return Guard holding the new page; its number is PageGuard::page_number()
+	 * @throws BufferExceededException If every frame is pinned; the file is then left unchanged
+	 */
+  PageGuard allocate(File* file);
+
+	/**
+	 * Writes out all dirty pages of the file to disk and evicts the file's pages from the buffer pool.
+	 * Dirty pages are written in page number order, runs of consecutive pages with a single write,
+	 * and the file is synced once at the end.
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
 	 * Otherwise Error returned.
 	 *
@@ -256,6 +702,54 @@ class BufMgr
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Writes out all dirty pages in the buffer pool to disk and evicts every page, as flushFile() does for every file.
+	 * All frames need to be unpinned before this function can be successfully called.
+	 *
+   * @throws  PagePinnedException If any page is pinned in the buffer pool
+   * @throws BadBufferException If any frame assigned to a file is found to be invalid
+	 */
+  void flushAll();
+
+	/**
+	 * Writes out all dirty pages of the file to disk without evicting them from the buffer pool.
+	 * Unlike flushFile(), pinned pages are written too (as they are at the time of the call) and stay pinned; those a
+	 * writer holds latched exclusively at the time are left dirty for a later checkpoint.
+	 * Written pages are marked clean; unpinning one of them as dirty later marks it dirty again.
+	 *
+	 * @param file   	File object
+	 */
+  void checkpoint(const File* file);
+
+	/**
+	 * Writes out all dirty pages in the buffer pool to disk without evicting them, as checkpoint() does for every file.
+	 */
+  void checkpointAll();
+
+	/**
+	 * Oldest recovery LSN of the dirty pages in the buffer pool, and of the pinned ones, which may be changed before
+	 * they are unpinned as dirty. Every change logged before it is on disk, so redo after a crash can start there.
+	 *
+	 * @return Oldest recovery LSN, or 0 if no page is dirty or pinned
+	 */
+  Lsn minRecLsn() const;
+
+	/**
+	 * Number of dirty pages whose recovery LSN is below lsn
+	 */
+  std::uint32_t dirtyBefore(const Lsn lsn) const;
+
+	/**
+	 * Writes out, as checkpoint() does, up to maxFrames of the dirty pages whose recovery LSN is below lsn, those
+	 * dirtied first going first. The pages stay in the buffer pool, pinned or not; pages latched exclusively are left
+	 * dirty. Used by Checkpointer to spread a checkpoint's writes over time.
+	 *
+	 * @param lsn		Pages dirtied before this LSN are written
+	 * @param maxFrames	Largest number of pages to write
+	 * @return Number of pages written
+	 */
+  std::uint32_t writeOldest(const Lsn lsn, const std::uint32_t maxFrames);
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
@@ -266,11 +760,167 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Makes readPages() and the write-backs of flushFile(), flushAll() and checkpoint() go through an asynchronous
+	 * I/O queue, so that up to queueDepth reads or writes are in flight at once. io_uring is used when the kernel
+	 * supports it, with the buffer pool registered as fixed buffers; otherwise preadv/pwritev are used.
+	 *
+	 * @param queueDepth	Maximum number of reads or writes in flight at once
+	 * @param useIoUring	If false, use the preadv/pwritev path even if io_uring is available
+	 */
+  void enableAsyncIo(const unsigned queueDepth, const bool useIoUring = true);
+
+	/**
+	 * Enforces write-ahead logging: from now on no dirty page is written to its file, whether evicted to make room
+	 * or written back by flushFile(), checkpoint() and the like, before the log record of its page LSN is durable.
+	 * The log is flushed as needed (see BufStats::logflushes).
+	 *
+	 * @param log		Write-ahead log the pages are changed through, or NULL to stop enforcing it. Must outlive
+	 *                  the buffer manager or be detached first.
+	 */
+  void attachWal(Wal* log)
+  {
+		wal = log;
+  }
+
+	/**
+	 * Protects pages from being torn by a crash while written: from now on dirty pages are written to the
+	 * double-write buffer, which is synced, before they are written to their files. Evicting a dirty page writes
+	 * back a batch of the dirty unpinned pages the clock reaches next along with it, so the syncs are shared.
+	 * Write-backs go through blocking File I/O even if asynchronous I/O is enabled.
+	 *
+	 * @param buffer	Double-write buffer, or NULL to write pages straight to their files. Must outlive the
+	 *                  buffer manager or be detached first.
+	 */
+  void attachDoubleWrite(DoubleWriteBuffer* buffer)
+  {
+		doubleWrite = buffer;
+  }
+
+	/**
+	 * Without a double-write buffer, makes evicting a dirty page write back up to the given number of the dirty
+	 * unpinned pages the clock reaches next along with it, as a double-write buffer's batches do, and sync their
+	 * files. Evictions then write less often, in larger, durable batches, and a page written back this way is on
+	 * disk when its frame is reused. 1, the default, keeps the eviction path as it was: the victim is written alone
+	 * and not synced. Ignored while a double-write buffer is attached, whose capacity sets the batch.
+	 *
+	 * @param pages		Largest number of pages written back per eviction; 0 counts as 1
+	 */
+  void setEvictionBatch(const std::uint32_t pages)
+  {
+		evictionBatch = pages > 0 ? pages : 1;
+  }
+
+	/**
+	 * Chooses how the page to evict is picked from now on. REPLACE_CLOCK, the default, suits most pools; a pool
+	 * mostly read by scans keeps the pages it held before a scan with REPLACE_MRU.
+	 *
+	 * @param replacement	Replacement policy
+	 */
+  void setReplacementPolicy(const ReplacementPolicy replacement)
+  {
+		policy = replacement;
+  }
+
+	/**
+	 * Returns the replacement policy of the buffer pool.
+	 */
+  ReplacementPolicy replacementPolicy() const
+  {
+		return policy;
+  }
+
+	/**
+	 * Keeps the pages evicted from the buffer pool LZ4-compressed in memory, so that a page read again soon after is
+	 * decompressed instead of read from its file (see BufStats::victimhits). Pages leave the cache when they are
+	 * read back into a frame; the cache holds as many more pages than the same memory as frames would as they
+	 * compress. Dirty pages are written back before they are cached, as always.
+	 *
+	 * @param bytes		Memory for the compressed pages, or 0 to drop the cache
+	 * @throws std::bad_alloc If the memory cannot be allocated
+	 */
+  void enableVictimCache(const std::size_t bytes);
+
+	/**
+	 * Puts a second-level page cache on a fast local device behind the buffer pool (and the victim cache): pages
+	 * evicted from the pool are written to it asynchronously once clean, unless it holds them already, and a page
+	 * missing from the pool is read from it before its file is (see BufStats::ssdhits). A page written back to its
+	 * file is dropped from the cache. Reads from the cache are synchronous, for fetchAsync() too.
+	 *
+	 * @param cache		SSD cache, or NULL to stop using one. Must outlive the buffer manager or be detached first.
+	 *                  Anything it held is dropped.
+	 */
+  void attachSsdCache(SsdCache* cache);
+
+	/**
+	 * Changes the number of frames in the buffer pool while it is in use. The pool never moves in memory, so pages
+	 * pinned by readers stay valid.
+	 * Growing backs more of the pool's reserved address space with memory and adds the new frames to the clock; the
+	 * hash table grows along, moving its entries to the larger table a few buckets at a time on later accesses.
+	 * Shrinking takes the frames past the new size out of use: unpinned ones are evicted, dirty pages being written
+	 * back as a group first, and pinned ones are evicted and their memory released when they are last unpinned.
+	 * In NUMA mode the frames are split over the nodes again.
+	 *
+	 * @param frames	New number of frames
+	 * @throws PoolResizeException If frames is 0 or more than capacity()
+	 * @throws std::bad_alloc If the kernel does not provide the memory for more frames
+	 */
+  void resize(const std::uint32_t frames);
+
+	/**
+   * Number of frames in the buffer pool
+	 */
+  std::uint32_t size() const
+  {
+		return numBufs;
+  }
+
+	/**
+   * Largest number of frames the buffer pool can grow to
+	 */
+  std::uint32_t capacity() const;
+
+	/**
    * Print member variable values. 
 	 */
   void  printSelf();
 
 	/**
+	 * Splits the buffer pool into per-NUMA-node partitions: each node gets a contiguous share of the frames and of
+	 * the BufDesc table, bound to its memory with mbind, its own clock hand, and a hash table partition first touched
+	 * from the node. New pages get frames from the requesting thread's node, other nodes only serving when all of its
+	 * frames are pinned. Nodes the machine lacks are simulated (no memory binding); threads choose one with
+	 * setThreadNode(). Local and remote frame accesses are counted in BufStats.
+	 * The buffer pool is flushed first.
+	 *
+	 * @param nodes		Number of nodes, or 0 for as many as the machine has
+	 * @throws PagePinnedException If any page is pinned
+	 */
+  void enableNuma(const unsigned nodes = 0);
+
+	/**
+   * Number of NUMA partitions of the buffer pool
+	 */
+  unsigned numaNodes() const
+  {
+		return clockHands.size();
+  }
+
+	/**
+	 * Sets the NUMA node the calling thread counts as running on, for all buffer managers, instead of the node of its CPU.
+	 *
+	 * @param node		Node number, or -1 to use the node of the CPU again
+	 */
+  static void setThreadNode(const int node);
+
+	/**
+   * Page size actually backing the buffer pool memory
+	 */
+  PoolPageSize poolPageSize() const
+  {
+		return poolMemory->backing();
+  }
+
+	/**
    * Get buffer pool usage statistics
 	 */
   BufStats & getBufStats()
@@ -288,3 +938,7 @@ class BufMgr
 };
 
 }
+
+#ifdef __cpp_impl_coroutine
+#include "fetch_awaitable.h"
+#endif
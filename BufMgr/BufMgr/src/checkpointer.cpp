@@ -0,0 +1,128 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "checkpointer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace badgerdb {
+
+Checkpointer::Checkpointer(BufMgr& buf_mgr, Wal& wal,
+                           std::mutex& buf_mgr_mutex)
+    : buf_mgr_(buf_mgr),
+      wal_(wal),
+      buf_mgr_mutex_(buf_mgr_mutex),
+      stopping_(false),
+      batch_size_(64) {
+  std::memset(&stats_, 0, sizeof(stats_));
+}
+
+Checkpointer::~Checkpointer() {
+  stop();
+}
+
+Lsn Checkpointer::checkpoint(const unsigned spread_ms) {
+  std::lock_guard<std::mutex> checkpoint_lock(checkpoint_mutex_);
+  // Every page dirtied before this is written before the checkpoint is
+  // logged; pages dirtied since are left to the next one.
+  const Lsn begin = wal_.endLsn();
+  std::uint32_t batch;
+  std::uint32_t remaining;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch = batch_size_;
+  }
+  {
+    std::lock_guard<std::mutex> lock(buf_mgr_mutex_);
+    remaining = buf_mgr_.dirtyBefore(begin);
+  }
+  const std::uint32_t batches = (remaining + batch - 1) / batch;
+  const std::chrono::microseconds pause =
+      batches > 1 ? std::chrono::microseconds(spread_ms * 1000ull / batches)
+                  : std::chrono::microseconds(0);
+
+  std::uint64_t written = 0;
+  Lsn redo_lsn;
+  for (;;) {
+    std::uint32_t count;
+    {
+      std::lock_guard<std::mutex> lock(buf_mgr_mutex_);
+      count = buf_mgr_.writeOldest(begin, batch);
+      if (count == 0) {
+        // Pages dirtied since <begin> are not on disk, nor is anything
+        // changed on a page still pinned.
+        const Lsn oldest = buf_mgr_.minRecLsn();
+        redo_lsn = oldest != 0 && oldest < begin ? oldest : begin;
+        break;
+      }
+    }
+    written += count;
+    if (pause.count() > 0) {
+      std::this_thread::sleep_for(pause);
+    }
+  }
+
+  const Lsn lsn = wal_.logCheckpoint(redo_lsn);
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.checkpoints;
+  stats_.pages_written += written;
+  stats_.redo_lsn = redo_lsn;
+  return lsn;
+}
+
+void Checkpointer::start(const unsigned interval_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (thread_.joinable()) {
+    return;
+  }
+  stopping_ = false;
+  thread_ = std::thread(&Checkpointer::run, this, interval_ms);
+}
+
+void Checkpointer::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!thread_.joinable()) {
+      return;
+    }
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+  thread_ = std::thread();
+}
+
+void Checkpointer::setBatchSize(const std::uint32_t pages) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  batch_size_ = std::max<std::uint32_t>(1, pages);
+}
+
+CheckpointStats Checkpointer::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void Checkpointer::run(const unsigned interval_ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (wake_.wait_for(lock, std::chrono::milliseconds(interval_ms),
+                       [this]() { return stopping_; })) {
+      break;
+    }
+    lock.unlock();
+    try {
+      checkpoint(interval_ms / 2);
+    } catch (...) {
+      // A failed checkpoint leaves the last one in force; try again later.
+    }
+    lock.lock();
+  }
+}
+
+}
@@ -0,0 +1,143 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "buffer.h"
+#include "wal.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Counters of a checkpointer.
+ */
+struct CheckpointStats {
+  /**
+   * Checkpoints logged.
+   */
+  std::uint64_t checkpoints;
+
+  /**
+   * Dirty pages written by checkpoints.
+   */
+  std::uint64_t pages_written;
+
+  /**
+   * Redo LSN of the last checkpoint, 0 before the first.
+   */
+  Lsn redo_lsn;
+};
+
+/**
+ * @brief Fuzzy checkpoints of a buffer pool, so that recovery does not have to
+ *        read the whole log.
+ *
+ * A checkpoint notes the end of the log, writes out the pages dirtied before
+ * it, oldest first and in batches spread over the time allowed, and then logs
+ * a checkpoint record with Wal::logCheckpoint() whose redo LSN is the oldest
+ * recovery LSN left in the pool (BufMgr::minRecLsn()).  Pages stay in the
+ * pool, and other threads go on using the buffer manager between batches:
+ * nothing waits for the checkpoint to finish.  Recovery then starts its scan
+ * at the redo LSN of the last checkpoint.
+ *
+ * start() runs checkpoints on a thread of their own at a fixed interval.
+ *
+ * The buffer manager is not threadsafe: the checkpointer locks the mutex it
+ * is given around every call it makes, and all other users of the buffer
+ * manager must hold the same mutex around theirs.  Pages must be changed
+ * through the log (Wal::insertRecord() and the like) under an exclusive frame
+ * latch, and a page changed must stay pinned until it is unpinned as dirty.
+ * Pinned pages are written as they are between changes; a page latched when
+ * its batch is written, or changed while it is, stays dirty, and the redo LSN
+ * stays at or before its oldest change.
+ */
+class Checkpointer {
+ public:
+  /**
+   * Prepares checkpoints of the pages of <buf_mgr>, logged to <wal>, which
+   * must be attached to the buffer manager.
+   *
+   * @param buf_mgr_mutex   Mutex held around every call to <buf_mgr>.
+   */
+  Checkpointer(BufMgr& buf_mgr, Wal& wal, std::mutex& buf_mgr_mutex);
+
+  /**
+   * Stops the background thread, if running.
+   */
+  ~Checkpointer();
+
+  /**
+   * Takes a checkpoint, spreading the writes of dirty pages over about
+   * <spread_ms> milliseconds (0 writes them all at once).
+   *
+   * @return  LSN of the checkpoint record.
+   * @throws  IoException  If a page or the log cannot be written.
+   */
+  Lsn checkpoint(const unsigned spread_ms = 0);
+
+  /**
+   * Starts taking a checkpoint every <interval_ms> milliseconds on a
+   * background thread, each spread over half the interval.  Does nothing if
+   * the thread is running already.
+   */
+  void start(const unsigned interval_ms);
+
+  /**
+   * Stops the background thread, after the checkpoint in progress if any.
+   */
+  void stop();
+
+  /**
+   * Sets the largest number of pages written at once, 64 by default.
+   */
+  void setBatchSize(const std::uint32_t pages);
+
+  /**
+   * Returns the counters of the checkpointer.
+   */
+  CheckpointStats stats() const;
+
+ private:
+  Checkpointer(const Checkpointer&);
+  Checkpointer& operator=(const Checkpointer&);
+
+  /**
+   * Body of the background thread.
+   */
+  void run(const unsigned interval_ms);
+
+  BufMgr& buf_mgr_;
+  Wal& wal_;
+  std::mutex& buf_mgr_mutex_;
+
+  /**
+   * Serializes checkpoints, so that start() and checkpoint() may overlap.
+   */
+  std::mutex checkpoint_mutex_;
+
+  /**
+   * Guards everything below.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Signalled to wake the background thread on stop().
+   */
+  std::condition_variable wake_;
+  std::thread thread_;
+  bool stopping_;
+
+  std::uint32_t batch_size_;
+  CheckpointStats stats_;
+};
+
+}
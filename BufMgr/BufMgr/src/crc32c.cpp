@@ -0,0 +1,299 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * CRC-32C polynomial, bit-reversed.
+ */
+const std::uint32_t kPolynomial = 0x82f63b78;
+
+/**
+ * Lengths of the interleaved streams of the x86 version: three of kLong bytes
+ * at a time while the range is long enough, then three of kShort.
+ */
+const std::size_t kLong = 2048;
+const std::size_t kShort = 256;
+
+typedef std::uint32_t (*Crc32cFunction)(const unsigned char*, std::size_t,
+                                         std::uint32_t);
+
+/**
+ * Multiplies a 32x32 matrix over GF(2) by a vector.
+ */
+std::uint32_t gf2MatrixTimes(const std::uint32_t* matrix, std::uint32_t vector) {
+  std::uint32_t sum = 0;
+  while (vector != 0) {
+    if (vector & 1) {
+      sum ^= *matrix;
+    }
+    vector >>= 1;
+    ++matrix;
+  }
+  return sum;
+}
+
+void gf2MatrixSquare(std::uint32_t* square, const std::uint32_t* matrix) {
+  for (int n = 0; n < 32; ++n) {
+    square[n] = gf2MatrixTimes(matrix, matrix[n]);
+  }
+}
+
+/**
+ * @brief Tables of the software version, and of the shifts combining the
+ *        interleaved streams of the x86 version.
+ */
+struct Tables {
+  /**
+   * slicing[k][b]: CRC register after byte b followed by k zero bytes.
+   */
+  std::uint32_t slicing[8][256];
+
+  /**
+   * Apply kLong, respectively kShort, zero bytes to a CRC register, one table
+   * per byte of the register.
+   */
+  std::uint32_t long_shift[4][256];
+  std::uint32_t short_shift[4][256];
+
+  Tables() {
+    for (std::uint32_t n = 0; n < 256; ++n) {
+      std::uint32_t crc = n;
+      for (int k = 0; k < 8; ++k) {
+        crc = crc & 1 ? (crc >> 1) ^ kPolynomial : crc >> 1;
+      }
+      slicing[0][n] = crc;
+    }
+    for (std::uint32_t n = 0; n < 256; ++n) {
+      for (int k = 1; k < 8; ++k) {
+        slicing[k][n] =
+            (slicing[k - 1][n] >> 8) ^ slicing[0][slicing[k - 1][n] & 0xff];
+      }
+    }
+    zeros(long_shift, kLong);
+    zeros(short_shift, kShort);
+  }
+
+  /**
+   * Fills in the tables applying <length> zero bytes, a power of two, to a
+   * CRC register.
+   */
+  static void zeros(std::uint32_t shift[4][256], std::size_t length) {
+    // Operator for one zero bit, then squared up to <length> bytes
+    std::uint32_t odd[32];
+    std::uint32_t even[32];
+    odd[0] = kPolynomial;
+    for (int n = 1; n < 32; ++n) {
+      odd[n] = 1u << (n - 1);
+    }
+    gf2MatrixSquare(even, odd);  // 2 bits
+    gf2MatrixSquare(odd, even);  // 4 bits
+    const std::uint32_t* op = NULL;
+    for (;;) {
+      gf2MatrixSquare(even, odd);
+      length >>= 1;
+      if (length == 0) {
+        op = even;
+        break;
+      }
+      gf2MatrixSquare(odd, even);
+      length >>= 1;
+      if (length == 0) {
+        op = odd;
+        break;
+      }
+    }
+    for (std::uint32_t n = 0; n < 256; ++n) {
+      shift[0][n] = gf2MatrixTimes(op, n);
+      shift[1][n] = gf2MatrixTimes(op, n << 8);
+      shift[2][n] = gf2MatrixTimes(op, n << 16);
+      shift[3][n] = gf2MatrixTimes(op, n << 24);
+    }
+  }
+};
+
+const Tables& tables() {
+  static const Tables instance;
+  return instance;
+}
+
+std::uint32_t shift(const std::uint32_t table[4][256], const std::uint32_t crc) {
+  return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^
+         table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+}
+
+std::uint32_t crc32cSoftware(const unsigned char* next, std::size_t length,
+                             std::uint32_t crc) {
+  const std::uint32_t (*slicing)[256] = tables().slicing;
+  crc = ~crc;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (length >= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, next, sizeof(word));
+    word ^= crc;
+    crc = slicing[7][word & 0xff] ^ slicing[6][(word >> 8) & 0xff] ^
+          slicing[5][(word >> 16) & 0xff] ^ slicing[4][(word >> 24) & 0xff] ^
+          slicing[3][(word >> 32) & 0xff] ^ slicing[2][(word >> 40) & 0xff] ^
+          slicing[1][(word >> 48) & 0xff] ^ slicing[0][word >> 56];
+    next += 8;
+    length -= 8;
+  }
+#endif
+  while (length > 0) {
+    crc = (crc >> 8) ^ slicing[0][(crc ^ *next) & 0xff];
+    ++next;
+    --length;
+  }
+  return ~crc;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2")))
+std::uint64_t crc32cWord(const std::uint64_t crc, const unsigned char* next) {
+  std::uint64_t word;
+  std::memcpy(&word, next, sizeof(word));
+  return _mm_crc32_u64(crc, word);
+}
+
+/**
+ * Checksums three streams of <stream> bytes at once, each starting on its
+ * own register, and folds them into <crc>.
+ */
+__attribute__((target("sse4.2")))
+std::uint64_t crc32cStreams(std::uint64_t crc, const unsigned char* next,
+                            const std::size_t stream,
+                            const std::uint32_t table[4][256]) {
+  std::uint64_t crc1 = 0;
+  std::uint64_t crc2 = 0;
+  const unsigned char* const end = next + stream;
+  while (next < end) {
+    crc = crc32cWord(crc, next);
+    crc1 = crc32cWord(crc1, next + stream);
+    crc2 = crc32cWord(crc2, next + 2 * stream);
+    next += 8;
+  }
+  crc = shift(table, static_cast<std::uint32_t>(crc)) ^ crc1;
+  return shift(table, static_cast<std::uint32_t>(crc)) ^ crc2;
+}
+
+__attribute__((target("sse4.2")))
+std::uint32_t crc32cSse42(const unsigned char* next, std::size_t length,
+                          std::uint32_t crc) {
+  std::uint64_t crc0 = ~crc;
+  while (length > 0 && reinterpret_cast<std::uintptr_t>(next) % 8 != 0) {
+    crc0 = _mm_crc32_u8(static_cast<std::uint32_t>(crc0), *next);
+    ++next;
+    --length;
+  }
+  const Tables& t = tables();
+  while (length >= 3 * kLong) {
+    crc0 = crc32cStreams(crc0, next, kLong, t.long_shift);
+    next += 3 * kLong;
+    length -= 3 * kLong;
+  }
+  while (length >= 3 * kShort) {
+    crc0 = crc32cStreams(crc0, next, kShort, t.short_shift);
+    next += 3 * kShort;
+    length -= 3 * kShort;
+  }
+  while (length >= 8) {
+    crc0 = crc32cWord(crc0, next);
+    next += 8;
+    length -= 8;
+  }
+  while (length > 0) {
+    crc0 = _mm_crc32_u8(static_cast<std::uint32_t>(crc0), *next);
+    ++next;
+    --length;
+  }
+  return ~static_cast<std::uint32_t>(crc0);
+}
+
+#elif defined(__aarch64__)
+
+__attribute__((target("+crc")))
+std::uint32_t crc32cArmv8(const unsigned char* next, std::size_t length,
+                          std::uint32_t crc) {
+  crc = ~crc;
+  while (length > 0 && reinterpret_cast<std::uintptr_t>(next) % 8 != 0) {
+    crc = __crc32cb(crc, *next);
+    ++next;
+    --length;
+  }
+  while (length >= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, next, sizeof(word));
+    crc = __crc32cd(crc, word);
+    next += 8;
+    length -= 8;
+  }
+  while (length > 0) {
+    crc = __crc32cb(crc, *next);
+    ++next;
+    --length;
+  }
+  return ~crc;
+}
+
+#endif
+
+/**
+ * Picks the fastest version the processor supports.
+ */
+Crc32cFunction choose() {
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("sse4.2")) {
+    return crc32cSse42;
+  }
+#elif defined(__aarch64__)
+  if (::getauxval(AT_HWCAP) & HWCAP_CRC32) {
+    return crc32cArmv8;
+  }
+#endif
+  return crc32cSoftware;
+}
+
+Crc32cFunction chosen() {
+  static const Crc32cFunction function = choose();
+  return function;
+}
+
+}
+
+std::uint32_t Crc32c::compute(const void* data, const std::size_t length,
+                              const std::uint32_t crc) {
+  return chosen()(static_cast<const unsigned char*>(data), length, crc);
+}
+
+std::uint32_t Crc32c::computeSoftware(const void* data,
+                                      const std::size_t length,
+                                      const std::uint32_t crc) {
+  return crc32cSoftware(static_cast<const unsigned char*>(data), length, crc);
+}
+
+bool Crc32c::hardware() {
+  return chosen() != crc32cSoftware;
+}
+
+}
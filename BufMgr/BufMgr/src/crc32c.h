@@ -0,0 +1,51 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief CRC-32C (Castagnoli) checksums of byte ranges.
+ *
+ * On x86 processors with SSE4.2, the checksum is computed with the CRC32
+ * instruction, over three interleaved streams so that the instruction's
+ * latency is hidden; on ARMv8 processors with the CRC extension, with the
+ * CRC32C instructions.  Which is used is decided at run time, once.
+ * Elsewhere, a table-driven software version processes eight bytes per step
+ * (slicing-by-8).  All give the same results.
+ */
+class Crc32c {
+ public:
+  /**
+   * Returns the checksum of a byte range.
+   *
+   * @param data    Start of the range.
+   * @param length  Length of the range in bytes.
+   * @param crc     Checksum of the bytes before the range, to extend it, or 0.
+   */
+  static std::uint32_t compute(const void* data, const std::size_t length,
+                               const std::uint32_t crc = 0);
+
+  /**
+   * Returns the checksum of a byte range, as compute() does, computed with
+   * the software version whatever the processor.
+   */
+  static std::uint32_t computeSoftware(const void* data,
+                                       const std::size_t length,
+                                       const std::uint32_t crc = 0);
+
+  /**
+   * Returns true if compute() uses CRC instructions of the processor.
+   */
+  static bool hardware();
+};
+
+}
@@ -0,0 +1,321 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "double_write.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "crc32c.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_exception.h"
+#include "exceptions/page_checksum_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * First bytes of a double-write file with a batch in it ("BDGRDBLW").
+ */
+const std::uint64_t kMagic = 0x574c424452474442ULL;
+
+/**
+ * Fixed part of the header, followed by the file table (a 16-bit length and
+ * the name of every file) and a DoubleWriteEntry for every page.  The pages
+ * follow the header, padded to File::BLOCK_SIZE.
+ */
+struct DoubleWriteHeader {
+  std::uint64_t magic;
+
+  /**
+   * Checksum of the header up to <length>, computed with this field set to 0.
+   */
+  std::uint32_t checksum;
+  std::uint32_t length;
+  std::uint32_t page_count;
+  std::uint32_t file_count;
+};
+
+struct DoubleWriteEntry {
+  std::uint32_t file_index;
+  PageId page_number;
+
+  /**
+   * Checksum of the copy of the page, so a torn copy is not restored.
+   */
+  std::uint32_t checksum;
+};
+
+std::size_t padToBlock(const std::size_t length) {
+  return (length + File::BLOCK_SIZE - 1) / File::BLOCK_SIZE * File::BLOCK_SIZE;
+}
+
+/**
+ * Largest header a batch of <capacity> pages can have: every page from a
+ * different file, each with the longest name the file table can hold.
+ */
+std::size_t maxHeaderLength(const std::uint32_t capacity) {
+  return sizeof(DoubleWriteHeader) +
+         std::size_t(capacity) *
+             (sizeof(std::uint16_t) + 0xffff + sizeof(DoubleWriteEntry));
+}
+
+bool readFully(const int fd, char* buffer, const std::size_t length,
+               const off_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pread(fd, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException("pread", errno);
+    }
+    if (n == 0) {
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
+void writeFully(const int fd, const char* buffer, const std::size_t length,
+                const off_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pwrite(fd, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException("pwrite", errno);
+    }
+    if (n == 0) {
+      throw IoException("pwrite", 0 /* short transfer */);
+    }
+    done += n;
+  }
+}
+
+/**
+ * Writes <header> at the start of the file and <pages> right after it, in a
+ * single sequential write unless the transfer comes up short.
+ */
+void writeBatch(const int fd, const char* header,
+                const std::size_t header_length, const char* pages,
+                const std::size_t pages_length) {
+  struct iovec parts[2];
+  parts[0].iov_base = const_cast<char*>(header);
+  parts[0].iov_len = header_length;
+  parts[1].iov_base = const_cast<char*>(pages);
+  parts[1].iov_len = pages_length;
+  ssize_t n;
+  do {
+    n = ::pwritev(fd, parts, 2, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    throw IoException("pwritev", errno);
+  }
+  // Finish a short transfer piece by piece
+  std::size_t done = n;
+  if (done < header_length) {
+    writeFully(fd, header + done, header_length - done, done);
+    done = header_length;
+  }
+  writeFully(fd, pages + (done - header_length),
+             pages_length - (done - header_length), done);
+}
+
+}
+
+DoubleWriteBuffer::DoubleWriteBuffer(const std::string& filename,
+                                     const std::uint32_t capacity)
+    : filename_(filename),
+      fd_(-1),
+      capacity_(capacity > 0 ? capacity : 1),
+      pages_(NULL) {
+  std::memset(&stats_, 0, sizeof(stats_));
+  void* memory;
+  if (::posix_memalign(&memory, File::BLOCK_SIZE,
+                       std::size_t(capacity_) * Page::SIZE) != 0) {
+    throw std::bad_alloc();
+  }
+  pages_ = static_cast<char*>(memory);
+  fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    const int error = errno;
+    std::free(pages_);
+    throw IoException("open", error);
+  }
+}
+
+DoubleWriteBuffer::~DoubleWriteBuffer() {
+  ::close(fd_);
+  std::free(pages_);
+}
+
+char* DoubleWriteBuffer::add(const File* file, const PageId first_page_number,
+                             const std::uint32_t count) {
+  assert(size() + count <= capacity_);
+  std::uint32_t file_index = 0;
+  while (file_index < filenames_.size() &&
+         filenames_[file_index] != file->filename()) {
+    ++file_index;
+  }
+  if (file_index == filenames_.size()) {
+    filenames_.push_back(file->filename());
+  }
+  char* run = pages_ + std::size_t(size()) * Page::SIZE;
+  for (std::uint32_t i = 0; i < count; ++i) {
+    const Slot slot = {file_index, first_page_number + i};
+    slots_.push_back(slot);
+  }
+  return run;
+}
+
+void DoubleWriteBuffer::write() {
+  if (slots_.empty()) {
+    return;
+  }
+  std::vector<char> header(sizeof(DoubleWriteHeader));
+  for (std::size_t f = 0; f < filenames_.size(); ++f) {
+    const std::uint16_t length = static_cast<std::uint16_t>(filenames_[f].size());
+    header.insert(header.end(), reinterpret_cast<const char*>(&length),
+                  reinterpret_cast<const char*>(&length) + sizeof(length));
+    header.insert(header.end(), filenames_[f].begin(), filenames_[f].end());
+  }
+  for (std::size_t s = 0; s < slots_.size(); ++s) {
+    const DoubleWriteEntry entry = {
+        slots_[s].file_index, slots_[s].page_number,
+        Crc32c::compute(pages_ + s * Page::SIZE, Page::SIZE)};
+    header.insert(header.end(), reinterpret_cast<const char*>(&entry),
+                  reinterpret_cast<const char*>(&entry) + sizeof(entry));
+  }
+  DoubleWriteHeader fixed;
+  std::memset(&fixed, 0, sizeof(fixed));
+  fixed.magic = kMagic;
+  fixed.length = static_cast<std::uint32_t>(header.size());
+  fixed.page_count = static_cast<std::uint32_t>(slots_.size());
+  fixed.file_count = static_cast<std::uint32_t>(filenames_.size());
+  std::memcpy(&header[0], &fixed, sizeof(fixed));
+  fixed.checksum = Crc32c::compute(&header[0], header.size());
+  std::memcpy(&header[offsetof(DoubleWriteHeader, checksum)], &fixed.checksum,
+              sizeof(fixed.checksum));
+
+  // A crash before the sync may leave any part of this unwritten; the
+  // checksums tell a restart which copies are whole.
+  const std::size_t header_length = padToBlock(header.size());
+  header.resize(header_length);
+  writeBatch(fd_, &header[0], header_length, pages_,
+             slots_.size() * Page::SIZE);
+  if (::fdatasync(fd_) != 0) {
+    throw IoException("fdatasync", errno);
+  }
+  ++stats_.batches;
+  stats_.pages += slots_.size();
+}
+
+void DoubleWriteBuffer::clear() {
+  slots_.clear();
+  filenames_.clear();
+}
+
+std::uint32_t DoubleWriteBuffer::restoreTornPages() {
+  DoubleWriteHeader fixed;
+  if (!readFully(fd_, reinterpret_cast<char*>(&fixed), sizeof(fixed), 0) ||
+      fixed.magic != kMagic || fixed.length < sizeof(fixed)) {
+    return 0;  // No batch written yet
+  }
+  // The length is not covered by the checksum until the header is read, so
+  // bound it by the largest header a batch of capacity_ pages can have
+  if (fixed.length > maxHeaderLength(capacity_)) {
+    return 0;
+  }
+  std::vector<char> header(fixed.length);
+  if (!readFully(fd_, &header[0], header.size(), 0)) {
+    return 0;
+  }
+  std::memset(&header[offsetof(DoubleWriteHeader, checksum)], 0,
+              sizeof(fixed.checksum));
+  if (Crc32c::compute(&header[0], header.size()) != fixed.checksum) {
+    return 0;  // Torn header: the batch never reached its home pages
+  }
+
+  // An intact header can still come from a buffer of another capacity or a
+  // different build; never read past its end
+  std::vector<std::string> filenames;
+  std::size_t offset = sizeof(fixed);
+  for (std::uint32_t f = 0; f < fixed.file_count; ++f) {
+    std::uint16_t length;
+    if (offset + sizeof(length) > header.size()) {
+      return 0;
+    }
+    std::memcpy(&length, &header[offset], sizeof(length));
+    offset += sizeof(length);
+    if (offset + length > header.size()) {
+      return 0;
+    }
+    filenames.push_back(std::string(&header[offset], length));
+    offset += length;
+  }
+  if (offset + std::size_t(fixed.page_count) * sizeof(DoubleWriteEntry) >
+      header.size()) {
+    return 0;
+  }
+
+  std::map<std::uint32_t, std::unique_ptr<File> > files;
+  const off_t pages_offset = padToBlock(fixed.length);
+  std::uint32_t restored = 0;
+  for (std::uint32_t p = 0; p < fixed.page_count; ++p) {
+    DoubleWriteEntry entry;
+    std::memcpy(&entry, &header[offset + p * sizeof(entry)], sizeof(entry));
+    if (entry.file_index >= filenames.size() ||
+        !readFully(fd_, pages_, Page::SIZE, pages_offset + p * Page::SIZE) ||
+        Crc32c::compute(pages_, Page::SIZE) != entry.checksum) {
+      continue;
+    }
+    std::unique_ptr<File>& file = files[entry.file_index];
+    if (file.get() == NULL) {
+      try {
+        file.reset(new File(File::open(filenames[entry.file_index])));
+      } catch (FileNotFoundException&) {
+        continue;
+      }
+    }
+    try {
+      file->readPage(entry.page_number);
+    } catch (PageChecksumException&) {
+      file->writeAssembled(entry.page_number, 1, pages_);
+      ++restored;
+    } catch (InvalidPageException&) {
+      // Deleted since, or never allocated; nothing to restore.
+    }
+  }
+  for (std::map<std::uint32_t, std::unique_ptr<File> >::iterator it =
+           files.begin();
+       it != files.end(); ++it) {
+    if (it->second.get() != NULL) {
+      it->second->sync();
+    }
+  }
+  stats_.restored += restored;
+  return restored;
+}
+
+}
@@ -0,0 +1,163 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Counters of a double-write buffer.
+ */
+struct DoubleWriteStats {
+  /**
+   * Batches written, each with one sync, and pages in them.
+   */
+  std::uint64_t batches;
+  std::uint64_t pages;
+
+  /**
+   * Torn pages restored by restoreTornPages().
+   */
+  std::uint64_t restored;
+};
+
+/**
+ * @brief Double-write buffer: a file that a batch of pages is written to, and
+ *        synced, before the pages are written to their places in their files.
+ *
+ * A page write is not atomic on disks with sectors smaller than a page; a
+ * crash in the middle of one leaves a torn page, half old and half new, that
+ * the write-ahead log cannot repair, as its records apply to whole pages.
+ * With a double-write buffer attached (BufMgr::attachDoubleWrite()), the
+ * buffer manager lays out every group of pages it writes back in this
+ * buffer, writes them to the double-write file with one sequential write and
+ * syncs it, and only then writes the pages home and syncs their files.  At
+ * any moment, either the copy in the double-write file or the page at home
+ * is intact.  On restart, restoreTornPages() copies the pages of the last
+ * batch back home where the page there fails its checksum.
+ *
+ * Torn pages are told by their checksums, so files must be written with
+ * checksums on (File::setChecksums(), the default).  Writes made by File
+ * itself, outside the buffer manager (allocating and deleting pages), do not
+ * go through the buffer.
+ *
+ * On disk, the file holds the last batch: a block with a header listing the
+ * files and page numbers of the pages, with checksums of the header and of
+ * every page, followed by the pages.
+ *
+ * @warning This class is not threadsafe.
+ */
+class DoubleWriteBuffer {
+ public:
+  /**
+   * Opens the double-write file, creating it if it does not exist.  Its
+   * contents are kept for restoreTornPages().
+   *
+   * @param filename  Name of the double-write file.
+   * @param capacity  Largest number of pages in a batch.
+   * @throws  IoException  If the file cannot be opened.
+   */
+  DoubleWriteBuffer(const std::string& filename,
+                    const std::uint32_t capacity = 64);
+
+  ~DoubleWriteBuffer();
+
+  /**
+   * Returns the largest number of pages in a batch.
+   */
+  std::uint32_t capacity() const { return capacity_; }
+
+  /**
+   * Returns the number of pages in the batch being gathered.
+   */
+  std::uint32_t size() const { return static_cast<std::uint32_t>(slots_.size()); }
+
+  /**
+   * Adds a run of consecutive pages of a file to the batch.
+   *
+   * @param file    File of the pages.
+   * @param first_page_number   Number of first page of the run.
+   * @param count   Number of pages, at most capacity() - size().
+   * @return  Memory for the run, BLOCK_SIZE-aligned, for the caller to lay the
+   *          pages out in with File::assemblePages().
+   */
+  char* add(const File* file, const PageId first_page_number,
+            const std::uint32_t count);
+
+  /**
+   * Writes the batch to the double-write file and syncs it.  The pages can
+   * then be written home from the memory returned by add().
+   *
+   * @throws  IoException  If the file cannot be written or synced.
+   */
+  void write();
+
+  /**
+   * Empties the batch, once its pages are on disk at home.
+   */
+  void clear();
+
+  /**
+   * Restores from the double-write file the pages of the last batch whose
+   * copy at home fails its checksum, and syncs the files changed.  To be run
+   * on restart, before anything else reads the files (and before restart
+   * recovery from the log).  A batch cut short by a crash is ignored: its
+   * pages were not written home yet.
+   *
+   * @return  Number of pages restored.
+   * @throws  IoException  If the double-write file cannot be read.
+   */
+  std::uint32_t restoreTornPages();
+
+  /**
+   * Returns the counters of the buffer.
+   */
+  DoubleWriteStats stats() const { return stats_; }
+
+ private:
+  /**
+   * @brief Page of the batch.
+   */
+  struct Slot {
+    std::uint32_t file_index;
+    PageId page_number;
+  };
+
+  DoubleWriteBuffer(const DoubleWriteBuffer&);
+  DoubleWriteBuffer& operator=(const DoubleWriteBuffer&);
+
+  /**
+   * Name of the double-write file and its descriptor.
+   */
+  std::string filename_;
+  int fd_;
+
+  std::uint32_t capacity_;
+
+  /**
+   * Memory for capacity_ pages, BLOCK_SIZE-aligned, and where the pages of
+   * the batch are in it.
+   */
+  char* pages_;
+  std::vector<Slot> slots_;
+
+  /**
+   * Names of the files of the batch, indexed by Slot::file_index.
+   */
+  std::vector<std::string> filenames_;
+
+  DoubleWriteStats stats_;
+};
+
+}
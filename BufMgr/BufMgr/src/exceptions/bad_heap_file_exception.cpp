@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bad_heap_file_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+BadHeapFileException::BadHeapFileException(const std::string& filename,
+                                           const std::string& reason)
+    : BadgerDbException(""), filename_(filename) {
+  std::stringstream ss;
+  ss << "Bad heap file " << filename_ << ": " << reason;
+  message_.assign(ss.str());
+}
+
+}
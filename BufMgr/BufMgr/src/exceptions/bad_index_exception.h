@@ -0,0 +1,48 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when an index file does not hold the
+ *        index expected, or an index is used in a way it does not support.
+ */
+class BadIndexException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a bad index exception for the given file.
+   *
+   * @param filename  Name of the index file.
+   * @param reason    What is wrong.
+   */
+  BadIndexException(const std::string& filename, const std::string& reason);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~BadIndexException() throw() {}
+
+  /**
+   * Returns the name of the index file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of the index file that caused this exception.
+   */
+  const std::string filename_;
+};
+
+}
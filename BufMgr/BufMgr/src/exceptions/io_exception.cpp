@@ -0,0 +1,25 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_exception.h"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+IoException::IoException(const std::string& operation, const int error)
+    : BadgerDbException(""),
+      error_(error) {
+  std::stringstream ss;
+  ss << "I/O operation " << operation << " failed: "
+     << (error_ != 0 ? std::strerror(error_) : "short transfer");
+  message_.assign(ss.str());
+}
+
+}
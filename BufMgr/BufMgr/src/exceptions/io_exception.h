@@ -0,0 +1,49 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a read, write or sync issued to the
+ *        operating system fails or transfers fewer bytes than requested.
+ */
+class IoException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an I/O exception for the given operation.
+   *
+   * @param operation Name of the operation that failed.
+   * @param error     errno value reported for the failure, or 0 for a short
+   *                  transfer.
+   */
+  IoException(const std::string& operation, const int error);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~IoException() throw() {}
+
+  /**
+   * Returns the errno value of the failure, or 0 for a short transfer.
+   */
+  virtual int error() const { return error_; }
+
+ protected:
+  /**
+   * errno value of the failure, or 0 for a short transfer.
+   */
+  const int error_;
+};
+
+}
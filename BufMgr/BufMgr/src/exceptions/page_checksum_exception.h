@@ -0,0 +1,63 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a page read from a file does not
+ *        match the checksum stored in its header.
+ *
+ * The page was damaged on disk or on its way from it; its contents cannot be
+ * trusted.
+ */
+class PageChecksumException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page checksum exception for the given page number and
+   * filename.
+   *
+   * @param page_number  Number of the damaged page.
+   * @param file         Name of file the page was read from.
+   */
+  PageChecksumException(const PageId page_number, const std::string& file);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PageChecksumException() throw() {}
+
+  /**
+   * Returns the number of the damaged page.
+   */
+  virtual PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns name of the file the page was read from.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Number of the damaged page.
+   */
+  const PageId page_number_;
+
+  /**
+   * Name of file the page was read from.
+   */
+  const std::string filename_;
+};
+
+}
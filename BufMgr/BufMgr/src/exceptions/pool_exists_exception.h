@@ -0,0 +1,47 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a buffer pool is created with the
+ *        name of a pool that has other settings.
+ */
+class PoolExistsException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a pool exists exception for the given pool name.
+   *
+   * @param name  Name of the pool that exists.
+   */
+  explicit PoolExistsException(const std::string& name);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PoolExistsException() throw() {}
+
+  /**
+   * Returns the name of the pool that caused this exception.
+   */
+  virtual const std::string& name() const { return name_; }
+
+ protected:
+  /**
+   * Name of the pool that caused this exception.
+   */
+  const std::string name_;
+};
+
+}
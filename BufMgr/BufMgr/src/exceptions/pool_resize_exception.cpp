@@ -0,0 +1,24 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pool_resize_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+PoolResizeException::PoolResizeException(const std::uint32_t frames,
+                                         const std::uint32_t capacity)
+    : BadgerDbException(""), frames_(frames), capacity_(capacity) {
+  std::stringstream ss;
+  ss << "Cannot resize buffer pool to " << frames_ << " frames (capacity "
+     << capacity_ << " frames)";
+  message_.assign(ss.str());
+}
+
+}
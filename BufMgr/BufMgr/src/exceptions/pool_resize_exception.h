@@ -0,0 +1,54 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when the buffer pool is asked to resize
+ *        to no frames or to more frames than were reserved for it.
+ */
+class PoolResizeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a pool resize exception for the given sizes.
+   *
+   * @param frames    Number of frames asked for.
+   * @param capacity  Largest number of frames the buffer pool can hold.
+   */
+  PoolResizeException(const std::uint32_t frames,
+                      const std::uint32_t capacity);
+
+  /**
+   * Returns the number of frames asked for.
+   */
+  virtual std::uint32_t frames() const { return frames_; }
+
+  /**
+   * Returns the largest number of frames the buffer pool can hold.
+   */
+  virtual std::uint32_t capacity() const { return capacity_; }
+
+ protected:
+  /**
+   * Number of frames asked for.
+   */
+  const std::uint32_t frames_;
+
+  /**
+   * Largest number of frames the buffer pool can hold.
+   */
+  const std::uint32_t capacity_;
+};
+
+}
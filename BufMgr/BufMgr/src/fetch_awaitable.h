@@ -0,0 +1,86 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Awaitable returned by BufMgr::fetchAsync(file, page_number) in C++20
+ *        builds; co_await yields the PageGuard of the page.
+ *
+ * The fetch is started when the coroutine awaits.  On a hit the coroutine
+ * goes on without suspending.  On a miss it is suspended and resumed from
+ * BufMgr::pollFetches() once the read has finished, so a thread can keep
+ * many coroutines' reads in flight:
+ *
+ * @code
+ *   Task scan(BufMgr& buf_mgr, File* file, PageId page_number) {
+ *     PageGuard page = co_await buf_mgr.fetchAsync(file, page_number);
+ *     ...
+ *   }
+ *
+ *   // Scheduler loop.
+ *   while (buf_mgr.pendingFetches() > 0) {
+ *     buf_mgr.pollFetches(true);
+ *   }
+ * @endcode
+ */
+class FetchAwaitable {
+ public:
+  FetchAwaitable(BufMgr* buf_mgr, File* file, const PageId page_number)
+      : buf_mgr_(buf_mgr), file_(file), page_number_(page_number) {}
+
+  bool await_ready() {
+    return buf_mgr_->fetchAsync(
+        file_, page_number_,
+        [this](PageGuard guard, std::exception_ptr error) {
+          guard_ = std::move(guard);
+          error_ = error;
+          if (waiter_) {
+            waiter_.resume();
+          }
+        });
+  }
+
+  void await_suspend(std::coroutine_handle<> waiter) { waiter_ = waiter; }
+
+  PageGuard await_resume() {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    return std::move(guard_);
+  }
+
+ private:
+  BufMgr* buf_mgr_;
+  File* file_;
+  PageId page_number_;
+
+  /**
+   * Result of the fetch.
+   */
+  PageGuard guard_;
+  std::exception_ptr error_;
+
+  /**
+   * Coroutine suspended until the read has finished.
+   */
+  std::coroutine_handle<> waiter_;
+};
+
+inline FetchAwaitable BufMgr::fetchAsync(File* file, const PageId pageNo) {
+  return FetchAwaitable(this, file, pageNo);
+}
+
+}
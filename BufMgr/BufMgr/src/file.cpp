@@ -12,31 +12,130 @@
 
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <cstdio>
+#include <cstring>
 #include <cassert>
-
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "async_io.h"
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_exception.h"
+#include "exceptions/page_checksum_exception.h"
+#include "exceptions/read_only_file_exception.h"
 #include "file_iterator.h"
+#include "lz4.h"
 #include "page.h"
+#include "page_map.h"
 
 namespace badgerdb {
 
+namespace {
+
+/**
+ * Block-aligned scratch memory for direct I/O and for runs of pages.
+ */
+class AlignedBuffer {
+ public:
+  explicit AlignedBuffer(const std::size_t length) : data_(NULL) {
+    if (::posix_memalign(&data_, File::BLOCK_SIZE, length) != 0) {
+      throw std::bad_alloc();
+    }
+  }
+
+  ~AlignedBuffer() { std::free(data_); }
+
+  char* get() const { return static_cast<char*>(data_); }
+
+ private:
+  AlignedBuffer(const AlignedBuffer&);
+  AlignedBuffer& operator=(const AlignedBuffer&);
+
+  void* data_;
+};
+
+/**
+ * Largest single transfer; Linux caps reads and writes just below 2 GB.
+ */
+const std::size_t kMaxTransfer = 1u << 30;
+
+/**
+ * Number of pages read ahead at a time by scans of mapped files.
+ */
+const PageId kScanWindowPages = 128;
+
+bool isAligned(const void* address) {
+  return reinterpret_cast<std::uintptr_t>(address) % File::BLOCK_SIZE == 0;
+}
+
+/**
+ * Start of the slot of a page in a compressed file, followed by the page
+ * header as is, so that it can be read without decompressing the page, and
+ * then the data of the page.
+ */
+struct StoredPageHeader {
+  /**
+   * Length of the compressed data, or Page::DATA_SIZE if it is stored as is
+   * because it does not compress.
+   */
+  std::uint32_t length;
+
+  /**
+   * Number of the page, to tell a slot the map wrongly points to.
+   */
+  PageId page_number;
+};
+
+/**
+ * Largest slot of a page, in bytes.
+ */
+const std::size_t kMaxSlot = sizeof(StoredPageHeader) + Page::SIZE;
+
+std::streampos sectorPosition(const std::uint32_t sector) {
+  return static_cast<std::streamoff>(sector) * PageMap::SECTOR_SIZE;
+}
+
+}
+
 File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+File::DescriptorMap File::open_descriptors_;
+File::PageMapMap File::open_page_maps_;
 
 File File::create(const std::string& filename) {
   return File(filename, true /* create_new */);
 }
 
+File File::createCompressed(const std::string& filename) {
+  return File(filename, true /* create_new */, true /* compressed */);
+}
+
 File File::open(const std::string& filename) {
   return File(filename, false /* create_new */);
 }
 
+File File::openMapped(const std::string& filename) {
+  File file(filename, false /* create_new */);
+  file.map();
+  return file;
+}
+
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
     throw FileNotFoundException(filename);
@@ -67,16 +166,36 @@ bool File::exists(const std::string& filename) {
 
 File::File(const File& other)
   : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
+    stream_(open_streams_[filename_]),
+    page_map_(other.page_map_),
+    fd_(open_descriptors_[filename_]),
+    cache_mode_(CACHE_BUFFERED),
+    direct_fd_(-1),
+    mapping_(other.mapping_),
+    mapping_length_(other.mapping_length_),
+    checksums_(other.checksums_) {
   ++open_counts_[filename_];
+  if (other.cache_mode_ != CACHE_BUFFERED) {
+    setCacheMode(other.cache_mode_);
+  }
 }
 
 File& File::operator=(const File& rhs) {
   // This accounts for self-assignment and assignment of a File object for the
   // same file.
+  const CacheMode mode = rhs.cache_mode_;
+  const std::shared_ptr<const char> mapping = rhs.mapping_;
+  const std::size_t mapping_length = rhs.mapping_length_;
+  const bool checksums = rhs.checksums_;
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
   openIfNeeded(false /* create_new */);
+  mapping_ = mapping;
+  mapping_length_ = mapping_length;
+  checksums_ = checksums;
+  if (mode != CACHE_BUFFERED) {
+    setCacheMode(mode);
+  }
   return *this;
 }
 
@@ -159,9 +278,8 @@ Page File::readPage(const PageId page_number) const {
 
 Page File::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+  readStoredPages(page_number, 1, reinterpret_cast<char*>(&page));
+  verifyChecksum(page_number, &page);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
@@ -169,6 +287,118 @@ Page File::readPage(const PageId page_number, const bool allow_free) const {
   return page;
 }
 
+void File::readPages(const PageId first_page_number, const std::uint32_t count,
+                     Page* const* pages) const {
+  FileHeader header = readHeader();
+  if (first_page_number == Page::INVALID_NUMBER ||
+      first_page_number + count > header.num_pages) {
+    throw InvalidPageException(first_page_number + count - 1, filename_);
+  }
+  if (count == 1) {
+    // Straight into the page, which in direct mode avoids the bounce buffer
+    // if the page is a buffer pool frame.
+    readStoredPages(first_page_number, 1, reinterpret_cast<char*>(pages[0]));
+  } else {
+    AlignedBuffer run(count * Page::SIZE);
+    readStoredPages(first_page_number, count, run.get());
+    for (std::uint32_t i = 0; i < count; ++i) {
+      std::memcpy(pages[i], run.get() + i * Page::SIZE, Page::SIZE);
+    }
+  }
+  for (std::uint32_t i = 0; i < count; ++i) {
+    verifyChecksum(first_page_number + i, pages[i]);
+    if (!pages[i]->isUsed()) {
+      throw InvalidPageException(first_page_number + i, filename_);
+    }
+  }
+}
+
+void File::readPages(AsyncIo& io, const PageId* page_numbers,
+                     const std::uint32_t count, Page* const* pages) const {
+  FileHeader header = readHeader();
+  for (std::uint32_t i = 0; i < count; ++i) {
+    assert(i == 0 || page_numbers[i] > page_numbers[i - 1]);
+    if (page_numbers[i] == Page::INVALID_NUMBER ||
+        page_numbers[i] >= header.num_pages) {
+      throw InvalidPageException(page_numbers[i], filename_);
+    }
+  }
+
+  if (isCompressed()) {
+    // Pages have to be decompressed, one at a time.
+    for (std::uint32_t i = 0; i < count; ++i) {
+      readStoredPages(page_numbers[i], 1, reinterpret_cast<char*>(pages[i]));
+      verifyChecksum(page_numbers[i], pages[i]);
+      if (!pages[i]->isUsed()) {
+        throw InvalidPageException(page_numbers[i], filename_);
+      }
+    }
+    return;
+  }
+
+  // A Page is laid out exactly as on disk, so runs are read straight into the
+  // pages; a single page can use the registered buffer pool directly.  Direct
+  // reads need every page to be block-aligned, as buffer pool frames are.
+  int fd = fd_;
+  if (cache_mode_ == CACHE_DIRECT) {
+    fd = direct_fd_;
+    for (std::uint32_t i = 0; i < count; ++i) {
+      if (!isAligned(pages[i])) {
+        fd = fd_;
+        break;
+      }
+    }
+  }
+  std::vector<struct iovec> iov(count);
+  std::uint32_t run;
+  for (std::uint32_t i = 0; i < count; i += run) {
+    run = 1;
+    while (i + run < count && run < IOV_MAX &&
+           page_numbers[i + run] == page_numbers[i] + run) {
+      ++run;
+    }
+    for (std::uint32_t r = i; r < i + run; ++r) {
+      iov[r].iov_base = pages[r];
+      iov[r].iov_len = Page::SIZE;
+    }
+    io.read(fd, pagePosition(page_numbers[i]), &iov[i], run);
+  }
+  io.wait();
+  for (std::uint32_t i = 0; i < count; ++i) {
+    if (fd == fd_) {
+      dropCached(pagePosition(page_numbers[i]), Page::SIZE);
+    }
+    verifyChecksum(page_numbers[i], pages[i]);
+    if (!pages[i]->isUsed()) {
+      throw InvalidPageException(page_numbers[i], filename_);
+    }
+  }
+}
+
+void File::startReadPage(AsyncIo& io, const PageId page_number, Page* page,
+                         const std::uint64_t tag) const {
+  assert(!isCompressed());
+  const FileHeader header = readHeader();
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  struct iovec iov;
+  iov.iov_base = page;
+  iov.iov_len = Page::SIZE;
+  const int fd =
+      cache_mode_ == CACHE_DIRECT && isAligned(page) ? direct_fd_ : fd_;
+  io.submitRead(fd, pagePosition(page_number), &iov, 1, tag);
+}
+
+void File::finishReadPage(const PageId page_number, const Page* page) const {
+  dropCached(pagePosition(page_number), Page::SIZE);
+  verifyChecksum(page_number, page);
+  if (!page->isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+}
+
 void File::writePage(const Page& new_page) {
   PageHeader header = readPageHeader(new_page.page_number());
   if (header.current_page_number == Page::INVALID_NUMBER) {
@@ -184,6 +414,134 @@ void File::writePage(const Page& new_page) {
   writePage(new_page.page_number(), header, new_page);
 }
 
+void File::writePages(const PageId first_page_number, const std::uint32_t count,
+                      const Page* const* pages) {
+  AlignedBuffer run(count * Page::SIZE);
+  assemblePages(first_page_number, count, pages, run.get());
+  writeAssembled(first_page_number, count, run.get());
+}
+
+void File::assemblePages(const PageId first_page_number,
+                         const std::uint32_t count, const Page* const* pages,
+                         char* raw_pages) const {
+  // Read the run as it is on disk first: as in writePage(const Page&), the
+  // next page pointers there may have been updated since the pages were read.
+  readStoredPages(first_page_number, count, raw_pages);
+  for (std::uint32_t i = 0; i < count; ++i) {
+    char* raw = raw_pages + i * Page::SIZE;
+    const Page& new_page = *pages[i];
+    assert(new_page.page_number() == first_page_number + i);
+    PageHeader header;
+    std::memcpy(&header, raw, sizeof(header));
+    if (header.current_page_number == Page::INVALID_NUMBER) {
+      throw InvalidPageException(first_page_number + i, filename_);
+    }
+    const PageId next_page_number = header.next_page_number;
+    header = new_page.header_;
+    header.next_page_number = next_page_number;
+    std::memcpy(raw, &header, sizeof(header));
+    std::memcpy(raw + sizeof(header), new_page.data_, Page::DATA_SIZE);
+    stampChecksum(reinterpret_cast<Page*>(raw));
+  }
+}
+
+void File::writeAssembled(const PageId first_page_number,
+                          const std::uint32_t count, const char* raw_pages) {
+  writeStoredPages(first_page_number, count, raw_pages);
+}
+
+void File::writePages(AsyncIo& io, const Page* const* pages,
+                      const std::uint32_t count) {
+  checkWritable();
+  if (isCompressed()) {
+    // Pages are compressed and written one at a time anyway.
+    for (std::uint32_t i = 0; i < count; ++i) {
+      writePages(pages[i]->page_number(), 1, &pages[i]);
+    }
+    return;
+  }
+  // The pages are assembled in one aligned buffer, so that each run is a
+  // single contiguous write that can also go through O_DIRECT.  First fetch
+  // the on-disk headers there for their next page pointers, as
+  // writePage(const Page&) does, but all at once.
+  AlignedBuffer staging(count * Page::SIZE);
+  std::vector<struct iovec> iov(count);
+  for (std::uint32_t i = 0; i < count; ++i) {
+    iov[i].iov_base = staging.get() + i * Page::SIZE;
+    iov[i].iov_len = sizeof(PageHeader);
+    io.read(fd_, pagePosition(pages[i]->page_number()), &iov[i], 1);
+  }
+  io.wait();
+  for (std::uint32_t i = 0; i < count; ++i) {
+    char* raw = staging.get() + i * Page::SIZE;
+    PageHeader header;
+    std::memcpy(&header, raw, sizeof(header));
+    if (header.current_page_number == Page::INVALID_NUMBER) {
+      throw InvalidPageException(pages[i]->page_number(), filename_);
+    }
+    const PageId next_page_number = header.next_page_number;
+    std::memcpy(raw, pages[i], Page::SIZE);
+    std::memcpy(raw + offsetof(PageHeader, next_page_number),
+                &next_page_number, sizeof(next_page_number));
+    stampChecksum(reinterpret_cast<Page*>(raw));
+  }
+
+  const int fd = cache_mode_ == CACHE_DIRECT ? direct_fd_ : fd_;
+  std::uint32_t run;
+  for (std::uint32_t i = 0; i < count; i += run) {
+    run = 1;
+    while (i + run < count && (run + 1) * Page::SIZE <= kMaxTransfer &&
+           pages[i + run]->page_number() == pages[i]->page_number() + run) {
+      ++run;
+    }
+    iov[i].iov_base = staging.get() + i * Page::SIZE;
+    iov[i].iov_len = run * Page::SIZE;
+    io.write(fd, pagePosition(pages[i]->page_number()), &iov[i], 1);
+  }
+  io.wait();
+  if (fd == fd_) {
+    for (std::uint32_t i = 0; i < count; ++i) {
+      dropCached(pagePosition(pages[i]->page_number()), Page::SIZE);
+    }
+  }
+}
+
+void File::sync() {
+  stream_->flush();
+  if (isCompressed()) {
+    page_map_->flush();
+  }
+  if (::fsync(fd_) != 0) {
+    throw IoException("fsync", errno);
+  }
+  dropCached(0, 0 /* to end of file */);
+}
+
+File::CacheMode File::setCacheMode(const CacheMode mode) {
+  if (direct_fd_ >= 0) {
+    ::close(direct_fd_);
+    direct_fd_ = -1;
+  }
+  cache_mode_ = mode;
+  if (mode == CACHE_DIRECT && isCompressed()) {
+    // Slots of compressed pages are not aligned to direct I/O blocks.
+    cache_mode_ = CACHE_DROP;
+  } else if (mode == CACHE_DIRECT) {
+    direct_fd_ = ::open(filename_.c_str(), O_RDWR | O_DIRECT);
+    if (direct_fd_ < 0) {
+      // Filesystem without O_DIRECT support (tmpfs, for one).
+      cache_mode_ = CACHE_DROP;
+    }
+  }
+  if (cache_mode_ != CACHE_BUFFERED) {
+    // Whatever was cached so far would be stale after direct writes anyway.
+    stream_->flush();
+    ::fdatasync(fd_);
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED);
+  }
+  return cache_mode_;
+}
+
 void File::deletePage(const PageId page_number) {
   FileHeader header = readHeader();
   Page existing_page = readPage(page_number);
@@ -223,14 +581,25 @@ FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
+File::File(const std::string& name, const bool create_new,
+           const bool compressed)
+    : filename_(name),
+      cache_mode_(CACHE_BUFFERED),
+      direct_fd_(-1),
+      mapping_length_(0),
+      checksums_(true) {
   openIfNeeded(create_new);
 
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         compressed ? FileHeader::COMPRESSED : 0 /* flags */};
     writeHeader(header);
+    if (compressed) {
+      page_map_.reset(new PageMap(fd_, BLOCK_SIZE / PageMap::SECTOR_SIZE));
+      open_page_maps_[filename_] = page_map_;
+    }
   }
 }
 
@@ -238,6 +607,11 @@ void File::openIfNeeded(const bool create_new) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
     stream_ = open_streams_[filename_];
+    fd_ = open_descriptors_[filename_];
+    PageMapMap::const_iterator page_map = open_page_maps_.find(filename_);
+    if (page_map != open_page_maps_.end()) {
+      page_map_ = page_map->second;
+    }
   } else {
     std::ios_base::openmode mode =
         std::fstream::in | std::fstream::out | std::fstream::binary;
@@ -256,35 +630,309 @@ void File::openIfNeeded(const bool create_new) {
       }
     }
     stream_.reset(new std::fstream(filename_, mode));
+    fd_ = ::open(filename_.c_str(), O_RDWR);
     open_streams_[filename_] = stream_;
+    open_descriptors_[filename_] = fd_;
     open_counts_[filename_] = 1;
+    if (!create_new && (readHeader().flags & FileHeader::COMPRESSED)) {
+      page_map_.reset(new PageMap(fd_, BLOCK_SIZE / PageMap::SECTOR_SIZE));
+      page_map_->load();
+      open_page_maps_[filename_] = page_map_;
+    }
   }
 }
 
 void File::close() {
+  if (direct_fd_ >= 0) {
+    ::close(direct_fd_);
+    direct_fd_ = -1;
+  }
+  mapping_.reset();
+  mapping_length_ = 0;
   --open_counts_[filename_];
   stream_.reset();
+  page_map_.reset();
   if (open_counts_[filename_] == 0) {
+    PageMapMap::iterator page_map = open_page_maps_.find(filename_);
+    if (page_map != open_page_maps_.end()) {
+      try {
+        page_map->second->flush();
+      } catch (IoException&) {
+        // The map on disk stays as of the last sync().
+      }
+      open_page_maps_.erase(page_map);
+    }
+    ::close(open_descriptors_[filename_]);
+    open_descriptors_.erase(filename_);
     open_streams_.erase(filename_);
     open_counts_.erase(filename_);
   }
 }
 
 void File::writePage(const PageId page_number, const Page& new_page) {
-  writePage(page_number, new_page.header_, new_page);
+  Page page(new_page);
+  stampChecksum(&page);
+  writeStoredPages(page_number, 1, reinterpret_cast<const char*>(&page));
 }
 
 void File::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
-  stream_->flush();
+  Page page(new_page);
+  page.header_ = header;
+  stampChecksum(&page);
+  writeStoredPages(page_number, 1, reinterpret_cast<const char*>(&page));
+}
+
+void File::readStoredPages(const PageId first_page_number,
+                           const std::uint32_t count, char* raw_pages) const {
+  if (!isCompressed()) {
+    readBlocks(pagePosition(first_page_number), raw_pages, count * Page::SIZE);
+    return;
+  }
+  char slot[kMaxSlot];
+  for (std::uint32_t i = 0; i < count; ++i) {
+    const PageId page_number = first_page_number + i;
+    char* raw = raw_pages + i * Page::SIZE;
+    const PageExtent extent = page_map_->find(page_number);
+    const std::size_t length =
+        std::min<std::size_t>(extent.sectors * PageMap::SECTOR_SIZE, kMaxSlot);
+    if (length == 0) {
+      std::memset(raw, 0, Page::SIZE);
+      continue;
+    }
+    readBlocks(sectorPosition(extent.sector), slot, length);
+    StoredPageHeader stored;
+    std::memcpy(&stored, slot, sizeof(stored));
+    const std::size_t data_offset = sizeof(stored) + sizeof(PageHeader);
+    if (stored.page_number != page_number ||
+        stored.length > length - data_offset) {
+      throw PageChecksumException(page_number, filename_);
+    }
+    std::memcpy(raw, slot + sizeof(stored), sizeof(PageHeader));
+    char* data = raw + sizeof(PageHeader);
+    if (stored.length == Page::DATA_SIZE) {
+      std::memcpy(data, slot + data_offset, Page::DATA_SIZE);
+    } else if (!Lz4::decompress(slot + data_offset, stored.length, data,
+                                Page::DATA_SIZE)) {
+      throw PageChecksumException(page_number, filename_);
+    }
+  }
+}
+
+void File::writeStoredPages(const PageId first_page_number,
+                            const std::uint32_t count, const char* raw_pages) {
+  if (!isCompressed()) {
+    writeBlocks(pagePosition(first_page_number), raw_pages,
+                count * Page::SIZE);
+    return;
+  }
+  checkWritable();
+  char slot[kMaxSlot + PageMap::SECTOR_SIZE];
+  const std::size_t data_offset = sizeof(StoredPageHeader) + sizeof(PageHeader);
+  for (std::uint32_t i = 0; i < count; ++i) {
+    const PageId page_number = first_page_number + i;
+    const char* raw = raw_pages + i * Page::SIZE;
+    StoredPageHeader stored;
+    stored.page_number = page_number;
+    stored.length = static_cast<std::uint32_t>(
+        Lz4::compress(raw + sizeof(PageHeader), Page::DATA_SIZE,
+                      slot + data_offset, Page::DATA_SIZE - 1));
+    if (stored.length == 0) {
+      // Incompressible: stored as is
+      stored.length = Page::DATA_SIZE;
+      std::memcpy(slot + data_offset, raw + sizeof(PageHeader),
+                  Page::DATA_SIZE);
+    }
+    std::memcpy(slot, &stored, sizeof(stored));
+    std::memcpy(slot + sizeof(stored), raw, sizeof(PageHeader));
+    const std::size_t used = data_offset + stored.length;
+    const std::uint32_t sectors = static_cast<std::uint32_t>(
+        (used + PageMap::SECTOR_SIZE - 1) / PageMap::SECTOR_SIZE);
+    std::memset(slot + used, 0, sectors * PageMap::SECTOR_SIZE - used);
+    const PageExtent extent = page_map_->place(page_number, sectors);
+    writeBlocks(sectorPosition(extent.sector), slot,
+                sectors * PageMap::SECTOR_SIZE);
+  }
+}
+
+void File::readBlocks(const std::streampos position, char* buffer,
+                      const std::size_t length) const {
+  const std::size_t offset = static_cast<std::streamoff>(position);
+  if (isMapped() && offset + length <= mapping_length_) {
+    std::memcpy(buffer, mapping_.get() + offset, length);
+    return;
+  }
+  if (cache_mode_ != CACHE_DIRECT) {
+    stream_->seekg(position, std::ios::beg);
+    stream_->read(buffer, length);
+    dropCached(position, length);
+    return;
+  }
+
+  std::unique_ptr<AlignedBuffer> bounce;
+  char* target = buffer;
+  if (!isAligned(buffer)) {
+    bounce.reset(new AlignedBuffer(length));
+    target = bounce->get();
+  }
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n =
+        ::pread(direct_fd_, target + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException("pread", errno);
+    }
+    if (n == 0) {
+      break;  // End of file.
+    }
+    done += n;
+  }
+  if (target != buffer) {
+    std::memcpy(buffer, target, done);
+  }
+}
+
+void File::writeBlocks(const std::streampos position, const char* buffer,
+                       const std::size_t length) {
+  checkWritable();
+  if (cache_mode_ != CACHE_DIRECT) {
+    stream_->seekp(position, std::ios::beg);
+    stream_->write(buffer, length);
+    stream_->flush();
+    dropCached(position, length);
+    return;
+  }
+
+  std::unique_ptr<AlignedBuffer> bounce;
+  const char* source = buffer;
+  if (!isAligned(buffer)) {
+    bounce.reset(new AlignedBuffer(length));
+    std::memcpy(bounce->get(), buffer, length);
+    source = bounce->get();
+  }
+  const off_t offset = static_cast<std::streamoff>(position);
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n =
+        ::pwrite(direct_fd_, source + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException("pwrite", errno);
+    }
+    if (n == 0) {
+      throw IoException("pwrite", 0 /* short transfer */);
+    }
+    done += n;
+  }
+}
+
+const Page* File::mappedPage(const PageId page_number) const {
+  assert(isMapped());
+  const std::size_t offset =
+      static_cast<std::streamoff>(pagePosition(page_number));
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= readHeader().num_pages ||
+      offset + Page::SIZE > mapping_length_) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const Page* page = reinterpret_cast<const Page*>(mapping_.get() + offset);
+  verifyChecksum(page_number, page);
+  if (!page->isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return page;
+}
+
+void File::map() {
+  if (isCompressed()) {
+    throw IoException("mmap", EINVAL);
+  }
+  struct stat status;
+  if (::fstat(fd_, &status) != 0) {
+    throw IoException("fstat", errno);
+  }
+  const std::size_t length = status.st_size;
+  void* base = ::mmap(NULL, length, PROT_READ, MAP_SHARED, fd_, 0);
+  if (base == MAP_FAILED) {
+    throw IoException("mmap", errno);
+  }
+  mapping_.reset(static_cast<const char*>(base), [length](const char* p) {
+    ::munmap(const_cast<char*>(p), length);
+  });
+  mapping_length_ = length;
+}
+
+void File::adviseScan(const PageId page_number, const bool start) const {
+  if (!isMapped() || page_number == Page::INVALID_NUMBER) {
+    return;
+  }
+  char* base = const_cast<char*>(mapping_.get());
+  if (start) {
+    ::madvise(base, mapping_length_, MADV_SEQUENTIAL);
+  } else if ((page_number - 1) % kScanWindowPages != 0) {
+    return;
+  }
+  // Read ahead from the window after the current one (from the current one
+  // too when starting).  The mapping is page-aligned, and so are the pages.
+  const PageId window = (page_number - 1) / kScanWindowPages + (start ? 0 : 1);
+  const std::size_t offset = static_cast<std::streamoff>(
+      pagePosition(window * kScanWindowPages + 1));
+  if (offset >= mapping_length_) {
+    return;
+  }
+  const std::size_t length = std::min<std::size_t>(
+      (start ? 2 : 1) * kScanWindowPages * Page::SIZE,
+      mapping_length_ - offset);
+  ::madvise(base + offset, length, MADV_WILLNEED);
+}
+
+std::uint64_t File::storedBytes() const {
+  if (isCompressed()) {
+    return page_map_->storedSectors() * PageMap::SECTOR_SIZE;
+  }
+  return static_cast<std::uint64_t>(readHeader().num_pages - 1) * Page::SIZE;
+}
+
+void File::stampChecksum(Page* page) const {
+  if (checksums_) {
+    page->updateChecksum();
+  } else {
+    page->clearChecksum();
+  }
+}
+
+void File::verifyChecksum(const PageId page_number, const Page* page) const {
+  if (checksums_ && !page->verifyChecksum()) {
+    throw PageChecksumException(page_number, filename_);
+  }
+}
+
+void File::checkWritable() const {
+  if (isMapped()) {
+    throw ReadOnlyFileException(filename_);
+  }
+}
+
+void File::dropCached(const std::streampos position,
+                      const std::size_t length) const {
+  if (cache_mode_ != CACHE_BUFFERED) {
+    // Dirty pages are only queued for write-back here; sync() drops them.
+    ::posix_fadvise(fd_, static_cast<std::streamoff>(position), length,
+                    POSIX_FADV_DONTNEED);
+  }
 }
 
 FileHeader File::readHeader() const {
   FileHeader header;
+  if (isMapped()) {
+    std::memcpy(&header, mapping_.get(), sizeof(header));
+    return header;
+  }
   stream_->seekg(0 /* pos */, std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
 
@@ -292,6 +940,7 @@ FileHeader File::readHeader() const {
 }
 
 void File::writeHeader(const FileHeader& header) {
+  checkWritable();
   stream_->seekp(0 /* pos */, std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
   stream_->flush();
@@ -299,6 +948,25 @@ void File::writeHeader(const FileHeader& header) {
 
 PageHeader File::readPageHeader(PageId page_number) const {
   PageHeader header;
+  if (isCompressed()) {
+    // Stored as is after the start of the slot
+    const PageExtent extent = page_map_->find(page_number);
+    if (extent.sectors == 0) {
+      std::memset(&header, 0, sizeof(header));
+      return header;
+    }
+    stream_->seekg(sectorPosition(extent.sector) +
+                       static_cast<std::streamoff>(sizeof(StoredPageHeader)),
+                   std::ios::beg);
+    stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+    return header;
+  }
+  const std::size_t offset =
+      static_cast<std::streamoff>(pagePosition(page_number));
+  if (isMapped() && offset + sizeof(header) <= mapping_length_) {
+    std::memcpy(&header, mapping_.get() + offset, sizeof(header));
+    return header;
+  }
   stream_->seekg(pagePosition(page_number), std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
 
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <fstream>
 #include <string>
 #include <map>
@@ -16,12 +17,19 @@
 
 namespace badgerdb {
 
+class AsyncIo;
 class FileIterator;
+class PageMap;
 
 /**
  * @brief Header metadata for files on disk which contain pages.
  */
 struct FileHeader {
+  /**
+   * Flag of files whose pages are stored compressed.
+   */
+  static const std::uint32_t COMPRESSED = 1;
+
   /**
    * Number of pages allocated in the file.
    */
@@ -42,6 +50,11 @@ struct FileHeader {
    */
   PageId first_free_page;
 
+  /**
+   * Format flags of the file (COMPRESSED), 0 for a file of plain pages.
+   */
+  std::uint32_t flags;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -52,7 +65,8 @@ struct FileHeader {
     return num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        first_free_page == rhs.first_free_page &&
+        flags == rhs.flags;
   }
 };
 
@@ -68,10 +82,51 @@ struct FileHeader {
  * detects this (by looking in the open_streams_ map) and just returns a file object with
  * the already created stream for the file without actually opening the UNIX file again. 
  *
+ * Pages are written with a CRC-32C checksum in their header and checked
+ * against it when read, so that a page damaged on disk is reported with
+ * PageChecksumException instead of being used; setChecksums() turns this off.
+ *
+ * A file made with createCompressed() stores its pages LZ4-compressed, each
+ * in as many 512-byte sectors as it needs, located through a page-offset map
+ * (PageMap) instead of at a fixed position; open() tells the formats apart.
+ * Pages are compressed on write and decompressed on read, so the pages handed
+ * in and out are the same in both formats.  Compressed files cannot be mapped
+ * or read asynchronously, and use CACHE_DROP when CACHE_DIRECT is asked for.
+ *
  * @warning This class is not threadsafe.
  */
 class File {
  public:
+  /**
+   * Ways in which page reads and writes use the operating system's page cache.
+   */
+  enum CacheMode {
+    /**
+     * Pages are cached by the operating system as well (the default).
+     */
+    CACHE_BUFFERED,
+
+    /**
+     * Pages bypass the operating system's page cache (O_DIRECT).  Pages at
+     * BLOCK_SIZE-aligned addresses, like the frames of the buffer pool, are
+     * transferred directly; others go through an aligned bounce buffer.
+     */
+    CACHE_DIRECT,
+
+    /**
+     * Pages go through the operating system's page cache but are dropped from
+     * it (posix_fadvise) once read or written.  Used when the filesystem does
+     * not support O_DIRECT.
+     */
+    CACHE_DROP
+  };
+
+  /**
+   * Alignment of file offsets, lengths and memory for direct I/O.  The file
+   * header is padded to this size so that every page starts on a block.
+   */
+  static const std::size_t BLOCK_SIZE = 4096;
+
   /**
    * Creates a new file.
    *
@@ -80,6 +135,14 @@ class File {
    */
   static File create(const std::string& filename);
 
+  /**
+   * Creates a new file whose pages are stored compressed.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileExistsException     If the requested file already exists.
+   */
+  static File createCompressed(const std::string& filename);
+
   /**
    * Opens the file named fileName and returns the corresponding File object.
 	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
@@ -92,6 +155,20 @@ class File {
    */
   static File open(const std::string& filename);
 
+  /**
+   * Opens an existing file read-only and maps it into memory.  Pages are read
+   * from the mapping instead of through system calls, and mappedPage() gives
+   * direct access to them, which BufMgr hands out instead of copying pages
+   * into frames.  Scans through FileIterator advise the kernel to read ahead.
+   * The file must not be changed through other File objects while mapped.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  IoException             If the file cannot be mapped, or is
+   *                                  compressed (EINVAL).
+   */
+  static File openMapped(const std::string& filename);
+
   /**
    * Deletes an existing file.
    *
@@ -152,9 +229,66 @@ class File {
    * @return  The page.
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
+   * @throws  PageChecksumException If the page does not match its checksum.
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads a run of consecutive existing pages from the file with a single
+   * seek and read, instead of one of each per page.
+   *
+   * @param first_page_number Number of first page of the run.
+   * @param count             Number of pages in the run.
+   * @param pages             Array of <count> pages to read the run into.
+   * @throws  InvalidPageException  If any page of the run doesn't exist in the
+   *                                file or is not currently used.
+   * @throws  PageChecksumException If any page does not match its checksum.
+   */
+  void readPages(const PageId first_page_number, const std::uint32_t count,
+                 Page* const* pages) const;
+
+  /**
+   * Reads existing pages through an asynchronous I/O queue, straight into the
+   * given pages.  Each run of consecutive page numbers is one vectored read,
+   * and all runs are in flight at the same time.
+   *
+   * @param io            Queue to issue the reads on.
+   * @param page_numbers  Numbers of pages to read, in increasing order.
+   * @param count         Number of pages to read.
+   * @param pages         Array of <count> pages to read into.
+   * @throws  InvalidPageException  If any page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  PageChecksumException If any page does not match its checksum.
+   * @throws  IoException           If a read fails.
+   */
+  void readPages(AsyncIo& io, const PageId* page_numbers,
+                 const std::uint32_t count, Page* const* pages) const;
+
+  /**
+   * Queues a read of an existing page into <page> on an asynchronous I/O
+   * queue without waiting for it.  Its completion is reported by
+   * AsyncIo::poll() under <tag>; finishReadPage() then checks the page.
+   *
+   * @param io           Queue to issue the read on.
+   * @param page_number  Number of page to read.
+   * @param page         Page to read into.
+   * @param tag          Tag of the read's completion.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   * @warning Not for compressed files (isCompressed()).
+   */
+  void startReadPage(AsyncIo& io, const PageId page_number, Page* page,
+                     const std::uint64_t tag) const;
+
+  /**
+   * Completes a read queued with startReadPage() once it has finished.
+   *
+   * @param page_number  Number of page read.
+   * @param page         Page read into.
+   * @throws  InvalidPageException  If the page is not currently used.
+   * @throws  PageChecksumException If the page does not match its checksum.
+   */
+  void finishReadPage(const PageId page_number, const Page* page) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
@@ -164,6 +298,135 @@ class File {
    */
   void writePage(const Page& new_page);
 
+  /**
+   * Writes a run of consecutive pages into the file with a single seek and
+   * write, replacing their existing contents.  As with writePage(), the pages
+   * must have been allocated in this file, and the next page pointers on disk
+   * are kept.  Data is handed to the operating system but not synced; call
+   * sync() once after a group of writes.
+   *
+   * @param first_page_number Number of first page of the run.
+   * @param count             Number of pages in the run.
+   * @param pages             Array of <count> pages to write, in page order.
+   * @throws  InvalidPageException  If any page of the run has been deleted.
+   */
+  void writePages(const PageId first_page_number, const std::uint32_t count,
+                  const Page* const* pages);
+
+  /**
+   * First half of writePages(): lays out a run of consecutive pages in memory
+   * exactly as writePages() would write them, next page pointers from disk
+   * and checksums included.  Used to copy pages elsewhere (a double-write
+   * buffer) before writing them home with writeAssembled().
+   *
+   * @param first_page_number Number of first page of the run.
+   * @param count             Number of pages in the run.
+   * @param pages             Array of <count> pages to write, in page order.
+   * @param raw_pages         Memory for <count> pages; BLOCK_SIZE-aligned in
+   *                          CACHE_DIRECT mode to avoid a bounce buffer.
+   * @throws  InvalidPageException  If any page of the run has been deleted.
+   */
+  void assemblePages(const PageId first_page_number, const std::uint32_t count,
+                     const Page* const* pages, char* raw_pages) const;
+
+  /**
+   * Second half of writePages(): writes a run laid out by assemblePages(), or
+   * a copy of one, to its place in the file.  Data is not synced.
+   *
+   * @param first_page_number Number of first page of the run.
+   * @param count             Number of pages in the run.
+   * @param raw_pages         The run as laid out by assemblePages().
+   */
+  void writeAssembled(const PageId first_page_number,
+                      const std::uint32_t count, const char* raw_pages);
+
+  /**
+   * Writes pages through an asynchronous I/O queue, replacing their existing
+   * contents as writePages() does.  The on-disk headers of all pages are read
+   * in one batch, then each run of consecutive pages is written with one
+   * vectored write, all runs in flight at the same time.  Data is not synced.
+   *
+   * @param io      Queue to issue the reads and writes on.
+   * @param pages   Array of <count> pages to write, in increasing page order.
+   * @param count   Number of pages to write.
+   * @throws  InvalidPageException  If any of the pages has been deleted.
+   * @throws  IoException           If a read or write fails.
+   */
+  void writePages(AsyncIo& io, const Page* const* pages,
+                  const std::uint32_t count);
+
+  /**
+   * Forces everything written to the file so far out to stable storage,
+   * including the page-offset map of a compressed file.
+   *
+   * @throws  IoException  If the file cannot be synced.
+   */
+  void sync();
+
+  /**
+   * Sets how page reads and writes through this object use the operating
+   * system's page cache.  Pages already in the OS page cache are dropped when
+   * switching away from CACHE_BUFFERED.  If CACHE_DIRECT is requested but the
+   * file cannot be opened with O_DIRECT, or is compressed, CACHE_DROP is used
+   * instead.
+   *
+   * @param mode  Requested cache mode.
+   * @return  The cache mode now in effect.
+   */
+  CacheMode setCacheMode(const CacheMode mode);
+
+  /**
+   * Returns the cache mode in effect for this object.
+   */
+  CacheMode cacheMode() const { return cache_mode_; }
+
+  /**
+   * Sets whether pages written through this object get a checksum, and pages
+   * read through it are checked against theirs; on by default.  Pages written
+   * without a checksum are never checked, so files written either way can be
+   * read either way.
+   *
+   * @param enable  Whether to write and check checksums.
+   */
+  void setChecksums(const bool enable) { checksums_ = enable; }
+
+  /**
+   * Returns true if pages written and read through this object are
+   * checksummed.
+   */
+  bool checksums() const { return checksums_; }
+
+  /**
+   * Returns true if this object was opened with openMapped().  Such objects
+   * are read-only: writing, allocating or deleting pages throws
+   * ReadOnlyFileException.
+   */
+  bool isMapped() const { return mapping_.get() != NULL; }
+
+  /**
+   * Returns true if the pages of the file are stored compressed.
+   */
+  bool isCompressed() const { return page_map_.get() != NULL; }
+
+  /**
+   * Returns the number of bytes the stored pages of a compressed file take up
+   * on disk, or of all pages of a plain one.
+   */
+  std::uint64_t storedBytes() const;
+
+  /**
+   * Returns a view of an existing page in the mapping of a file opened with
+   * openMapped().  The memory is read-only, and stays valid as long as any
+   * File object sharing the mapping exists.
+   *
+   * @param page_number   Number of page to view.
+   * @return  Pointer to the page in the mapping.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  PageChecksumException If the page does not match its checksum.
+   */
+  const Page* mappedPage(const PageId page_number) const;
+
   /**
    * Deletes a page from the file.
    *
@@ -202,7 +465,8 @@ class File {
    * @return  Position of page in file.
    */
   static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+    return BLOCK_SIZE + (static_cast<std::streamoff>(page_number - 1) *
+                         Page::SIZE);
   }
 
   /**
@@ -214,12 +478,14 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param compressed  Whether a new file stores its pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const bool compressed = false);
 
   /**
    * Opens the underlying file named in filename_.
@@ -237,7 +503,7 @@ class File {
   /**
    * Closes the underlying file stream in <stream_>.
    * This method only closes the file if no other File objects exist that access
-   * the same file.
+   * the same file, writing out the page-offset map of a compressed file.
    */
   void close();
 
@@ -278,6 +544,84 @@ class File {
   void writePage(const PageId page_number, const PageHeader& header,
                  const Page& new_page);
 
+  /**
+   * Reads a run of consecutive pages as stored on disk: straight from their
+   * places in a plain file, or decompressed from their slots in a compressed
+   * one.  A page of a compressed file never stored reads as zeros.
+   *
+   * @throws  PageChecksumException If a compressed page cannot be
+   *                                decompressed.
+   */
+  void readStoredPages(const PageId first_page_number,
+                       const std::uint32_t count, char* raw_pages) const;
+
+  /**
+   * Writes a run of consecutive pages, laid out as on disk, to their places in
+   * a plain file, or compressed to their slots in a compressed one.
+   */
+  void writeStoredPages(const PageId first_page_number,
+                        const std::uint32_t count, const char* raw_pages);
+
+  /**
+   * Reads <length> bytes of whole pages starting at <position>, honouring the
+   * cache mode.  Bytes past the end of the file are left untouched.
+   *
+   * @throws  IoException  If a direct read fails.
+   */
+  void readBlocks(const std::streampos position, char* buffer,
+                  const std::size_t length) const;
+
+  /**
+   * Writes <length> bytes of whole pages starting at <position>, honouring the
+   * cache mode.  Data is handed to the operating system but not synced.
+   *
+   * @throws  IoException  If a direct write fails.
+   */
+  void writeBlocks(const std::streampos position, const char* buffer,
+                   const std::size_t length);
+
+  /**
+   * Maps the whole file read-only into memory for openMapped().
+   *
+   * @throws  IoException  If the file cannot be mapped.
+   */
+  void map();
+
+  /**
+   * Advises the kernel about a FileIterator scan of a mapped file having
+   * reached <page_number>.  The start of a scan marks the whole mapping as
+   * sequentially accessed; after that, pages are read ahead one window before
+   * the scan needs them.
+   *
+   * @param page_number   Page the scan is at.
+   * @param start         Whether the scan starts at this page.
+   */
+  void adviseScan(const PageId page_number, const bool start) const;
+
+  /**
+   * Stores the checksum of a page about to be written in its header, or 0 if
+   * checksums are off.
+   */
+  void stampChecksum(Page* page) const;
+
+  /**
+   * Throws PageChecksumException if checksums are on and a page just read
+   * does not match its checksum.
+   */
+  void verifyChecksum(const PageId page_number, const Page* page) const;
+
+  /**
+   * Throws ReadOnlyFileException if this object is mapped.
+   */
+  void checkWritable() const;
+
+  /**
+   * Drops a range of the file from the OS page cache unless in CACHE_BUFFERED
+   * mode.
+   */
+  void dropCached(const std::streampos position,
+                  const std::size_t length) const;
+
   /**
    * Reads the header for this file from disk.
    *
@@ -304,6 +648,8 @@ class File {
   typedef std::map<std::string,
                    std::shared_ptr<std::fstream> > StreamMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, int> DescriptorMap;
+  typedef std::map<std::string, std::shared_ptr<PageMap> > PageMapMap;
 
   /**
    * Streams for opened files.
@@ -315,6 +661,17 @@ class File {
    */
   static CountMap open_counts_;
 
+  /**
+   * POSIX descriptors for opened files, used for I/O that streams cannot do
+   * (vectored and asynchronous I/O, syncing).
+   */
+  static DescriptorMap open_descriptors_;
+
+  /**
+   * Page-offset maps of opened compressed files.
+   */
+  static PageMapMap open_page_maps_;
+
   /**
    * Name of the file this object represents.
    */
@@ -325,8 +682,42 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Page-offset map of the underlying file if it is compressed, or NULL.
+   */
+  std::shared_ptr<PageMap> page_map_;
+
+  /**
+   * POSIX descriptor for the underlying filesystem object.
+   */
+  int fd_;
+
+  /**
+   * Cache mode of this object, and its own O_DIRECT descriptor for the
+   * underlying file in CACHE_DIRECT mode (-1 otherwise).
+   */
+  CacheMode cache_mode_;
+  int direct_fd_;
+
+  /**
+   * Read-only mapping of the whole file for openMapped(), shared by copies of
+   * this object, or NULL.
+   */
+  std::shared_ptr<const char> mapping_;
+  std::size_t mapping_length_;
+
+  /**
+   * Whether pages are checksummed when written and checked when read.
+   */
+  bool checksums_;
+
   friend class FileIterator;
   friend class FileTest;
 };
 
+static_assert(sizeof(FileHeader) <= File::BLOCK_SIZE,
+              "File header must fit in the block reserved for it.");
+static_assert(Page::SIZE % File::BLOCK_SIZE == 0,
+              "Pages must be a whole number of direct I/O blocks.");
+
 }
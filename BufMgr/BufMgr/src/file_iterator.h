@@ -41,6 +41,7 @@ class FileIterator {
     assert(file_ != NULL);
     const FileHeader& header = file_->readHeader();
     current_page_number_ = header.first_used_page;
+    file_->adviseScan(current_page_number_, true /* start */);
   }
 
   /**
@@ -53,6 +54,7 @@ class FileIterator {
   FileIterator(File* file, PageId page_number)
       : file_(file),
         current_page_number_(page_number) {
+    file_->adviseScan(current_page_number_, true /* start */);
   }
 
   /**
@@ -62,6 +64,7 @@ class FileIterator {
     assert(file_ != NULL);
     const PageHeader& header = file_->readPageHeader(current_page_number_);
     current_page_number_ = header.next_page_number;
+    file_->adviseScan(current_page_number_, false /* start */);
 
 		return *this;
 	}
@@ -74,6 +77,7 @@ class FileIterator {
     assert(file_ != NULL);
     const PageHeader& header = file_->readPageHeader(current_page_number_);
     current_page_number_ = header.next_page_number;
+    file_->adviseScan(current_page_number_, false /* start */);
 
 		return tmp;
 	}
@@ -0,0 +1,160 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace badgerdb {
+
+/**
+ * @brief Access mode of a page: unlatched, shared or exclusive.
+ */
+enum LatchMode {
+  /**
+   * Pinned only; the caller coordinates access to the page itself.
+   */
+  LATCH_NONE,
+
+  /**
+   * Any number of readers, no writer.
+   */
+  LATCH_SHARED,
+
+  /**
+   * A single writer.
+   */
+  LATCH_EXCLUSIVE
+};
+
+/**
+ * @brief Reader/writer latch of a buffer frame, with a version for
+ *        optimistic reads, in a single 64-bit word.
+ *
+ * The low 16 bits count the shared holders, bit 16 is set while the latch is
+ * held exclusively, and the remaining bits hold a version that is advanced
+ * every time an exclusive holder lets go.  An optimistic reader takes the
+ * version with readVersion(), reads the page without latching it, and then
+ * keeps what it read only if validate() confirms that no writer got in
+ * between, the way a seqlock works.  Optimistic readers never write to the
+ * word, so a page read by every core causes no cache line transfers.
+ *
+ * Waiting holders spin, yielding the CPU between attempts: latches are meant
+ * to be held for the few instructions of a page access.
+ */
+class FrameLatch {
+ public:
+  FrameLatch() : word_(0) {}
+
+  /**
+   * Waits until no writer holds the latch and takes a shared hold.
+   */
+  void lockShared() {
+    std::uint64_t word = word_.load(std::memory_order_relaxed);
+    while (true) {
+      if ((word & kExclusive) != 0 || (word & kSharedMask) == kSharedMask) {
+        std::this_thread::yield();
+        word = word_.load(std::memory_order_relaxed);
+      } else if (word_.compare_exchange_weak(word, word + 1,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+
+  /**
+   * Takes a shared hold if no writer holds the latch, without waiting.
+   *
+   * @return  True if the hold was taken.
+   */
+  bool tryLockShared() {
+    std::uint64_t word = word_.load(std::memory_order_relaxed);
+    while ((word & kExclusive) == 0 && (word & kSharedMask) != kSharedMask) {
+      if (word_.compare_exchange_weak(word, word + 1,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Gives up a shared hold.
+   */
+  void unlockShared() { word_.fetch_sub(1, std::memory_order_release); }
+
+  /**
+   * Waits until nobody holds the latch and takes it exclusively.
+   */
+  void lockExclusive() {
+    std::uint64_t word = word_.load(std::memory_order_relaxed);
+    while (true) {
+      if ((word & (kExclusive | kSharedMask)) != 0) {
+        std::this_thread::yield();
+        word = word_.load(std::memory_order_relaxed);
+      } else if (word_.compare_exchange_weak(word, word | kExclusive,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+
+  /**
+   * Gives up the exclusive hold and advances the version.
+   */
+  void unlockExclusive() {
+    word_.fetch_add(kVersionOne - kExclusive, std::memory_order_release);
+  }
+
+  /**
+   * Returns true if a writer holds the latch at the moment.
+   */
+  bool heldExclusive() const {
+    return (word_.load(std::memory_order_relaxed) & kExclusive) != 0;
+  }
+
+  /**
+   * Waits until no writer holds the latch and returns the version, for an
+   * optimistic read.
+   */
+  std::uint64_t readVersion() const {
+    std::uint64_t word = word_.load(std::memory_order_acquire);
+    while ((word & kExclusive) != 0) {
+      std::this_thread::yield();
+      word = word_.load(std::memory_order_acquire);
+    }
+    return word >> kVersionShift;
+  }
+
+  /**
+   * Returns true if no writer held the latch since readVersion() returned
+   * <version>, so that what was read in between is consistent.
+   */
+  bool validate(const std::uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const std::uint64_t word = word_.load(std::memory_order_relaxed);
+    return (word & kExclusive) == 0 && (word >> kVersionShift) == version;
+  }
+
+ private:
+  FrameLatch(const FrameLatch&);
+  FrameLatch& operator=(const FrameLatch&);
+
+  static const std::uint64_t kSharedMask = 0xffff;
+  static const std::uint64_t kExclusive = std::uint64_t(1) << 16;
+  static const int kVersionShift = 17;
+  static const std::uint64_t kVersionOne = std::uint64_t(1) << kVersionShift;
+
+  std::atomic<std::uint64_t> word_;
+};
+
+}
@@ -0,0 +1,420 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "hash_index.h"
+
+#include <cstring>
+
+#include "file_iterator.h"
+#include "exceptions/bad_index_exception.h"
+
+namespace badgerdb {
+
+const std::size_t HashIndex::MAX_KEY_LENGTH;
+const std::uint32_t HashIndex::DIRECTORY_ENTRIES;
+const std::uint32_t HashIndex::MAX_GLOBAL_DEPTH;
+
+namespace {
+
+const std::uint32_t kMetaMagic = 0x48534849;    // "HSHI"
+const std::uint32_t kBucketMagic = 0x48534842;  // "HSHB"
+
+/**
+ * Start of the first page of the index file, followed by the directory page
+ * numbers.
+ */
+struct MetaHeader {
+  std::uint32_t magic;
+  std::uint32_t key_type;
+  std::uint32_t global_depth;
+  std::uint32_t directory_count;
+};
+
+/**
+ * Start of every bucket page, followed by its cells, packed.
+ */
+struct BucketHeader {
+  std::uint32_t magic;
+  std::uint16_t local_depth;
+  std::uint16_t count;
+
+  /**
+   * Bytes taken by the cells.
+   */
+  std::uint32_t used;
+};
+
+static_assert(sizeof(MetaHeader) +
+                  (std::size_t(1) << HashIndex::MAX_GLOBAL_DEPTH) /
+                      HashIndex::DIRECTORY_ENTRIES * sizeof(PageId) <=
+              Page::DATA_SIZE,
+              "Directory page numbers must fit the first page");
+static_assert(HashIndex::DIRECTORY_ENTRIES * sizeof(PageId) <=
+              Page::DATA_SIZE, "Directory entries must fit a page");
+
+const std::size_t kBucketSpace = Page::DATA_SIZE - sizeof(BucketHeader);
+
+/**
+ * Marker of a key not found in a bucket.
+ */
+const std::size_t kNotFound = ~std::size_t(0);
+
+MetaHeader* metaHeader(char* data) {
+  return reinterpret_cast<MetaHeader*>(data);
+}
+
+PageId* directory(char* data) { return reinterpret_cast<PageId*>(data); }
+
+BucketHeader* bucketHeader(char* data) {
+  return reinterpret_cast<BucketHeader*>(data);
+}
+
+char* cells(char* data) { return data + sizeof(BucketHeader); }
+
+/**
+ * Size of a cell: the hash, key length, key and record ID.
+ */
+std::size_t cellSize(const std::size_t key_length) {
+  return sizeof(std::uint64_t) + sizeof(std::uint16_t) + key_length +
+         sizeof(PageId) + sizeof(SlotId);
+}
+
+std::size_t cellSizeAt(const char* cell) {
+  std::uint16_t key_length;
+  std::memcpy(&key_length, cell + sizeof(std::uint64_t), sizeof(key_length));
+  return cellSize(key_length);
+}
+
+std::uint64_t cellHash(const char* cell) {
+  std::uint64_t hash;
+  std::memcpy(&hash, cell, sizeof(hash));
+  return hash;
+}
+
+void initBucket(char* data, const std::uint16_t local_depth) {
+  BucketHeader* h = bucketHeader(data);
+  h->magic = kBucketMagic;
+  h->local_depth = local_depth;
+  h->count = 0;
+  h->used = 0;
+}
+
+void appendCell(char* data, const std::uint64_t hash, const std::string& key,
+                const RecordId& rid) {
+  BucketHeader* h = bucketHeader(data);
+  char* p = cells(data) + h->used;
+  const std::uint16_t key_length = static_cast<std::uint16_t>(key.size());
+  std::memcpy(p, &hash, sizeof(hash));
+  p += sizeof(hash);
+  std::memcpy(p, &key_length, sizeof(key_length));
+  p += sizeof(key_length);
+  std::memcpy(p, key.data(), key.size());
+  p += key.size();
+  std::memcpy(p, &rid.page_number, sizeof(PageId));
+  std::memcpy(p + sizeof(PageId), &rid.slot_number, sizeof(SlotId));
+  h->used += static_cast<std::uint32_t>(cellSize(key.size()));
+  ++h->count;
+}
+
+/**
+ * Returns the offset of the cell of a key among the cells of a bucket, or
+ * kNotFound.
+ */
+std::size_t findCell(char* data, const std::uint64_t hash,
+                     const std::string& key) {
+  const BucketHeader* h = bucketHeader(data);
+  const char* c = cells(data);
+  for (std::size_t offset = 0; offset < h->used;
+       offset += cellSizeAt(c + offset)) {
+    const char* cell = c + offset;
+    if (cellHash(cell) != hash) {
+      continue;
+    }
+    std::uint16_t key_length;
+    std::memcpy(&key_length, cell + sizeof(hash), sizeof(key_length));
+    if (key_length == key.size() &&
+        std::memcmp(cell + sizeof(hash) + sizeof(key_length), key.data(),
+                    key.size()) == 0) {
+      return offset;
+    }
+  }
+  return kNotFound;
+}
+
+RecordId cellRid(const char* cell) {
+  std::uint16_t key_length;
+  std::memcpy(&key_length, cell + sizeof(std::uint64_t), sizeof(key_length));
+  const char* p = cell + sizeof(std::uint64_t) + sizeof(key_length) +
+                  key_length;
+  RecordId rid;
+  std::memcpy(&rid.page_number, p, sizeof(PageId));
+  std::memcpy(&rid.slot_number, p + sizeof(PageId), sizeof(SlotId));
+  return rid;
+}
+
+/**
+ * FNV-1a, whose low bits, which pick the bucket, are then mixed with the
+ * high ones by the MurmurHash3 finalizer.
+ */
+std::uint64_t hashKey(const std::string& key) {
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  for (std::size_t i = 0; i < key.size(); ++i) {
+    hash ^= static_cast<unsigned char>(key[i]);
+    hash *= 0x100000001b3ull;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+}
+
+HashIndex::HashIndex(BufMgr& buf_mgr, File* file, const HashKeyType key_type)
+    : buf_mgr_(buf_mgr),
+      file_(file),
+      key_type_(key_type),
+      meta_page_(Page::INVALID_NUMBER),
+      global_depth_(0) {
+  std::memset(&stats_, 0, sizeof(stats_));
+  if (file_->begin() == file_->end()) {
+    PageGuard meta = buf_mgr_.allocate(file_);
+    PageGuard dir = buf_mgr_.allocate(file_);
+    PageGuard bucket = buf_mgr_.allocate(file_);
+    initBucket(data(bucket.get()), 0);
+    bucket.markDirty();
+    directory(data(dir.get()))[0] = bucket.page_number();
+    dir.markDirty();
+    meta_page_ = meta.page_number();
+    directory_pages_.push_back(dir.page_number());
+    MetaHeader* m = metaHeader(data(meta.get()));
+    m->magic = kMetaMagic;
+    m->key_type = key_type_;
+    meta.markDirty();
+    meta.release();
+    writeMeta();
+    return;
+  }
+
+  meta_page_ = (*file_->begin()).page_number();
+  PageGuard meta = buf_mgr_.fetch(file_, meta_page_);
+  const MetaHeader* m = metaHeader(data(meta.get()));
+  if (m->magic != kMetaMagic) {
+    throw BadIndexException(file_->filename(), "not a hash index");
+  }
+  if (m->key_type != static_cast<std::uint32_t>(key_type_)) {
+    throw BadIndexException(file_->filename(), "index of another key type");
+  }
+  global_depth_ = m->global_depth;
+  const PageId* pages =
+      reinterpret_cast<const PageId*>(data(meta.get()) + sizeof(MetaHeader));
+  directory_pages_.assign(pages, pages + m->directory_count);
+}
+
+bool HashIndex::insert(const std::int64_t key, const RecordId& rid) {
+  return insertEncoded(encode(key), rid);
+}
+
+bool HashIndex::insert(const std::string& key, const RecordId& rid) {
+  return insertEncoded(encode(key), rid);
+}
+
+bool HashIndex::lookup(const std::int64_t key, RecordId& rid) {
+  return lookupEncoded(encode(key), rid);
+}
+
+bool HashIndex::lookup(const std::string& key, RecordId& rid) {
+  return lookupEncoded(encode(key), rid);
+}
+
+bool HashIndex::remove(const std::int64_t key) {
+  return removeEncoded(encode(key));
+}
+
+bool HashIndex::remove(const std::string& key) {
+  return removeEncoded(encode(key));
+}
+
+std::string HashIndex::encode(const std::int64_t key) const {
+  if (key_type_ != HASH_INT_KEYS) {
+    throw BadIndexException(file_->filename(),
+                            "integer key for an index of string keys");
+  }
+  const std::uint64_t bits = static_cast<std::uint64_t>(key);
+  std::string encoded(sizeof(bits), '\0');
+  for (std::size_t b = 0; b < sizeof(bits); ++b) {
+    encoded[b] = static_cast<char>(bits >> (8 * b));
+  }
+  return encoded;
+}
+
+std::string HashIndex::encode(const std::string& key) const {
+  if (key_type_ != HASH_STRING_KEYS) {
+    throw BadIndexException(file_->filename(),
+                            "string key for an index of integer keys");
+  }
+  if (key.size() > MAX_KEY_LENGTH) {
+    throw BadIndexException(file_->filename(), "key too long");
+  }
+  return key;
+}
+
+PageId HashIndex::bucketFor(const std::uint64_t hash) {
+  const std::uint64_t slot =
+      hash & ((std::uint64_t(1) << global_depth_) - 1);
+  PageGuard dir = buf_mgr_.fetch(
+      file_, directory_pages_[slot / DIRECTORY_ENTRIES]);
+  return directory(data(dir.get()))[slot % DIRECTORY_ENTRIES];
+}
+
+bool HashIndex::insertEncoded(const std::string& key, const RecordId& rid) {
+  const std::uint64_t hash = hashKey(key);
+  for (;;) {
+    PageGuard bucket = buf_mgr_.fetch(file_, bucketFor(hash));
+    char* b = data(bucket.get());
+    if (findCell(b, hash, key) != kNotFound) {
+      return false;
+    }
+    if (bucketHeader(b)->used + cellSize(key.size()) <= kBucketSpace) {
+      appendCell(b, hash, key, rid);
+      bucket.markDirty();
+      ++stats_.inserts;
+      return true;
+    }
+    // All entries may land on one side, so split until the key fits
+    split(hash, bucket);
+  }
+}
+
+bool HashIndex::lookupEncoded(const std::string& key, RecordId& rid) {
+  const std::uint64_t hash = hashKey(key);
+  PageGuard bucket = buf_mgr_.fetch(file_, bucketFor(hash));
+  char* b = data(bucket.get());
+  const std::size_t offset = findCell(b, hash, key);
+  if (offset == kNotFound) {
+    return false;
+  }
+  rid = cellRid(cells(b) + offset);
+  return true;
+}
+
+bool HashIndex::removeEncoded(const std::string& key) {
+  const std::uint64_t hash = hashKey(key);
+  PageGuard bucket = buf_mgr_.fetch(file_, bucketFor(hash));
+  char* b = data(bucket.get());
+  const std::size_t offset = findCell(b, hash, key);
+  if (offset == kNotFound) {
+    return false;
+  }
+  BucketHeader* h = bucketHeader(b);
+  char* cell = cells(b) + offset;
+  const std::size_t size = cellSizeAt(cell);
+  std::memmove(cell, cell + size, h->used - offset - size);
+  h->used -= static_cast<std::uint32_t>(size);
+  --h->count;
+  bucket.markDirty();
+  ++stats_.removes;
+  return true;
+}
+
+void HashIndex::split(const std::uint64_t hash, PageGuard& bucket) {
+  char* b = data(bucket.get());
+  BucketHeader* h = bucketHeader(b);
+  const std::uint32_t local_depth = h->local_depth;
+  if (local_depth == global_depth_) {
+    if (global_depth_ == MAX_GLOBAL_DEPTH) {
+      throw BadIndexException(file_->filename(),
+                              "bucket full at the largest directory");
+    }
+    doubleDirectory();
+  }
+
+  // Entries with bit <local_depth> of their hash set move to the new bucket
+  PageGuard sibling = buf_mgr_.allocate(file_);
+  char* s = data(sibling.get());
+  initBucket(s, static_cast<std::uint16_t>(local_depth + 1));
+  const std::uint64_t bit = std::uint64_t(1) << local_depth;
+  std::vector<char> kept;
+  kept.reserve(h->used);
+  std::uint16_t kept_count = 0;
+  const char* c = cells(b);
+  for (std::size_t offset = 0; offset < h->used;) {
+    const char* cell = c + offset;
+    const std::size_t size = cellSizeAt(cell);
+    if (cellHash(cell) & bit) {
+      std::memcpy(cells(s) + bucketHeader(s)->used, cell, size);
+      bucketHeader(s)->used += static_cast<std::uint32_t>(size);
+      ++bucketHeader(s)->count;
+    } else {
+      kept.insert(kept.end(), cell, cell + size);
+      ++kept_count;
+    }
+    offset += size;
+  }
+  if (!kept.empty()) {
+    std::memcpy(cells(b), &kept[0], kept.size());
+  }
+  h->used = static_cast<std::uint32_t>(kept.size());
+  h->count = kept_count;
+  h->local_depth = static_cast<std::uint16_t>(local_depth + 1);
+  bucket.markDirty();
+  sibling.markDirty();
+
+  // Of the directory entries of the bucket, those with the bit set now
+  // point to the new one
+  const std::uint64_t entries = std::uint64_t(1) << global_depth_;
+  PageGuard dir;
+  std::size_t dir_index = directory_pages_.size();
+  for (std::uint64_t slot = (hash & (bit - 1)) | bit; slot < entries;
+       slot += bit << 1) {
+    if (slot / DIRECTORY_ENTRIES != dir_index) {
+      dir_index = slot / DIRECTORY_ENTRIES;
+      dir = buf_mgr_.fetch(file_, directory_pages_[dir_index]);
+      dir.markDirty();
+    }
+    directory(data(dir.get()))[slot % DIRECTORY_ENTRIES] =
+        sibling.page_number();
+  }
+  ++stats_.splits;
+}
+
+void HashIndex::doubleDirectory() {
+  const std::uint64_t entries = std::uint64_t(1) << global_depth_;
+  if (entries * 2 <= DIRECTORY_ENTRIES) {
+    PageGuard dir = buf_mgr_.fetch(file_, directory_pages_[0]);
+    PageId* d = directory(data(dir.get()));
+    std::memcpy(d + entries, d, entries * sizeof(PageId));
+    dir.markDirty();
+  } else {
+    const std::size_t pages = directory_pages_.size();
+    for (std::size_t p = 0; p < pages; ++p) {
+      PageGuard source = buf_mgr_.fetch(file_, directory_pages_[p]);
+      PageGuard copy = buf_mgr_.allocate(file_);
+      std::memcpy(data(copy.get()), data(source.get()),
+                  DIRECTORY_ENTRIES * sizeof(PageId));
+      copy.markDirty();
+      directory_pages_.push_back(copy.page_number());
+    }
+  }
+  ++global_depth_;
+  writeMeta();
+  ++stats_.doublings;
+}
+
+void HashIndex::writeMeta() {
+  PageGuard meta = buf_mgr_.fetch(file_, meta_page_);
+  MetaHeader* m = metaHeader(data(meta.get()));
+  m->global_depth = global_depth_;
+  m->directory_count = static_cast<std::uint32_t>(directory_pages_.size());
+  std::memcpy(data(meta.get()) + sizeof(MetaHeader), &directory_pages_[0],
+              directory_pages_.size() * sizeof(PageId));
+  meta.markDirty();
+}
+
+}
@@ -0,0 +1,214 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "page_guard.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Kind of keys a hash index holds.
+ */
+enum HashKeyType {
+  /**
+   * Signed 64-bit integers.
+   */
+  HASH_INT_KEYS = 1,
+
+  /**
+   * Byte strings of up to HashIndex::MAX_KEY_LENGTH bytes.
+   */
+  HASH_STRING_KEYS = 2
+};
+
+/**
+ * @brief Counters of a hash index.
+ */
+struct HashIndexStats {
+  /**
+   * Entries inserted and removed.
+   */
+  std::uint64_t inserts;
+  std::uint64_t removes;
+
+  /**
+   * Buckets split, and times the directory doubled.
+   */
+  std::uint64_t splits;
+  std::uint64_t doublings;
+};
+
+/**
+ * @brief Extendible hash index from keys to record IDs, stored in a File of
+ *        its own and accessed through the buffer pool.
+ *
+ * A key's bucket is found from the low <global depth> bits of its 64-bit
+ * hash, which index a directory of bucket page numbers.  A bucket with
+ * local depth l holds the keys whose hashes end in the same l bits, and
+ * 2^(global depth - l) directory entries point to it.  A full bucket is
+ * split in two on its next bit, only its own entries being moved and only
+ * its directory entries being changed; if its local depth is the global
+ * depth, the directory is doubled first, by copying it.  Removes leave
+ * buckets as they are, however empty.
+ *
+ * The first page of the file holds the key type, the global depth and the
+ * numbers of the directory pages, and is read once, when the index is
+ * opened.  Directory pages hold DIRECTORY_ENTRIES bucket numbers each, so a
+ * lookup pins exactly two pages: the directory page of its hash, and its
+ * bucket.  Buckets store the hash of each key next to it, so lookups compare
+ * keys only on a hash match and splits do not hash keys again.
+ *
+ * Keys are unique: an index maps each key to one record ID.  Changes to the
+ * index are not logged to the write-ahead log.
+ *
+ * @warning This class is not threadsafe.  Callers sharing the buffer manager
+ *          between threads hold their mutex around every call.
+ */
+class HashIndex {
+ public:
+  /**
+   * Longest key of a HASH_STRING_KEYS index.
+   */
+  static const std::size_t MAX_KEY_LENGTH = 1024;
+
+  /**
+   * Bucket numbers in a directory page.
+   */
+  static const std::uint32_t DIRECTORY_ENTRIES = 1024;
+
+  /**
+   * Largest global depth, set by the number of directory pages the first
+   * page of the file has room for.
+   */
+  static const std::uint32_t MAX_GLOBAL_DEPTH = 20;
+
+  /**
+   * Opens the index stored in <file>, or creates an empty one if the file has
+   * no pages.
+   *
+   * @param buf_mgr   Buffer manager the pages are read through.
+   * @param file      File of the index.  Must outlive the index.
+   * @param key_type  Kind of keys.
+   * @throws  BadIndexException  If the file holds something else, or an index
+   *                             of another key type.
+   */
+  HashIndex(BufMgr& buf_mgr, File* file, const HashKeyType key_type);
+
+  /**
+   * Returns the kind of keys of the index.
+   */
+  HashKeyType keyType() const { return key_type_; }
+
+  /**
+   * Maps a key to a record.
+   *
+   * @return  False if the key is mapped already; its record is left as is.
+   * @throws  BadIndexException  If the key is of the other type or too long,
+   *                             or its bucket cannot be split any further.
+   */
+  bool insert(const std::int64_t key, const RecordId& rid);
+  bool insert(const std::string& key, const RecordId& rid);
+
+  /**
+   * Finds the record a key is mapped to.
+   *
+   * @return  False if the key is not mapped.
+   */
+  bool lookup(const std::int64_t key, RecordId& rid);
+  bool lookup(const std::string& key, RecordId& rid);
+
+  /**
+   * Removes the mapping of a key.
+   *
+   * @return  False if the key is not mapped.
+   */
+  bool remove(const std::int64_t key);
+  bool remove(const std::string& key);
+
+  /**
+   * Returns the number of hash bits the directory is indexed by.
+   */
+  std::uint32_t globalDepth() const { return global_depth_; }
+
+  /**
+   * Returns the counters of the index.
+   */
+  HashIndexStats stats() const { return stats_; }
+
+ private:
+  HashIndex(const HashIndex&);
+  HashIndex& operator=(const HashIndex&);
+
+  /**
+   * Returns where the index lives in a page.
+   */
+  static char* data(Page* page) { return page->data_; }
+
+  /**
+   * Turns a key into its stored form, checking that it fits the index.
+   */
+  std::string encode(const std::int64_t key) const;
+  std::string encode(const std::string& key) const;
+
+  /**
+   * Returns the bucket page a hash belongs in, from its directory page.
+   */
+  PageId bucketFor(const std::uint64_t hash);
+
+  /**
+   * The operations on stored keys.
+   */
+  bool insertEncoded(const std::string& key, const RecordId& rid);
+  bool lookupEncoded(const std::string& key, RecordId& rid);
+  bool removeEncoded(const std::string& key);
+
+  /**
+   * Splits the full bucket a hash belongs in, doubling the directory first if
+   * need be.
+   */
+  void split(const std::uint64_t hash, PageGuard& bucket);
+
+  /**
+   * Doubles the directory, the entries of the new half pointing to the
+   * buckets of the entries they copy.
+   */
+  void doubleDirectory();
+
+  /**
+   * Writes the global depth and the directory page numbers to the first page
+   * of the file.
+   */
+  void writeMeta();
+
+  BufMgr& buf_mgr_;
+  File* file_;
+  HashKeyType key_type_;
+
+  /**
+   * Page holding the key type, global depth and directory page numbers.
+   */
+  PageId meta_page_;
+
+  /**
+   * Copies of the global depth and the directory page numbers of the first
+   * page, in directory order.
+   */
+  std::uint32_t global_depth_;
+  std::vector<PageId> directory_pages_;
+
+  HashIndexStats stats_;
+};
+
+}
@@ -0,0 +1,230 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "heap_file.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "file_iterator.h"
+#include "page_guard.h"
+#include "exceptions/bad_heap_file_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_record_exception.h"
+
+namespace badgerdb {
+
+const std::size_t HeapFile::CATEGORY_BYTES;
+const std::uint8_t HeapFile::NOT_DATA;
+
+namespace {
+
+const std::uint32_t kMetaMagic = 0x48454150;  // "HEAP"
+
+/**
+ * Start of the first page of the file, followed by the map page numbers.
+ */
+struct MetaHeader {
+  std::uint32_t magic;
+  std::uint32_t map_count;
+};
+
+const std::size_t kMaxMapPages =
+    (Page::DATA_SIZE - sizeof(MetaHeader)) / sizeof(PageId);
+
+/**
+ * Largest record a page holds.
+ */
+const std::size_t kMaxRecord = Page::DATA_SIZE - sizeof(PageSlot);
+
+static_assert(kMaxRecord / HeapFile::CATEGORY_BYTES < HeapFile::NOT_DATA,
+              "Free space categories must not reach NOT_DATA");
+
+MetaHeader* metaHeader(char* data) {
+  return reinterpret_cast<MetaHeader*>(data);
+}
+
+PageId* mapPageList(char* data) {
+  return reinterpret_cast<PageId*>(data + sizeof(MetaHeader));
+}
+
+}
+
+HeapFile::HeapFile(BufMgr& buf_mgr, File* file)
+    : buf_mgr_(buf_mgr),
+      file_(file),
+      meta_page_(Page::INVALID_NUMBER),
+      members_(NOT_DATA),
+      data_pages_(0) {
+  std::memset(&stats_, 0, sizeof(stats_));
+  if (file_->begin() == file_->end()) {
+    PageGuard meta = buf_mgr_.allocate(file_);
+    meta_page_ = meta.page_number();
+    MetaHeader* m = metaHeader(data(meta.get()));
+    m->magic = kMetaMagic;
+    m->map_count = 0;
+    meta.markDirty();
+    meta.release();
+    cover(meta_page_);
+    return;
+  }
+
+  meta_page_ = (*file_->begin()).page_number();
+  {
+    PageGuard meta = buf_mgr_.fetch(file_, meta_page_);
+    const MetaHeader* m = metaHeader(data(meta.get()));
+    if (m->magic != kMetaMagic || m->map_count > kMaxMapPages) {
+      throw BadHeapFileException(file_->filename(), "not a heap file");
+    }
+    const PageId* pages = mapPageList(data(meta.get()));
+    map_pages_.assign(pages, pages + m->map_count);
+  }
+  categories_.resize(map_pages_.size() * Page::DATA_SIZE);
+  positions_.resize(categories_.size());
+  for (std::size_t p = 0; p < map_pages_.size(); ++p) {
+    PageGuard map = buf_mgr_.fetch(file_, map_pages_[p]);
+    std::memcpy(&categories_[p * Page::DATA_SIZE], data(map.get()),
+                Page::DATA_SIZE);
+  }
+  for (PageId page_number = 0; page_number < categories_.size();
+       ++page_number) {
+    const std::uint8_t category = categories_[page_number];
+    if (category == NOT_DATA) {
+      continue;
+    }
+    ++data_pages_;
+    if (category != 0) {
+      positions_[page_number] =
+          static_cast<std::uint32_t>(members_[category].size());
+      members_[category].push_back(page_number);
+    }
+  }
+}
+
+RecordId HeapFile::insertRecord(const std::string& record) {
+  if (record.size() > kMaxRecord) {
+    throw InsufficientSpaceException(Page::INVALID_NUMBER, record.size(),
+                                     kMaxRecord);
+  }
+  PageId page_number = findPage(record.size());
+  PageGuard page;
+  if (page_number == Page::INVALID_NUMBER) {
+    page = buf_mgr_.allocate(file_);
+    page_number = page.page_number();
+    cover(page_number);
+    ++stats_.new_pages;
+  } else {
+    page = buf_mgr_.fetch(file_, page_number);
+  }
+  const RecordId rid = page->insertRecord(record);
+  page.markDirty();
+  setCategory(page_number, categoryOf(*page));
+  ++stats_.inserts;
+  return rid;
+}
+
+std::string HeapFile::getRecord(const RecordId& rid) {
+  if (!isDataPage(rid.page_number)) {
+    throw InvalidRecordException(rid, rid.page_number);
+  }
+  PageGuard page = buf_mgr_.fetch(file_, rid.page_number);
+  return page->getRecord(rid);
+}
+
+void HeapFile::updateRecord(const RecordId& rid, const std::string& record) {
+  if (!isDataPage(rid.page_number)) {
+    throw InvalidRecordException(rid, rid.page_number);
+  }
+  PageGuard page = buf_mgr_.fetch(file_, rid.page_number);
+  page->updateRecord(rid, record);
+  page.markDirty();
+  setCategory(rid.page_number, categoryOf(*page));
+}
+
+void HeapFile::deleteRecord(const RecordId& rid) {
+  if (!isDataPage(rid.page_number)) {
+    throw InvalidRecordException(rid, rid.page_number);
+  }
+  PageGuard page = buf_mgr_.fetch(file_, rid.page_number);
+  page->deleteRecord(rid);
+  page.markDirty();
+  setCategory(rid.page_number, categoryOf(*page));
+}
+
+std::uint8_t HeapFile::categoryOf(const Page& page) {
+  // Counted as if a new record needed a new slot
+  const std::size_t free_space = page.getFreeSpace();
+  const std::size_t room =
+      free_space > sizeof(PageSlot) ? free_space - sizeof(PageSlot) : 0;
+  return static_cast<std::uint8_t>(room / CATEGORY_BYTES);
+}
+
+PageId HeapFile::findPage(const std::size_t length) const {
+  // Rounded up, so that every page of the category has room
+  const std::size_t smallest = std::max<std::size_t>(
+      1, (length + CATEGORY_BYTES - 1) / CATEGORY_BYTES);
+  for (std::size_t category = smallest; category < NOT_DATA; ++category) {
+    if (!members_[category].empty()) {
+      return members_[category].back();
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+void HeapFile::setCategory(const PageId page_number,
+                           const std::uint8_t category) {
+  const std::uint8_t old = categories_[page_number];
+  if (old == category) {
+    return;
+  }
+  if (old != 0 && old != NOT_DATA) {
+    // Move the last page of the list into the place of this one
+    std::vector<PageId>& list = members_[old];
+    const std::uint32_t position = positions_[page_number];
+    list[position] = list.back();
+    positions_[list[position]] = position;
+    list.pop_back();
+  }
+  if (category != 0 && category != NOT_DATA) {
+    positions_[page_number] =
+        static_cast<std::uint32_t>(members_[category].size());
+    members_[category].push_back(page_number);
+  }
+  if (old == NOT_DATA) {
+    ++data_pages_;
+  }
+  categories_[page_number] = category;
+
+  PageGuard map =
+      buf_mgr_.fetch(file_, map_pages_[page_number / Page::DATA_SIZE]);
+  data(map.get())[page_number % Page::DATA_SIZE] =
+      static_cast<char>(category);
+  map.markDirty();
+  ++stats_.map_updates;
+}
+
+void HeapFile::cover(const PageId page_number) {
+  while (page_number >= categories_.size()) {
+    if (map_pages_.size() == kMaxMapPages) {
+      throw BadHeapFileException(file_->filename(), "free space map full");
+    }
+    PageGuard map = buf_mgr_.allocate(file_);
+    std::memset(data(map.get()), NOT_DATA, Page::DATA_SIZE);
+    map.markDirty();
+    map_pages_.push_back(map.page_number());
+    categories_.resize(categories_.size() + Page::DATA_SIZE, NOT_DATA);
+    positions_.resize(categories_.size());
+
+    PageGuard meta = buf_mgr_.fetch(file_, meta_page_);
+    metaHeader(data(meta.get()))->map_count =
+        static_cast<std::uint32_t>(map_pages_.size());
+    mapPageList(data(meta.get()))[map_pages_.size() - 1] = map.page_number();
+    meta.markDirty();
+  }
+}
+
+}
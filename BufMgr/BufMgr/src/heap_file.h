@@ -0,0 +1,200 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Counters of a heap file.
+ */
+struct HeapFileStats {
+  /**
+   * Records inserted, and pages allocated for them because no page had
+   * room.
+   */
+  std::uint64_t inserts;
+  std::uint64_t new_pages;
+
+  /**
+   * Changes of a page's free space category written to the map.
+   */
+  std::uint64_t map_updates;
+};
+
+/**
+ * @brief File of records in no particular order, with a free space map to
+ *        find a page with room for a new record without reading any.
+ *
+ * The map keeps a byte per page of the file: the free space category of a
+ * page holding records, its free space (less a slot) in units of
+ * CATEGORY_BYTES, rounded down, or NOT_DATA for the pages of the map itself
+ * and pages not in use.  The first page of the file lists the map pages,
+ * which hold Page::DATA_SIZE bytes of the map each and are added as the file
+ * grows.
+ *
+ * The map is read into memory when the file is opened, with the pages of
+ * each category kept in a list, so inserting a record looks up the lists of
+ * the categories large enough for it, from the smallest, and takes a page
+ * from the first that is not empty: a constant number of steps, however
+ * large the file.  Every insert, update and delete sets the category of its
+ * page afresh, writing the map page only if it changed.  A record larger
+ * than a category's smallest free space is never put on a page of that
+ * category, so pages with a few bytes over are left to smaller records.
+ *
+ * The pages of the map are pages of the file too: scans of the file with
+ * FileIterator must skip the pages isDataPage() is false for.
+ *
+ * @warning This class is not threadsafe.  Callers sharing the buffer manager
+ *          between threads hold their mutex around every call.
+ */
+class HeapFile {
+ public:
+  /**
+   * Free space in a unit of the map.
+   */
+  static const std::size_t CATEGORY_BYTES = 32;
+
+  /**
+   * Category of a page with no records: a page of the map, or a page not in
+   * use.
+   */
+  static const std::uint8_t NOT_DATA = 0xff;
+
+  /**
+   * Opens the heap file stored in <file>, reading its map, or creates an
+   * empty one if the file has no pages.
+   *
+   * @param buf_mgr   Buffer manager the pages are read through.
+   * @param file      File of the records.  Must outlive the heap file.
+   * @throws  BadHeapFileException  If the file holds something else.
+   */
+  HeapFile(BufMgr& buf_mgr, File* file);
+
+  /**
+   * Stores a record on a page with room for it, found from the map, or on a
+   * new page if none has.
+   *
+   * @param record  Bytes of the record.
+   * @return  ID of the record.
+   * @throws  InsufficientSpaceException  If the record does not fit an empty
+   *                                      page.
+   */
+  RecordId insertRecord(const std::string& record);
+
+  /**
+   * Returns the bytes of a record.
+   *
+   * @throws  InvalidRecordException  If there is no such record.
+   */
+  std::string getRecord(const RecordId& rid);
+
+  /**
+   * Replaces the bytes of a record, which stays on its page.
+   *
+   * @throws  InsufficientSpaceException  If the page has no room for the new
+   *                                      bytes.
+   * @throws  InvalidRecordException      If there is no such record.
+   */
+  void updateRecord(const RecordId& rid, const std::string& record);
+
+  /**
+   * Deletes a record.
+   *
+   * @throws  InvalidRecordException  If there is no such record.
+   */
+  void deleteRecord(const RecordId& rid);
+
+  /**
+   * Returns true if a page of the file holds records, rather than being a
+   * page of the map.
+   */
+  bool isDataPage(const PageId page_number) const {
+    return page_number < categories_.size() &&
+           categories_[page_number] != NOT_DATA;
+  }
+
+  /**
+   * Returns the number of pages holding records.
+   */
+  std::size_t numDataPages() const { return data_pages_; }
+
+  /**
+   * Returns the counters of the heap file.
+   */
+  HeapFileStats stats() const { return stats_; }
+
+ private:
+  HeapFile(const HeapFile&);
+  HeapFile& operator=(const HeapFile&);
+
+  /**
+   * Returns where the map lives in a page.
+   */
+  static char* data(Page* page) { return page->data_; }
+
+  /**
+   * Returns the free space category of a page holding records.
+   */
+  static std::uint8_t categoryOf(const Page& page);
+
+  /**
+   * Returns a page holding records with room for a record of <length>
+   * bytes, or Page::INVALID_NUMBER.
+   */
+  PageId findPage(const std::size_t length) const;
+
+  /**
+   * Sets the category of a page, in the lists and in the map.
+   */
+  void setCategory(const PageId page_number, const std::uint8_t category);
+
+  /**
+   * Adds map pages until the map covers <page_number>.
+   */
+  void cover(const PageId page_number);
+
+  BufMgr& buf_mgr_;
+  File* file_;
+
+  /**
+   * Page listing the map pages.
+   */
+  PageId meta_page_;
+
+  /**
+   * Map pages, in page number order of the pages they cover.
+   */
+  std::vector<PageId> map_pages_;
+
+  /**
+   * Copy of the map: the category of every page covered.
+   */
+  std::vector<std::uint8_t> categories_;
+
+  /**
+   * Pages of each category from 1 up, and where each page is in the list of
+   * its category, so a page changing category is moved in constant time.
+   * Pages of category 0 have no room to speak of and are not listed.
+   */
+  std::vector<std::vector<PageId> > members_;
+  std::vector<std::uint32_t> positions_;
+
+  std::size_t data_pages_;
+
+  HeapFileStats stats_;
+};
+
+}
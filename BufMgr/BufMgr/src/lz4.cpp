@@ -0,0 +1,282 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lz4.h"
+
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Shortest match; shorter repeats are left as literals.
+ */
+const std::size_t kMinMatch = 4;
+
+/**
+ * The block format ends with at least kLastLiterals literals, and no match
+ * starts within the last kMatchFindLimit bytes.
+ */
+const std::size_t kLastLiterals = 5;
+const std::size_t kMatchFindLimit = 12;
+
+/**
+ * Farthest a match can be behind the bytes it repeats.
+ */
+const std::size_t kMaxOffset = 65535;
+
+/**
+ * Size of the compressor's hash table of positions, as a power of two.
+ */
+const int kHashLog = 12;
+
+std::uint32_t read32(const unsigned char* p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+std::uint64_t read64(const unsigned char* p) {
+  std::uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+/**
+ * Copies <length> bytes in steps of <Step>, writing up to Step - 1 bytes
+ * past the end; the caller makes sure there is room for them.
+ */
+template <std::size_t Step>
+void wildCopy(unsigned char* op, const unsigned char* ip,
+              const std::size_t length) {
+  unsigned char* const end = op + length;
+  do {
+    std::memcpy(op, ip, Step);
+    op += Step;
+    ip += Step;
+  } while (op < end);
+}
+
+/**
+ * Returns how many bytes from <a> and <b> on are equal, up to <limit>.
+ */
+std::size_t commonLength(const unsigned char* a, const unsigned char* b,
+                         const std::size_t limit) {
+  std::size_t length = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (length + 8 <= limit) {
+    const std::uint64_t diff = read64(a + length) ^ read64(b + length);
+    if (diff != 0) {
+      return length + __builtin_ctzll(diff) / 8;
+    }
+    length += 8;
+  }
+#endif
+  while (length < limit && a[length] == b[length]) {
+    ++length;
+  }
+  return length;
+}
+
+std::uint32_t hashSequence(const std::uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - kHashLog);
+}
+
+/**
+ * Writes the part of a literal or match length that does not fit in the
+ * token, as a run of 255s and the remainder.
+ */
+unsigned char* writeLength(unsigned char* op, std::size_t length) {
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = static_cast<unsigned char>(length);
+  return op;
+}
+
+/**
+ * Adds to <length> the part of a length after the token, returning false if
+ * the input ends first.
+ */
+bool readLength(const unsigned char*& ip, const unsigned char* iend,
+                std::size_t& length) {
+  unsigned char byte;
+  do {
+    if (ip >= iend) {
+      return false;
+    }
+    byte = *ip++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Writes a sequence: literals, then a match of <match_length> bytes
+ * <offset> back, or no match (0) for the last sequence.  Returns false if it
+ * does not fit before <oend>.
+ */
+bool writeSequence(unsigned char*& op, const unsigned char* oend,
+                   const unsigned char* literals,
+                   const std::size_t literal_length, const std::size_t offset,
+                   const std::size_t match_length) {
+  std::size_t needed = 1 + literal_length + literal_length / 255 + 1;
+  if (match_length > 0) {
+    needed += 2 + match_length / 255 + 1;
+  }
+  if (needed > static_cast<std::size_t>(oend - op)) {
+    return false;
+  }
+  unsigned char* token = op++;
+  if (literal_length >= 15) {
+    *token = 15 << 4;
+    op = writeLength(op, literal_length - 15);
+  } else {
+    *token = static_cast<unsigned char>(literal_length << 4);
+  }
+  std::memcpy(op, literals, literal_length);
+  op += literal_length;
+  if (match_length == 0) {
+    return true;
+  }
+  *op++ = static_cast<unsigned char>(offset & 0xff);
+  *op++ = static_cast<unsigned char>(offset >> 8);
+  const std::size_t extra = match_length - kMinMatch;
+  if (extra >= 15) {
+    *token |= 15;
+    op = writeLength(op, extra - 15);
+  } else {
+    *token |= static_cast<unsigned char>(extra);
+  }
+  return true;
+}
+
+}
+
+std::size_t Lz4::compress(const void* source, const std::size_t length,
+                          void* dest, const std::size_t capacity) {
+  const unsigned char* const src = static_cast<const unsigned char*>(source);
+  unsigned char* op = static_cast<unsigned char*>(dest);
+  const unsigned char* const oend = op + capacity;
+  std::size_t anchor = 0;  // First byte not yet written out
+
+  if (length > kMatchFindLimit) {
+    // Position + 1 of the last occurrence of each hash, or 0
+    std::uint32_t table[1 << kHashLog];
+    std::memset(table, 0, sizeof(table));
+    const std::size_t match_limit = length - kLastLiterals;
+    const std::size_t start_limit = length - kMatchFindLimit;
+    std::size_t ip = 0;
+    unsigned misses = 0;
+    while (ip < start_limit) {
+      const std::uint32_t sequence = read32(src + ip);
+      std::uint32_t& entry = table[hashSequence(sequence)];
+      const std::size_t candidate = entry;
+      entry = static_cast<std::uint32_t>(ip + 1);
+      if (candidate == 0 || ip - (candidate - 1) > kMaxOffset ||
+          read32(src + candidate - 1) != sequence) {
+        // Step faster through data that does not compress
+        ip += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+      std::size_t match = candidate - 1;
+      while (ip > anchor && match > 0 && src[ip - 1] == src[match - 1]) {
+        --ip;
+        --match;
+      }
+      const std::size_t match_length =
+          kMinMatch + commonLength(src + ip + kMinMatch,
+                                   src + match + kMinMatch,
+                                   match_limit - ip - kMinMatch);
+      if (!writeSequence(op, oend, src + anchor, ip - anchor, ip - match,
+                         match_length)) {
+        return 0;
+      }
+      ip += match_length;
+      anchor = ip;
+      if (ip < start_limit) {
+        table[hashSequence(read32(src + ip - 2))] =
+            static_cast<std::uint32_t>(ip - 1);
+      }
+    }
+  }
+  if (!writeSequence(op, oend, src + anchor, length - anchor, 0, 0)) {
+    return 0;
+  }
+  return op - static_cast<unsigned char*>(dest);
+}
+
+bool Lz4::decompress(const void* source, const std::size_t length, void* dest,
+                     const std::size_t dest_length) {
+  const unsigned char* ip = static_cast<const unsigned char*>(source);
+  const unsigned char* const iend = ip + length;
+  unsigned char* const start = static_cast<unsigned char*>(dest);
+  unsigned char* op = start;
+  unsigned char* const oend = op + dest_length;
+  for (;;) {
+    if (ip >= iend) {
+      return false;
+    }
+    const unsigned token = *ip++;
+    std::size_t literal_length = token >> 4;
+    if (literal_length == 15 && !readLength(ip, iend, literal_length)) {
+      return false;
+    }
+    if (literal_length > static_cast<std::size_t>(iend - ip) ||
+        literal_length > static_cast<std::size_t>(oend - op)) {
+      return false;
+    }
+    if (static_cast<std::size_t>(iend - ip) >= literal_length + 16 &&
+        static_cast<std::size_t>(oend - op) >= literal_length + 16) {
+      wildCopy<16>(op, ip, literal_length);
+    } else {
+      std::memcpy(op, ip, literal_length);
+    }
+    ip += literal_length;
+    op += literal_length;
+    if (ip == iend) {
+      return op == oend;  // Last sequence: literals only
+    }
+
+    if (iend - ip < 2) {
+      return false;
+    }
+    const std::size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<std::size_t>(op - start)) {
+      return false;
+    }
+    std::size_t match_length = token & 15;
+    if (match_length == 15 && !readLength(ip, iend, match_length)) {
+      return false;
+    }
+    match_length += kMinMatch;
+    if (match_length > static_cast<std::size_t>(oend - op)) {
+      return false;
+    }
+    const unsigned char* match = op - offset;
+    if (offset >= 8 &&
+        static_cast<std::size_t>(oend - op) >= match_length + 8) {
+      // Every 8 bytes copied were written before they are read
+      wildCopy<8>(op, match, match_length);
+      op += match_length;
+    } else if (offset >= match_length) {
+      std::memcpy(op, match, match_length);
+      op += match_length;
+    } else {
+      // Overlapping: the match repeats bytes it is writing
+      for (std::size_t i = 0; i < match_length; ++i) {
+        *op++ = *match++;
+      }
+    }
+  }
+}
+
+}
@@ -0,0 +1,62 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief LZ4 compression of byte ranges, in the LZ4 block format.
+ *
+ * The compressor is the single-pass greedy one of the reference
+ * implementation: four-byte sequences are looked up in a hash table of the
+ * positions they were last seen at, and a match found is extended as far as
+ * it goes.  It trades compression ratio for speed, which is what pages
+ * compressed on every write-back and decompressed on every read need.  The
+ * output can be decompressed by any LZ4 block decoder, and the decompressor
+ * checks its input, so damaged data is reported instead of overrunning.
+ */
+class Lz4 {
+ public:
+  /**
+   * Returns the largest compressed length of <length> bytes.
+   */
+  static std::size_t compressBound(const std::size_t length) {
+    return length + length / 255 + 16;
+  }
+
+  /**
+   * Compresses a byte range.
+   *
+   * @param source    Start of the range.
+   * @param length    Length of the range in bytes.
+   * @param dest      Memory for the compressed bytes.
+   * @param capacity  Length of <dest>.
+   * @return  Length of the compressed bytes, or 0 if they do not fit in
+   *          <capacity> bytes.
+   */
+  static std::size_t compress(const void* source, const std::size_t length,
+                              void* dest, const std::size_t capacity);
+
+  /**
+   * Decompresses a byte range compressed by compress().
+   *
+   * @param source       Start of the compressed bytes.
+   * @param length       Length of the compressed bytes.
+   * @param dest         Memory for the decompressed bytes.
+   * @param dest_length  Length the bytes decompress to.
+   * @return  False if the compressed bytes are damaged, or do not decompress
+   *          to exactly <dest_length> bytes.
+   */
+  static bool decompress(const void* source, const std::size_t length,
+                         void* dest, const std::size_t dest_length);
+};
+
+}
@@ -7,17 +7,41 @@
 #include <iostream>
 #include <stdlib.h>
 //#include <stdio.h>
+#include <chrono>
 #include <cstring>
+#include <fstream>
 #include <memory>
+#include <thread>
+#include <utility>
 #include "page.h"
 #include "buffer.h"
+#include "pool_registry.h"
+#include "wal.h"
+#include "recovery.h"
+#include "checkpointer.h"
+#include "crc32c.h"
+#include "double_write.h"
+#include "lz4.h"
+#include "ssd_cache.h"
+#include "btree.h"
+#include "hash_index.h"
+#include "heap_file.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_checksum_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/read_only_file_exception.h"
+#include "exceptions/pool_resize_exception.h"
+#include "exceptions/pool_not_found_exception.h"
+#include "exceptions/pool_exists_exception.h"
+#include "exceptions/bad_index_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_record_exception.h"
+#include "exceptions/slot_in_use_exception.h"
 
 #define PRINT_ERROR(str) \
 { \
@@ -42,6 +66,35 @@ void test3();
 void test4();
 void test5();
 void test6();
+void test7();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
+void test33();
+void test34();
+void test35();
 void testBufMgr();
 
 int main() 
@@ -80,12 +133,14 @@ int main()
     for (FileIterator iter = new_file.begin();
          iter != new_file.end();
          ++iter) {
-      // Iterate through all records on the page.
-      for (PageIterator page_iter = (*iter).begin();
-           page_iter != (*iter).end();
+      // Iterate through all records on the page.  The page is copied out of
+      // the iterator first, since PageIterator keeps a pointer to it.
+      Page curr_page = *iter;
+      for (PageIterator page_iter = curr_page.begin();
+           page_iter != curr_page.end();
            ++page_iter) {
         std::cout << "Found record: " << *page_iter
-            << " on page " << (*iter).page_number() << "\n";
+            << " on page " << curr_page.page_number() << "\n";
       }
     }
 
@@ -152,6 +207,35 @@ void testBufMgr()
 	test4();
 	test5();
 	test6();
+	test7();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+	test31();
+	test32();
+	test33();
+	test34();
+	test35();
 
 	//Close files before deleting them
 	file1.~File();
@@ -325,3 +409,2657 @@ void test6()
 
 	bufMgr->flushFile(file1ptr);
 }
+
+void test7()
+{
+	//Reading a batch of pages at once. Page 5 is already in the buffer pool, page 3 is requested twice,
+	//and the remaining misses form runs of consecutive pages.
+	PageId batch[] = {7, 3, 4, 5, 40, 3, 90, 6, 41};
+	const std::uint32_t batchSize = sizeof(batch) / sizeof(batch[0]);
+	Page* pages[batchSize];
+
+	bufMgr->readPage(file1ptr, 5, page);
+	bufMgr->readPages(file1ptr, batch, batchSize, pages);
+	for (std::uint32_t j = 0; j < batchSize; j++)
+	{
+		RecordId recordId = {batch[j], 1};
+		sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", batch[j], (float)batch[j]);
+		if(strncmp(pages[j]->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	if (pages[1] != pages[5] || pages[3] != page)
+	{
+		PRINT_ERROR("ERROR :: Same page should be returned in the same frame.");
+	}
+	for (std::uint32_t j = 0; j < batchSize; j++)
+		bufMgr->unPinPage(file1ptr, batch[j], false);
+	bufMgr->unPinPage(file1ptr, 5, false);
+
+	//A batch containing a page that does not exist should leave nothing pinned
+	PageId badBatch[] = {10, 11, num + 5};
+	try
+	{
+		bufMgr->readPages(file1ptr, badBatch, 3, pages);
+		PRINT_ERROR("ERROR :: Page does not exist. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(InvalidPageException e)
+	{
+	}
+	bufMgr->flushFile(file1ptr);
+
+	std::cout << "Test 7 passed" << "\n";
+}
+
+void test8()
+{
+	//Updating pages of two files, including runs of consecutive pages, and writing them all out with flushAll()
+	for (i = 1; i <= num/3; i++)
+	{
+		bufMgr->readPage(i % 2 ? file2ptr : file3ptr, i, page);
+		sprintf((char*)tmpbuf, "flushAll Page %d %7.1f", i, (float)i);
+		page->insertRecord(tmpbuf);
+		bufMgr->unPinPage(i % 2 ? file2ptr : file3ptr, i, true);
+	}
+
+	bufMgr->readPage(file2ptr, 1, page);
+	try
+	{
+		bufMgr->flushAll();
+		PRINT_ERROR("ERROR :: Page pinned while flushing. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(PagePinnedException e)
+	{
+	}
+	bufMgr->unPinPage(file2ptr, 1, false);
+	bufMgr->flushAll();
+
+	//Pages on disk should have the new records
+	for (i = 1; i <= num/3; i++)
+	{
+		Page diskPage = (i % 2 ? file2ptr : file3ptr)->readPage(i);
+		RecordId recordId = {i, 2};
+		sprintf((char*)tmpbuf, "flushAll Page %d %7.1f", i, (float)i);
+		if(strncmp(diskPage.getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+
+	std::cout << "Test 8 passed" << "\n";
+}
+
+void test9()
+{
+	//Checkpointing writes dirty pages, pinned ones included, and keeps them in the buffer pool
+	for (i = 1; i <= 10; i++)
+	{
+		bufMgr->readPage(file2ptr, i, page);
+		sprintf((char*)tmpbuf, "checkpoint Page %d %7.1f", i, (float)i);
+		rid[i] = page->insertRecord(tmpbuf);
+		bufMgr->unPinPage(file2ptr, i, true);
+	}
+	bufMgr->readPage(file2ptr, 1, page2);
+
+	bufMgr->clearBufStats();
+	bufMgr->checkpointAll();
+	if (bufMgr->getBufStats().diskwrites != 10)
+	{
+		PRINT_ERROR("ERROR :: All dirty pages should have been written by the checkpoint.");
+	}
+	for (i = 1; i <= 10; i++)
+	{
+		Page diskPage = file2ptr->readPage(i);
+		sprintf((char*)tmpbuf, "checkpoint Page %d %7.1f", i, (float)i);
+		if(strncmp(diskPage.getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		bufMgr->readPage(file2ptr, i, page);
+		bufMgr->unPinPage(file2ptr, i, false);
+	}
+	if (bufMgr->getBufStats().diskreads != 0)
+	{
+		PRINT_ERROR("ERROR :: Checkpointed pages should have stayed in the buffer pool.");
+	}
+
+	//Pages are clean after the checkpoint
+	bufMgr->checkpoint(file2ptr);
+	if (bufMgr->getBufStats().diskwrites != 10)
+	{
+		PRINT_ERROR("ERROR :: Checkpointed pages should have been marked clean.");
+	}
+	bufMgr->unPinPage(file2ptr, 1, false);
+	bufMgr->flushFile(file2ptr);
+
+	std::cout << "Test 9 passed" << "\n";
+}
+
+void test10()
+{
+	//Batched reads and write-backs through the asynchronous I/O queue, first through io_uring (if the kernel
+	//has it) and then through the preadv/pwritev fallback
+	PageId batch[] = {12, 13, 14, 20, 60, 61};
+	const std::uint32_t batchSize = sizeof(batch) / sizeof(batch[0]);
+	Page* pages[batchSize];
+	RecordId batchRids[batchSize];
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		bufMgr->enableAsyncIo(4, pass == 0);
+		bufMgr->readPages(file1ptr, batch, batchSize, pages);
+		for (std::uint32_t j = 0; j < batchSize; j++)
+		{
+			RecordId recordId = {batch[j], 1};
+			sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", batch[j], (float)batch[j]);
+			if(strncmp(pages[j]->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			sprintf((char*)tmpbuf, "async pass %d Page %d", pass, batch[j]);
+			batchRids[j] = pages[j]->insertRecord(tmpbuf);
+			bufMgr->unPinPage(file1ptr, batch[j], true);
+		}
+		bufMgr->flushFile(file1ptr);
+
+		for (std::uint32_t j = 0; j < batchSize; j++)
+		{
+			Page diskPage = file1ptr->readPage(batch[j]);
+			sprintf((char*)tmpbuf, "async pass %d Page %d", pass, batch[j]);
+			if(strncmp(diskPage.getRecord(batchRids[j]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+	}
+
+	std::cout << "Test 10 passed" << "\n";
+}
+
+void test11()
+{
+	//Pages of test.1 read and written bypassing the OS page cache (or dropped from it where O_DIRECT is not
+	//supported), then through the posix_fadvise mode, then back in the default buffered mode
+	const File::CacheMode modes[] = {File::CACHE_DIRECT, File::CACHE_DROP, File::CACHE_BUFFERED};
+	RecordId modeRids[10];
+
+	for (int pass = 0; pass < 3; pass++)
+	{
+		if (file1ptr->setCacheMode(modes[pass]) == File::CACHE_BUFFERED && pass != 2)
+		{
+			PRINT_ERROR("ERROR :: CACHE MODE NOT SET");
+		}
+
+		for (i = 30; i < 40; i++)
+		{
+			bufMgr->readPage(file1ptr, i, page);
+			sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", i, (float)i);
+			RecordId recordId = {i, 1};
+			if(strncmp(page->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			sprintf((char*)tmpbuf, "cache mode %d Page %d", pass, i);
+			modeRids[i - 30] = page->insertRecord(tmpbuf);
+			bufMgr->unPinPage(file1ptr, i, true);
+		}
+		bufMgr->flushFile(file1ptr);
+
+		//A page written outside the buffer pool, from unaligned memory
+		Page diskPage = file1ptr->readPage(30);
+		const RecordId& extraRid = diskPage.insertRecord("written around the buffer pool");
+		file1ptr->writePage(diskPage);
+
+		PageId batch[10];
+		Page* pages[10];
+		for (i = 0; i < 10; i++)
+		{
+			batch[i] = 30 + i;
+		}
+		bufMgr->readPages(file1ptr, batch, 10, pages);
+		for (i = 0; i < 10; i++)
+		{
+			sprintf((char*)tmpbuf, "cache mode %d Page %d", pass, batch[i]);
+			if(strncmp(pages[i]->getRecord(modeRids[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			bufMgr->unPinPage(file1ptr, batch[i], false);
+		}
+		if(pages[0]->getRecord(extraRid) != "written around the buffer pool")
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		bufMgr->flushFile(file1ptr);
+	}
+
+	std::cout << "Test 11 passed" << "\n";
+}
+
+void test12()
+{
+	//test.1 opened again memory-mapped: pages are views into the mapping, pinned without taking a frame
+	File mapped = File::openMapped(file1ptr->filename());
+	if (!mapped.isMapped())
+	{
+		PRINT_ERROR("ERROR :: FILE NOT MAPPED");
+	}
+
+	for (i = 1; i <= num; i++)
+	{
+		bufMgr->readPage(&mapped, i, page);
+		if (page >= bufMgr->bufPool && page < bufMgr->bufPool + num)
+		{
+			PRINT_ERROR("ERROR :: MAPPED PAGE COPIED INTO A FRAME");
+		}
+		sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", i, (float)i);
+		RecordId recordId = {i, 1};
+		if(strncmp(page->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		if (i != 5)
+		{
+			bufMgr->unPinPage(&mapped, i, false);
+		}
+	}
+
+	try
+	{
+		bufMgr->flushFile(&mapped);
+		PRINT_ERROR("ERROR :: Pages pinned for file being flushed. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(PagePinnedException e)
+	{
+	}
+	try
+	{
+		bufMgr->unPinPage(&mapped, 5, true);
+		PRINT_ERROR("ERROR :: Mapped page unpinned dirty. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(ReadOnlyFileException e)
+	{
+	}
+	try
+	{
+		bufMgr->unPinPage(&mapped, 5, false);
+		PRINT_ERROR("ERROR :: Page is not pinned. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(PageNotPinnedException e)
+	{
+	}
+	try
+	{
+		mapped.writePage(mapped.readPage(5));
+		PRINT_ERROR("ERROR :: Mapped file written. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(ReadOnlyFileException e)
+	{
+	}
+
+	//A scan through FileIterator reads the pages from the mapping
+	PageId scanned = 0;
+	for (FileIterator iter = mapped.begin(); iter != mapped.end(); ++iter)
+	{
+		Page scanPage = *iter;
+		sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", scanPage.page_number(), (float)scanPage.page_number());
+		RecordId recordId = {scanPage.page_number(), 1};
+		if(strncmp(scanPage.getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		scanned++;
+	}
+	if (scanned != num)
+	{
+		PRINT_ERROR("ERROR :: SCAN MISSED PAGES");
+	}
+
+	PageId batch[] = {7, 8, 9, 7};
+	Page* pages[4];
+	bufMgr->readPages(&mapped, batch, 4, pages);
+	if (pages[0] != pages[3] || pages[1] != pages[0] + 1)
+	{
+		PRINT_ERROR("ERROR :: MAPPED VIEWS DO NOT MATCH");
+	}
+	for (i = 0; i < 4; i++)
+	{
+		bufMgr->unPinPage(&mapped, batch[i], false);
+	}
+	bufMgr->flushFile(&mapped);
+
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	//Buffer pools on huge pages, falling back to smaller or transparent huge pages where the kernel has none reserved
+	const PoolPageSize sizes[] = {POOL_TRANSPARENT_HUGE_PAGES, POOL_HUGE_PAGES_2MB, POOL_HUGE_PAGES_1GB};
+
+	for (int s = 0; s < 3; s++)
+	{
+		BufMgr hugeMgr(num, sizes[s]);
+		if (hugeMgr.poolPageSize() == POOL_SMALL_PAGES || hugeMgr.poolPageSize() > sizes[s])
+		{
+			PRINT_ERROR("ERROR :: UNEXPECTED POOL PAGE SIZE");
+		}
+		if (reinterpret_cast<std::uintptr_t>(hugeMgr.bufPool) % File::BLOCK_SIZE != 0)
+		{
+			PRINT_ERROR("ERROR :: POOL NOT ALIGNED");
+		}
+
+		for (i = 0; i < num; i++)
+		{
+			hugeMgr.readPage(file1ptr, i + 1, page);
+			sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", i + 1, (float)(i + 1));
+			RecordId recordId = {i + 1, 1};
+			if(strncmp(page->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			hugeMgr.unPinPage(file1ptr, i + 1, false);
+		}
+		hugeMgr.flushFile(file1ptr);
+	}
+
+	std::cout << "Test 13 passed" << "\n";
+}
+
+void test14()
+{
+	//A pool split over 4 simulated NUMA nodes of 10 frames each: frames come from the requesting thread's node
+	//until all of them are pinned, then from the next node
+	BufMgr numaMgr(40);
+	numaMgr.enableNuma(4);
+	if (numaMgr.numaNodes() != 4)
+	{
+		PRINT_ERROR("ERROR :: WRONG NUMBER OF NUMA NODES");
+	}
+
+	BufMgr::setThreadNode(2);
+	for (i = 1; i <= 10; i++)
+	{
+		numaMgr.readPage(file1ptr, i, page);
+		if (page < numaMgr.bufPool + 20 || page >= numaMgr.bufPool + 30)
+		{
+			PRINT_ERROR("ERROR :: FRAME NOT ON LOCAL NODE");
+		}
+	}
+	numaMgr.readPage(file1ptr, 11, page);
+	if (page < numaMgr.bufPool + 30)
+	{
+		PRINT_ERROR("ERROR :: FRAME NOT ON NEXT NODE");
+	}
+	if (numaMgr.getBufStats().localaccesses != 10 || numaMgr.getBufStats().remoteaccesses != 1)
+	{
+		PRINT_ERROR("ERROR :: LOCAL/REMOTE ACCESSES MISCOUNTED");
+	}
+
+	//The same page is local to a thread on the node its frame is on
+	BufMgr::setThreadNode(3);
+	numaMgr.readPage(file1ptr, 11, page2);
+	if (page2 != page || numaMgr.getBufStats().localaccesses != 11)
+	{
+		PRINT_ERROR("ERROR :: LOCAL/REMOTE ACCESSES MISCOUNTED");
+	}
+	numaMgr.unPinPage(file1ptr, 11, false);
+	BufMgr::setThreadNode(-1);
+
+	for (i = 1; i <= 11; i++)
+	{
+		numaMgr.unPinPage(file1ptr, i, false);
+	}
+	numaMgr.flushFile(file1ptr);
+
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	//A pool grown from 10 to 100 frames in place holds every page of file 1 pinned; shrunk back to 20 frames while
+	//they are pinned, the frames past 20 stay readable and are released as they are unpinned
+	BufMgr resizeMgr(10, POOL_SMALL_PAGES, 200);
+	Page* const base = resizeMgr.bufPool;
+	for (i = 1; i <= 10; i++)
+	{
+		resizeMgr.readPage(file1ptr, i, page);
+		resizeMgr.unPinPage(file1ptr, i, false);
+	}
+
+	resizeMgr.resize(num);
+	if (resizeMgr.size() != (std::uint32_t)num || resizeMgr.bufPool != base)
+	{
+		PRINT_ERROR("ERROR :: POOL NOT GROWN IN PLACE");
+	}
+	Page* pages[100];
+	for (i = 0; i < num; i++)
+	{
+		resizeMgr.readPage(file1ptr, i + 1, pages[i]);
+	}
+
+	resizeMgr.resize(20);
+	if (resizeMgr.size() != 20)
+	{
+		PRINT_ERROR("ERROR :: POOL NOT SHRUNK");
+	}
+	for (i = 0; i < num; i++)
+	{
+		sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", i + 1, (float)(i + 1));
+		RecordId recordId = {i + 1, 1};
+		if(strncmp(pages[i]->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		resizeMgr.unPinPage(file1ptr, i + 1, true);
+	}
+
+	//Only 20 frames are left
+	for (i = 1; i <= 20; i++)
+	{
+		resizeMgr.readPage(file1ptr, i, page);
+	}
+	try
+	{
+		resizeMgr.readPage(file1ptr, 21, page);
+		PRINT_ERROR("ERROR :: Exceeded the buffer pool but no exception thrown.");
+	}
+	catch(const BufferExceededException &e)
+	{
+	}
+	for (i = 1; i <= 20; i++)
+	{
+		resizeMgr.unPinPage(file1ptr, i, false);
+	}
+
+	try
+	{
+		resizeMgr.resize(201);
+		PRINT_ERROR("ERROR :: Resized past the capacity but no exception thrown.");
+	}
+	catch(const PoolResizeException &e)
+	{
+	}
+	resizeMgr.flushFile(file1ptr);
+
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	//Pools sharing a budget of 30 frames: "scan" may grow from 5 to 10 frames, "hot" keeps its 5 frames, and the
+	//default pool grows into the free frames and then takes back those "scan" holds above its 5
+	PoolRegistry registry(30, 10);
+	registry.createPool("scan", 5, 10);
+	registry.createPool("hot", 5);
+	registry.assign(file1ptr, "scan");
+	if (registry.poolName(file1ptr) != "scan" || registry.poolName(file2ptr) != PoolRegistry::kDefaultPool)
+	{
+		PRINT_ERROR("ERROR :: WRONG POOL ASSIGNMENT");
+	}
+
+	for (i = 1; i <= 10; i++)
+	{
+		registry.readPage(file1ptr, i, page);
+	}
+	try
+	{
+		registry.readPage(file1ptr, 11, page);
+		PRINT_ERROR("ERROR :: Exceeded the pool maximum but no exception thrown.");
+	}
+	catch(const BufferExceededException &e)
+	{
+	}
+	for (i = 1; i <= 10; i++)
+	{
+		registry.unPinPage(file1ptr, i, false);
+	}
+	if (registry.pool("scan").size() != 10 || registry.getBufStats("scan").diskreads != 10 ||
+			registry.getBufStats(PoolRegistry::kDefaultPool).accesses != 0)
+	{
+		PRINT_ERROR("ERROR :: POOL STATISTICS WRONG");
+	}
+
+	registry.assign(file1ptr, PoolRegistry::kDefaultPool);
+	for (i = 1; i <= 20; i++)
+	{
+		registry.readPage(file1ptr, i, page);
+		sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", i, (float)i);
+		RecordId recordId = {i, 1};
+		if(strncmp(page->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	if (registry.pool("scan").size() != 5 || registry.pool("hot").size() != 5 || registry.freeFrames() != 0)
+	{
+		PRINT_ERROR("ERROR :: MINIMUM RESERVATIONS NOT KEPT");
+	}
+	try
+	{
+		registry.readPage(file1ptr, 21, page);
+		PRINT_ERROR("ERROR :: Exceeded the budget but no exception thrown.");
+	}
+	catch(const BufferExceededException &e)
+	{
+	}
+	for (i = 1; i <= 20; i++)
+	{
+		registry.unPinPage(file1ptr, i, false);
+	}
+
+	try
+	{
+		registry.pool("archive");
+		PRINT_ERROR("ERROR :: Unknown pool but no exception thrown.");
+	}
+	catch(const PoolNotFoundException &e)
+	{
+	}
+	registry.flushAll();
+
+	std::cout << "Test 16 passed" << "\n";
+}
+
+void test17()
+{
+	//Pages held by guards are unpinned when the guards go, also when an exception is thrown, and guards marked
+	//dirty unpin their pages dirty
+	BufMgr guardMgr(10);
+	PageId guardPageNo;
+	{
+		PageGuard guard = guardMgr.allocate(file4ptr);
+		guardPageNo = guard.page_number();
+		sprintf((char*)tmpbuf, "test.4 Page %d guarded", guardPageNo);
+		rid[0] = guard->insertRecord(tmpbuf);
+		guard.markDirty();
+	}
+
+	try
+	{
+		PageGuard guard = guardMgr.fetch(file4ptr, guardPageNo);
+		if(strncmp(guard->getRecord(rid[0]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		throw InvalidPageException(guardPageNo, file4ptr->filename());
+	}
+	catch(const InvalidPageException &e)
+	{
+	}
+
+	//A moved guard leaves the pin to its new owner
+	PageGuard first = guardMgr.fetch(file4ptr, guardPageNo);
+	PageGuard second(std::move(first));
+	if (first || second.get() == NULL)
+	{
+		PRINT_ERROR("ERROR :: GUARD NOT MOVED");
+	}
+	second.release();
+
+	//No pin left behind, and the page was written
+	guardMgr.flushFile(file4ptr);
+	Page diskPage = file4ptr->readPage(guardPageNo);
+	if(strncmp(diskPage.getRecord(rid[0]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+	{
+		PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+	}
+
+	std::cout << "Test 17 passed" << "\n";
+}
+
+void test18()
+{
+	//One page pinned once and shared by threads: writers insert records under the exclusive latch, readers read
+	//its free space optimistically and must only ever see it between inserts
+	BufMgr latchMgr(10);
+	PageGuard guard = latchMgr.allocate(file4ptr);
+	const std::string record("latched record");
+	const int startSpace = guard->getFreeSpace();
+	guard->insertRecord(record);
+	const int recordSpace = startSpace - guard->getFreeSpace();
+	const int writes = 40;
+	bool torn = false;
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 2; t++)
+	{
+		threads.push_back(std::thread([&guard, &record]() {
+			for (int w = 0; w < writes; w++)
+			{
+				PageLatch exclusive(guard, LATCH_EXCLUSIVE);
+				guard->insertRecord(record);
+			}
+		}));
+		threads.push_back(std::thread([&guard, &torn, startSpace, recordSpace]() {
+			int last = startSpace;
+			for (int r = 0; r < 200; r++)
+			{
+				int space = 0;
+				guard.readOptimistic([&space](const Page& page) {
+					space = page.getFreeSpace();
+				});
+				if ((startSpace - space) % recordSpace != 0 || space > last)
+				{
+					torn = true;
+				}
+				last = space;
+			}
+		}));
+	}
+	for (std::size_t t = 0; t < threads.size(); t++)
+	{
+		threads[t].join();
+	}
+	if (torn || guard->getFreeSpace() != startSpace - (2 * writes + 1) * recordSpace)
+	{
+		PRINT_ERROR("ERROR :: LATCHED PAGE ACCESS INCONSISTENT");
+	}
+
+	//Shared guards on one page coexist; the latch goes with the guard
+	{
+		PageGuard reader1 = latchMgr.fetch(file4ptr, guard.page_number(), LATCH_SHARED);
+		PageGuard reader2 = latchMgr.fetch(file4ptr, guard.page_number(), LATCH_SHARED);
+		if (reader1.latchMode() != LATCH_SHARED || reader1.get() != reader2.get())
+		{
+			PRINT_ERROR("ERROR :: SHARED LATCHES NOT HELD");
+		}
+	}
+	guard.latch(LATCH_EXCLUSIVE);
+	guard.markDirty();
+	guard.release();
+	latchMgr.flushFile(file4ptr);
+
+	std::cout << "Test 18 passed" << "\n";
+}
+
+void test19()
+{
+	//Fetches that miss start reads and hand over their pages once the reads finish; fetches of a page being read
+	//share the read, and readPage() waits for it
+	BufMgr asyncMgr(10);
+	asyncMgr.enableAsyncIo(8);
+	std::vector<PageGuard> fetched;
+	int failed = 0;
+	BufMgr::FetchCallback keep = [&fetched, &failed](PageGuard guard, std::exception_ptr error) {
+		if (error)
+		{
+			failed++;
+		}
+		else
+		{
+			fetched.push_back(std::move(guard));
+		}
+	};
+
+	if (asyncMgr.fetchAsync(file1ptr, 1, keep) || asyncMgr.fetchAsync(file1ptr, 1, keep) ||
+			asyncMgr.fetchAsync(file1ptr, 2, keep) || asyncMgr.pendingFetches() != 2)
+	{
+		PRINT_ERROR("ERROR :: FETCHES NOT PENDING");
+	}
+	while (asyncMgr.pendingFetches() > 0)
+	{
+		asyncMgr.pollFetches(true);
+	}
+	if (failed != 0 || fetched.size() != 3 || fetched[0].get() != fetched[1].get() ||
+			asyncMgr.getBufStats().diskreads != 2)
+	{
+		PRINT_ERROR("ERROR :: READ NOT SHARED");
+	}
+	for (std::size_t f = 0; f < fetched.size(); f++)
+	{
+		sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", fetched[f].page_number(), (float)fetched[f].page_number());
+		RecordId recordId = {fetched[f].page_number(), 1};
+		if(strncmp(fetched[f]->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+
+	//A hit is handed over at once
+	if (!asyncMgr.fetchAsync(file1ptr, 2, keep) || fetched.size() != 4)
+	{
+		PRINT_ERROR("ERROR :: HIT NOT HANDED OVER");
+	}
+
+	asyncMgr.fetchAsync(file1ptr, 3, keep);
+	asyncMgr.readPage(file1ptr, 3, page);
+	if (asyncMgr.pendingFetches() != 0 || fetched.size() != 5 || fetched[4].get() != page)
+	{
+		PRINT_ERROR("ERROR :: READPAGE DID NOT WAIT FOR FETCH");
+	}
+	asyncMgr.unPinPage(file1ptr, 3, false);
+
+	try
+	{
+		asyncMgr.fetchAsync(file1ptr, num + 1, keep);
+		PRINT_ERROR("ERROR :: Page that does not exist fetched but no exception thrown.");
+	}
+	catch(const InvalidPageException &e)
+	{
+	}
+
+	fetched.clear();
+	asyncMgr.flushFile(file1ptr);
+
+	std::cout << "Test 19 passed" << "\n";
+}
+
+void test20()
+{
+	//Changes made through the write-ahead log reach the log before their pages reach the file
+	const std::string logName = "test.wal";
+	const std::string dataName = "test.6";
+	std::remove(logName.c_str());
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	const int walPages = 6;
+	PageId walPageNos[walPages];
+	RecordId walRids[walPages];
+	{
+		File dataFile = File::create(dataName);
+		Wal wal(logName);
+		BufMgr walMgr(3);
+		walMgr.attachWal(&wal);
+		TxnId txn = wal.begin();
+		for (int k = 0; k < walPages; k++)
+		{
+			walMgr.allocPage(&dataFile, walPageNos[k], page);
+			wal.logPage(txn, &dataFile, page);
+			sprintf((char*)tmpbuf, "wal record %d", k);
+			const Lsn insertLsn = wal.endLsn();
+			walRids[k] = wal.insertRecord(txn, &dataFile, page, tmpbuf);
+			if (page->page_lsn() != insertLsn)
+			{
+				PRINT_ERROR("ERROR :: PAGE LSN NOT STAMPED");
+			}
+			walMgr.unPinPage(&dataFile, walPageNos[k], true);
+		}
+
+		//Evicting the first pages had to make their records durable first
+		if (walMgr.getBufStats().logflushes == 0 || wal.stats().syncs == 0 || wal.flushedLsn() == Wal::firstLsn())
+		{
+			PRINT_ERROR("ERROR :: LOG NOT FLUSHED BEFORE EVICTION");
+		}
+		for (int k = 0; k < walPages; k++)
+		{
+			if (dataFile.readPage(walPageNos[k]).page_lsn() >= wal.flushedLsn())
+			{
+				PRINT_ERROR("ERROR :: PAGE WRITTEN BEFORE ITS LOG RECORD");
+			}
+		}
+
+		walMgr.readPage(&dataFile, walPageNos[0], page);
+		wal.updateRecord(txn, &dataFile, page, walRids[0], "updated");
+		wal.deleteRecord(txn, &dataFile, page, walRids[0]);
+		walMgr.unPinPage(&dataFile, walPageNos[0], true);
+		const Lsn commitLsn = wal.commit(txn);
+		if (wal.flushedLsn() <= commitLsn || wal.stats().commits != 1)
+		{
+			PRINT_ERROR("ERROR :: COMMIT NOT DURABLE");
+		}
+		walMgr.flushFile(&dataFile);
+	}
+
+	{
+		//The log reads back in order, each record linked to the previous one of its transaction
+		Wal wal(logName);
+		LogRecord record;
+		Lsn lsn = Wal::firstLsn();
+		Lsn prev = 0;
+		int counts[LOG_COMMIT + 1] = {0};
+		int inserts = 0;
+		while (wal.readRecord(lsn, record, lsn))
+		{
+			if (record.prev_lsn != prev || record.filename != (record.type == LOG_COMMIT ? "" : dataName))
+			{
+				PRINT_ERROR("ERROR :: LOG RECORD NOT LINKED");
+			}
+			if (record.type == LOG_INSERT)
+			{
+				sprintf((char*)tmpbuf, "wal record %d", inserts);
+				if (record.after != tmpbuf || record.page_number != walPageNos[inserts])
+				{
+					PRINT_ERROR("ERROR :: LOGGED INSERT DOES NOT MATCH");
+				}
+				inserts++;
+			}
+			if (record.type == LOG_UPDATE && (record.before != "wal record 0" || record.after != "updated"))
+			{
+				PRINT_ERROR("ERROR :: LOGGED UPDATE DOES NOT MATCH");
+			}
+			if (record.type == LOG_PAGE_IMAGE && record.after.size() != Page::SIZE)
+			{
+				PRINT_ERROR("ERROR :: LOGGED PAGE IMAGE DOES NOT MATCH");
+			}
+			counts[record.type]++;
+			prev = record.lsn;
+		}
+		if (counts[LOG_PAGE_IMAGE] != walPages || counts[LOG_INSERT] != walPages || counts[LOG_UPDATE] != 1 ||
+				counts[LOG_DELETE] != 1 || counts[LOG_COMMIT] != 1 || wal.begin() != 2)
+		{
+			PRINT_ERROR("ERROR :: LOG RECORDS MISSING");
+		}
+	}
+
+	{
+		//Commits of concurrent threads share syncs, and a torn tail is cut off when the log is opened again
+		Wal wal(logName);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; t++)
+		{
+			threads.push_back(std::thread([&wal]() {
+				for (int c = 0; c < 25; c++)
+				{
+					wal.commit(wal.begin());
+				}
+			}));
+		}
+		for (std::size_t t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+		if (wal.stats().commits != 100 || wal.stats().syncs > 100 || wal.flushedLsn() != wal.endLsn())
+		{
+			PRINT_ERROR("ERROR :: GROUP COMMIT");
+		}
+	}
+	const Lsn intactEnd = Wal(logName).endLsn();
+	FILE* torn = fopen(logName.c_str(), "ab");
+	fwrite("torn", 1, 4, torn);
+	fclose(torn);
+	if (Wal(logName).endLsn() != intactEnd)
+	{
+		PRINT_ERROR("ERROR :: TORN LOG TAIL NOT CUT OFF");
+	}
+
+	std::remove(logName.c_str());
+	File::remove(dataName);
+
+	std::cout << "Test 20 passed" << "\n";
+}
+
+void test21()
+{
+	//Restart recovery redoes committed changes lost with the buffer pool and rolls back unfinished transactions
+	const std::string logName = "test.wal";
+	const std::string dataName = "test.6";
+	const std::string crashName = "test.7";
+	std::remove(logName.c_str());
+	std::remove(crashName.c_str());
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	const int recPages = 8;
+	PageId recPageNos[recPages];
+	RecordId recRids[recPages];
+	{
+		File dataFile = File::create(dataName);
+		Wal wal(logName);
+		BufMgr recMgr(4);
+		recMgr.attachWal(&wal);
+		TxnId txn = wal.begin();
+		for (int k = 0; k < recPages; k++)
+		{
+			recMgr.allocPage(&dataFile, recPageNos[k], page);
+			wal.logPage(txn, &dataFile, page);
+			recMgr.unPinPage(&dataFile, recPageNos[k], true);
+		}
+		wal.commit(txn);
+		recMgr.flushFile(&dataFile);
+		//The files as a crash right now would leave them: the pages allocated, nothing more
+		std::ifstream in(dataName.c_str(), std::ios::binary);
+		std::ofstream out(crashName.c_str(), std::ios::binary);
+		out << in.rdbuf();
+		out.close();
+
+		txn = wal.begin();
+		for (int k = 0; k < recPages; k++)
+		{
+			recMgr.readPage(&dataFile, recPageNos[k], page);
+			sprintf((char*)tmpbuf, "committed %d", k);
+			recRids[k] = wal.insertRecord(txn, &dataFile, page, tmpbuf);
+			recMgr.unPinPage(&dataFile, recPageNos[k], true);
+		}
+		wal.commit(txn);
+
+		//A transaction still running at the crash, some of whose changes reached the log
+		TxnId loser = wal.begin();
+		for (int k = 0; k < 3; k++)
+		{
+			recMgr.readPage(&dataFile, recPageNos[k], page);
+			if (k == 0)
+			{
+				wal.updateRecord(loser, &dataFile, page, recRids[k], "loser");
+			}
+			else if (k == 1)
+			{
+				wal.insertRecord(loser, &dataFile, page, "loser");
+			}
+			else
+			{
+				wal.deleteRecord(loser, &dataFile, page, recRids[k]);
+			}
+			recMgr.unPinPage(&dataFile, recPageNos[k], true);
+		}
+		wal.flush(wal.endLsn());
+		recMgr.attachWal(NULL);
+	}
+	std::remove(dataName.c_str());
+	std::rename(crashName.c_str(), dataName.c_str());
+
+	RecoveryStats stats;
+	{
+		Wal wal(logName);
+		BufMgr recMgr(6);
+		recMgr.attachWal(&wal);
+		Recovery recovery(wal, recMgr);
+		stats = recovery.run(3);
+	}
+	if (stats.losers != 1 || stats.undone != 3 || stats.pages != (std::uint64_t)recPages ||
+			stats.redone != (std::uint64_t)recPages + 3 || stats.threads != 3)
+	{
+		PRINT_ERROR("ERROR :: RECOVERY DID NOT REDO AND UNDO");
+	}
+	{
+		File dataFile = File::open(dataName);
+		for (int k = 0; k < recPages; k++)
+		{
+			Page recovered = dataFile.readPage(recPageNos[k]);
+			sprintf((char*)tmpbuf, "committed %d", k);
+			int records = 0;
+			for (PageIterator iter = recovered.begin(); iter != recovered.end(); ++iter)
+			{
+				records++;
+			}
+			if (recovered.getRecord(recRids[k]) != tmpbuf || records != 1)
+			{
+				PRINT_ERROR("ERROR :: RECOVERED PAGE DOES NOT MATCH");
+			}
+		}
+	}
+
+	//Recovering again finds everything done: nothing to redo, the loser rolled back
+	{
+		Wal wal(logName);
+		BufMgr recMgr(6);
+		recMgr.attachWal(&wal);
+		Recovery recovery(wal, recMgr);
+		stats = recovery.run(2);
+	}
+	if (stats.losers != 0 || stats.redone != 0 || stats.skipped == 0)
+	{
+		PRINT_ERROR("ERROR :: RECOVERY NOT IDEMPOTENT");
+	}
+
+	std::remove(logName.c_str());
+	File::remove(dataName);
+
+	std::cout << "Test 21 passed" << "\n";
+}
+
+void test22()
+{
+	//A fuzzy checkpoint writes dirty pages without evicting them, and recovery starts at its redo LSN
+	const std::string logName = "test.wal";
+	const std::string dataName = "test.6";
+	const std::string crashName = "test.7";
+	std::remove(logName.c_str());
+	std::remove(crashName.c_str());
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	const int ckPages = 4;
+	PageId ckPageNos[ckPages];
+	RecordId ckRids[ckPages];
+	Lsn checkpointLsn;
+	Lsn redoLsn;
+	std::uint64_t loggedRecords;
+	{
+		File dataFile = File::create(dataName);
+		Wal wal(logName);
+		BufMgr ckMgr(8);
+		ckMgr.attachWal(&wal);
+		TxnId txn = wal.begin();
+		for (int k = 0; k < ckPages; k++)
+		{
+			ckMgr.allocPage(&dataFile, ckPageNos[k], page);
+			wal.logPage(txn, &dataFile, page);
+			sprintf((char*)tmpbuf, "before %d", k);
+			ckRids[k] = wal.insertRecord(txn, &dataFile, page, tmpbuf);
+			ckMgr.unPinPage(&dataFile, ckPageNos[k], true);
+		}
+		wal.commit(txn);
+
+		//Running across the checkpoint, so the checkpoint writes its change out
+		TxnId loser = wal.begin();
+		ckMgr.readPage(&dataFile, ckPageNos[0], page);
+		wal.updateRecord(loser, &dataFile, page, ckRids[0], "loser");
+		ckMgr.unPinPage(&dataFile, ckPageNos[0], true);
+		if (ckMgr.minRecLsn() < Wal::firstLsn() || ckMgr.dirtyBefore(wal.endLsn()) != (std::uint32_t)ckPages)
+		{
+			PRINT_ERROR("ERROR :: RECOVERY LSNS NOT TRACKED");
+		}
+
+		std::mutex ckMutex;
+		Checkpointer checkpointer(ckMgr, wal, ckMutex);
+		checkpointer.setBatchSize(1);
+		checkpointer.checkpoint(4);
+		CheckpointStats ckStats = checkpointer.stats();
+		if (ckStats.checkpoints != 1 || ckStats.pages_written != (std::uint64_t)ckPages ||
+				ckMgr.minRecLsn() != 0 || wal.checkpointLsn() == 0)
+		{
+			PRINT_ERROR("ERROR :: CHECKPOINT DID NOT WRITE DIRTY PAGES");
+		}
+		//Still in the pool
+		const int reads = ckMgr.getBufStats().diskreads;
+		for (int k = 0; k < ckPages; k++)
+		{
+			ckMgr.readPage(&dataFile, ckPageNos[k], page);
+			ckMgr.unPinPage(&dataFile, ckPageNos[k], false);
+		}
+		if (ckMgr.getBufStats().diskreads != reads)
+		{
+			PRINT_ERROR("ERROR :: CHECKPOINT EVICTED PAGES");
+		}
+
+		//Checkpoints in the background
+		checkpointer.start(2);
+		while (checkpointer.stats().checkpoints < 3)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		checkpointer.stop();
+		checkpointLsn = wal.checkpointLsn();
+		redoLsn = checkpointer.stats().redo_lsn;
+
+		std::ifstream in(dataName.c_str(), std::ios::binary);
+		std::ofstream out(crashName.c_str(), std::ios::binary);
+		out << in.rdbuf();
+		out.close();
+
+		//After the checkpoint: a committed insert on two pages, and the loser's insert on a third
+		txn = wal.begin();
+		for (int k = 1; k < 3; k++)
+		{
+			ckMgr.readPage(&dataFile, ckPageNos[k], page);
+			wal.insertRecord(txn, &dataFile, page, "after");
+			ckMgr.unPinPage(&dataFile, ckPageNos[k], true);
+		}
+		wal.commit(txn);
+		ckMgr.readPage(&dataFile, ckPageNos[3], page);
+		wal.insertRecord(loser, &dataFile, page, "loser");
+		ckMgr.unPinPage(&dataFile, ckPageNos[3], true);
+		wal.flush(wal.endLsn());
+		loggedRecords = wal.stats().records;
+		ckMgr.attachWal(NULL);
+	}
+	std::remove(dataName.c_str());
+	std::rename(crashName.c_str(), dataName.c_str());
+
+	RecoveryStats stats;
+	{
+		Wal wal(logName);
+		if (wal.checkpointLsn() != checkpointLsn)
+		{
+			PRINT_ERROR("ERROR :: CHECKPOINT NOT FOUND AFTER RESTART");
+		}
+		BufMgr recMgr(6);
+		recMgr.attachWal(&wal);
+		Recovery recovery(wal, recMgr);
+		stats = recovery.run(2);
+	}
+	if (stats.start_lsn != redoLsn || stats.start_lsn <= Wal::firstLsn() || stats.records >= loggedRecords ||
+			stats.redone != 3 || stats.losers != 1 || stats.undone != 2)
+	{
+		PRINT_ERROR("ERROR :: RECOVERY DID NOT START AT THE CHECKPOINT");
+	}
+	{
+		File dataFile = File::open(dataName);
+		for (int k = 0; k < ckPages; k++)
+		{
+			Page recovered = dataFile.readPage(ckPageNos[k]);
+			sprintf((char*)tmpbuf, "before %d", k);
+			int records = 0;
+			for (PageIterator iter = recovered.begin(); iter != recovered.end(); ++iter)
+			{
+				records++;
+			}
+			if (recovered.getRecord(ckRids[k]) != tmpbuf || records != (k == 1 || k == 2 ? 2 : 1))
+			{
+				PRINT_ERROR("ERROR :: RECOVERED PAGE DOES NOT MATCH");
+			}
+		}
+	}
+
+	std::remove(logName.c_str());
+	File::remove(dataName);
+
+	std::cout << "Test 22 passed" << "\n";
+}
+
+void test23()
+{
+	//Pages are checksummed on write-back, and a page damaged on disk is caught when read
+	const std::string dataName = "test.6";
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	if (Crc32c::compute("123456789", 9) != 0xe3069283 || Crc32c::computeSoftware("123456789", 9) != 0xe3069283)
+	{
+		PRINT_ERROR("ERROR :: CRC32C DOES NOT MATCH THE STANDARD CHECK VALUE");
+	}
+
+	const int sumPages = 3;
+	PageId sumPageNos[sumPages];
+	RecordId sumRids[sumPages];
+	{
+		File dataFile = File::create(dataName);
+		BufMgr sumMgr(4);
+		for (int k = 0; k < sumPages; k++)
+		{
+			sumMgr.allocPage(&dataFile, sumPageNos[k], page);
+			sprintf((char*)tmpbuf, "checksummed %d", k);
+			sumRids[k] = page->insertRecord(tmpbuf);
+			sumMgr.unPinPage(&dataFile, sumPageNos[k], true);
+		}
+		sumMgr.flushFile(&dataFile);
+		//The last page is written again without a checksum
+		dataFile.setChecksums(false);
+		sumMgr.readPage(&dataFile, sumPageNos[sumPages - 1], page);
+		sumMgr.unPinPage(&dataFile, sumPageNos[sumPages - 1], true);
+		sumMgr.flushFile(&dataFile);
+		dataFile.setChecksums(true);
+		for (int k = 0; k < sumPages; k++)
+		{
+			Page stored = dataFile.readPage(sumPageNos[k]);
+			if (!stored.verifyChecksum())
+			{
+				PRINT_ERROR("ERROR :: PAGE WRITTEN WITHOUT A VALID CHECKSUM");
+			}
+		}
+	}
+
+	//Damage the slot array of every page on disk
+	{
+		std::fstream raw(dataName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		for (int k = 0; k < sumPages; k++)
+		{
+			const std::streamoff offset = File::BLOCK_SIZE + (sumPageNos[k] - 1) * (std::streamoff)Page::SIZE +
+				sizeof(PageHeader) + 2;
+			raw.seekp(offset);
+			raw.put((char)0x7f);
+		}
+		//and point the record of the unchecksummed page past its end
+		raw.seekp(File::BLOCK_SIZE + (sumPageNos[sumPages - 1] - 1) * (std::streamoff)Page::SIZE + sizeof(PageHeader) + 3);
+		raw.put((char)0x7f);
+	}
+
+	{
+		File dataFile = File::open(dataName);
+		BufMgr sumMgr(4);
+		for (int k = 0; k < sumPages - 1; k++)
+		{
+			try
+			{
+				dataFile.readPage(sumPageNos[k]);
+				PRINT_ERROR("ERROR :: DAMAGED PAGE READ WITHOUT ERROR");
+			}
+			catch(PageChecksumException e)
+			{
+			}
+			try
+			{
+				sumMgr.readPage(&dataFile, sumPageNos[k], page);
+				PRINT_ERROR("ERROR :: DAMAGED PAGE READ INTO THE BUFFER POOL");
+			}
+			catch(PageChecksumException e)
+			{
+			}
+		}
+		//No checksum to check the unchecksummed page against, or any page with checksums off
+		sumMgr.readPage(&dataFile, sumPageNos[sumPages - 1], page);
+		//but the damaged slot is refused rather than followed
+		try
+		{
+			page->getRecord(sumRids[sumPages - 1]);
+			PRINT_ERROR("ERROR :: RECORD READ THROUGH A DAMAGED SLOT");
+		}
+		catch(InvalidRecordException e)
+		{
+		}
+		try
+		{
+			page->deleteRecord(sumRids[sumPages - 1]);
+			PRINT_ERROR("ERROR :: RECORD DELETED THROUGH A DAMAGED SLOT");
+		}
+		catch(InvalidRecordException e)
+		{
+		}
+		sumMgr.unPinPage(&dataFile, sumPageNos[sumPages - 1], false);
+		dataFile.setChecksums(false);
+		dataFile.readPage(sumPageNos[0]);
+		if (sumMgr.getBufStats().diskreads != 1)
+		{
+			PRINT_ERROR("ERROR :: FAILED READS LEFT PAGES IN THE BUFFER POOL");
+		}
+	}
+
+	File::remove(dataName);
+
+	std::cout << "Test 23 passed" << "\n";
+}
+
+void test24()
+{
+	//Pages go through the double-write buffer, and a page torn at home is restored from it on restart
+	const std::string dataName = "test.6";
+	const std::string dwName = "test.7";
+	std::remove(dwName.c_str());
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	const int dwPages = 8;
+	PageId dwPageNos[dwPages];
+	RecordId dwRids[dwPages];
+	{
+		File dataFile = File::create(dataName);
+		DoubleWriteBuffer doubleWrite(dwName, 16);
+		{
+			BufMgr dwMgr(4);
+			dwMgr.attachDoubleWrite(&doubleWrite);
+			for (int k = 0; k < dwPages; k++)
+			{
+				dwMgr.allocPage(&dataFile, dwPageNos[k], page);
+				sprintf((char*)tmpbuf, "doubled %d", k);
+				dwRids[k] = page->insertRecord(tmpbuf);
+				dwMgr.unPinPage(&dataFile, dwPageNos[k], true);
+			}
+			//Evicting the first dirty page cleaned the pool in one batch
+			if (doubleWrite.stats().batches != 1 || doubleWrite.stats().pages != 4)
+			{
+				PRINT_ERROR("ERROR :: EVICTION DID NOT WRITE A BATCH");
+			}
+			dwMgr.flushFile(&dataFile);
+		}
+		if (doubleWrite.stats().batches != 2 || doubleWrite.stats().pages != (std::uint64_t)dwPages)
+		{
+			PRINT_ERROR("ERROR :: PAGES DID NOT GO THROUGH THE DOUBLE-WRITE BUFFER");
+		}
+	}
+
+	//Crash halfway through writing the last page home, and through an earlier one no longer in the buffer
+	{
+		std::fstream raw(dataName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		const PageId torn[2] = {dwPageNos[dwPages - 1], dwPageNos[0]};
+		const std::string garbage(Page::SIZE / 2, (char)0x5a);
+		for (int t = 0; t < 2; t++)
+		{
+			raw.seekp(File::BLOCK_SIZE + (torn[t] - 1) * (std::streamoff)Page::SIZE + Page::SIZE / 2);
+			raw.write(garbage.data(), garbage.size());
+		}
+	}
+
+	{
+		DoubleWriteBuffer doubleWrite(dwName);
+		if (doubleWrite.restoreTornPages() != 1)
+		{
+			PRINT_ERROR("ERROR :: TORN PAGE NOT RESTORED");
+		}
+		File dataFile = File::open(dataName);
+		for (int k = 1; k < dwPages; k++)
+		{
+			sprintf((char*)tmpbuf, "doubled %d", k);
+			if (dataFile.readPage(dwPageNos[k]).getRecord(dwRids[k]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: RESTORED PAGE DOES NOT MATCH");
+			}
+		}
+		try
+		{
+			dataFile.readPage(dwPageNos[0]);
+			PRINT_ERROR("ERROR :: TORN PAGE READ WITHOUT ERROR");
+		}
+		catch(PageChecksumException e)
+		{
+		}
+	}
+
+	//A header with an impossible length, or an intact one naming no file, restores nothing
+	{
+		std::uint32_t fields[6] = {0x52474442, 0x574c4244, 0, 0xffffffffu, 1, 1};
+		{
+			std::ofstream raw(dwName.c_str(), std::ios::binary | std::ios::trunc);
+			raw.write((const char*)fields, sizeof(fields));
+		}
+		DoubleWriteBuffer doubleWrite(dwName);
+		if (doubleWrite.restoreTornPages() != 0)
+		{
+			PRINT_ERROR("ERROR :: PAGE RESTORED FROM A HEADER WITH AN IMPOSSIBLE LENGTH");
+		}
+	}
+	{
+		const std::string copy(Page::SIZE, '\0');
+		//Fixed header (no files, one page) followed by an entry for file 0, checksummed
+		std::uint32_t fields[9] = {0x52474442, 0x574c4244, 0, 36, 1, 0,
+			0, dwPageNos[1], Crc32c::compute(copy.data(), copy.size())};
+		fields[2] = Crc32c::compute(fields, sizeof(fields));
+		{
+			std::ofstream raw(dwName.c_str(), std::ios::binary | std::ios::trunc);
+			raw.write((const char*)fields, sizeof(fields));
+			raw.seekp(File::BLOCK_SIZE);
+			raw.write(copy.data(), copy.size());
+		}
+		DoubleWriteBuffer doubleWrite(dwName);
+		if (doubleWrite.restoreTornPages() != 0)
+		{
+			PRINT_ERROR("ERROR :: PAGE RESTORED FOR A FILE NOT IN THE HEADER");
+		}
+	}
+
+	std::remove(dwName.c_str());
+	File::remove(dataName);
+
+	std::cout << "Test 24 passed" << "\n";
+}
+
+void test25()
+{
+	//Pages of a compressed file are stored compressed and read back unchanged through the buffer pool
+	const std::string dataName = "test.6";
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	{
+		const std::string text(3000, 'x');
+		char packed[4000];
+		char unpacked[3000];
+		const std::size_t length = Lz4::compress(text.data(), text.size(), packed, sizeof(packed));
+		if (length == 0 || length >= text.size() / 10 ||
+			!Lz4::decompress(packed, length, unpacked, sizeof(unpacked)) ||
+			std::string(unpacked, sizeof(unpacked)) != text ||
+			Lz4::decompress(packed, length - 1, unpacked, sizeof(unpacked)))
+		{
+			PRINT_ERROR("ERROR :: LZ4 ROUND TRIP FAILED");
+		}
+	}
+
+	const int zipPages = 12;
+	PageId zipPageNos[zipPages];
+	RecordId zipRids[zipPages];
+	{
+		File dataFile = File::createCompressed(dataName);
+		if (!dataFile.isCompressed())
+		{
+			PRINT_ERROR("ERROR :: FILE NOT COMPRESSED");
+		}
+		BufMgr zipMgr(4);
+		for (int k = 0; k < zipPages; k++)
+		{
+			zipMgr.allocPage(&dataFile, zipPageNos[k], page);
+			sprintf((char*)tmpbuf, "compressed record %d of a page of mostly repeated text", k);
+			zipRids[k] = page->insertRecord(tmpbuf);
+			//All but the first page are filled
+			while (k > 0 && page->hasSpaceForRecord(tmpbuf))
+			{
+				page->insertRecord(tmpbuf);
+			}
+			zipMgr.unPinPage(&dataFile, zipPageNos[k], true);
+		}
+		zipMgr.flushFile(&dataFile);
+		if (dataFile.storedBytes() * 3 > zipPages * (std::uint64_t)Page::SIZE)
+		{
+			PRINT_ERROR("ERROR :: PAGES NOT STORED COMPRESSED");
+		}
+	}
+
+	{
+		std::ifstream raw(dataName.c_str(), std::ios::binary | std::ios::ate);
+		if ((std::uint64_t)raw.tellg() * 2 > zipPages * (std::uint64_t)Page::SIZE)
+		{
+			PRINT_ERROR("ERROR :: COMPRESSED FILE NOT SMALLER ON DISK");
+		}
+	}
+
+	{
+		//The format is told from the header, and the page-offset map read back
+		File dataFile = File::open(dataName);
+		BufMgr zipMgr(4);
+		if (!dataFile.isCompressed())
+		{
+			PRINT_ERROR("ERROR :: COMPRESSED FILE OPENED AS PLAIN");
+		}
+		int found = 0;
+		for (FileIterator iter = dataFile.begin(); iter != dataFile.end(); ++iter)
+		{
+			found++;
+		}
+		if (found != zipPages)
+		{
+			PRINT_ERROR("ERROR :: COMPRESSED FILE DOES NOT LIST ITS PAGES");
+		}
+		for (int k = 0; k < zipPages; k++)
+		{
+			zipMgr.readPage(&dataFile, zipPageNos[k], page);
+			sprintf((char*)tmpbuf, "compressed record %d of a page of mostly repeated text", k);
+			if (page->getRecord(zipRids[k]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: COMPRESSED PAGE DOES NOT MATCH");
+			}
+			//Random bytes that no longer compress move the page to a larger slot
+			if (k == 0)
+			{
+				std::string noise(1000, ' ');
+				for (std::size_t c = 0; c < noise.size(); c++)
+				{
+					noise[c] = (char)(rand() % 256);
+				}
+				page->updateRecord(zipRids[k], noise);
+			}
+			zipMgr.unPinPage(&dataFile, zipPageNos[k], k == 0);
+		}
+		zipMgr.flushFile(&dataFile);
+		zipMgr.disposePage(&dataFile, zipPageNos[zipPages - 1]);
+		dataFile.sync();
+	}
+
+	{
+		File dataFile = File::open(dataName);
+		Page moved = dataFile.readPage(zipPageNos[0]);
+		if (moved.getRecord(zipRids[0]).size() != 1000)
+		{
+			PRINT_ERROR("ERROR :: MOVED PAGE NOT READ BACK");
+		}
+		try
+		{
+			dataFile.readPage(zipPageNos[zipPages - 1]);
+			PRINT_ERROR("ERROR :: DELETED COMPRESSED PAGE READ");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+		sprintf((char*)tmpbuf, "compressed record %d of a page of mostly repeated text", 1);
+		if (dataFile.readPage(zipPageNos[1]).getRecord(zipRids[1]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: COMPRESSED PAGE CHANGED");
+		}
+	}
+
+	File::remove(dataName);
+
+	std::cout << "Test 25 passed" << "\n";
+}
+
+void test26()
+{
+	//Pages evicted from a small pool are kept compressed in a victim cache and read back without disk reads
+	const std::string dataName = "test.6";
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	const int cachedPages = 12;
+	PageId cachedPageNos[cachedPages];
+	RecordId cachedRids[cachedPages];
+	{
+		File dataFile = File::create(dataName);
+		BufMgr cacheMgr(4);
+		//Room for 4 pages uncompressed, and for all of them compressed
+		cacheMgr.enableVictimCache(4 * Page::SIZE);
+		for (int k = 0; k < cachedPages; k++)
+		{
+			cacheMgr.allocPage(&dataFile, cachedPageNos[k], page);
+			sprintf((char*)tmpbuf, "victim cache record %d", k);
+			cachedRids[k] = page->insertRecord(tmpbuf);
+			cacheMgr.unPinPage(&dataFile, cachedPageNos[k], true);
+		}
+
+		for (int round = 0; round < 2; round++)
+		{
+			cacheMgr.clearBufStats();
+			for (int k = 0; k < cachedPages; k++)
+			{
+				cacheMgr.readPage(&dataFile, cachedPageNos[k], page);
+				sprintf((char*)tmpbuf, "victim cache record %d", k);
+				if (page->getRecord(cachedRids[k]) != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: PAGE FROM VICTIM CACHE DOES NOT MATCH");
+				}
+				cacheMgr.unPinPage(&dataFile, cachedPageNos[k], false);
+			}
+			if (cacheMgr.getBufStats().diskreads != 0 || cacheMgr.getBufStats().victimmisses != 0 ||
+				cacheMgr.getBufStats().victimhits != cachedPages)
+			{
+				PRINT_ERROR("ERROR :: EVICTED PAGES NOT READ FROM VICTIM CACHE");
+			}
+		}
+
+		//A disposed page is dropped from the cache too
+		cacheMgr.disposePage(&dataFile, cachedPageNos[0]);
+		try
+		{
+			cacheMgr.readPage(&dataFile, cachedPageNos[0], page);
+			PRINT_ERROR("ERROR :: DISPOSED PAGE READ FROM VICTIM CACHE");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+
+		//So are the pages of a flushed file
+		cacheMgr.flushFile(&dataFile);
+		cacheMgr.clearBufStats();
+		cacheMgr.readPage(&dataFile, cachedPageNos[1], page);
+		cacheMgr.unPinPage(&dataFile, cachedPageNos[1], false);
+		if (cacheMgr.getBufStats().diskreads != 1 || cacheMgr.getBufStats().victimhits != 0 ||
+			cacheMgr.getBufStats().victimmisses != 1)
+		{
+			PRINT_ERROR("ERROR :: FLUSHED PAGE READ FROM VICTIM CACHE");
+		}
+		cacheMgr.flushFile(&dataFile);
+	}
+
+	File::remove(dataName);
+
+	std::cout << "Test 26 passed" << "\n";
+}
+
+void test27()
+{
+	//Clean pages evicted from a small pool are written to an SSD cache file and read back from it
+	const std::string dataName = "test.6";
+	const std::string cacheName = "test.7";
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	const int cachedPages = 12;
+	PageId cachedPageNos[cachedPages];
+	RecordId cachedRids[cachedPages];
+	{
+		File dataFile = File::create(dataName);
+		SsdCache ssdCache(cacheName, 16, 4);
+		BufMgr cacheMgr(4);
+		cacheMgr.attachSsdCache(&ssdCache);
+		for (int k = 0; k < cachedPages; k++)
+		{
+			cacheMgr.allocPage(&dataFile, cachedPageNos[k], page);
+			sprintf((char*)tmpbuf, "ssd cache record %d", k);
+			cachedRids[k] = page->insertRecord(tmpbuf);
+			cacheMgr.unPinPage(&dataFile, cachedPageNos[k], true);
+		}
+
+		std::uint64_t writes = 0;
+		for (int round = 0; round < 2; round++)
+		{
+			cacheMgr.clearBufStats();
+			for (int k = 0; k < cachedPages; k++)
+			{
+				cacheMgr.readPage(&dataFile, cachedPageNos[k], page);
+				sprintf((char*)tmpbuf, "ssd cache record %d", k);
+				if (page->getRecord(cachedRids[k]) != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: PAGE FROM SSD CACHE DOES NOT MATCH");
+				}
+				cacheMgr.unPinPage(&dataFile, cachedPageNos[k], false);
+			}
+			if (cacheMgr.getBufStats().diskreads != 0 || cacheMgr.getBufStats().ssdhits != cachedPages)
+			{
+				PRINT_ERROR("ERROR :: EVICTED PAGES NOT READ FROM SSD CACHE");
+			}
+			//Pages evicted unchanged are not written to the cache again
+			if (round == 1 && ssdCache.stats().writes != writes)
+			{
+				PRINT_ERROR("ERROR :: UNCHANGED PAGES WRITTEN TO SSD CACHE AGAIN");
+			}
+			writes = ssdCache.stats().writes;
+		}
+
+		//Changes reach the cache whether the page is written back on eviction or by a checkpoint
+		for (int k = 0; k < 2; k++)
+		{
+			cacheMgr.readPage(&dataFile, cachedPageNos[k], page);
+			sprintf((char*)tmpbuf, "ssd cache record %d changed", k);
+			page->updateRecord(cachedRids[k], tmpbuf);
+			cacheMgr.unPinPage(&dataFile, cachedPageNos[k], true);
+			if (k == 1)
+			{
+				cacheMgr.checkpoint(&dataFile);
+			}
+			for (int j = 2; j < 2 + 4; j++)
+			{
+				cacheMgr.readPage(&dataFile, cachedPageNos[j], page);
+				cacheMgr.unPinPage(&dataFile, cachedPageNos[j], false);
+			}
+			cacheMgr.readPage(&dataFile, cachedPageNos[k], page);
+			if (page->getRecord(cachedRids[k]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: STALE PAGE READ FROM SSD CACHE");
+			}
+			cacheMgr.unPinPage(&dataFile, cachedPageNos[k], false);
+		}
+
+		//Disposed pages and the pages of flushed files are dropped
+		cacheMgr.disposePage(&dataFile, cachedPageNos[cachedPages - 1]);
+		try
+		{
+			cacheMgr.readPage(&dataFile, cachedPageNos[cachedPages - 1], page);
+			PRINT_ERROR("ERROR :: DISPOSED PAGE READ FROM SSD CACHE");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+		cacheMgr.flushFile(&dataFile);
+		cacheMgr.clearBufStats();
+		cacheMgr.readPage(&dataFile, cachedPageNos[2], page);
+		cacheMgr.unPinPage(&dataFile, cachedPageNos[2], false);
+		if (cacheMgr.getBufStats().diskreads != 1 || cacheMgr.getBufStats().ssdhits != 0)
+		{
+			PRINT_ERROR("ERROR :: FLUSHED PAGE READ FROM SSD CACHE");
+		}
+		cacheMgr.flushFile(&dataFile);
+		cacheMgr.attachSsdCache(NULL);
+	}
+
+	//The cache file goes with the cache
+	if (std::ifstream(cacheName.c_str()).good())
+	{
+		PRINT_ERROR("ERROR :: SSD CACHE FILE LEFT BEHIND");
+	}
+	File::remove(dataName);
+
+	std::cout << "Test 27 passed" << "\n";
+}
+
+void test28()
+{
+	//B+tree index over pages of the buffer pool, shared by threads under one mutex
+	const std::string intName = "test.6";
+	const std::string stringName = "test.7";
+	for (const std::string& name : {intName, stringName})
+	{
+		try
+		{
+			File::remove(name);
+		}
+		catch(FileNotFoundException e)
+		{
+		}
+	}
+	const int numKeys = 5000;
+	std::mutex treeMutex;
+	{
+		File intFile = File::create(intName);
+		BufMgr treeMgr(32);
+		BTreeIndex intTree(treeMgr, &intFile, treeMutex, BTREE_INT_KEYS);
+
+		//Keys inserted in a scrambled order, negative ones too
+		for (int k = 0; k < numKeys; k++)
+		{
+			const std::int64_t key = (k * 7919) % numKeys - numKeys / 2;
+			RecordId rid = {static_cast<PageId>(key + numKeys), static_cast<SlotId>(k % 5)};
+			intTree.insert(key, rid);
+		}
+		if (intTree.height() < 2 || intTree.stats().splits == 0)
+		{
+			PRINT_ERROR("ERROR :: B+TREE DID NOT SPLIT");
+		}
+		RecordId rid;
+		for (std::int64_t key = -numKeys / 2; key < numKeys / 2; key++)
+		{
+			if (!intTree.lookup(key, rid) || rid.page_number != key + numKeys)
+			{
+				PRINT_ERROR("ERROR :: B+TREE KEY NOT FOUND");
+			}
+		}
+		if (intTree.lookup(std::int64_t(numKeys), rid))
+		{
+			PRINT_ERROR("ERROR :: B+TREE FOUND A KEY NEVER INSERTED");
+		}
+
+		//Range scans return the keys in order, bounds included
+		{
+			BTreeScan scan = intTree.scan(-100, 99);
+			std::int64_t expected = -100;
+			while (scan.next(rid))
+			{
+				if (scan.intKey() != expected || rid.page_number != expected + numKeys)
+				{
+					PRINT_ERROR("ERROR :: B+TREE SCAN OUT OF ORDER");
+				}
+				expected++;
+			}
+			if (expected != 100)
+			{
+				PRINT_ERROR("ERROR :: B+TREE SCAN MISSED KEYS");
+			}
+		}
+
+		//Duplicate keys are kept apart by record ID, and removed one at a time
+		RecordId duplicate = {1, 1};
+		intTree.insert(0, duplicate);
+		int found = 0;
+		{
+			BTreeScan scan = intTree.scan(0, 0);
+			while (scan.next(rid))
+			{
+				found++;
+			}
+		}
+		if (found != 2 || !intTree.remove(0, duplicate) || intTree.remove(0, duplicate))
+		{
+			PRINT_ERROR("ERROR :: B+TREE DUPLICATE KEYS MISHANDLED");
+		}
+		for (std::int64_t key = -numKeys / 2; key < numKeys / 2; key += 2)
+		{
+			RecordId removed = {static_cast<PageId>(key + numKeys), 0};
+			intTree.lookup(key, removed);
+			if (!intTree.remove(key, removed))
+			{
+				PRINT_ERROR("ERROR :: B+TREE ENTRY NOT REMOVED");
+			}
+		}
+		for (std::int64_t key = -numKeys / 2; key < numKeys / 2; key++)
+		{
+			if (intTree.lookup(key, rid) != (key % 2 != 0))
+			{
+				PRINT_ERROR("ERROR :: B+TREE REMOVE LOOKUP MISMATCH");
+			}
+		}
+
+		//Lookups on several threads, with an insert thread splitting nodes under them
+		std::atomic<int> lookupErrors(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 3; t++)
+		{
+			threads.push_back(std::thread([&intTree, &lookupErrors, t]() {
+				RecordId found;
+				for (std::int64_t key = -numKeys / 2 + 1 + 2 * t; key < numKeys / 2; key += 6)
+				{
+					if (!intTree.lookup(key, found) || found.page_number != key + numKeys)
+					{
+						lookupErrors++;
+					}
+				}
+			}));
+		}
+		threads.push_back(std::thread([&intTree]() {
+			for (int k = 0; k < numKeys; k++)
+			{
+				RecordId added = {static_cast<PageId>(2 * numKeys + k), 0};
+				intTree.insert(std::int64_t(numKeys + k), added);
+			}
+		}));
+		for (std::size_t t = 0; t < threads.size(); t++)
+		{
+			threads[t].join();
+		}
+		if (lookupErrors != 0 || !intTree.lookup(std::int64_t(2 * numKeys - 1), rid))
+		{
+			PRINT_ERROR("ERROR :: B+TREE LOOKUPS FAILED DURING INSERTS");
+		}
+
+		//A bulk load needs an empty index and sorted entries
+		try
+		{
+			intTree.bulkLoad(std::vector<std::pair<std::int64_t, RecordId> >(1, std::make_pair(std::int64_t(1), rid)));
+			PRINT_ERROR("ERROR :: BULK LOAD INTO A NON-EMPTY B+TREE");
+		}
+		catch(BadIndexException e)
+		{
+		}
+		try
+		{
+			intTree.insert(std::string("text"), rid);
+			PRINT_ERROR("ERROR :: STRING KEY IN AN INTEGER B+TREE");
+		}
+		catch(BadIndexException e)
+		{
+		}
+		treeMgr.flushFile(&intFile);
+	}
+
+	{
+		//Bulk loaded string keys, read back after reopening the file
+		File stringFile = File::create(stringName);
+		BufMgr treeMgr(32);
+		std::vector<std::pair<std::string, RecordId> > entries;
+		for (int k = 0; k < numKeys; k++)
+		{
+			sprintf((char*)tmpbuf, "key %06d", k);
+			RecordId rid = {static_cast<PageId>(k + 1), 0};
+			entries.push_back(std::make_pair(std::string((char*)tmpbuf), rid));
+		}
+		{
+			BTreeIndex stringTree(treeMgr, &stringFile, treeMutex, BTREE_STRING_KEYS);
+			std::vector<std::pair<std::string, RecordId> > unsorted(entries.rbegin(), entries.rend());
+			try
+			{
+				stringTree.bulkLoad(unsorted);
+				PRINT_ERROR("ERROR :: UNSORTED BULK LOAD ACCEPTED");
+			}
+			catch(BadIndexException e)
+			{
+			}
+			stringTree.bulkLoad(entries);
+			try
+			{
+				stringTree.insert(std::string(BTreeIndex::MAX_KEY_LENGTH + 1, 'x'), entries[0].second);
+				PRINT_ERROR("ERROR :: TOO LONG B+TREE KEY ACCEPTED");
+			}
+			catch(BadIndexException e)
+			{
+			}
+			stringTree.insert(std::string(BTreeIndex::MAX_KEY_LENGTH, 'k'), entries[0].second);
+		}
+		treeMgr.flushFile(&stringFile);
+
+		try
+		{
+			BTreeIndex wrongTree(treeMgr, &stringFile, treeMutex, BTREE_INT_KEYS);
+			PRINT_ERROR("ERROR :: B+TREE OPENED WITH THE WRONG KEY TYPE");
+		}
+		catch(BadIndexException e)
+		{
+		}
+		BTreeIndex stringTree(treeMgr, &stringFile, treeMutex, BTREE_STRING_KEYS);
+		RecordId rid;
+		if (!stringTree.lookup(std::string("key 004321"), rid) || rid.page_number != 4322
+			|| !stringTree.lookup(std::string(BTreeIndex::MAX_KEY_LENGTH, 'k'), rid))
+		{
+			PRINT_ERROR("ERROR :: BULK LOADED B+TREE KEY NOT FOUND");
+		}
+		int scanned = 0;
+		{
+			BTreeScan scan = stringTree.scan(std::string("key 001000"), std::string("key 001999~"));
+			while (scan.next(rid))
+			{
+				sprintf((char*)tmpbuf, "key %06d", 1000 + scanned);
+				if (scan.stringKey() != (char*)tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: B+TREE STRING SCAN OUT OF ORDER");
+				}
+				scanned++;
+			}
+		}
+		if (scanned != 1000 || stringTree.stats().prefetches == 0)
+		{
+			PRINT_ERROR("ERROR :: B+TREE STRING SCAN MISSED KEYS");
+		}
+		treeMgr.flushFile(&stringFile);
+	}
+	File::remove(intName);
+	File::remove(stringName);
+
+	std::cout << "Test 28 passed" << "\n";
+}
+
+void test29()
+{
+	//Extendible hash index: splits, directory doubling past one page, two page accesses per lookup
+	const std::string intName = "test.6";
+	const std::string stringName = "test.7";
+	for (const std::string& name : {intName, stringName})
+	{
+		try
+		{
+			File::remove(name);
+		}
+		catch(FileNotFoundException e)
+		{
+		}
+	}
+	const int numKeys = 20000;
+	{
+		File intFile = File::create(intName);
+		BufMgr hashMgr(16);
+		HashIndex intHash(hashMgr, &intFile, HASH_INT_KEYS);
+		for (int k = 0; k < numKeys; k++)
+		{
+			RecordId rid = {static_cast<PageId>(k + 1), static_cast<SlotId>(k % 7)};
+			if (!intHash.insert(std::int64_t(k) * 1000003 - numKeys, rid))
+			{
+				PRINT_ERROR("ERROR :: HASH INDEX KEY NOT INSERTED");
+			}
+		}
+		if (intHash.stats().splits == 0 || intHash.globalDepth() == 0)
+		{
+			PRINT_ERROR("ERROR :: HASH INDEX DID NOT SPLIT");
+		}
+		RecordId rid = {1, 1};
+		if (intHash.insert(std::int64_t(-numKeys), rid))
+		{
+			PRINT_ERROR("ERROR :: HASH INDEX KEY INSERTED TWICE");
+		}
+		for (int k = 0; k < numKeys; k++)
+		{
+			hashMgr.clearBufStats();
+			if (!intHash.lookup(std::int64_t(k) * 1000003 - numKeys, rid) || rid.page_number != PageId(k + 1)
+				|| rid.slot_number != k % 7)
+			{
+				PRINT_ERROR("ERROR :: HASH INDEX KEY NOT FOUND");
+			}
+			if (hashMgr.getBufStats().accesses != 2)
+			{
+				PRINT_ERROR("ERROR :: HASH INDEX LOOKUP TOUCHED MORE THAN TWO PAGES");
+			}
+		}
+		for (int k = 0; k < numKeys; k += 2)
+		{
+			if (!intHash.remove(std::int64_t(k) * 1000003 - numKeys))
+			{
+				PRINT_ERROR("ERROR :: HASH INDEX KEY NOT REMOVED");
+			}
+		}
+		for (int k = 0; k < numKeys; k++)
+		{
+			if (intHash.lookup(std::int64_t(k) * 1000003 - numKeys, rid) != (k % 2 == 1))
+			{
+				PRINT_ERROR("ERROR :: HASH INDEX REMOVE LOOKUP MISMATCH");
+			}
+		}
+		try
+		{
+			intHash.lookup(std::string("text"), rid);
+			PRINT_ERROR("ERROR :: STRING KEY IN AN INTEGER HASH INDEX");
+		}
+		catch(BadIndexException e)
+		{
+		}
+		hashMgr.flushFile(&intFile);
+	}
+
+	{
+		//Long keys split buckets often enough for the directory to need several pages
+		const int numStrings = 6000;
+		File stringFile = File::create(stringName);
+		BufMgr hashMgr(16);
+		{
+			HashIndex stringHash(hashMgr, &stringFile, HASH_STRING_KEYS);
+			for (int k = 0; k < numStrings; k++)
+			{
+				sprintf((char*)tmpbuf, "%d", k);
+				RecordId rid = {static_cast<PageId>(k + 1), 0};
+				stringHash.insert(std::string((char*)tmpbuf) + std::string(900, 'v'), rid);
+			}
+			if (stringHash.globalDepth() <= 10)
+			{
+				PRINT_ERROR("ERROR :: HASH INDEX DIRECTORY DID NOT OUTGROW A PAGE");
+			}
+			try
+			{
+				RecordId rid = {1, 0};
+				stringHash.insert(std::string(HashIndex::MAX_KEY_LENGTH + 1, 'x'), rid);
+				PRINT_ERROR("ERROR :: TOO LONG HASH INDEX KEY ACCEPTED");
+			}
+			catch(BadIndexException e)
+			{
+			}
+		}
+		hashMgr.flushFile(&stringFile);
+
+		//Reopened from its file
+		try
+		{
+			HashIndex wrongHash(hashMgr, &stringFile, HASH_INT_KEYS);
+			PRINT_ERROR("ERROR :: HASH INDEX OPENED WITH THE WRONG KEY TYPE");
+		}
+		catch(BadIndexException e)
+		{
+		}
+		HashIndex stringHash(hashMgr, &stringFile, HASH_STRING_KEYS);
+		for (int k = 0; k < numStrings; k++)
+		{
+			sprintf((char*)tmpbuf, "%d", k);
+			RecordId rid;
+			hashMgr.clearBufStats();
+			if (!stringHash.lookup(std::string((char*)tmpbuf) + std::string(900, 'v'), rid)
+				|| rid.page_number != PageId(k + 1) || hashMgr.getBufStats().accesses != 2)
+			{
+				PRINT_ERROR("ERROR :: REOPENED HASH INDEX KEY NOT FOUND");
+			}
+		}
+		hashMgr.flushFile(&stringFile);
+	}
+	File::remove(intName);
+	File::remove(stringName);
+
+	std::cout << "Test 29 passed" << "\n";
+}
+
+void test30()
+{
+	//Heap file inserts find a page with room from the free space map, kept up to date by updates and deletes
+	const std::string heapName = "test.6";
+	try
+	{
+		File::remove(heapName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	const int numRecords = 3000;
+	std::vector<RecordId> rids;
+	std::size_t recordBytes = 0;
+	{
+		File heapFile = File::create(heapName);
+		BufMgr heapMgr(16);
+		HeapFile heap(heapMgr, &heapFile);
+		for (int k = 0; k < numRecords; k++)
+		{
+			const std::string record(10 + (k * 37) % 300, 'a' + k % 26);
+			rids.push_back(heap.insertRecord(record));
+			recordBytes += record.size() + sizeof(PageSlot);
+		}
+		//Pages are filled before new ones are allocated
+		const std::size_t fewestPages = (recordBytes + Page::DATA_SIZE - 1) / Page::DATA_SIZE;
+		if (heap.numDataPages() > fewestPages + 1 || heap.stats().new_pages != heap.numDataPages())
+		{
+			PRINT_ERROR("ERROR :: HEAP FILE LEFT ROOM UNUSED");
+		}
+		for (int k = 0; k < numRecords; k++)
+		{
+			if (heap.getRecord(rids[k]) != std::string(10 + (k * 37) % 300, 'a' + k % 26))
+			{
+				PRINT_ERROR("ERROR :: HEAP FILE RECORD DOES NOT MATCH");
+			}
+		}
+		//The map pages hold no records
+		if (heap.isDataPage(1) || heap.isDataPage(2))
+		{
+			PRINT_ERROR("ERROR :: HEAP FILE MAP PAGE TAKEN FOR A DATA PAGE");
+		}
+		try
+		{
+			RecordId mapRid = {2, 1};
+			heap.getRecord(mapRid);
+			PRINT_ERROR("ERROR :: RECORD READ FROM A HEAP FILE MAP PAGE");
+		}
+		catch(InvalidRecordException e)
+		{
+		}
+		try
+		{
+			heap.insertRecord(std::string(Page::DATA_SIZE, 'x'));
+			PRINT_ERROR("ERROR :: TOO LARGE HEAP FILE RECORD ACCEPTED");
+		}
+		catch(InsufficientSpaceException e)
+		{
+		}
+
+		//Room made by deletes is reused before new pages are allocated
+		const PageId freedPage = rids[numRecords / 2].page_number;
+		int freed = 0;
+		for (int k = 0; k < numRecords; k++)
+		{
+			if (rids[k].page_number == freedPage)
+			{
+				heap.deleteRecord(rids[k]);
+				freed++;
+			}
+		}
+		const std::uint64_t newPages = heap.stats().new_pages;
+		for (int k = 0; k < freed; k++)
+		{
+			heap.insertRecord(std::string(100, 'r'));
+		}
+		if (heap.stats().new_pages != newPages)
+		{
+			PRINT_ERROR("ERROR :: HEAP FILE ROOM FROM DELETES NOT REUSED");
+		}
+
+		//A record grown in place takes room from its page
+		const RecordId grown = heap.insertRecord("small");
+		heap.updateRecord(grown, std::string(64, 'g'));
+		if (heap.getRecord(grown) != std::string(64, 'g'))
+		{
+			PRINT_ERROR("ERROR :: HEAP FILE RECORD NOT UPDATED");
+		}
+		heapMgr.flushFile(&heapFile);
+	}
+
+	{
+		//The map is read back when the file is opened again
+		File heapFile = File::open(heapName);
+		BufMgr heapMgr(16);
+		HeapFile heap(heapMgr, &heapFile);
+		const std::size_t dataPages = heap.numDataPages();
+		for (int k = 0; k < 20; k++)
+		{
+			heap.insertRecord("reopened");
+		}
+		if (heap.stats().new_pages != 0 || heap.numDataPages() != dataPages)
+		{
+			PRINT_ERROR("ERROR :: REOPENED HEAP FILE MAP LOST");
+		}
+		heapMgr.flushFile(&heapFile);
+	}
+	File::remove(heapName);
+
+	//Slots added after trailing slots were freed start out unused, though records once lay where they are
+	Page page;
+	const RecordId first = page.insertRecord(std::string(100, 'a'));
+	const RecordId second = page.insertRecord(std::string(100, 'b'));
+	const RecordId third = page.insertRecord(std::string(100, 'c'));
+	page.deleteRecord(first);
+	page.insertRecord(std::string(page.getFreeSpace(), 'd'));
+	page.deleteRecord(second);
+	page.deleteRecord(third);
+	try
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			page.insertRecord("e");
+		}
+	}
+	catch(SlotInUseException e)
+	{
+		PRINT_ERROR("ERROR :: NEW PAGE SLOT FOUND IN USE");
+	}
+
+	std::cout << "Test 30 passed" << "\n";
+}
+
+void test31()
+{
+	//Checkpoints write pinned pages a writer changes under the exclusive latch as they were between changes, and
+	//leave them dirty from before the first change they missed
+	const std::string logName = "test.wal";
+	const std::string dataName = "test.6";
+	std::remove(logName.c_str());
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	{
+		File dataFile = File::create(dataName);
+		Wal wal(logName);
+		BufMgr latchMgr(8);
+		latchMgr.attachWal(&wal);
+		std::mutex latchMutex;
+		const std::size_t half = 1000;
+		PageGuard guard = latchMgr.allocate(&dataFile);
+		const PageId pageNo = guard.page_number();
+		const TxnId txn = wal.begin();
+		wal.logPage(txn, &dataFile, guard.get());
+		const RecordId rid = wal.insertRecord(txn, &dataFile, guard.get(), std::string(2 * half, 'a'));
+		guard.markDirty();
+		guard.release();
+
+		//A page latched exclusively is not written and stays dirty
+		guard = latchMgr.fetch(&dataFile, pageNo, LATCH_EXCLUSIVE);
+		latchMgr.checkpointAll();
+		if (latchMgr.dirtyBefore(wal.endLsn() + 1) != 1)
+		{
+			PRINT_ERROR("ERROR :: LATCHED PAGE WRITTEN BACK");
+		}
+		guard.release();
+		latchMgr.checkpointAll();
+		if (latchMgr.dirtyBefore(wal.endLsn() + 1) != 0)
+		{
+			PRINT_ERROR("ERROR :: UNLATCHED PAGE NOT WRITTEN BACK");
+		}
+
+		//Each change fills one half of the record, then the other, under one exclusive latch
+		const int changes = 300;
+		std::vector<Lsn> lsns;
+		std::atomic<bool> finished(false);
+		std::thread writer([&]() {
+			for (int c = 0; c < changes; c++)
+			{
+				const char fill = 'b' + c % 24;
+				PageGuard page;
+				{
+					std::lock_guard<std::mutex> lock(latchMutex);
+					page = latchMgr.fetch(&dataFile, pageNo);
+				}
+				page.latch(LATCH_EXCLUSIVE);
+				const std::string before = page->getRecord(rid);
+				wal.updateRecord(txn, &dataFile, page.get(), rid, std::string(half, fill) + before.substr(half));
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				wal.updateRecord(txn, &dataFile, page.get(), rid, std::string(2 * half, fill));
+				lsns.push_back(page->page_lsn());
+				page.markDirty();
+				std::lock_guard<std::mutex> lock(latchMutex);
+				page.release();
+			}
+			finished = true;
+		});
+		bool torn = false;
+		while (!finished)
+		{
+			{
+				std::lock_guard<std::mutex> lock(latchMutex);
+				latchMgr.checkpointAll();
+			}
+			const std::string onDisk = dataFile.readPage(pageNo).getRecord(rid);
+			if (onDisk != std::string(2 * half, onDisk[0]))
+			{
+				torn = true;
+			}
+		}
+		writer.join();
+		if (torn)
+		{
+			PRINT_ERROR("ERROR :: TORN PAGE CHECKPOINTED");
+		}
+
+		//Every change not on disk is at or after the oldest recovery LSN
+		const Lsn diskLsn = dataFile.readPage(pageNo).page_lsn();
+		for (std::size_t c = 0; c < lsns.size(); c++)
+		{
+			if (lsns[c] > diskLsn && (latchMgr.minRecLsn() == 0 || latchMgr.minRecLsn() > lsns[c]))
+			{
+				PRINT_ERROR("ERROR :: CHANGE MISSED BY CHECKPOINT MARKED WRITTEN");
+			}
+		}
+		wal.commit(txn);
+		latchMgr.flushFile(&dataFile);
+	}
+	std::remove(logName.c_str());
+	File::remove(dataName);
+
+	std::cout << "Test 31 passed" << "\n";
+}
+
+void test32()
+{
+	//Background checkpoints run while a writer changes a page under the exclusive latch: no half-changed page reaches
+	//disk, and the redo LSN of the last checkpoint is at or before every change not on disk
+	const std::string logName = "test.wal";
+	const std::string dataName = "test.6";
+	std::remove(logName.c_str());
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	{
+		File dataFile = File::create(dataName);
+		Wal wal(logName);
+		BufMgr ckMgr(8);
+		ckMgr.attachWal(&wal);
+		std::mutex ckMutex;
+		const std::size_t half = 1000;
+		PageId pageNo;
+		RecordId rid;
+		const TxnId txn = wal.begin();
+		{
+			PageGuard guard = ckMgr.allocate(&dataFile);
+			pageNo = guard.page_number();
+			wal.logPage(txn, &dataFile, guard.get());
+			rid = wal.insertRecord(txn, &dataFile, guard.get(), std::string(2 * half, 'a'));
+			guard.markDirty();
+		}
+
+		Checkpointer checkpointer(ckMgr, wal, ckMutex);
+		checkpointer.setBatchSize(1);
+		checkpointer.checkpoint(0);
+		checkpointer.start(1);
+		const int changes = 300;
+		std::vector<Lsn> lsns;
+		std::atomic<bool> finished(false);
+		std::thread writer([&]() {
+			for (int c = 0; c < changes; c++)
+			{
+				const char fill = 'b' + c % 24;
+				PageGuard page;
+				{
+					std::lock_guard<std::mutex> lock(ckMutex);
+					page = ckMgr.fetch(&dataFile, pageNo);
+				}
+				page.latch(LATCH_EXCLUSIVE);
+				const std::string before = page->getRecord(rid);
+				wal.updateRecord(txn, &dataFile, page.get(), rid, std::string(half, fill) + before.substr(half));
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				wal.updateRecord(txn, &dataFile, page.get(), rid, std::string(2 * half, fill));
+				lsns.push_back(page->page_lsn());
+				page.markDirty();
+				std::lock_guard<std::mutex> lock(ckMutex);
+				page.release();
+			}
+			finished = true;
+		});
+		bool torn = false;
+		while (!finished)
+		{
+			const std::string onDisk = dataFile.readPage(pageNo).getRecord(rid);
+			if (onDisk != std::string(2 * half, onDisk[0]))
+			{
+				torn = true;
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+		writer.join();
+		checkpointer.stop();
+		if (torn || checkpointer.stats().checkpoints == 0)
+		{
+			PRINT_ERROR("ERROR :: TORN PAGE WRITTEN BY BACKGROUND CHECKPOINT");
+		}
+
+		const Lsn diskLsn = dataFile.readPage(pageNo).page_lsn();
+		for (std::size_t c = 0; c < lsns.size(); c++)
+		{
+			if (lsns[c] > diskLsn && checkpointer.stats().redo_lsn > lsns[c])
+			{
+				PRINT_ERROR("ERROR :: CHECKPOINT REDO LSN PAST A CHANGE NOT WRITTEN");
+			}
+		}
+		wal.commit(txn);
+		ckMgr.flushFile(&dataFile);
+	}
+	std::remove(logName.c_str());
+	File::remove(dataName);
+
+	std::cout << "Test 32 passed" << "\n";
+}
+
+void test33()
+{
+	//Checkpoints logged while transactions commit never list a committed transaction as active, so recovery
+	//does not roll it back
+	const std::string logName = "test.wal";
+	const std::string dataName = "test.6";
+	std::remove(logName.c_str());
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	const int committers = 4;
+	const int commits = 300;
+	PageId pageNos[committers];
+	RecordId rids[committers];
+	RecoveryStats stats;
+	{
+		File dataFile = File::create(dataName);
+		Wal wal(logName);
+		BufMgr txnMgr(8);
+		txnMgr.attachWal(&wal);
+		std::vector<PageGuard> guards;
+		TxnId txn = wal.begin();
+		for (int t = 0; t < committers; t++)
+		{
+			guards.push_back(txnMgr.allocate(&dataFile));
+			pageNos[t] = guards[t].page_number();
+			wal.logPage(txn, &dataFile, guards[t].get());
+			rids[t] = wal.insertRecord(txn, &dataFile, guards[t].get(), "committed 0");
+			guards[t].markDirty();
+		}
+		wal.commit(txn);
+
+		//Several checkpointing threads, so that one is mostly waiting to append while commits are appended
+		std::atomic<bool> finished(false);
+		std::vector<std::thread> checkpoints;
+		for (int t = 0; t < committers; t++)
+		{
+			checkpoints.push_back(std::thread([&wal, &finished]() {
+				while (!finished)
+				{
+					wal.logCheckpoint(Wal::firstLsn());
+				}
+			}));
+		}
+		//Each thread commits changes to a page of its own
+		std::vector<std::thread> threads;
+		for (int t = 0; t < committers; t++)
+		{
+			threads.push_back(std::thread([&wal, &dataFile, &guards, &rids, t]() {
+				char record[32];
+				for (int c = 1; c <= commits; c++)
+				{
+					const TxnId own = wal.begin();
+					sprintf(record, "committed %d", c);
+					wal.updateRecord(own, &dataFile, guards[t].get(), rids[t], record);
+					wal.commit(own);
+				}
+			}));
+		}
+		for (int t = 0; t < committers; t++)
+		{
+			threads[t].join();
+		}
+		finished = true;
+		for (int t = 0; t < committers; t++)
+		{
+			checkpoints[t].join();
+		}
+
+		//No checkpoint lists a transaction committed before it
+		std::map<TxnId, Lsn> committed;
+		LogRecord record;
+		Lsn next;
+		for (Lsn lsn = Wal::firstLsn(); wal.readRecord(lsn, record, next); lsn = next)
+		{
+			if (record.type == LOG_COMMIT)
+			{
+				committed[record.txn] = lsn;
+			}
+			else if (record.type == LOG_CHECKPOINT)
+			{
+				for (std::map<TxnId, Lsn>::const_iterator it = record.active_txns.begin();
+						it != record.active_txns.end(); ++it)
+				{
+					if (committed.count(it->first) != 0)
+					{
+						PRINT_ERROR("ERROR :: CHECKPOINT LISTS A COMMITTED TRANSACTION");
+					}
+				}
+			}
+		}
+		guards.clear();
+		txnMgr.flushFile(&dataFile);
+	}
+
+	{
+		Wal wal(logName);
+		BufMgr recMgr(8);
+		recMgr.attachWal(&wal);
+		Recovery recovery(wal, recMgr);
+		stats = recovery.run(2);
+		recMgr.flushAll();
+	}
+	{
+		sprintf((char*)tmpbuf, "committed %d", commits);
+		File dataFile = File::open(dataName);
+		for (int t = 0; t < committers; t++)
+		{
+			if (stats.losers != 0 || dataFile.readPage(pageNos[t]).getRecord(rids[t]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: COMMITTED TRANSACTION ROLLED BACK");
+			}
+		}
+	}
+	std::remove(logName.c_str());
+	File::remove(dataName);
+
+	std::cout << "Test 33 passed" << "\n";
+}
+
+void test34()
+{
+	//Evictions write the victim alone by default, and a batch of dirty pages, synced, with setEvictionBatch()
+	const std::string dataName = "test.6";
+	try
+	{
+		File::remove(dataName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	for (int batch = 1; batch <= 4; batch += 3)
+	{
+		{
+			File dataFile = File::create(dataName);
+			PageId pageNos[5];
+			RecordId rids[5];
+			{
+				BufMgr batchMgr(4);
+				if (batch > 1)
+				{
+					batchMgr.setEvictionBatch(batch);
+				}
+				for (int k = 0; k < 5; k++)
+				{
+					batchMgr.allocPage(&dataFile, pageNos[k], page);
+					sprintf((char*)tmpbuf, "batched %d", k);
+					rids[k] = page->insertRecord(tmpbuf);
+					batchMgr.unPinPage(&dataFile, pageNos[k], true);
+				}
+				//Five dirty pages in four frames: the fifth evicts the first, alone or with the other three
+				if (batchMgr.getBufStats().diskwrites != batch)
+				{
+					PRINT_ERROR("ERROR :: EVICTION WROTE THE WRONG NUMBER OF PAGES");
+				}
+				batchMgr.flushFile(&dataFile);
+			}
+			for (int k = 0; k < 5; k++)
+			{
+				sprintf((char*)tmpbuf, "batched %d", k);
+				if (dataFile.readPage(pageNos[k]).getRecord(rids[k]) != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: BATCHED EVICTION LOST A PAGE");
+				}
+			}
+		}
+		File::remove(dataName);
+	}
+
+	std::cout << "Test 34 passed" << "\n";
+}
+
+void test35()
+{
+	//A scan through its own pool leaves the default pool's pages alone, and a pool evicting its most recently used
+	//page keeps the pages it held before the scan, where the clock evicts them
+	const std::string hotName = "test.6";
+	const std::string scanName = "test.7";
+	const int hotPages = 4;
+	const int scanPages = 64;
+	std::remove(hotName.c_str());
+	std::remove(scanName.c_str());
+	{
+		File hotFile = File::create(hotName);
+		File scanFile = File::create(scanName);
+		for (int k = 0; k < hotPages; k++)
+		{
+			hotFile.allocatePage();
+		}
+		for (int k = 0; k < scanPages; k++)
+		{
+			scanFile.allocatePage();
+		}
+
+		for (int mru = 0; mru <= 1; mru++)
+		{
+			const ReplacementPolicy policy = mru ? REPLACE_MRU : REPLACE_CLOCK;
+			PoolRegistry registry(24, 8);
+			BufMgr& scanPool = registry.createPool("scan", 8, 8, policy);
+			if (scanPool.replacementPolicy() != policy ||
+				registry.pool(PoolRegistry::kDefaultPool).replacementPolicy() != REPLACE_CLOCK)
+			{
+				PRINT_ERROR("ERROR :: WRONG REPLACEMENT POLICY");
+			}
+			registry.assign(&scanFile, "scan");
+
+			for (PageId pageNo = 1; pageNo <= hotPages; pageNo++)
+			{
+				registry.readPage(&hotFile, pageNo, page);
+				registry.unPinPage(&hotFile, pageNo, false);
+				registry.readPage(&scanFile, pageNo, page);
+				registry.unPinPage(&scanFile, pageNo, false);
+			}
+			for (PageId pageNo = hotPages + 1; pageNo <= scanPages; pageNo++)
+			{
+				registry.readPage(&scanFile, pageNo, page);
+				registry.unPinPage(&scanFile, pageNo, false);
+			}
+			const int scanReads = registry.getBufStats("scan").diskreads;
+			for (PageId pageNo = 1; pageNo <= hotPages; pageNo++)
+			{
+				registry.readPage(&hotFile, pageNo, page);
+				registry.unPinPage(&hotFile, pageNo, false);
+				registry.readPage(&scanFile, pageNo, page);
+				registry.unPinPage(&scanFile, pageNo, false);
+			}
+			if (registry.getBufStats(PoolRegistry::kDefaultPool).diskreads != hotPages)
+			{
+				PRINT_ERROR("ERROR :: SCAN POOL PUSHED PAGES OUT OF THE DEFAULT POOL");
+			}
+			const int reread = registry.getBufStats("scan").diskreads - scanReads;
+			if (mru ? reread != 0 : reread != hotPages)
+			{
+				PRINT_ERROR("ERROR :: SCAN EVICTED THE WRONG PAGES");
+			}
+
+			//Asking for the pool again with other settings is an error, with the same ones it returns the pool
+			if (&registry.createPool("scan", 8, 8, policy) != &scanPool)
+			{
+				PRINT_ERROR("ERROR :: EXISTING POOL NOT RETURNED");
+			}
+			try
+			{
+				registry.createPool("scan", 4, 8, policy);
+				PRINT_ERROR("ERROR :: Pool created again with other settings but no exception thrown.");
+			}
+			catch(const PoolExistsException &e)
+			{
+			}
+			try
+			{
+				registry.createPool("scan", 8, 8, mru ? REPLACE_CLOCK : REPLACE_MRU);
+				PRINT_ERROR("ERROR :: Pool created again with another policy but no exception thrown.");
+			}
+			catch(const PoolExistsException &e)
+			{
+			}
+			registry.flushAll();
+		}
+	}
+	std::remove(hotName.c_str());
+	std::remove(scanName.c_str());
+
+	std::cout << "Test 35 passed" << "\n";
+}
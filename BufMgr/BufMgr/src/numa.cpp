@@ -0,0 +1,145 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "numa.h"
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace badgerdb {
+
+namespace {
+
+const char* const kNodeDirectory = "/sys/devices/system/node/node";
+
+// From <linux/mempolicy.h>, which clashes with the libc headers.
+const int kMpolPreferred = 1;
+const unsigned kMpolMfMove = 1 << 1;
+
+/**
+ * Parses a CPU list such as "0-3,8,10-11" into <cpus>.
+ */
+void parseCpuList(const std::string& list, std::vector<unsigned>& cpus) {
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    unsigned first;
+    unsigned last;
+    char dash;
+    std::stringstream rs(range);
+    if (!(rs >> first)) {
+      continue;
+    }
+    last = first;
+    if (rs >> dash) {
+      rs >> last;
+    }
+    for (unsigned cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+}
+
+unsigned readNodeCount() {
+  unsigned count = 0;
+  while (std::ifstream((kNodeDirectory + std::to_string(count) +
+                        "/cpulist").c_str())) {
+    ++count;
+  }
+  return count == 0 ? 1 : count;
+}
+
+}
+
+unsigned NumaTopology::nodeCount() {
+  static const unsigned count = readNodeCount();
+  return count;
+}
+
+unsigned NumaTopology::currentNode() {
+  const int cpu = ::sched_getcpu();
+  const std::vector<unsigned>& nodes = cpuNodes();
+  if (cpu < 0 || static_cast<std::size_t>(cpu) >= nodes.size()) {
+    return 0;
+  }
+  return nodes[cpu];
+}
+
+bool NumaTopology::bindMemory(void* address, const std::size_t length,
+                              const unsigned node) {
+  if (node >= nodeCount() || node >= 64) {
+    return false;
+  }
+  // mbind works on whole pages only, so shrink the range to those.
+  const std::uintptr_t page = ::sysconf(_SC_PAGESIZE);
+  const std::uintptr_t start =
+      (reinterpret_cast<std::uintptr_t>(address) + page - 1) / page * page;
+  const std::uintptr_t end =
+      (reinterpret_cast<std::uintptr_t>(address) + length) / page * page;
+  if (end <= start) {
+    return false;
+  }
+  const unsigned long mask = 1UL << node;
+  return ::syscall(SYS_mbind, start, end - start, kMpolPreferred, &mask,
+                   sizeof(mask) * 8, kMpolMfMove) == 0;
+}
+
+const std::vector<unsigned>& NumaTopology::cpuNodes() {
+  static const std::vector<unsigned> nodes = readCpuNodes();
+  return nodes;
+}
+
+std::vector<unsigned> NumaTopology::readCpuNodes() {
+  std::vector<unsigned> nodes;
+  for (unsigned node = 0; node < nodeCount(); ++node) {
+    std::ifstream file((kNodeDirectory + std::to_string(node) +
+                        "/cpulist").c_str());
+    std::string list;
+    std::getline(file, list);
+    std::vector<unsigned> cpus;
+    parseCpuList(list, cpus);
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+      if (cpus[i] >= nodes.size()) {
+        nodes.resize(cpus[i] + 1, 0);
+      }
+      nodes[cpus[i]] = node;
+    }
+  }
+  if (nodes.empty()) {
+    nodes.push_back(0);
+  }
+  return nodes;
+}
+
+NodeAffinity::NodeAffinity(const unsigned node) : pinned_(false) {
+  if (node >= NumaTopology::nodeCount() || NumaTopology::nodeCount() == 1 ||
+      ::sched_getaffinity(0, sizeof(saved_), &saved_) != 0) {
+    return;
+  }
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  const std::vector<unsigned>& nodes = NumaTopology::cpuNodes();
+  for (std::size_t cpu = 0; cpu < nodes.size() && cpu < CPU_SETSIZE; ++cpu) {
+    if (nodes[cpu] == node) {
+      CPU_SET(cpu, &cpus);
+    }
+  }
+  pinned_ = ::sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+NodeAffinity::~NodeAffinity() {
+  if (pinned_) {
+    ::sched_setaffinity(0, sizeof(saved_), &saved_);
+  }
+}
+
+}
@@ -0,0 +1,78 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <sched.h>
+
+namespace badgerdb {
+
+/**
+ * @brief NUMA layout of the machine, read from /sys/devices/system/node.
+ *
+ * Machines without NUMA support (or without sysfs) look like a single node
+ * holding every CPU.  Memory policies are set through the mbind system call
+ * directly, so no NUMA library is needed.
+ */
+class NumaTopology {
+ public:
+  /**
+   * Returns the number of NUMA nodes of the machine (at least 1).
+   */
+  static unsigned nodeCount();
+
+  /**
+   * Returns the node of the CPU the calling thread runs on.
+   */
+  static unsigned currentNode();
+
+  /**
+   * Asks the kernel to keep the memory pages wholly inside the given range on
+   * <node>, moving those already allocated.  Best effort: returns false if
+   * the kernel refused.
+   *
+   * @param address   Start of the range.
+   * @param length    Length of the range in bytes.
+   * @param node      Node to keep the memory on.
+   */
+  static bool bindMemory(void* address, const std::size_t length,
+                         const unsigned node);
+
+ private:
+  /**
+   * Node of every CPU, indexed by CPU number; read once.
+   */
+  static const std::vector<unsigned>& cpuNodes();
+  static std::vector<unsigned> readCpuNodes();
+
+  friend class NodeAffinity;
+};
+
+/**
+ * @brief Runs the calling thread on the CPUs of one node while in scope, so
+ *        that memory it touches first is allocated on that node.
+ *
+ * The previous CPU affinity is restored on destruction.  Nodes the machine
+ * does not have leave the affinity alone.
+ */
+class NodeAffinity {
+ public:
+  explicit NodeAffinity(const unsigned node);
+  ~NodeAffinity();
+
+ private:
+  NodeAffinity(const NodeAffinity&);
+  NodeAffinity& operator=(const NodeAffinity&);
+
+  cpu_set_t saved_;
+  bool pinned_;
+};
+
+}
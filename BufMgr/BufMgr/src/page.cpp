@@ -10,6 +10,10 @@
  */
 
 #include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#include "crc32c.h"
 
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
@@ -31,7 +35,33 @@ void Page::initialize() {
   header_.num_free_slots = 0;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
-  data_.assign(DATA_SIZE, char());
+  header_.page_lsn = 0;
+  header_.checksum = 0;
+  std::memset(data_, 0, DATA_SIZE);
+}
+
+namespace {
+
+/**
+ * Checksum of the page with the checksum field and the padding after it left
+ * out, never 0, which marks a page without one.
+ */
+std::uint32_t pageChecksum(const PageHeader& header, const char* data) {
+  std::uint32_t crc =
+      Crc32c::compute(&header, offsetof(PageHeader, checksum));
+  crc = Crc32c::compute(data, Page::DATA_SIZE, crc);
+  return crc != 0 ? crc : 1;
+}
+
+}
+
+void Page::updateChecksum() {
+  header_.checksum = pageChecksum(header_, data_);
+}
+
+bool Page::verifyChecksum() const {
+  return header_.checksum == 0 ||
+         header_.checksum == pageChecksum(header_, data_);
 }
 
 RecordId Page::insertRecord(const std::string& record_data) {
@@ -44,10 +74,37 @@ RecordId Page::insertRecord(const std::string& record_data) {
   return {page_number(), slot_number};
 }
 
+void Page::insertRecordAt(const SlotId slot_number,
+                          const std::string& record_data) {
+  if (slot_number == INVALID_SLOT) {
+    throw InvalidSlotException(page_number(), slot_number);
+  }
+  std::size_t record_size = record_data.length();
+  if (slot_number > header_.num_slots) {
+    record_size += sizeof(PageSlot) * (slot_number - header_.num_slots);
+  }
+  if (record_size > getFreeSpace()) {
+    throw InsufficientSpaceException(
+        page_number(), record_data.length(), getFreeSpace());
+  }
+  // Grow the slot array up to the slot, as getAvailableSlot() does one slot at
+  // a time; the new slots are free.
+  while (header_.num_slots < slot_number) {
+    PageSlot* slot = getSlot(header_.num_slots + 1);
+    slot->used = false;
+    slot->item_offset = 0;
+    slot->item_length = 0;
+    ++header_.num_slots;
+    ++header_.num_free_slots;
+    header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
+  }
+  insertRecordInSlot(slot_number, record_data);
+}
+
 std::string Page::getRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-  return data_.substr(slot.item_offset, slot.item_length);
+  return std::string(data_ + slot.item_offset, slot.item_length);
 }
 
 void Page::updateRecord(const RecordId& record_id,
@@ -75,7 +132,7 @@ void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
   PageSlot* slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
+  std::memset(data_ + slot->item_offset, 0, slot->item_length);
 
   // Compact the data by removing the hole left by this record (if necessary).
   std::uint16_t move_offset = slot->item_offset; 
@@ -94,8 +151,8 @@ void Page::deleteRecord(const RecordId& record_id,
   }
   // If we have data to move, shift it to the right.
   if (move_bytes > 0) {
-    const std::string& data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+    std::memmove(data_ + move_offset + slot->item_length, data_ + move_offset,
+                 move_bytes);
   }
   header_.free_space_upper_bound += slot->item_length;
 
@@ -158,8 +215,13 @@ SlotId Page::getAvailableSlot() {
       }
     }
   } else {
-    // Have to allocate a new slot.
+    // Have to allocate a new slot.  Its bytes may hold record data from
+    // before slots at the end were freed, so clear it.
     slot_number = header_.num_slots + 1;
+    PageSlot* slot = getSlot(slot_number);
+    slot->used = false;
+    slot->item_offset = 0;
+    slot->item_length = 0;
     ++header_.num_slots;
     ++header_.num_free_slots;
     header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
@@ -184,17 +246,27 @@ void Page::insertRecordInSlot(const SlotId slot_number,
   slot->item_offset = header_.free_space_upper_bound - record_length;
   header_.free_space_upper_bound = slot->item_offset;
   --header_.num_free_slots;
-  data_.replace(slot->item_offset, slot->item_length, record_data);
+  std::memcpy(data_ + slot->item_offset, record_data.data(), slot->item_length);
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
   if (record_id.page_number != page_number()) {
     throw InvalidRecordException(record_id, page_number());
   }
+  if (record_id.slot_number == INVALID_SLOT ||
+      record_id.slot_number > header_.num_slots ||
+      header_.num_slots * sizeof(PageSlot) > DATA_SIZE) {
+    throw InvalidRecordException(record_id, page_number());
+  }
   const PageSlot& slot = getSlot(record_id.slot_number);
   if (!slot.used) {
     throw InvalidRecordException(record_id, page_number());
   }
+  // A damaged slot must not send reads or writes outside the record area
+  if (slot.item_offset < header_.num_slots * sizeof(PageSlot) ||
+      slot.item_offset + std::size_t(slot.item_length) > DATA_SIZE) {
+    throw InvalidRecordException(record_id, page_number());
+  }
 }
 
 PageIterator Page::begin() {
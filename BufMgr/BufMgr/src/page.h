@@ -57,6 +57,18 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * LSN of the write-ahead log record of the last change made to the page, or
+   * 0 if no change was logged.
+   */
+  Lsn page_lsn;
+
+  /**
+   * CRC-32C checksum of the page as last written to disk, or 0 if the page
+   * was written without one.  Last, so that it covers everything before it.
+   */
+  std::uint32_t checksum;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -140,6 +152,21 @@ class Page {
    */
   RecordId insertRecord(const std::string& record_data);
 
+  /**
+   * Inserts a record into the given slot, which must not be in use.  Slots up
+   * to it are allocated first if the slot array is shorter.  Used to put a
+   * record back under the ID it had, as undoing a delete does.
+   *
+   * @param slot_number  Number of slot to insert the record into.
+   * @param record_data  Bytes that compose the record.
+   * @throws  InsufficientSpaceException  If the record and any new slots do
+   *                                      not fit.
+   * @throws  InvalidSlotException  If the slot number is INVALID_SLOT.
+   * @throws  SlotInUseException    If the slot holds a record.
+   */
+  void insertRecordAt(const SlotId slot_number,
+                      const std::string& record_data);
+
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
    * stored on the page; use updateRecord to change it.
@@ -199,6 +226,38 @@ class Page {
    */
   PageId next_page_number() const { return header_.next_page_number; }
 
+  /**
+   * Returns the LSN of the log record of the last change made to this page.
+   *
+   * @return  Page LSN, or 0 if no change was logged.
+   */
+  Lsn page_lsn() const { return header_.page_lsn; }
+
+  /**
+   * Sets the LSN of the log record of the last change made to this page.
+   * Called by whoever logs the change, before the page is unpinned.
+   *
+   * @param lsn   LSN of the log record.
+   */
+  void set_page_lsn(const Lsn lsn) { header_.page_lsn = lsn; }
+
+  /**
+   * Stores the checksum of the page as it is now in its header, as File does
+   * before writing the page.
+   */
+  void updateChecksum();
+
+  /**
+   * Stores 0 as the checksum of the page: the page is not checked when read.
+   */
+  void clearChecksum() { header_.checksum = 0; }
+
+  /**
+   * Returns true if the page has no checksum or matches the one stored by
+   * updateChecksum().
+   */
+  bool verifyChecksum() const;
+
   /**
    * Returns an iterator at the first record in the page.
    *
@@ -309,7 +368,8 @@ class Page {
    *
    * @param record_id   Record ID to validate.
    * @throws  InvalidRecordException  Thrown if the ID has a bad page or slot
-   *                                  number.
+   *                                  number, or the slot points outside the
+   *                                  record area of the page.
    */
   void validateRecordId(const RecordId& record_id) const;
 
@@ -327,20 +387,25 @@ class Page {
 
   /**
    * Data stored on the page.  Includes bookkeeping information about slots as
-   * well as actual content.
+   * well as actual content.  Kept inline after the header, so that a Page is
+   * laid out in memory exactly as it is stored on disk.
    */
-
-  std::string data_;
+  char data_[DATA_SIZE];
 
   friend class File;
   friend class PageIterator;
   friend class PageTest;
   friend class BufferTest;
+  friend class BTreeIndex;
+  friend class HashIndex;
+  friend class HeapFile;
 };
 
 static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(sizeof(Page) == Page::SIZE,
+              "Page must be laid out in memory exactly as on disk.");
 
 }
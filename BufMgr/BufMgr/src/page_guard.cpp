@@ -0,0 +1,137 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_guard.h"
+
+#include "buffer.h"
+#include "exceptions/read_only_file_exception.h"
+
+namespace badgerdb {
+
+PageGuard::PageGuard()
+    : buf_mgr_(NULL),
+      file_(NULL),
+      page_number_(Page::INVALID_NUMBER),
+      frame_(0),
+      page_(NULL),
+      dirty_(false),
+      latch_(NULL),
+      mode_(LATCH_NONE) {
+}
+
+PageGuard::PageGuard(BufMgr* buf_mgr, File* file, const PageId page_number,
+                     const FrameId frame, Page* page)
+    : buf_mgr_(buf_mgr),
+      file_(file),
+      page_number_(page_number),
+      frame_(frame),
+      page_(page),
+      dirty_(false),
+      latch_(file->isMapped() ? NULL : &buf_mgr->frameLatch(frame)),
+      mode_(LATCH_NONE) {
+}
+
+PageGuard::PageGuard(PageGuard&& other)
+    : buf_mgr_(other.buf_mgr_),
+      file_(other.file_),
+      page_number_(other.page_number_),
+      frame_(other.frame_),
+      page_(other.page_),
+      dirty_(other.dirty_),
+      latch_(other.latch_),
+      mode_(other.mode_) {
+  other.page_ = NULL;
+  other.mode_ = LATCH_NONE;
+}
+
+PageGuard& PageGuard::operator=(PageGuard&& other) {
+  if (this != &other) {
+    release();
+    buf_mgr_ = other.buf_mgr_;
+    file_ = other.file_;
+    page_number_ = other.page_number_;
+    frame_ = other.frame_;
+    page_ = other.page_;
+    dirty_ = other.dirty_;
+    latch_ = other.latch_;
+    mode_ = other.mode_;
+    other.page_ = NULL;
+    other.mode_ = LATCH_NONE;
+  }
+  return *this;
+}
+
+PageGuard::~PageGuard() {
+  release();
+}
+
+void PageGuard::markDirty() {
+  if (file_->isMapped()) {
+    throw ReadOnlyFileException(file_->filename());
+  }
+  dirty_ = true;
+}
+
+void PageGuard::latch(const LatchMode mode) {
+  unlatch();
+  if (latch_ == NULL) {
+    return;
+  }
+  if (mode == LATCH_SHARED) {
+    latch_->lockShared();
+  } else if (mode == LATCH_EXCLUSIVE) {
+    latch_->lockExclusive();
+  }
+  mode_ = mode;
+}
+
+void PageGuard::unlatch() {
+  if (mode_ == LATCH_SHARED) {
+    latch_->unlockShared();
+  } else if (mode_ == LATCH_EXCLUSIVE) {
+    latch_->unlockExclusive();
+  }
+  mode_ = LATCH_NONE;
+}
+
+void PageGuard::release() {
+  if (page_ == NULL) {
+    return;
+  }
+  unlatch();
+  page_ = NULL;
+  if (file_->isMapped()) {
+    buf_mgr_->unPinPage(file_, page_number_, false);
+  } else {
+    buf_mgr_->unPinFrame(frame_, dirty_);
+  }
+}
+
+PageLatch::PageLatch(const PageGuard& guard, const LatchMode mode)
+    : latch_(guard.latch_), mode_(mode) {
+  if (latch_ == NULL) {
+    return;
+  }
+  if (mode_ == LATCH_SHARED) {
+    latch_->lockShared();
+  } else if (mode_ == LATCH_EXCLUSIVE) {
+    latch_->lockExclusive();
+  }
+}
+
+PageLatch::~PageLatch() {
+  if (latch_ == NULL) {
+    return;
+  }
+  if (mode_ == LATCH_SHARED) {
+    latch_->unlockShared();
+  } else if (mode_ == LATCH_EXCLUSIVE) {
+    latch_->unlockExclusive();
+  }
+}
+
+}
@@ -0,0 +1,227 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "file.h"
+#include "frame_latch.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+
+/**
+ * @brief Handle on a page pinned in the buffer pool, returned by
+ *        BufMgr::fetch() and BufMgr::allocate().
+ *
+ * The page stays pinned as long as the guard holds it and is unpinned when
+ * the guard is destroyed or release() is called, marked dirty if markDirty()
+ * was called.  Guards can be moved but not copied, so every pin is released
+ * exactly once.  The guard remembers the frame holding the page, so
+ * unpinning does not look the page up in the hash table again.
+ *
+ * A guard may also hold the frame's latch (see FrameLatch), shared or
+ * exclusive, which it lets go of before unpinning.  Threads sharing a page
+ * pinned once by a guard latch it with PageLatch, or read it optimistically
+ * with readOptimistic().
+ *
+ * An empty guard (default constructed or moved from) holds no page.  The
+ * page of a guard must not also be unpinned with BufMgr::unPinPage().
+ */
+class PageGuard {
+ public:
+  /**
+   * Constructs an empty guard.
+   */
+  PageGuard();
+
+  /**
+   * Takes over the page held by <other>, leaving it empty.
+   */
+  PageGuard(PageGuard&& other);
+
+  /**
+   * Releases the page held, then takes over the page held by <other>,
+   * leaving it empty.
+   */
+  PageGuard& operator=(PageGuard&& other);
+
+  /**
+   * Releases the page held, if any.
+   */
+  ~PageGuard();
+
+  /**
+   * Returns true if the guard holds a page.
+   */
+  explicit operator bool() const { return page_ != NULL; }
+
+  /**
+   * Returns the page held, or NULL if the guard is empty.
+   */
+  Page* get() const { return page_; }
+
+  Page* operator->() const { return page_; }
+  Page& operator*() const { return *page_; }
+
+  /**
+   * Returns the file of the page held.
+   */
+  File* file() const { return file_; }
+
+  /**
+   * Returns the number of the page held.
+   */
+  PageId page_number() const { return page_number_; }
+
+  /**
+   * Marks the page held as changed, so it is unpinned dirty.
+   *
+   * @throws  ReadOnlyFileException  If the page is of a mapped file.
+   */
+  void markDirty();
+
+  /**
+   * Returns the mode the guard holds the frame's latch in.
+   */
+  LatchMode latchMode() const { return mode_; }
+
+  /**
+   * Takes the frame's latch in <mode>, letting go of the one the guard
+   * holds first, if any.  The page may change while it is not latched.
+   */
+  void latch(const LatchMode mode);
+
+  /**
+   * Lets go of the frame's latch, keeping the page pinned.
+   */
+  void unlatch();
+
+  /**
+   * Unpins the page held now and empties the guard.  Does nothing if the
+   * guard is empty.
+   */
+  void release();
+
+  /**
+   * Calls <read> with the page without latching it, and again until no
+   * writer changed the page while it ran; after a few failed attempts, the
+   * page is latched shared for the last call.  <read> may see the page half
+   * written, so it must only keep what it read in variables it sets afresh
+   * on every call, and must not follow what it read into other memory
+   * without checking it.  Exceptions thrown by <read> on a page that changed
+   * under it are ignored.
+   *
+   * @param read  Function called as read(const Page&).
+   */
+  template <typename ReadFunction>
+  void readOptimistic(ReadFunction read) const;
+
+ private:
+  friend class BufMgr;
+  friend class PageLatch;
+
+  /**
+   * Optimistic reads tried before readOptimistic() latches the page.
+   */
+  static const int kOptimisticAttempts = 4;
+
+  PageGuard(BufMgr* buf_mgr, File* file, const PageId page_number,
+            const FrameId frame, Page* page);
+
+  PageGuard(const PageGuard&);
+  PageGuard& operator=(const PageGuard&);
+
+  /**
+   * Buffer manager the page is pinned in.
+   */
+  BufMgr* buf_mgr_;
+
+  /**
+   * File and number of the page held.
+   */
+  File* file_;
+  PageId page_number_;
+
+  /**
+   * Frame holding the page (unused for pages of mapped files).
+   */
+  FrameId frame_;
+
+  /**
+   * The page held, or NULL.
+   */
+  Page* page_;
+
+  /**
+   * True if the page is to be unpinned dirty.
+   */
+  bool dirty_;
+
+  /**
+   * Latch of the frame, or NULL for pages of mapped files, and the mode the
+   * guard holds it in.
+   */
+  FrameLatch* latch_;
+  LatchMode mode_;
+};
+
+/**
+ * @brief Latch on the page of a PageGuard, held while in scope.
+ *
+ * Lets several threads work on a page pinned once: each latches it shared to
+ * read or exclusive to write, without pinning it again.  The guard must
+ * outlive the latch.
+ */
+class PageLatch {
+ public:
+  /**
+   * Takes the latch of the guard's page in <mode>.
+   */
+  PageLatch(const PageGuard& guard, const LatchMode mode);
+
+  /**
+   * Lets go of the latch.
+   */
+  ~PageLatch();
+
+ private:
+  PageLatch(const PageLatch&);
+  PageLatch& operator=(const PageLatch&);
+
+  FrameLatch* latch_;
+  LatchMode mode_;
+};
+
+template <typename ReadFunction>
+void PageGuard::readOptimistic(ReadFunction read) const {
+  if (latch_ == NULL || mode_ != LATCH_NONE) {
+    // Not written to, or latched by this guard already.
+    read(static_cast<const Page&>(*page_));
+    return;
+  }
+  for (int attempt = 0; attempt < kOptimisticAttempts; ++attempt) {
+    const std::uint64_t version = latch_->readVersion();
+    try {
+      read(static_cast<const Page&>(*page_));
+    } catch (...) {
+      if (latch_->validate(version)) {
+        throw;
+      }
+      continue;
+    }
+    if (latch_->validate(version)) {
+      return;
+    }
+  }
+  PageLatch shared(*this, LATCH_SHARED);
+  read(static_cast<const Page&>(*page_));
+}
+
+}
@@ -0,0 +1,200 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_map.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Bytes and sectors of a chunk of the map on disk.
+ */
+const std::size_t kChunkBytes = PageMap::CHUNK_ENTRIES * sizeof(PageExtent);
+const std::uint32_t kChunkSectors = kChunkBytes / PageMap::SECTOR_SIZE;
+
+static_assert(kChunkBytes % PageMap::SECTOR_SIZE == 0,
+              "Chunks of the page map must be whole sectors.");
+static_assert(PageMap::DIRECTORY_OFFSET +
+                  PageMap::MAX_CHUNKS * sizeof(std::uint32_t) <= 4096,
+              "The chunk directory must fit in the header block.");
+
+bool lessBySector(const PageExtent& a, const PageExtent& b) {
+  return a.sector < b.sector;
+}
+
+/**
+ * Reads <length> bytes at <offset>; bytes past the end of the file read as
+ * zeros.
+ */
+void readFully(const int fd, char* buffer, const std::size_t length,
+               const off_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pread(fd, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException("pread", errno);
+    }
+    if (n == 0) {
+      std::memset(buffer + done, 0, length - done);
+      return;
+    }
+    done += n;
+  }
+}
+
+void writeFully(const int fd, const char* buffer, const std::size_t length,
+                const off_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pwrite(fd, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException("pwrite", errno);
+    }
+    if (n == 0) {
+      throw IoException("pwrite", 0 /* short transfer */);
+    }
+    done += n;
+  }
+}
+
+}
+
+PageMap::PageMap(const int fd, const std::uint32_t first_sector)
+    : fd_(fd),
+      first_sector_(first_sector),
+      end_sector_(first_sector),
+      dirty_directory_(false),
+      stored_sectors_(0) {}
+
+void PageMap::load() {
+  std::vector<std::uint32_t> directory(MAX_CHUNKS);
+  readFully(fd_, reinterpret_cast<char*>(&directory[0]),
+            MAX_CHUNKS * sizeof(std::uint32_t), DIRECTORY_OFFSET);
+  chunks_.clear();
+  entries_.clear();
+  std::vector<PageExtent> used;
+  for (std::uint32_t c = 0; c < MAX_CHUNKS && directory[c] != 0; ++c) {
+    chunks_.push_back(directory[c]);
+    entries_.resize(chunks_.size() * CHUNK_ENTRIES);
+    readFully(fd_, reinterpret_cast<char*>(&entries_[c * CHUNK_ENTRIES]),
+              kChunkBytes, off_t(directory[c]) * SECTOR_SIZE);
+    const PageExtent chunk = {directory[c], kChunkSectors};
+    used.push_back(chunk);
+  }
+  stored_sectors_ = 0;
+  for (std::size_t p = 0; p < entries_.size(); ++p) {
+    if (entries_[p].sectors > 0) {
+      used.push_back(entries_[p]);
+      stored_sectors_ += entries_[p].sectors;
+    }
+  }
+
+  // Whatever lies between the chunks and slots is free
+  std::sort(used.begin(), used.end(), lessBySector);
+  free_runs_.clear();
+  released_.clear();
+  end_sector_ = first_sector_;
+  for (std::size_t u = 0; u < used.size(); ++u) {
+    if (used[u].sector > end_sector_) {
+      free_runs_.insert(
+          std::make_pair(used[u].sector - end_sector_, end_sector_));
+    }
+    end_sector_ = std::max(end_sector_, used[u].sector + used[u].sectors);
+  }
+  dirty_chunks_.clear();
+  dirty_directory_ = false;
+}
+
+PageExtent PageMap::place(const PageId page_number,
+                          const std::uint32_t sectors) {
+  const std::uint32_t chunk = page_number / CHUNK_ENTRIES;
+  if (chunk >= MAX_CHUNKS) {
+    throw IoException("page map", EFBIG);
+  }
+  while (chunks_.size() <= chunk) {
+    chunks_.push_back(allocate(kChunkSectors));
+    entries_.resize(chunks_.size() * CHUNK_ENTRIES);
+    dirty_chunks_.insert(static_cast<std::uint32_t>(chunks_.size() - 1));
+    dirty_directory_ = true;
+  }
+  PageExtent& entry = entries_[page_number];
+  if (entry.sectors >= sectors) {
+    return entry;
+  }
+  if (entry.sectors > 0) {
+    // Still the page's slot in the map on disk
+    released_.push_back(entry);
+    stored_sectors_ -= entry.sectors;
+  }
+  entry.sector = allocate(sectors);
+  entry.sectors = sectors;
+  stored_sectors_ += sectors;
+  dirty_chunks_.insert(chunk);
+  return entry;
+}
+
+void PageMap::flush() {
+  if (dirty_chunks_.empty() && !dirty_directory_ && released_.empty()) {
+    return;
+  }
+  for (std::set<std::uint32_t>::const_iterator c = dirty_chunks_.begin();
+       c != dirty_chunks_.end(); ++c) {
+    writeFully(fd_, reinterpret_cast<const char*>(&entries_[*c * CHUNK_ENTRIES]),
+               kChunkBytes, off_t(chunks_[*c]) * SECTOR_SIZE);
+  }
+  if (dirty_directory_) {
+    writeFully(fd_, reinterpret_cast<const char*>(&chunks_[0]),
+               chunks_.size() * sizeof(std::uint32_t), DIRECTORY_OFFSET);
+  }
+  if (::fdatasync(fd_) != 0) {
+    throw IoException("fdatasync", errno);
+  }
+  dirty_chunks_.clear();
+  dirty_directory_ = false;
+  for (std::size_t r = 0; r < released_.size(); ++r) {
+    release(released_[r]);
+  }
+  released_.clear();
+}
+
+std::uint32_t PageMap::allocate(const std::uint32_t sectors) {
+  std::multimap<std::uint32_t, std::uint32_t>::iterator run =
+      free_runs_.lower_bound(sectors);
+  if (run == free_runs_.end()) {
+    const std::uint32_t sector = end_sector_;
+    end_sector_ += sectors;
+    return sector;
+  }
+  const std::uint32_t length = run->first;
+  const std::uint32_t sector = run->second;
+  free_runs_.erase(run);
+  if (length > sectors) {
+    free_runs_.insert(std::make_pair(length - sectors, sector + sectors));
+  }
+  return sector;
+}
+
+void PageMap::release(const PageExtent& extent) {
+  free_runs_.insert(std::make_pair(extent.sectors, extent.sector));
+}
+
+}
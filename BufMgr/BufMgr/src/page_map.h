@@ -0,0 +1,170 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Place of a stored page in a compressed file, in sectors.
+ */
+struct PageExtent {
+  /**
+   * First sector, counted from the start of the file.
+   */
+  std::uint32_t sector;
+
+  /**
+   * Number of sectors, 0 if the page has never been stored.
+   */
+  std::uint32_t sectors;
+};
+
+/**
+ * @brief Page-offset map of a compressed file: where each page is stored.
+ *
+ * A compressed file stores every page in a slot of whole sectors, as few as
+ * its compressed length needs, anywhere after the header block.  A page
+ * written back is stored in its slot again if it still fits, and otherwise
+ * moves to a new one; the old slot is freed once the map saying so is on
+ * disk (flush()), so that until then the map on disk still points at a whole
+ * copy of the page.  Free sectors are not recorded on disk: they are the
+ * gaps between the slots in the map, found again by load().
+ *
+ * On disk, the map is kept in chunks of CHUNK_ENTRIES entries, each one
+ * sector-aligned block anywhere in the file, located through a directory in
+ * the header block of the file, after the FileHeader.
+ *
+ * @warning This class is not threadsafe.
+ */
+class PageMap {
+ public:
+  /**
+   * Unit of the slots of stored pages.
+   */
+  static const std::size_t SECTOR_SIZE = 512;
+
+  /**
+   * Number of pages a chunk of the map on disk covers.
+   */
+  static const std::uint32_t CHUNK_ENTRIES = 512;
+
+  /**
+   * Offset of the chunk directory in the header block, and the number of
+   * chunks it has room for; this limits a compressed file to
+   * MAX_CHUNKS * CHUNK_ENTRIES pages.
+   */
+  static const std::size_t DIRECTORY_OFFSET = 64;
+  static const std::uint32_t MAX_CHUNKS = 1008;
+
+  /**
+   * Creates the map of a file.
+   *
+   * @param fd          Descriptor of the file, read and written with pread()
+   *                    and pwrite().
+   * @param first_sector  First sector after the header block of the file.
+   */
+  PageMap(const int fd, const std::uint32_t first_sector);
+
+  /**
+   * Reads the map from the file.
+   *
+   * @throws  IoException  If the file cannot be read.
+   */
+  void load();
+
+  /**
+   * Returns the slot of a page, with no sectors if it has none.
+   */
+  PageExtent find(const PageId page_number) const {
+    return page_number < entries_.size() ? entries_[page_number]
+                                         : PageExtent();
+  }
+
+  /**
+   * Returns the slot to store a page of <sectors> sectors in: its own slot if
+   * it fits there, or else a new one, which the map then records.
+   *
+   * @throws  IoException  If the file has grown to more pages than the map
+   *                       has room for (EFBIG).
+   */
+  PageExtent place(const PageId page_number, const std::uint32_t sectors);
+
+  /**
+   * Writes the parts of the map changed since the last flush() to the file,
+   * syncs it, and frees the slots pages moved out of.
+   *
+   * @throws  IoException  If the file cannot be written or synced.
+   */
+  void flush();
+
+  /**
+   * Returns the number of sectors in slots of pages.
+   */
+  std::uint64_t storedSectors() const { return stored_sectors_; }
+
+ private:
+  PageMap(const PageMap&);
+  PageMap& operator=(const PageMap&);
+
+  /**
+   * Takes <sectors> free sectors, the smallest run of free sectors that has
+   * them or else from the end of the file.
+   */
+  std::uint32_t allocate(const std::uint32_t sectors);
+
+  /**
+   * Returns sectors to the free runs.
+   */
+  void release(const PageExtent& extent);
+
+  int fd_;
+
+  std::uint32_t first_sector_;
+
+  /**
+   * Sector after the last one used.
+   */
+  std::uint32_t end_sector_;
+
+  /**
+   * Slot of each page, indexed by page number, for all pages the chunks
+   * cover.
+   */
+  std::vector<PageExtent> entries_;
+
+  /**
+   * Sector of each chunk, indexed by chunk number.
+   */
+  std::vector<std::uint32_t> chunks_;
+
+  /**
+   * Chunks changed since the last flush(), and whether a chunk has been
+   * added to the directory.
+   */
+  std::set<std::uint32_t> dirty_chunks_;
+  bool dirty_directory_;
+
+  /**
+   * Runs of free sectors, by length, and slots that become free at the next
+   * flush().
+   */
+  std::multimap<std::uint32_t, std::uint32_t> free_runs_;
+  std::vector<PageExtent> released_;
+
+  std::uint64_t stored_sectors_;
+};
+
+}
@@ -0,0 +1,139 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pool_memory.h"
+
+#include <cstdint>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+const int kShift2Mb = 21;
+const int kShift1Gb = 30;
+
+std::size_t roundUp(const std::size_t length, const std::size_t unit) {
+  return (length + unit - 1) / unit * unit;
+}
+
+}
+
+PoolMemory::PoolMemory(const std::size_t length, const PoolPageSize page_size,
+                       const std::size_t capacity)
+    : reservation_(NULL),
+      reservation_length_(0),
+      base_(NULL),
+      length_(0),
+      capacity_(0),
+      backing_(page_size) {
+  // Try the page size asked for, then every smaller one.
+  for (int backing = page_size; backing >= POOL_SMALL_PAGES; --backing) {
+    backing_ = static_cast<PoolPageSize>(backing);
+    if (!reserve(capacity > length ? capacity : length) &&
+        !reserve(length)) {
+      continue;
+    }
+    if (resize(length)) {
+      return;
+    }
+    ::munmap(reservation_, reservation_length_);
+    reservation_ = NULL;
+  }
+  throw std::bad_alloc();
+}
+
+PoolMemory::~PoolMemory() {
+  ::munmap(reservation_, reservation_length_);
+}
+
+bool PoolMemory::resize(const std::size_t length) {
+  const std::size_t target = roundUp(length, unit());
+  if (target > capacity_) {
+    return false;
+  }
+  if (target > length_) {
+    if (!commit(length_, target)) {
+      return false;
+    }
+  } else if (target < length_) {
+    decommit(target, length_);
+  }
+  length_ = target;
+  return true;
+}
+
+std::size_t PoolMemory::unit() const {
+  switch (backing_) {
+    case POOL_HUGE_PAGES_1GB:
+      return std::size_t(1) << kShift1Gb;
+    case POOL_HUGE_PAGES_2MB:
+    case POOL_TRANSPARENT_HUGE_PAGES:
+      // Transparent huge pages only back 2 MB-aligned stretches.
+      return std::size_t(1) << kShift2Mb;
+    default:
+      return ::sysconf(_SC_PAGESIZE);
+  }
+}
+
+bool PoolMemory::reserve(const std::size_t capacity) {
+  const std::size_t aligned_capacity = roundUp(capacity, unit());
+  const std::size_t length = aligned_capacity + unit();
+  void* reservation = ::mmap(NULL, length, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                             -1, 0);
+  if (reservation == MAP_FAILED) {
+    return false;
+  }
+  reservation_ = reservation;
+  reservation_length_ = length;
+  base_ = reinterpret_cast<char*>(
+      roundUp(reinterpret_cast<std::uintptr_t>(reservation), unit()));
+  length_ = 0;
+  capacity_ = aligned_capacity;
+  return true;
+}
+
+bool PoolMemory::commit(const std::size_t from, const std::size_t to) {
+  if (backing_ == POOL_HUGE_PAGES_2MB || backing_ == POOL_HUGE_PAGES_1GB) {
+    const int shift =
+        backing_ == POOL_HUGE_PAGES_1GB ? kShift1Gb : kShift2Mb;
+    void* mapped = ::mmap(base_ + from, to - from, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED |
+                              MAP_HUGETLB | (shift << MAP_HUGE_SHIFT),
+                          -1, 0);
+    if (mapped == MAP_FAILED) {
+      decommit(from, to);
+      return false;
+    }
+    return true;
+  }
+  if (::mprotect(base_ + from, to - from, PROT_READ | PROT_WRITE) != 0) {
+    return false;
+  }
+#ifdef MADV_HUGEPAGE
+  if (backing_ == POOL_TRANSPARENT_HUGE_PAGES) {
+    ::madvise(base_ + from, to - from, MADV_HUGEPAGE);
+  }
+#endif
+  return true;
+}
+
+void PoolMemory::decommit(const std::size_t from, const std::size_t to) {
+  // A fresh reservation on top drops the pages of the old mapping.
+  ::mmap(base_ + from, to - from, PROT_NONE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+}
+
+}
@@ -0,0 +1,140 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * @brief Size of the virtual memory pages backing a memory area.
+ */
+enum PoolPageSize {
+  /**
+   * Regular (usually 4 KB) pages.
+   */
+  POOL_SMALL_PAGES,
+
+  /**
+   * Transparent huge pages: regular memory that the kernel is asked
+   * (madvise(MADV_HUGEPAGE)) to back with 2 MB pages when it can.
+   */
+  POOL_TRANSPARENT_HUGE_PAGES,
+
+  /**
+   * 2 MB pages reserved from the kernel's huge page pool (MAP_HUGETLB).
+   */
+  POOL_HUGE_PAGES_2MB,
+
+  /**
+   * 1 GB pages reserved from the kernel's huge page pool (MAP_HUGETLB).
+   */
+  POOL_HUGE_PAGES_1GB
+};
+
+/**
+ * @brief Anonymous memory area for the buffer pool, backed by pages of a
+ *        chosen size, that can grow and shrink in place.
+ *
+ * Huge pages let the TLB cover a large buffer pool with few entries, and keep
+ * the page tables for it small.  An area asked for with MAP_HUGETLB pages
+ * falls back to smaller huge pages, then to transparent huge pages, when the
+ * kernel has none reserved (see /proc/sys/vm/nr_hugepages); backing() tells
+ * what was obtained.
+ *
+ * Address space for the largest size the area may grow to is reserved up
+ * front, so resizing never moves the memory; only the part in use is backed.
+ * Memory starts zeroed and is aligned to at least 4 KB.
+ */
+class PoolMemory {
+ public:
+  /**
+   * Maps an area of at least <length> bytes.
+   *
+   * @param length      Number of bytes needed.
+   * @param page_size   Largest page size wanted for the area.
+   * @param capacity    Number of bytes the area may grow to with resize().  If
+   *                    that much address space cannot be reserved, the area
+   *                    cannot grow past <length>.
+   * @throws  std::bad_alloc  If no memory can be mapped at all.
+   */
+  PoolMemory(const std::size_t length, const PoolPageSize page_size,
+             const std::size_t capacity = 0);
+
+  /**
+   * Unmaps the area.
+   */
+  ~PoolMemory();
+
+  /**
+   * Returns the start of the area.
+   */
+  void* base() const { return base_; }
+
+  /**
+   * Returns the length of the area in bytes, rounded up to whole pages.
+   */
+  std::size_t length() const { return length_; }
+
+  /**
+   * Returns the number of bytes the area can grow to.
+   */
+  std::size_t capacity() const { return capacity_; }
+
+  /**
+   * Returns the page size actually backing the area.  For transparent huge
+   * pages this is what was asked for; the kernel may still use small pages.
+   */
+  PoolPageSize backing() const { return backing_; }
+
+  /**
+   * Changes the length of the area, backing more of the reserved address
+   * space or handing the memory past the new length back to the kernel.
+   * Contents below both the old and the new length are kept.
+   *
+   * @param length  Number of bytes needed.
+   * @return  False if <length> exceeds the capacity or the kernel refused
+   *          more memory; the area is then unchanged.
+   */
+  bool resize(const std::size_t length);
+
+ private:
+  PoolMemory(const PoolMemory&);
+  PoolMemory& operator=(const PoolMemory&);
+
+  /**
+   * Returns the granularity in which memory of the current backing is added
+   * and removed.
+   */
+  std::size_t unit() const;
+
+  /**
+   * Reserves address space for <capacity> bytes, aligned to unit().
+   */
+  bool reserve(const std::size_t capacity);
+
+  /**
+   * Backs [from, to) of the area with memory.
+   */
+  bool commit(const std::size_t from, const std::size_t to);
+
+  /**
+   * Returns the memory of [from, to) to the kernel, keeping the address
+   * space reserved.
+   */
+  void decommit(const std::size_t from, const std::size_t to);
+
+  void* reservation_;
+  std::size_t reservation_length_;
+  char* base_;
+  std::size_t length_;
+  std::size_t capacity_;
+  PoolPageSize backing_;
+};
+
+}
@@ -0,0 +1,231 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pool_registry.h"
+
+#include <algorithm>
+
+#include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/pool_exists_exception.h"
+#include "exceptions/pool_not_found_exception.h"
+#include "exceptions/pool_resize_exception.h"
+
+namespace badgerdb {
+
+const char* const PoolRegistry::kDefaultPool = "default";
+
+PoolRegistry::PoolRegistry(const std::uint32_t total_frames,
+                           const std::uint32_t default_frames,
+                           const PoolPageSize page_size)
+    : total_frames_(total_frames),
+      page_size_(page_size) {
+  createPool(kDefaultPool, default_frames);
+}
+
+PoolRegistry::~PoolRegistry() {
+  for (std::map<std::string, Pool>::iterator it = pools_.begin();
+       it != pools_.end(); ++it) {
+    delete it->second.buf_mgr;
+  }
+}
+
+BufMgr& PoolRegistry::createPool(const std::string& name,
+                                 const std::uint32_t min_frames,
+                                 const std::uint32_t max_frames,
+                                 const ReplacementPolicy policy) {
+  const std::uint32_t limit = max_frames == 0 ? total_frames_ : max_frames;
+  std::map<std::string, Pool>::iterator existing = pools_.find(name);
+  if (existing != pools_.end()) {
+    const Pool& pool = existing->second;
+    if (pool.min_frames != min_frames || pool.max_frames != limit ||
+        pool.buf_mgr->replacementPolicy() != policy) {
+      throw PoolExistsException(name);
+    }
+    return *pool.buf_mgr;
+  }
+  const std::uint32_t unreserved = total_frames_ - reservedFrames();
+  if (min_frames == 0 || min_frames > limit || min_frames > unreserved) {
+    throw PoolResizeException(min_frames, std::min(limit, unreserved));
+  }
+  // Other pools may have grown into the frames now guaranteed to this one.
+  reclaim(min_frames - std::min(min_frames, freeFrames()), NULL);
+  Pool pool;
+  // Address space for the largest size the pool may reach.
+  pool.buf_mgr = new BufMgr(min_frames, page_size_, limit);
+  pool.buf_mgr->setReplacementPolicy(policy);
+  pool.min_frames = min_frames;
+  pool.max_frames = limit;
+  pools_[name] = pool;
+  return *pool.buf_mgr;
+}
+
+BufMgr& PoolRegistry::pool(const std::string& name) {
+  return *entry(name).buf_mgr;
+}
+
+BufMgr& PoolRegistry::poolFor(const File* file) {
+  return *entryFor(file).buf_mgr;
+}
+
+const std::string& PoolRegistry::poolName(const File* file) const {
+  std::map<const File*, std::string>::const_iterator it =
+      assignments_.find(file);
+  if (it != assignments_.end()) {
+    return it->second;
+  }
+  return pools_.find(kDefaultPool)->first;
+}
+
+void PoolRegistry::assign(const File* file, const std::string& name) {
+  Pool& target = entry(name);
+  Pool& current = entryFor(file);
+  if (&target == &current) {
+    return;
+  }
+  current.buf_mgr->flushFile(file);
+  if (name == kDefaultPool) {
+    assignments_.erase(file);
+  } else {
+    assignments_[file] = name;
+  }
+}
+
+void PoolRegistry::resizePool(const std::string& name,
+                              const std::uint32_t frames) {
+  Pool& pool = entry(name);
+  const std::uint32_t available = pool.buf_mgr->size() + freeFrames();
+  if (frames < pool.min_frames || frames > pool.max_frames ||
+      frames > available) {
+    throw PoolResizeException(frames, std::min(pool.max_frames, available));
+  }
+  pool.buf_mgr->resize(frames);
+}
+
+std::uint32_t PoolRegistry::freeFrames() const {
+  std::uint32_t used = 0;
+  for (std::map<std::string, Pool>::const_iterator it = pools_.begin();
+       it != pools_.end(); ++it) {
+    used += it->second.buf_mgr->size();
+  }
+  return total_frames_ - used;
+}
+
+void PoolRegistry::readPage(File* file, const PageId page_number,
+                            Page*& page) {
+  Pool& pool = entryFor(file);
+  while (true) {
+    try {
+      pool.buf_mgr->readPage(file, page_number, page);
+      return;
+    } catch (BufferExceededException&) {
+      if (!grow(pool)) {
+        throw;
+      }
+    }
+  }
+}
+
+void PoolRegistry::allocPage(File* file, PageId& page_number, Page*& page) {
+  Pool& pool = entryFor(file);
+  while (true) {
+    try {
+      pool.buf_mgr->allocPage(file, page_number, page);
+      return;
+    } catch (BufferExceededException&) {
+      if (!grow(pool)) {
+        throw;
+      }
+    }
+  }
+}
+
+void PoolRegistry::unPinPage(File* file, const PageId page_number,
+                             const bool dirty) {
+  poolFor(file).unPinPage(file, page_number, dirty);
+}
+
+void PoolRegistry::flushFile(const File* file) {
+  poolFor(file).flushFile(file);
+}
+
+void PoolRegistry::flushAll() {
+  for (std::map<std::string, Pool>::iterator it = pools_.begin();
+       it != pools_.end(); ++it) {
+    it->second.buf_mgr->flushAll();
+  }
+}
+
+PoolRegistry::Pool& PoolRegistry::entry(const std::string& name) {
+  std::map<std::string, Pool>::iterator it = pools_.find(name);
+  if (it == pools_.end()) {
+    throw PoolNotFoundException(name);
+  }
+  return it->second;
+}
+
+PoolRegistry::Pool& PoolRegistry::entryFor(const File* file) {
+  std::map<const File*, std::string>::const_iterator it =
+      assignments_.find(file);
+  return entry(it != assignments_.end() ? it->second : kDefaultPool);
+}
+
+std::uint32_t PoolRegistry::reservedFrames() const {
+  std::uint32_t reserved = 0;
+  for (std::map<std::string, Pool>::const_iterator it = pools_.begin();
+       it != pools_.end(); ++it) {
+    reserved += it->second.min_frames;
+  }
+  return reserved;
+}
+
+bool PoolRegistry::grow(Pool& pool) {
+  const std::uint32_t size = pool.buf_mgr->size();
+  // A quarter more at a time, so a pool under pressure does not grow frame by
+  // frame.
+  std::uint32_t wanted = std::max<std::uint32_t>(1, size / 4);
+  wanted = std::min(wanted, pool.max_frames - size);
+  if (wanted == 0) {
+    return false;
+  }
+
+  const std::uint32_t from_budget = std::min(wanted, freeFrames());
+  const std::uint32_t granted =
+      from_budget + reclaim(wanted - from_budget, &pool);
+  if (granted == 0) {
+    return false;
+  }
+  pool.buf_mgr->resize(size + granted);
+  return true;
+}
+
+std::uint32_t PoolRegistry::reclaim(const std::uint32_t frames,
+                                    const Pool* except) {
+  std::uint32_t reclaimed = 0;
+  while (reclaimed < frames) {
+    // Take frames from the pool furthest above its guaranteed size.
+    Pool* donor = NULL;
+    std::uint32_t excess = 0;
+    for (std::map<std::string, Pool>::iterator it = pools_.begin();
+         it != pools_.end(); ++it) {
+      Pool& other = it->second;
+      const std::uint32_t other_size = other.buf_mgr->size();
+      if (&other != except && other_size - other.min_frames > excess) {
+        donor = &other;
+        excess = other_size - other.min_frames;
+      }
+    }
+    if (donor == NULL) {
+      break;
+    }
+    const std::uint32_t taken = std::min(excess, frames - reclaimed);
+    donor->buf_mgr->resize(donor->buf_mgr->size() - taken);
+    reclaimed += taken;
+  }
+  return reclaimed;
+}
+
+}
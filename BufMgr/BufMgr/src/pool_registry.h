@@ -0,0 +1,234 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "buffer.h"
+#include "pool_memory.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Named buffer pools sharing one frame budget, with files assigned to
+ *        pools.
+ *
+ * Every pool is a BufMgr of its own, with its own frames, replacement
+ * policy and statistics, so a large file read once ("scan") cannot push the pages of
+ * small, frequently used files ("hot") out of memory.  Pages of a file are
+ * read through the pool the file is assigned to, or through the "default"
+ * pool if it is not assigned to any.
+ *
+ * Each pool is guaranteed the number of frames it was created with.  When a
+ * pool runs out of unpinned frames it grows into the part of the budget no
+ * pool uses, and failing that takes frames from pools holding more than
+ * their guaranteed number.  Pools never grow past their maximum or shrink
+ * below their minimum.  A pool that gives up frames still pinned keeps them
+ * until they are unpinned (see BufMgr::resize()).
+ *
+ * @warning This class is not threadsafe.
+ */
+class PoolRegistry {
+ public:
+  /**
+   * Name of the pool for files not assigned to any other.
+   */
+  static const char* const kDefaultPool;
+
+  /**
+   * Creates a registry with the default pool.
+   *
+   * @param total_frames    Number of frames all pools together may hold.
+   * @param default_frames  Frames guaranteed to the default pool.
+   * @param page_size       Largest page size wanted for the pools' memory.
+   * @throws  PoolResizeException  If default_frames is 0 or more than
+   *                               total_frames.
+   */
+  PoolRegistry(const std::uint32_t total_frames,
+               const std::uint32_t default_frames,
+               const PoolPageSize page_size = POOL_SMALL_PAGES);
+
+  /**
+   * Destroys all pools, writing their dirty pages back.
+   */
+  ~PoolRegistry();
+
+  /**
+   * Creates a pool, or returns the pool of that name if there is one with the
+   * same settings.  Frames other pools hold above their minimum are taken
+   * back if the budget has too few left.
+   *
+   * @param name        Name of the pool.
+   * @param min_frames  Frames guaranteed to the pool; it starts with these.
+   * @param max_frames  Frames the pool may grow to, or 0 for no limit other
+   *                    than the budget.
+   * @param policy      How the pool picks pages to evict; REPLACE_MRU keeps
+   *                    a pool read mostly by scans from evicting the pages it
+   *                    held before each scan.
+   * @return  The pool.
+   * @throws  PoolExistsException  If a pool of that name exists with other
+   *                               frame limits or another policy.
+   * @throws  PoolResizeException  If min_frames is 0, more than max_frames,
+   *                               or more than the budget has left after the
+   *                               other pools' guaranteed frames.
+   */
+  BufMgr& createPool(const std::string& name, const std::uint32_t min_frames,
+                     const std::uint32_t max_frames = 0,
+                     const ReplacementPolicy policy = REPLACE_CLOCK);
+
+  /**
+   * Returns the pool with the given name.
+   *
+   * @throws  PoolNotFoundException  If there is no such pool.
+   */
+  BufMgr& pool(const std::string& name);
+
+  /**
+   * Returns the pool pages of the given file are read through.
+   */
+  BufMgr& poolFor(const File* file);
+
+  /**
+   * Returns the name of the pool pages of the given file are read through.
+   */
+  const std::string& poolName(const File* file) const;
+
+  /**
+   * Reads pages of a file through the named pool from now on.  The file's
+   * pages are flushed from the pool it was read through before.
+   *
+   * @throws  PoolNotFoundException  If there is no such pool.
+   * @throws  PagePinnedException    If a page of the file is pinned in the
+   *                                 pool it was read through before.
+   */
+  void assign(const File* file, const std::string& name);
+
+  /**
+   * Changes the number of frames of the named pool, within its minimum and
+   * maximum and the part of the budget the other pools do not hold.
+   *
+   * @throws  PoolNotFoundException  If there is no such pool.
+   * @throws  PoolResizeException    If the pool cannot have that many frames.
+   */
+  void resizePool(const std::string& name, const std::uint32_t frames);
+
+  /**
+   * Returns the number of frames of the budget not held by any pool.
+   */
+  std::uint32_t freeFrames() const;
+
+  /**
+   * Returns the usage statistics of the named pool.
+   *
+   * @throws  PoolNotFoundException  If there is no such pool.
+   */
+  BufStats& getBufStats(const std::string& name) {
+    return pool(name).getBufStats();
+  }
+
+  /**
+   * Reads a page through the file's pool, as BufMgr::readPage() does.  If
+   * all the pool's frames are pinned, the pool is grown first.
+   *
+   * @throws  BufferExceededException  If the pool is full and cannot grow.
+   */
+  void readPage(File* file, const PageId page_number, Page*& page);
+
+  /**
+   * Allocates a page through the file's pool, as BufMgr::allocPage() does.
+   * If all the pool's frames are pinned, the pool is grown first.
+   *
+   * @throws  BufferExceededException  If the pool is full and cannot grow.
+   */
+  void allocPage(File* file, PageId& page_number, Page*& page);
+
+  /**
+   * Unpins a page in the file's pool, as BufMgr::unPinPage() does.
+   */
+  void unPinPage(File* file, const PageId page_number, const bool dirty);
+
+  /**
+   * Flushes the file from its pool, as BufMgr::flushFile() does.
+   */
+  void flushFile(const File* file);
+
+  /**
+   * Flushes every pool, as BufMgr::flushAll() does.
+   */
+  void flushAll();
+
+ private:
+  /**
+   * A pool and the frames it is guaranteed and limited to.
+   */
+  struct Pool {
+    BufMgr* buf_mgr;
+    std::uint32_t min_frames;
+    std::uint32_t max_frames;
+  };
+
+  PoolRegistry(const PoolRegistry&);
+  PoolRegistry& operator=(const PoolRegistry&);
+
+  /**
+   * Returns the entry of the named pool.
+   *
+   * @throws  PoolNotFoundException  If there is no such pool.
+   */
+  Pool& entry(const std::string& name);
+
+  /**
+   * Returns the entry of the pool pages of the given file are read through.
+   */
+  Pool& entryFor(const File* file);
+
+  /**
+   * Returns the number of frames all pools are guaranteed together.
+   */
+  std::uint32_t reservedFrames() const;
+
+  /**
+   * Adds frames to a pool whose frames are all pinned, from the free part of
+   * the budget or else from pools above their minimum.
+   *
+   * @return  False if no frames could be found.
+   */
+  bool grow(Pool& pool);
+
+  /**
+   * Shrinks pools above their minimum, other than <except>, by up to
+   * <frames> frames in all, largest excess first.
+   *
+   * @return  The number of frames taken.
+   */
+  std::uint32_t reclaim(const std::uint32_t frames, const Pool* except);
+
+  /**
+   * Number of frames all pools together may hold.
+   */
+  std::uint32_t total_frames_;
+
+  /**
+   * Page size wanted for the pools' memory.
+   */
+  PoolPageSize page_size_;
+
+  /**
+   * Pools by name.
+   */
+  std::map<std::string, Pool> pools_;
+
+  /**
+   * Names of the pools files are assigned to.
+   */
+  std::map<const File*, std::string> assignments_;
+};
+
+}
@@ -0,0 +1,301 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "recovery.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <thread>
+
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+bool isPageChange(const LogRecordType type) {
+  return type == LOG_PAGE_IMAGE || type == LOG_INSERT || type == LOG_UPDATE ||
+         type == LOG_DELETE;
+}
+
+}
+
+Recovery::Recovery(Wal& wal, BufMgr& buf_mgr)
+    : wal_(wal),
+      buf_mgr_(buf_mgr) {
+  std::memset(&stats_, 0, sizeof(stats_));
+}
+
+Recovery::~Recovery() {
+  for (std::map<std::string, File*>::iterator it = files_.begin();
+       it != files_.end(); ++it) {
+    if (it->second != NULL) {
+      try {
+        buf_mgr_.flushFile(it->second);
+      } catch (...) {
+        // Frames must not outlive their File; nothing better to do here.
+      }
+      delete it->second;
+    }
+  }
+}
+
+RecoveryStats Recovery::run(const unsigned threads) {
+  analyze();
+  redo(threads);
+  undo();
+  for (std::map<std::string, File*>::iterator it = files_.begin();
+       it != files_.end(); ++it) {
+    if (it->second != NULL) {
+      buf_mgr_.flushFile(it->second);
+    }
+  }
+  wal_.flush(wal_.endLsn());
+  return stats_;
+}
+
+void Recovery::analyze() {
+  LogRecord record;
+  Lsn lsn = Wal::firstLsn();
+  Lsn next;
+  const Lsn checkpoint = wal_.checkpointLsn();
+  if (checkpoint != 0 && wal_.readRecord(checkpoint, record, next) &&
+      record.type == LOG_CHECKPOINT) {
+    lsn = record.redo_lsn;
+  }
+  stats_.start_lsn = lsn;
+  while (wal_.readRecord(lsn, record, next)) {
+    ++stats_.records;
+    if (record.type == LOG_CHECKPOINT) {
+      // Transactions active at the checkpoint whose records may all be
+      // before the start of the scan
+      for (std::map<TxnId, Lsn>::const_iterator it =
+               record.active_txns.begin();
+           it != record.active_txns.end(); ++it) {
+        std::map<TxnId, Lsn>::iterator loser = losers_.find(it->first);
+        if (loser == losers_.end()) {
+          losers_.insert(*it);
+        } else {
+          loser->second = std::max(loser->second, it->second);
+        }
+      }
+    } else if (record.type == LOG_COMMIT || record.type == LOG_ABORT) {
+      losers_.erase(record.txn);
+    } else {
+      losers_[record.txn] = lsn;
+    }
+    if (isPageChange(record.type)) {
+      records_.push_back(record);
+      const std::pair<std::string, PageId> key(record.filename,
+                                               record.page_number);
+      std::map<std::pair<std::string, PageId>, PageRedo>::iterator page =
+          dirty_pages_.find(key);
+      if (page == dirty_pages_.end()) {
+        PageRedo entry;
+        entry.file = file(record.filename);
+        entry.page_number = record.page_number;
+        entry.rec_lsn = lsn;
+        page = dirty_pages_.insert(std::make_pair(key, entry)).first;
+      }
+      page->second.records.push_back(&records_.back());
+    }
+    lsn = next;
+  }
+  stats_.pages = dirty_pages_.size();
+}
+
+void Recovery::redo(unsigned threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // Half the frames are pinned at most, so the buffer manager can always
+  // find a frame for the next batch.
+  threads = std::min<std::uint32_t>(threads,
+                                    std::max<std::uint32_t>(1, buf_mgr_.size() / 2));
+  const std::uint32_t batch =
+      std::max<std::uint32_t>(1, buf_mgr_.size() / (2 * threads));
+  stats_.threads = threads;
+
+  // Partition by page; the map is ordered by file and page number, so every
+  // partition is too, and batches cover runs of nearby pages.
+  std::vector<std::vector<PageRedo*> > partitions(threads);
+  std::size_t index = 0;
+  for (std::map<std::pair<std::string, PageId>, PageRedo>::iterator it =
+           dirty_pages_.begin();
+       it != dirty_pages_.end(); ++it, ++index) {
+    PageRedo& page = it->second;
+    if (page.file == NULL) {
+      ++stats_.missing_pages;
+      continue;
+    }
+    // Consecutive groups of pages go to the same thread, so batches can be
+    // read as runs.
+    partitions[(index / batch) % threads].push_back(&page);
+  }
+
+  std::vector<RedoCounts> counts(threads);
+  std::vector<std::exception_ptr> errors(threads);
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads; ++t) {
+    workers.push_back(std::thread([this, t, batch, &partitions, &counts,
+                                   &errors]() {
+      try {
+        redoPages(partitions[t], batch, counts[t]);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    }));
+  }
+  try {
+    redoPages(partitions[0], batch, counts[0]);
+  } catch (...) {
+    errors[0] = std::current_exception();
+  }
+  for (std::size_t w = 0; w < workers.size(); ++w) {
+    workers[w].join();
+  }
+  for (unsigned t = 0; t < threads; ++t) {
+    if (errors[t]) {
+      std::rethrow_exception(errors[t]);
+    }
+    stats_.redone += counts[t].redone;
+    stats_.skipped += counts[t].skipped;
+    stats_.missing_pages += counts[t].missing_pages;
+  }
+}
+
+void Recovery::redoPages(const std::vector<PageRedo*>& pages,
+                         const std::uint32_t batch, RedoCounts& counts) {
+  std::memset(&counts, 0, sizeof(counts));
+  std::vector<PageId> page_numbers;
+  std::vector<Page*> frames;
+  std::size_t first = 0;
+  while (first < pages.size()) {
+    // A batch of pages of one file
+    File* file = pages[first]->file;
+    std::size_t end = first;
+    while (end < pages.size() && end - first < batch &&
+           pages[end]->file == file) {
+      ++end;
+    }
+    page_numbers.clear();
+    for (std::size_t p = first; p < end; ++p) {
+      page_numbers.push_back(pages[p]->page_number);
+    }
+    frames.assign(end - first, NULL);
+    {
+      std::lock_guard<std::mutex> lock(buf_mgr_mutex_);
+      try {
+        buf_mgr_.readPages(file, &page_numbers[0], page_numbers.size(),
+                           &frames[0]);
+      } catch (InvalidPageException&) {
+        // Some page is gone from the file; pin the others one by one.
+        for (std::size_t p = 0; p < page_numbers.size(); ++p) {
+          try {
+            buf_mgr_.readPage(file, page_numbers[p], frames[p]);
+          } catch (InvalidPageException&) {
+            frames[p] = NULL;
+            ++counts.missing_pages;
+          }
+        }
+      }
+    }
+
+    std::vector<bool> changed(frames.size(), false);
+    for (std::size_t p = 0; p < frames.size(); ++p) {
+      if (frames[p] == NULL) {
+        continue;
+      }
+      const std::vector<const LogRecord*>& records = pages[first + p]->records;
+      for (std::size_t r = 0; r < records.size(); ++r) {
+        if (Wal::redo(*records[r], frames[p])) {
+          ++counts.redone;
+          changed[p] = true;
+        } else {
+          ++counts.skipped;
+        }
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(buf_mgr_mutex_);
+      for (std::size_t p = 0; p < frames.size(); ++p) {
+        if (frames[p] != NULL) {
+          buf_mgr_.unPinPage(file, page_numbers[p], changed[p]);
+        }
+      }
+    }
+    first = end;
+  }
+}
+
+void Recovery::undo() {
+  // Next record to undo of every loser, newest first across all of them
+  std::map<Lsn, TxnId> to_undo;
+  for (std::map<TxnId, Lsn>::iterator it = losers_.begin();
+       it != losers_.end(); ++it) {
+    to_undo[it->second] = it->first;
+  }
+  stats_.losers = losers_.size();
+
+  LogRecord record;
+  Lsn next;
+  while (!to_undo.empty()) {
+    const std::map<Lsn, TxnId>::iterator newest = --to_undo.end();
+    const Lsn lsn = newest->first;
+    const TxnId txn = newest->second;
+    to_undo.erase(newest);
+    wal_.readRecord(lsn, record, next);
+
+    Lsn undo_next = record.prev_lsn;
+    if (record.compensation) {
+      // Undone before the crash already
+      undo_next = record.undo_next_lsn;
+    } else if (isPageChange(record.type)) {
+      File* page_file = file(record.filename);
+      Page* page = NULL;
+      if (page_file != NULL) {
+        try {
+          buf_mgr_.readPage(page_file, record.page_number, page);
+        } catch (InvalidPageException&) {
+          page = NULL;
+        }
+      }
+      if (page != NULL) {
+        if (wal_.undo(txn, record, page_file, page) != 0) {
+          ++stats_.undone;
+        }
+        buf_mgr_.unPinPage(page_file, record.page_number, true);
+      }
+    }
+
+    if (undo_next == 0) {
+      wal_.abort(txn);
+    } else {
+      to_undo[undo_next] = txn;
+    }
+  }
+  losers_.clear();
+}
+
+File* Recovery::file(const std::string& filename) {
+  std::map<std::string, File*>::iterator it = files_.find(filename);
+  if (it != files_.end()) {
+    return it->second;
+  }
+  File* opened = NULL;
+  try {
+    opened = new File(File::open(filename));
+  } catch (FileNotFoundException&) {
+  }
+  files_[filename] = opened;
+  return opened;
+}
+
+}
@@ -0,0 +1,213 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "wal.h"
+
+namespace badgerdb {
+
+/**
+ * @brief What a recovery pass found and did.
+ */
+struct RecoveryStats {
+  /**
+   * LSN the analysis pass started at: the redo LSN of the last checkpoint,
+   * or the start of the log.
+   */
+  Lsn start_lsn;
+
+  /**
+   * Log records read by the analysis pass.
+   */
+  std::uint64_t records;
+
+  /**
+   * Pages changed by the records read (the dirty page table).
+   */
+  std::uint64_t pages;
+
+  /**
+   * Changes redone, and changes found on their pages already.
+   */
+  std::uint64_t redone;
+  std::uint64_t skipped;
+
+  /**
+   * Pages whose file or page no longer exists; their changes are skipped.
+   */
+  std::uint64_t missing_pages;
+
+  /**
+   * Transactions rolled back, and changes they made that were undone.
+   */
+  std::uint64_t losers;
+  std::uint64_t undone;
+
+  /**
+   * Threads the redo pass ran on.
+   */
+  unsigned threads;
+};
+
+/**
+ * @brief Restart recovery from a write-ahead log, in the three passes of
+ *        ARIES.
+ *
+ * Analysis reads the log and builds the dirty page table (every page changed,
+ * with the LSN that first changed it) and the table of transactions that
+ * neither committed nor rolled back.  It starts at the redo LSN of the last
+ * checkpoint (Wal::checkpointLsn()), before which every change is on disk,
+ * and takes the transactions active then from the checkpoint record.
+ *
+ * Redo repeats history: every change is applied again to its page unless the
+ * page LSN shows the page has it already.  Pages are split over worker
+ * threads by (file, page number), so each page is redone by one thread, with
+ * its records in log order, and no two threads touch the same page.  The
+ * pages are read into buffer pool frames with BufMgr::readPages(), in
+ * batches per file, and changed there.  The buffer manager is not
+ * threadsafe, so its calls, reads included, are serialized; with
+ * asynchronous I/O enabled on it, the reads of a batch are in flight at
+ * once, and the threads apply records to pinned pages in parallel.
+ *
+ * Undo rolls back the transactions the crash interrupted, newest change
+ * first across all of them, logging a compensation record for every change
+ * undone and an abort record for every transaction, so that a crash during
+ * recovery does not undo anything twice.
+ *
+ * Finally, the pages changed are written back (the log first) and the log is
+ * flushed, so the files are consistent when run() returns.
+ *
+ * The records of the log are held in memory during recovery.  Pages must
+ * have been allocated in their files (File::allocatePage() is not logged);
+ * changes to pages that are no longer there are skipped.
+ */
+class Recovery {
+ public:
+  /**
+   * Prepares recovery of the files changed through <wal>, using the frames of
+   * <buf_mgr>.  Recovery opens the files itself, so the buffer manager must
+   * not hold pages of them read through other File objects.
+   */
+  Recovery(Wal& wal, BufMgr& buf_mgr);
+
+  /**
+   * Closes the files opened for recovery, flushing their pages from the
+   * buffer pool first.
+   */
+  ~Recovery();
+
+  /**
+   * Runs analysis, redo and undo.
+   *
+   * @param threads   Number of redo threads, or 0 for one per core.
+   * @return  What was found and done.
+   */
+  RecoveryStats run(const unsigned threads = 0);
+
+ private:
+  /**
+   * @brief A page of the dirty page table and the records changing it.
+   */
+  struct PageRedo {
+    File* file;
+    PageId page_number;
+
+    /**
+     * LSN of the first record changing the page.
+     */
+    Lsn rec_lsn;
+
+    /**
+     * Records changing the page, in log order.
+     */
+    std::vector<const LogRecord*> records;
+  };
+
+  /**
+   * @brief Counters of one redo thread.
+   */
+  struct RedoCounts {
+    std::uint64_t redone;
+    std::uint64_t skipped;
+    std::uint64_t missing_pages;
+  };
+
+  Recovery(const Recovery&);
+  Recovery& operator=(const Recovery&);
+
+  /**
+   * Reads the log, filling in the dirty page table and the losers.
+   */
+  void analyze();
+
+  /**
+   * Redoes the dirty page table on <threads> threads.
+   */
+  void redo(unsigned threads);
+
+  /**
+   * Redoes the given pages, sorted by file and page number, pinning up to
+   * <batch> of them at a time.
+   */
+  void redoPages(const std::vector<PageRedo*>& pages, const std::uint32_t batch,
+                 RedoCounts& counts);
+
+  /**
+   * Rolls back the losers.
+   */
+  void undo();
+
+  /**
+   * Returns the file with the given name, opening it the first time, or NULL
+   * if it does not exist.
+   */
+  File* file(const std::string& filename);
+
+  Wal& wal_;
+  BufMgr& buf_mgr_;
+
+  /**
+   * Serializes calls to the buffer manager from the redo threads.
+   */
+  std::mutex buf_mgr_mutex_;
+
+  /**
+   * Files opened for recovery, by name; NULL for files that do not exist.
+   */
+  std::map<std::string, File*> files_;
+
+  /**
+   * Records of page changes read by analysis.  A deque, so the dirty page
+   * table can point into it.
+   */
+  std::deque<LogRecord> records_;
+
+  /**
+   * Dirty page table, by file name and page number.
+   */
+  std::map<std::pair<std::string, PageId>, PageRedo> dirty_pages_;
+
+  /**
+   * Last LSN of every transaction neither committed nor rolled back.
+   */
+  std::map<TxnId, Lsn> losers_;
+
+  RecoveryStats stats_;
+};
+
+}
@@ -0,0 +1,263 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "ssd_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "async_io.h"
+#include "file.h"
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+const std::uint32_t SsdCache::NONE;
+
+namespace {
+
+void readFully(const int fd, char* buffer, const std::size_t length,
+               const off_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pread(fd, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException("pread", errno);
+    }
+    if (n == 0) {
+      throw IoException("pread", 0 /* short transfer */);
+    }
+    done += n;
+  }
+}
+
+bool isAligned(const void* address) {
+  return reinterpret_cast<std::uintptr_t>(address) % File::BLOCK_SIZE == 0;
+}
+
+}
+
+SsdCache::SsdCache(const std::string& filename, const std::uint32_t pages,
+                   const unsigned queue_depth, const bool use_io_uring)
+    : filename_(filename),
+      fd_(-1),
+      slots_(std::max<std::uint32_t>(pages, 2)),
+      clock_hand_(0),
+      index_(static_cast<int>(std::max<std::uint32_t>(pages, 2) * 1.2) + 1),
+      io_(NULL),
+      staging_(NULL),
+      staging_pages_(std::min<std::uint32_t>(std::max(queue_depth, 1u),
+                                             capacity() / 2)),
+      staging_iov_(staging_pages_),
+      bounce_(NULL) {
+  std::memset(&stats_, 0, sizeof(stats_));
+  for (std::size_t s = 0; s < slots_.size(); ++s) {
+    slots_[s].file = NULL;
+    slots_[s].refbit = false;
+    slots_[s].staging = NONE;
+  }
+
+  void* memory;
+  if (::posix_memalign(&memory, File::BLOCK_SIZE,
+                       std::size_t(staging_pages_ + 1) * Page::SIZE) != 0) {
+    throw std::bad_alloc();
+  }
+  staging_ = static_cast<char*>(memory);
+  bounce_ = staging_ + std::size_t(staging_pages_) * Page::SIZE;
+  for (std::uint32_t b = 0; b < staging_pages_; ++b) {
+    staging_iov_[b].iov_base = staging_ + std::size_t(b) * Page::SIZE;
+    staging_iov_[b].iov_len = Page::SIZE;
+  }
+
+  // Cached pages should not take page cache memory as well
+  fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_DIRECT,
+               0644);
+  if (fd_ < 0 && errno == EINVAL) {
+    // Filesystem without O_DIRECT support (tmpfs, for one).
+    fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  }
+  if (fd_ < 0) {
+    const int error = errno;
+    std::free(staging_);
+    throw IoException("open", error);
+  }
+  const off_t length = off_t(capacity()) * Page::SIZE;
+  int error = ::posix_fallocate(fd_, 0, length);
+  if (error == EOPNOTSUPP || error == EINVAL) {
+    error = ::ftruncate(fd_, length) == 0 ? 0 : errno;
+  }
+  if (error != 0) {
+    ::close(fd_);
+    ::unlink(filename_.c_str());
+    std::free(staging_);
+    throw IoException("posix_fallocate", error);
+  }
+
+  io_ = new AsyncIo(staging_pages_, use_io_uring);
+  io_->registerBuffers(staging_, std::size_t(staging_pages_) * Page::SIZE,
+                       std::size_t(staging_pages_) * Page::SIZE);
+}
+
+SsdCache::~SsdCache() {
+  drain();
+  delete io_;
+  ::close(fd_);
+  ::unlink(filename_.c_str());
+  std::free(staging_);
+}
+
+void SsdCache::insert(const File* file, const PageId page_number,
+                      const Page& page) {
+  const std::uint32_t old = find(file, page_number);
+  if (old != NONE) {
+    drop(old);
+  }
+  if (staged_slots_.size() == staging_pages_) {
+    drain();
+  }
+  const std::uint32_t slot = victim();
+  const std::uint32_t buffer = static_cast<std::uint32_t>(staged_slots_.size());
+  char* copy = staging_ + std::size_t(buffer) * Page::SIZE;
+  std::memcpy(copy, &page, Page::SIZE);
+  reinterpret_cast<Page*>(copy)->updateChecksum();
+
+  Slot& entry = slots_[slot];
+  entry.file = file;
+  entry.page_number = page_number;
+  entry.refbit = false;
+  entry.staging = buffer;
+  staged_slots_.push_back(slot);
+  index_.insert(file, page_number, slot);
+  ++stats_.writes;
+  try {
+    io_->write(fd_, std::uint64_t(slot) * Page::SIZE, &staging_iov_[buffer], 1);
+    // Start the write now rather than when the queue fills
+    std::vector<AsyncIo::Completion> none;
+    io_->poll(none, false);
+  } catch (IoException&) {
+    drop(slot);
+    ++stats_.errors;
+  }
+}
+
+bool SsdCache::contains(const File* file, const PageId page_number) {
+  return find(file, page_number) != NONE;
+}
+
+bool SsdCache::read(const File* file, const PageId page_number, Page* page) {
+  const std::uint32_t slot = find(file, page_number);
+  if (slot == NONE) {
+    ++stats_.misses;
+    return false;
+  }
+  Slot& entry = slots_[slot];
+  if (entry.staging != NONE) {
+    std::memcpy(page, staging_ + std::size_t(entry.staging) * Page::SIZE,
+                Page::SIZE);
+  } else {
+    char* target = isAligned(page) ? reinterpret_cast<char*>(page) : bounce_;
+    try {
+      readFully(fd_, target, Page::SIZE, off_t(slot) * Page::SIZE);
+    } catch (IoException&) {
+      drop(slot);
+      ++stats_.errors;
+      ++stats_.misses;
+      return false;
+    }
+    if (target != reinterpret_cast<char*>(page)) {
+      std::memcpy(page, target, Page::SIZE);
+    }
+  }
+  if (!page->verifyChecksum() || page->page_number() != page_number) {
+    drop(slot);
+    ++stats_.errors;
+    ++stats_.misses;
+    return false;
+  }
+  entry.refbit = true;
+  ++stats_.hits;
+  return true;
+}
+
+void SsdCache::erase(const File* file, const PageId page_number) {
+  const std::uint32_t slot = find(file, page_number);
+  if (slot != NONE) {
+    drop(slot);
+  }
+}
+
+void SsdCache::eraseFile(const File* file) {
+  for (std::uint32_t s = 0; s < slots_.size(); ++s) {
+    if (slots_[s].file != NULL && (file == NULL || slots_[s].file == file)) {
+      drop(s);
+    }
+  }
+}
+
+std::uint32_t SsdCache::find(const File* file, const PageId page_number) {
+  FrameId slot;
+  return index_.find(file, page_number, slot) ? slot : NONE;
+}
+
+void SsdCache::drop(const std::uint32_t slot) {
+  Slot& entry = slots_[slot];
+  index_.remove(entry.file, entry.page_number);
+  entry.file = NULL;
+  entry.refbit = false;
+}
+
+std::uint32_t SsdCache::victim() {
+  // Fewer slots are being written than half the slots, so a free or
+  // unreferenced one turns up within two turns of the clock
+  for (;;) {
+    clock_hand_ = (clock_hand_ + 1) % capacity();
+    Slot& entry = slots_[clock_hand_];
+    if (entry.staging != NONE) {
+      continue;
+    }
+    if (entry.file == NULL) {
+      return clock_hand_;
+    }
+    if (entry.refbit) {
+      entry.refbit = false;
+      continue;
+    }
+    drop(clock_hand_);
+    ++stats_.evictions;
+    return clock_hand_;
+  }
+}
+
+void SsdCache::drain() {
+  bool failed = false;
+  try {
+    io_->wait();
+  } catch (IoException&) {
+    failed = true;
+  }
+  for (std::size_t b = 0; b < staged_slots_.size(); ++b) {
+    Slot& entry = slots_[staged_slots_[b]];
+    entry.staging = NONE;
+    if (failed && entry.file != NULL) {
+      // Which of the writes failed is not known
+      drop(staged_slots_[b]);
+      ++stats_.errors;
+    }
+  }
+  staged_slots_.clear();
+}
+
+}
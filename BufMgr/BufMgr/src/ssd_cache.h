@@ -0,0 +1,225 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "bufHashTbl.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class AsyncIo;
+class File;
+
+/**
+ * @brief Counters of an SSD cache.
+ */
+struct SsdCacheStats {
+  /**
+   * Pages written to the cache file, and pages overwritten to make room.
+   */
+  std::uint64_t writes;
+  std::uint64_t evictions;
+
+  /**
+   * Pages read back from the cache, and lookups of pages not in it.
+   */
+  std::uint64_t hits;
+  std::uint64_t misses;
+
+  /**
+   * Pages dropped because their write failed or their copy did not match its
+   * checksum when read back.
+   */
+  std::uint64_t errors;
+};
+
+/**
+ * @brief Second-level page cache in a file on a fast local device, for data
+ *        files on slower storage.
+ *
+ * The buffer manager (BufMgr::attachSsdCache()) hands the cache the pages it
+ * evicts, once they are clean, and looks a page missing from the pool up
+ * here before reading it from its file.  Pages stay in the cache when read
+ * back, so a page evicted again unchanged costs no write; a page written back
+ * to its file after a change is dropped from the cache first.
+ *
+ * The cache file is preallocated to a fixed number of page slots and opened
+ * with O_DIRECT where the filesystem allows, so cached pages do not take OS
+ * page cache memory as well.  Writes are asynchronous: a page is copied to a
+ * staging buffer and its write queued on an AsyncIo queue of the cache's
+ * own, and the staging buffers are only waited for once they are all in use.
+ * Until then a page is read from its staging buffer.
+ *
+ * Where a page is, is known only from an in-memory index (a BufHashTbl from
+ * file and page number to slot), so the file is of no use once the cache is
+ * destroyed and is removed then.  Slots are reused by a clock over them, a
+ * slot read from since the clock last passed getting a second chance.
+ * Copies are checksummed; one that fails its checksum when read back is
+ * dropped and the page read from its file instead.
+ *
+ * @warning This class is not threadsafe.
+ */
+class SsdCache {
+ public:
+  /**
+   * Creates the cache file, or truncates it if it exists, and preallocates
+   * it.
+   *
+   * @param filename    Name of the cache file, on the fast device.
+   * @param pages       Number of page slots, at least 2.
+   * @param queue_depth Number of writes in flight at once, and of staging
+   *                    buffers.
+   * @param use_io_uring  If false, write with pwritev even if io_uring is
+   *                      available.
+   * @throws  IoException  If the file cannot be created or preallocated.
+   */
+  SsdCache(const std::string& filename, const std::uint32_t pages,
+           const unsigned queue_depth = 32, const bool use_io_uring = true);
+
+  /**
+   * Waits for the writes in flight, and removes the cache file.
+   */
+  ~SsdCache();
+
+  /**
+   * Queues a write of a copy of a page, replacing any copy kept before.  The
+   * page must be the same as in its file.
+   *
+   * @param file          File of the page.
+   * @param page_number   Number of the page.
+   * @param page          The page.
+   */
+  void insert(const File* file, const PageId page_number, const Page& page);
+
+  /**
+   * Returns true if a copy of the page is kept.
+   */
+  bool contains(const File* file, const PageId page_number);
+
+  /**
+   * Reads the copy of a page into <page>.  Failing reads, and copies that fail
+   * their checksum, are dropped and count as misses.
+   *
+   * @return  False if no (intact) copy of the page is kept; <page> may have
+   *          been written to.
+   */
+  bool read(const File* file, const PageId page_number, Page* page);
+
+  /**
+   * Drops the copy of a page, if one is kept.
+   */
+  void erase(const File* file, const PageId page_number);
+
+  /**
+   * Drops the copies of all pages of a file, or of all files if <file> is
+   * NULL.
+   */
+  void eraseFile(const File* file);
+
+  /**
+   * Returns the number of page slots.
+   */
+  std::uint32_t capacity() const {
+    return static_cast<std::uint32_t>(slots_.size());
+  }
+
+  /**
+   * Returns the counters of the cache.
+   */
+  SsdCacheStats stats() const { return stats_; }
+
+ private:
+  /**
+   * @brief Page slot of the cache file.
+   */
+  struct Slot {
+    /**
+     * Page held, or a NULL file if the slot is free.
+     */
+    const File* file;
+    PageId page_number;
+
+    /**
+     * Read from since the clock last passed.
+     */
+    bool refbit;
+
+    /**
+     * Staging buffer the page is being written from, or NONE once the write
+     * is done.  The slot is not reused while its write is in flight.
+     */
+    std::uint32_t staging;
+  };
+
+  SsdCache(const SsdCache&);
+  SsdCache& operator=(const SsdCache&);
+
+  /**
+   * Returns the slot of a page, or NONE.
+   */
+  std::uint32_t find(const File* file, const PageId page_number);
+
+  /**
+   * Frees a slot, leaving a write in flight from it to finish.
+   */
+  void drop(const std::uint32_t slot);
+
+  /**
+   * Returns a slot for a new page, freeing the one the clock stops at.
+   */
+  std::uint32_t victim();
+
+  /**
+   * Waits for the writes in flight and frees their staging buffers.
+   */
+  void drain();
+
+  /**
+   * Marker of no slot or staging buffer.
+   */
+  static const std::uint32_t NONE = 0xffffffffu;
+
+  std::string filename_;
+  int fd_;
+
+  std::vector<Slot> slots_;
+  std::uint32_t clock_hand_;
+
+  /**
+   * Slot of each page kept.
+   */
+  BufHashTbl index_;
+
+  /**
+   * Queue the writes go through, the staging buffers (BLOCK_SIZE-aligned)
+   * and their iovecs, which must outlive the writes, and the slot each
+   * buffer in use is written to.
+   */
+  AsyncIo* io_;
+  char* staging_;
+  std::uint32_t staging_pages_;
+  std::vector<struct iovec> staging_iov_;
+  std::vector<std::uint32_t> staged_slots_;
+
+  /**
+   * Buffer to read a page through when the caller's is not aligned for
+   * O_DIRECT.
+   */
+  char* bounce_;
+
+  SsdCacheStats stats_;
+};
+
+}
@@ -24,6 +24,11 @@ typedef std::uint16_t SlotId;
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Log sequence number: position of a record in the write-ahead log.
+ */
+typedef std::uint64_t Lsn;
+
 /**
  * @brief Identifier for a record in a page.
  */
@@ -0,0 +1,187 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "victim_cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "lz4.h"
+
+namespace badgerdb {
+
+const std::size_t VictimCache::UNIT_SIZE;
+const std::uint32_t VictimCache::NONE;
+
+VictimCache::VictimCache(const std::size_t bytes)
+    : units_(static_cast<std::uint32_t>(bytes / UNIT_SIZE)),
+      arena_(NULL),
+      next_unit_(units_),
+      free_unit_(units_ > 0 ? 0 : NONE),
+      free_units_(units_),
+      entries_(units_),
+      newest_(NONE),
+      oldest_(NONE),
+      free_entry_(units_ > 0 ? 0 : NONE),
+      index_(static_cast<int>(units_ / 4 * 1.2) + 1),
+      scratch_(Page::SIZE + UNIT_SIZE) {
+  std::memset(&stats_, 0, sizeof(stats_));
+  arena_ = static_cast<char*>(std::malloc(std::size_t(units_) * UNIT_SIZE + 1));
+  if (arena_ == NULL) {
+    throw std::bad_alloc();
+  }
+  for (std::uint32_t u = 0; u < units_; ++u) {
+    next_unit_[u] = u + 1 < units_ ? u + 1 : NONE;
+    entries_[u].file = NULL;
+    entries_[u].next = u + 1 < units_ ? u + 1 : NONE;
+  }
+}
+
+VictimCache::~VictimCache() {
+  std::free(arena_);
+}
+
+void VictimCache::insert(const File* file, const PageId page_number,
+                         const Page& page) {
+  erase(file, page_number);
+  std::size_t length =
+      Lz4::compress(&page, Page::SIZE, &scratch_[0], Page::SIZE - 1);
+  if (length == 0) {
+    // Incompressible: kept as is
+    length = Page::SIZE;
+    std::memcpy(&scratch_[0], &page, Page::SIZE);
+  }
+  const std::uint32_t units =
+      static_cast<std::uint32_t>((length + UNIT_SIZE - 1) / UNIT_SIZE);
+  if (units > units_) {
+    return;
+  }
+  while (free_units_ < units) {
+    remove(oldest_);
+    ++stats_.evictions;
+  }
+
+  const std::uint32_t id = free_entry_;
+  Entry& entry = entries_[id];
+  free_entry_ = entry.next;
+  entry.file = file;
+  entry.page_number = page_number;
+  entry.length = static_cast<std::uint32_t>(length);
+  entry.first_unit = free_unit_;
+  std::uint32_t unit = free_unit_;
+  for (std::uint32_t u = 0; u < units; ++u) {
+    const std::size_t offset = std::size_t(u) * UNIT_SIZE;
+    std::memcpy(arena_ + std::size_t(unit) * UNIT_SIZE, &scratch_[offset],
+                std::min<std::size_t>(UNIT_SIZE, length - offset));
+    if (u + 1 == units) {
+      free_unit_ = next_unit_[unit];
+      next_unit_[unit] = NONE;
+    } else {
+      unit = next_unit_[unit];
+    }
+  }
+  free_units_ -= units;
+
+  entry.prev = NONE;
+  entry.next = newest_;
+  if (newest_ != NONE) {
+    entries_[newest_].prev = id;
+  } else {
+    oldest_ = id;
+  }
+  newest_ = id;
+  index_.insert(file, page_number, id);
+  ++stats_.inserts;
+  ++stats_.pages;
+  stats_.compressed_bytes += length;
+}
+
+bool VictimCache::take(const File* file, const PageId page_number,
+                       Page* page) {
+  const std::uint32_t id = find(file, page_number);
+  if (id == NONE) {
+    return false;
+  }
+  const Entry& entry = entries_[id];
+  std::size_t offset = 0;
+  for (std::uint32_t unit = entry.first_unit; unit != NONE;
+       unit = next_unit_[unit]) {
+    const std::size_t part = std::min<std::size_t>(UNIT_SIZE,
+                                                   entry.length - offset);
+    std::memcpy(&scratch_[offset], arena_ + std::size_t(unit) * UNIT_SIZE,
+                part);
+    offset += part;
+  }
+  bool whole = true;
+  if (entry.length == Page::SIZE) {
+    std::memcpy(page, &scratch_[0], Page::SIZE);
+  } else {
+    whole = Lz4::decompress(&scratch_[0], entry.length, page, Page::SIZE);
+  }
+  remove(id);
+  return whole;
+}
+
+void VictimCache::erase(const File* file, const PageId page_number) {
+  const std::uint32_t id = find(file, page_number);
+  if (id != NONE) {
+    remove(id);
+  }
+}
+
+void VictimCache::eraseFile(const File* file) {
+  for (std::uint32_t id = 0; id < entries_.size(); ++id) {
+    if (entries_[id].file != NULL &&
+        (file == NULL || entries_[id].file == file)) {
+      remove(id);
+    }
+  }
+}
+
+std::uint32_t VictimCache::find(const File* file, const PageId page_number) {
+  if (stats_.pages == 0) {
+    return NONE;
+  }
+  FrameId id;
+  return index_.find(file, page_number, id) ? id : NONE;
+}
+
+void VictimCache::remove(const std::uint32_t id) {
+  Entry& entry = entries_[id];
+  index_.remove(entry.file, entry.page_number);
+  stats_.pages--;
+  stats_.compressed_bytes -= entry.length;
+
+  // Units back on the free list, chain and all
+  std::uint32_t last = entry.first_unit;
+  std::uint32_t units = 1;
+  while (next_unit_[last] != NONE) {
+    last = next_unit_[last];
+    ++units;
+  }
+  next_unit_[last] = free_unit_;
+  free_unit_ = entry.first_unit;
+  free_units_ += units;
+
+  if (entry.prev != NONE) {
+    entries_[entry.prev].next = entry.next;
+  } else {
+    newest_ = entry.next;
+  }
+  if (entry.next != NONE) {
+    entries_[entry.next].prev = entry.prev;
+  } else {
+    oldest_ = entry.prev;
+  }
+  entry.file = NULL;
+  entry.next = free_entry_;
+  free_entry_ = id;
+}
+
+}
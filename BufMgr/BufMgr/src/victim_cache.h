@@ -0,0 +1,189 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bufHashTbl.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+
+/**
+ * @brief Counters of a victim cache.
+ */
+struct VictimCacheStats {
+  /**
+   * Pages put in the cache, and pages pushed out of it to make room.
+   */
+  std::uint64_t inserts;
+  std::uint64_t evictions;
+
+  /**
+   * Pages in the cache now, and the bytes they take compressed.
+   */
+  std::uint64_t pages;
+  std::uint64_t compressed_bytes;
+};
+
+/**
+ * @brief Second-level cache of pages evicted from the buffer pool, kept
+ *        LZ4-compressed in memory.
+ *
+ * The buffer manager (BufMgr::enableVictimCache()) hands a page it evicts to
+ * the cache once the page is clean, and looks a page missing from the pool up
+ * here before reading it from its file.  A page found is decompressed into
+ * the frame and leaves the cache, so no page is in both: the cache holds
+ * more pages than the same memory would as frames, by the compression ratio.
+ *
+ * Memory is an arena of UNIT_SIZE slabs; a compressed page takes as many as
+ * its length needs, chained, so any free unit fits any page and the arena
+ * never fragments.  Pages are found through a BufHashTbl keyed by file and
+ * page number, like the buffer pool's, and the least recently inserted page
+ * is pushed out when the arena is full.
+ *
+ * @warning This class is not threadsafe.
+ */
+class VictimCache {
+ public:
+  /**
+   * Bytes of an arena unit.
+   */
+  static const std::size_t UNIT_SIZE = 512;
+
+  /**
+   * Creates an empty cache.
+   *
+   * @param bytes   Memory for compressed pages, rounded down to UNIT_SIZE.
+   * @throws  std::bad_alloc  If the memory cannot be allocated.
+   */
+  explicit VictimCache(const std::size_t bytes);
+
+  ~VictimCache();
+
+  /**
+   * Keeps a compressed copy of a page, replacing any copy kept before, and
+   * pushing out the least recently inserted pages as needed.  The page must
+   * be the same as in its file.
+   *
+   * @param file          File of the page.
+   * @param page_number   Number of the page.
+   * @param page          The page.
+   */
+  void insert(const File* file, const PageId page_number, const Page& page);
+
+  /**
+   * Decompresses a page kept in the cache into <page> and drops it from the
+   * cache.
+   *
+   * @return  False if the page is not in the cache; <page> is left alone.
+   */
+  bool take(const File* file, const PageId page_number, Page* page);
+
+  /**
+   * Drops a page from the cache, if it is there.
+   */
+  void erase(const File* file, const PageId page_number);
+
+  /**
+   * Drops all pages of a file, or of all files if <file> is NULL.
+   */
+  void eraseFile(const File* file);
+
+  /**
+   * Returns the memory for compressed pages, in bytes.
+   */
+  std::size_t capacity() const { return units_ * UNIT_SIZE; }
+
+  /**
+   * Returns the counters of the cache.
+   */
+  VictimCacheStats stats() const { return stats_; }
+
+ private:
+  /**
+   * @brief Page kept in the cache.
+   */
+  struct Entry {
+    const File* file;
+    PageId page_number;
+
+    /**
+     * Compressed length, or Page::SIZE if stored as is.
+     */
+    std::uint32_t length;
+
+    /**
+     * First arena unit of the page, the rest following through next_unit_.
+     */
+    std::uint32_t first_unit;
+
+    /**
+     * Neighbours in the list from most to least recently inserted, or in the
+     * list of unused entries (next only).
+     */
+    std::uint32_t prev;
+    std::uint32_t next;
+  };
+
+  VictimCache(const VictimCache&);
+  VictimCache& operator=(const VictimCache&);
+
+  /**
+   * Returns the entry of a page, or NONE.
+   */
+  std::uint32_t find(const File* file, const PageId page_number);
+
+  /**
+   * Drops an entry, returning its units and itself to the free lists.
+   */
+  void remove(const std::uint32_t entry);
+
+  /**
+   * Marker of no entry or unit.
+   */
+  static const std::uint32_t NONE = 0xffffffffu;
+
+  std::uint32_t units_;
+
+  /**
+   * The arena, and the unit after each in its page's chain or the free list.
+   */
+  char* arena_;
+  std::vector<std::uint32_t> next_unit_;
+  std::uint32_t free_unit_;
+  std::uint32_t free_units_;
+
+  /**
+   * Entries, at most one per unit, the most and least recently inserted, and
+   * the first unused one.
+   */
+  std::vector<Entry> entries_;
+  std::uint32_t newest_;
+  std::uint32_t oldest_;
+  std::uint32_t free_entry_;
+
+  /**
+   * Entry of each page in the cache.
+   */
+  BufHashTbl index_;
+
+  /**
+   * Room for a compressed page while it is copied in or out of its units.
+   */
+  std::vector<char> scratch_;
+
+  VictimCacheStats stats_;
+};
+
+}
@@ -0,0 +1,543 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "wal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "crc32c.h"
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * First bytes of every log file ("BDGRWAL1"), followed by the LSN of the last
+ * checkpoint (the master record), 0 if none.
+ */
+const std::uint64_t kMagic = 0x314c415752474442ULL;
+const Lsn kCheckpointOffset = 8;
+const Lsn kHeaderSize = 16;
+
+/**
+ * Fixed part of a record on disk, followed by the file name, the before image
+ * and the after image.
+ */
+struct LogRecordHeader {
+  /**
+   * Length of the whole record, and CRC-32C checksum of it computed with this
+   * field set to 0.
+   */
+  std::uint32_t length;
+  std::uint32_t checksum;
+
+  /**
+   * LSN of the record, so that stale bytes past the end of the log are not
+   * taken for a record.
+   */
+  Lsn lsn;
+  Lsn prev_lsn;
+  Lsn undo_next_lsn;
+  TxnId txn;
+  PageId page_number;
+  std::uint32_t before_length;
+  std::uint32_t after_length;
+  SlotId slot_number;
+  std::uint16_t filename_length;
+  std::uint8_t type;
+  std::uint8_t compensation;
+};
+
+/**
+ * Entry of the active transaction table in a checkpoint record, after its
+ * redo LSN.
+ */
+struct ActiveTxn {
+  TxnId txn;
+  Lsn last_lsn;
+};
+
+/**
+ * Reads exactly <length> bytes at <offset>.
+ *
+ * @return  False if the file ends first.
+ */
+bool readFully(const int fd, char* buffer, const std::size_t length,
+               const Lsn offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pread(fd, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException("pread", errno);
+    }
+    if (n == 0) {
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
+void writeFully(const int fd, const char* buffer, const std::size_t length,
+                const Lsn offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pwrite(fd, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoException("pwrite", errno);
+    }
+    if (n == 0) {
+      throw IoException("pwrite", 0 /* short transfer */);
+    }
+    done += n;
+  }
+}
+
+}
+
+Wal::Wal(const std::string& filename)
+    : filename_(filename),
+      fd_(-1),
+      buffer_lsn_(kHeaderSize),
+      end_lsn_(kHeaderSize),
+      flushed_lsn_(kHeaderSize),
+      flushing_(false),
+      group_commit_delay_(0),
+      next_txn_(1),
+      checkpoint_lsn_(0) {
+  std::memset(&stats_, 0, sizeof(stats_));
+  fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    throw IoException("open", errno);
+  }
+  struct stat st;
+  if (::fstat(fd_, &st) != 0) {
+    const int error = errno;
+    ::close(fd_);
+    throw IoException("fstat", error);
+  }
+  try {
+    char header[kHeaderSize] = {};
+    if (st.st_size == 0) {
+      std::memcpy(header, &kMagic, sizeof(kMagic));
+      writeFully(fd_, header, sizeof(header), 0);
+      if (::fdatasync(fd_) != 0) {
+        throw IoException("fdatasync", errno);
+      }
+    } else {
+      std::uint64_t magic = 0;
+      if (!readFully(fd_, header, sizeof(header), 0) ||
+          (std::memcpy(&magic, header, sizeof(magic)), magic != kMagic)) {
+        throw IoException("open log " + filename_, EINVAL);
+      }
+      std::memcpy(&checkpoint_lsn_, header + kCheckpointOffset,
+                  sizeof(checkpoint_lsn_));
+      recover(st.st_size);
+    }
+  } catch (...) {
+    ::close(fd_);
+    throw;
+  }
+}
+
+Wal::~Wal() {
+  try {
+    flush(endLsn());
+  } catch (IoException&) {
+    // Nothing more to do about it here; the tail is lost as in a crash.
+  }
+  ::close(fd_);
+}
+
+TxnId Wal::begin() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return next_txn_++;
+}
+
+Lsn Wal::logPage(const TxnId txn, const File* file, Page* page) {
+  return append(txn, LOG_PAGE_IMAGE, file, page->page_number(),
+                Page::INVALID_SLOT, std::string(), std::string(), page);
+}
+
+RecordId Wal::insertRecord(const TxnId txn, const File* file, Page* page,
+                           const std::string& record_data) {
+  const RecordId record_id = page->insertRecord(record_data);
+  page->set_page_lsn(append(txn, LOG_INSERT, file, record_id.page_number,
+                            record_id.slot_number, std::string(),
+                            record_data));
+  return record_id;
+}
+
+void Wal::updateRecord(const TxnId txn, const File* file, Page* page,
+                       const RecordId& record_id,
+                       const std::string& record_data) {
+  const std::string before = page->getRecord(record_id);
+  page->updateRecord(record_id, record_data);
+  page->set_page_lsn(append(txn, LOG_UPDATE, file, record_id.page_number,
+                            record_id.slot_number, before, record_data));
+}
+
+void Wal::deleteRecord(const TxnId txn, const File* file, Page* page,
+                       const RecordId& record_id) {
+  const std::string before = page->getRecord(record_id);
+  page->deleteRecord(record_id);
+  page->set_page_lsn(append(txn, LOG_DELETE, file, record_id.page_number,
+                            record_id.slot_number, before, std::string()));
+}
+
+Lsn Wal::commit(const TxnId txn) {
+  const Lsn lsn = append(txn, LOG_COMMIT, NULL, Page::INVALID_NUMBER,
+                         Page::INVALID_SLOT, std::string(), std::string());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.commits;
+  }
+  flush(lsn);
+  return lsn;
+}
+
+Lsn Wal::undo(const TxnId txn, const LogRecord& record, const File* file,
+               Page* page) {
+  const RecordId record_id = {record.page_number, record.slot_number};
+  Lsn lsn = 0;
+  switch (record.type) {
+    case LOG_INSERT:
+      page->deleteRecord(record_id);
+      lsn = append(txn, LOG_DELETE, file, record.page_number,
+                   record.slot_number, record.after, std::string(), NULL,
+                   &record);
+      break;
+    case LOG_UPDATE:
+      page->updateRecord(record_id, record.before);
+      lsn = append(txn, LOG_UPDATE, file, record.page_number,
+                   record.slot_number, record.after, record.before, NULL,
+                   &record);
+      break;
+    case LOG_DELETE:
+      // Back under its old ID, which records elsewhere may refer to.
+      page->insertRecordAt(record.slot_number, record.before);
+      lsn = append(txn, LOG_INSERT, file, record.page_number,
+                   record.slot_number, std::string(), record.before, NULL,
+                   &record);
+      break;
+    default:
+      return 0;
+  }
+  page->set_page_lsn(lsn);
+  return lsn;
+}
+
+Lsn Wal::abort(const TxnId txn) {
+  return append(txn, LOG_ABORT, NULL, Page::INVALID_NUMBER,
+                Page::INVALID_SLOT, std::string(), std::string());
+}
+
+bool Wal::redo(const LogRecord& record, Page* page) {
+  if (page->page_lsn() >= record.lsn) {
+    return false;
+  }
+  const RecordId record_id = {record.page_number, record.slot_number};
+  switch (record.type) {
+    case LOG_PAGE_IMAGE:
+      std::memcpy(page, record.after.data(), Page::SIZE);
+      break;
+    case LOG_INSERT:
+      // Into the slot logged; the insert picked it from the same page state.
+      page->insertRecordAt(record.slot_number, record.after);
+      break;
+    case LOG_UPDATE:
+      page->updateRecord(record_id, record.after);
+      break;
+    case LOG_DELETE:
+      page->deleteRecord(record_id);
+      break;
+    default:
+      return false;
+  }
+  page->set_page_lsn(record.lsn);
+  return true;
+}
+
+void Wal::flush(const Lsn lsn) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (flushed_lsn_ <= lsn && flushed_lsn_ < end_lsn_) {
+    if (flushing_) {
+      // Another thread is writing; its sync may cover this record too.
+      flushed_.wait(lock);
+      continue;
+    }
+    flushing_ = true;
+    if (group_commit_delay_ > 0) {
+      lock.unlock();
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(group_commit_delay_));
+      lock.lock();
+    }
+    // Take everything appended so far, including records of threads waiting
+    // for this write, and write it with one sync.
+    std::vector<char> batch;
+    batch.swap(buffer_);
+    const Lsn start = buffer_lsn_;
+    const Lsn end = end_lsn_;
+    buffer_lsn_ = end;
+    lock.unlock();
+    int error = 0;
+    try {
+      writeFully(fd_, &batch[0], batch.size(), start);
+      if (::fdatasync(fd_) != 0) {
+        error = errno;
+      }
+    } catch (IoException& e) {
+      error = e.error() != 0 ? e.error() : EIO;
+    }
+    lock.lock();
+    flushing_ = false;
+    if (error != 0) {
+      // Put the batch back in front of whatever was appended since.
+      batch.insert(batch.end(), buffer_.begin(), buffer_.end());
+      buffer_.swap(batch);
+      buffer_lsn_ = start;
+      flushed_.notify_all();
+      throw IoException("log flush", error);
+    }
+    flushed_lsn_ = end;
+    ++stats_.syncs;
+    flushed_.notify_all();
+  }
+}
+
+Lsn Wal::logCheckpoint(const Lsn redo_lsn) {
+  const Lsn lsn = append(0, LOG_CHECKPOINT, NULL, Page::INVALID_NUMBER,
+                         Page::INVALID_SLOT, std::string(),
+                         std::string(reinterpret_cast<const char*>(&redo_lsn),
+                                     sizeof(redo_lsn)));
+  flush(lsn);
+  std::lock_guard<std::mutex> header_lock(header_mutex_);
+  if (lsn > checkpointLsn()) {
+    writeFully(fd_, reinterpret_cast<const char*>(&lsn), sizeof(lsn),
+               kCheckpointOffset);
+    if (::fdatasync(fd_) != 0) {
+      throw IoException("fdatasync", errno);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkpoint_lsn_ = lsn;
+  }
+  return lsn;
+}
+
+Lsn Wal::checkpointLsn() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return checkpoint_lsn_;
+}
+
+Lsn Wal::flushedLsn() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return flushed_lsn_;
+}
+
+Lsn Wal::endLsn() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return end_lsn_;
+}
+
+Lsn Wal::firstLsn() {
+  return kHeaderSize;
+}
+
+bool Wal::readRecord(const Lsn lsn, LogRecord& record, Lsn& next) {
+  if (lsn >= endLsn()) {
+    return false;
+  }
+  flush(lsn);
+  if (!readAt(lsn, flushedLsn(), record)) {
+    throw IoException("read log record", EIO);
+  }
+  LogRecordHeader header;
+  next = lsn + sizeof(header) + record.filename.size() +
+         record.before.size() + record.after.size();
+  return true;
+}
+
+void Wal::setGroupCommitDelay(const unsigned microseconds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  group_commit_delay_ = microseconds;
+}
+
+WalStats Wal::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+Lsn Wal::append(const TxnId txn, const LogRecordType type, const File* file,
+                const PageId page_number, const SlotId slot_number,
+                const std::string& before, const std::string& after,
+                Page* image, const LogRecord* undone) {
+  LogRecordHeader header;
+  std::memset(&header, 0, sizeof(header));
+  const std::string filename = file != NULL ? file->filename() : std::string();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<ActiveTxn> active;
+  if (type == LOG_CHECKPOINT) {
+    // Taken with the record appended, so no commit slips in between.
+    for (std::map<TxnId, Lsn>::const_iterator it = last_lsn_.begin();
+         it != last_lsn_.end(); ++it) {
+      const ActiveTxn entry = {it->first, it->second};
+      active.push_back(entry);
+    }
+  }
+  const std::size_t after_length =
+      image != NULL ? Page::SIZE
+                    : after.size() + active.size() * sizeof(ActiveTxn);
+  header.length = sizeof(header) + filename.size() + before.size() +
+                  after_length;
+  header.txn = txn;
+  header.page_number = page_number;
+  header.before_length = before.size();
+  header.after_length = after_length;
+  header.slot_number = slot_number;
+  header.filename_length = filename.size();
+  header.type = type;
+  if (undone != NULL) {
+    header.compensation = 1;
+    header.undo_next_lsn = undone->prev_lsn;
+  }
+  header.lsn = end_lsn_;
+  std::map<TxnId, Lsn>::iterator last = last_lsn_.find(txn);
+  header.prev_lsn = last != last_lsn_.end() ? last->second : 0;
+
+  const std::size_t offset = buffer_.size();
+  buffer_.resize(offset + header.length);
+  char* raw = &buffer_[offset];
+  std::memcpy(raw, &header, sizeof(header));
+  char* tail = raw + sizeof(header);
+  tail = std::copy(filename.begin(), filename.end(), tail);
+  tail = std::copy(before.begin(), before.end(), tail);
+  if (image != NULL) {
+    // The image includes its page LSN, known only now.
+    image->set_page_lsn(header.lsn);
+    std::memcpy(tail, image, Page::SIZE);
+  } else {
+    tail = std::copy(after.begin(), after.end(), tail);
+    if (!active.empty()) {
+      std::memcpy(tail, &active[0], active.size() * sizeof(ActiveTxn));
+    }
+  }
+  header.checksum = Crc32c::compute(raw, header.length);
+  std::memcpy(raw + offsetof(LogRecordHeader, checksum), &header.checksum,
+              sizeof(header.checksum));
+
+  end_lsn_ += header.length;
+  if (type == LOG_COMMIT || type == LOG_ABORT) {
+    // Ended with the record appended, so no checkpoint lists it as active
+    // after its end.
+    last_lsn_.erase(txn);
+  } else if (type != LOG_CHECKPOINT) {
+    last_lsn_[txn] = header.lsn;
+  }
+  ++stats_.records;
+  stats_.bytes += header.length;
+  return header.lsn;
+}
+
+bool Wal::readAt(const Lsn lsn, const Lsn limit, LogRecord& record) const {
+  LogRecordHeader header;
+  if (lsn + sizeof(header) > limit ||
+      !readFully(fd_, reinterpret_cast<char*>(&header), sizeof(header), lsn)) {
+    return false;
+  }
+  if (header.lsn != lsn || header.length < sizeof(header) ||
+      lsn + header.length > limit ||
+      header.length != sizeof(header) + header.filename_length +
+                       header.before_length + header.after_length) {
+    return false;
+  }
+  std::vector<char> raw(header.length);
+  if (!readFully(fd_, &raw[0], raw.size(), lsn)) {
+    return false;
+  }
+  const std::uint32_t stored = header.checksum;
+  std::memset(&raw[offsetof(LogRecordHeader, checksum)], 0,
+              sizeof(header.checksum));
+  if (Crc32c::compute(&raw[0], raw.size()) != stored) {
+    return false;
+  }
+
+  const char* tail = &raw[sizeof(header)];
+  record.lsn = lsn;
+  record.prev_lsn = header.prev_lsn;
+  record.txn = header.txn;
+  record.type = static_cast<LogRecordType>(header.type);
+  record.compensation = header.compensation != 0;
+  record.undo_next_lsn = header.undo_next_lsn;
+  record.filename.assign(tail, header.filename_length);
+  tail += header.filename_length;
+  record.page_number = header.page_number;
+  record.slot_number = header.slot_number;
+  record.before.assign(tail, header.before_length);
+  tail += header.before_length;
+  record.after.assign(tail, header.after_length);
+  record.redo_lsn = 0;
+  record.active_txns.clear();
+  if (record.type == LOG_CHECKPOINT && record.after.size() >= sizeof(Lsn)) {
+    std::memcpy(&record.redo_lsn, record.after.data(), sizeof(Lsn));
+    for (std::size_t offset = sizeof(Lsn);
+         offset + sizeof(ActiveTxn) <= record.after.size();
+         offset += sizeof(ActiveTxn)) {
+      ActiveTxn entry;
+      std::memcpy(&entry, record.after.data() + offset, sizeof(entry));
+      record.active_txns[entry.txn] = entry.last_lsn;
+    }
+  }
+  return true;
+}
+
+void Wal::recover(const Lsn file_size) {
+  LogRecord record;
+  Lsn lsn = kHeaderSize;
+  while (readAt(lsn, file_size, record)) {
+    if (record.txn >= next_txn_) {
+      next_txn_ = record.txn + 1;
+    }
+    if (record.type == LOG_COMMIT || record.type == LOG_ABORT) {
+      last_lsn_.erase(record.txn);
+    } else if (record.type != LOG_CHECKPOINT) {
+      last_lsn_[record.txn] = lsn;
+    }
+    lsn += sizeof(LogRecordHeader) + record.filename.size() +
+           record.before.size() + record.after.size();
+  }
+  if (lsn < file_size) {
+    // A torn write at the end; later appends overwrite it.
+    if (::ftruncate(fd_, lsn) != 0 || ::fdatasync(fd_) != 0) {
+      throw IoException("truncate log", errno);
+    }
+  }
+  buffer_lsn_ = end_lsn_ = flushed_lsn_ = lsn;
+  if (checkpoint_lsn_ >= lsn) {
+    // The checkpoint record was cut off with the tail.
+    checkpoint_lsn_ = 0;
+  }
+}
+
+}
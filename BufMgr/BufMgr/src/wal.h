@@ -0,0 +1,437 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Identifier for a transaction writing to the log.
+ */
+typedef std::uint64_t TxnId;
+
+/**
+ * @brief Kinds of records in the write-ahead log.
+ */
+enum LogRecordType {
+  /**
+   * Whole page as it is after a change; redone by copying it in.
+   */
+  LOG_PAGE_IMAGE = 1,
+
+  /**
+   * Record inserted into a slot of a page.
+   */
+  LOG_INSERT,
+
+  /**
+   * Record in a slot of a page replaced by a new version.
+   */
+  LOG_UPDATE,
+
+  /**
+   * Record deleted from a slot of a page.
+   */
+  LOG_DELETE,
+
+  /**
+   * Transaction committed.
+   */
+  LOG_COMMIT,
+
+  /**
+   * Transaction rolled back: all its changes have been undone.
+   */
+  LOG_ABORT,
+
+  /**
+   * Fuzzy checkpoint: where redo can start, and the transactions active.
+   */
+  LOG_CHECKPOINT
+};
+
+/**
+ * @brief A record of the write-ahead log, as read back by Wal::readRecord().
+ */
+struct LogRecord {
+  /**
+   * LSN of the record: its byte offset in the log file.
+   */
+  Lsn lsn;
+
+  /**
+   * LSN of the previous record of the same transaction, or 0 for its first.
+   */
+  Lsn prev_lsn;
+
+  /**
+   * Transaction that wrote the record.
+   */
+  TxnId txn;
+
+  LogRecordType type;
+
+  /**
+   * True for a compensation record, which logs the undoing of an earlier
+   * change.  Compensation records are redone but never undone; undo goes on
+   * at <undo_next_lsn>, the record before the one undone.
+   */
+  bool compensation;
+  Lsn undo_next_lsn;
+
+  /**
+   * File and page changed, and the slot for record changes.  Empty and 0 for
+   * commit records.
+   */
+  std::string filename;
+  PageId page_number;
+  SlotId slot_number;
+
+  /**
+   * Record before the change (updates and deletes), and record or whole page
+   * after it (inserts, updates and page images).
+   */
+  std::string before;
+  std::string after;
+
+  /**
+   * For checkpoint records: LSN redo after a crash can start at, and the last
+   * LSN of every transaction neither committed nor rolled back at the time.
+   */
+  Lsn redo_lsn;
+  std::map<TxnId, Lsn> active_txns;
+};
+
+/**
+ * @brief Counters of a write-ahead log.
+ */
+struct WalStats {
+  /**
+   * Records and bytes appended.
+   */
+  std::uint64_t records;
+  std::uint64_t bytes;
+
+  /**
+   * Writes of the log buffer, each ending in one fdatasync.
+   */
+  std::uint64_t syncs;
+
+  /**
+   * Transactions committed.
+   */
+  std::uint64_t commits;
+};
+
+/**
+ * @brief Append-only write-ahead log of page changes, with group commit.
+ *
+ * Every change made to a page through insertRecord(), updateRecord(),
+ * deleteRecord() or logPage() is applied to the page, appended to the log and
+ * stamped into the page header as the page LSN.  The LSN of a record is its
+ * byte offset in the log file, so LSNs grow with every record.  BufMgr, once
+ * given the log with BufMgr::attachWal(), writes no dirty page whose page LSN
+ * has not reached stable storage in the log (write-ahead logging).
+ *
+ * Records are appended to a buffer in memory and written out by flush().
+ * Threads flushing at the same time share the work: one of them writes
+ * everything appended so far and syncs once, the others wait for it and find
+ * their records durable (group commit).  setGroupCommitDelay() lets the
+ * writing thread wait for more commits to join before writing.
+ *
+ * A transaction that does not commit is rolled back by undoing its changes,
+ * newest first, with undo(), which logs a compensation record for each, and
+ * then logging abort().  Recovery does this for the transactions a crash
+ * interrupted, after redoing the log with redo().
+ *
+ * logCheckpoint() bounds the part of the log recovery has to read: it logs
+ * where redo can start, with the transactions active, and records the
+ * checkpoint in the log header (the master record).
+ *
+ * Every record carries a checksum.  On opening an existing log, the records
+ * are checked from the start and a torn or partly written tail is cut off.
+ *
+ * Threads may log and commit concurrently; changes to one page must still be
+ * serialized by the caller (for example with an exclusive frame latch).
+ */
+class Wal {
+ public:
+  /**
+   * Opens the log in the given file, creating it if it does not exist.
+   *
+   * @param filename  Name of the log file.
+   * @throws  IoException  If the file cannot be opened, read or written, or
+   *                       is not a log.
+   */
+  explicit Wal(const std::string& filename);
+
+  /**
+   * Writes out everything appended and closes the log.
+   */
+  ~Wal();
+
+  /**
+   * Returns the name of the log file.
+   */
+  const std::string& filename() const { return filename_; }
+
+  /**
+   * Starts a new transaction.
+   *
+   * @return  Its identifier, higher than that of any transaction in the log.
+   */
+  TxnId begin();
+
+  /**
+   * Logs the whole of a page as it is now, for changes not made through the
+   * record methods below (a newly allocated page, for one), and stamps its
+   * page LSN.
+   *
+   * @return  LSN of the record.
+   */
+  Lsn logPage(const TxnId txn, const File* file, Page* page);
+
+  /**
+   * Inserts a record into a page, as Page::insertRecord() does, logs the
+   * insert and stamps the page LSN.
+   *
+   * @return  ID of the new record.
+   * @throws  InsufficientSpaceException  If the record does not fit; nothing
+   *                                      is logged.
+   */
+  RecordId insertRecord(const TxnId txn, const File* file, Page* page,
+                        const std::string& record_data);
+
+  /**
+   * Replaces a record of a page, as Page::updateRecord() does, logs the old
+   * and new versions and stamps the page LSN.
+   *
+   * @throws  InvalidRecordException      If there is no such record.
+   * @throws  InsufficientSpaceException  If the new version does not fit.
+   */
+  void updateRecord(const TxnId txn, const File* file, Page* page,
+                    const RecordId& record_id, const std::string& record_data);
+
+  /**
+   * Deletes a record of a page, as Page::deleteRecord() does, logs the old
+   * version and stamps the page LSN.
+   *
+   * @throws  InvalidRecordException  If there is no such record.
+   */
+  void deleteRecord(const TxnId txn, const File* file, Page* page,
+                    const RecordId& record_id);
+
+  /**
+   * Logs the commit of a transaction and waits until the commit record is on
+   * stable storage, sharing the sync with other threads committing.
+   *
+   * @return  LSN of the commit record.
+   */
+  Lsn commit(const TxnId txn);
+
+  /**
+   * Undoes the change a record of <txn> made to its page, which is <page>,
+   * logs a compensation record for it and stamps the page LSN.  Page images
+   * and commit records have nothing to undo.
+   *
+   * @return  LSN of the compensation record, or 0 if nothing was undone.
+   */
+  Lsn undo(const TxnId txn, const LogRecord& record, const File* file,
+           Page* page);
+
+  /**
+   * Logs that a transaction has been rolled back, once undo() has been called
+   * for all its changes, newest first.
+   *
+   * @return  LSN of the abort record.
+   */
+  Lsn abort(const TxnId txn);
+
+  /**
+   * Redoes the change of a record on its page unless the page LSN shows the
+   * page has it already, and stamps the page LSN.
+   *
+   * @param record  Record of a change to <page>.
+   * @param page    Page changed.
+   * @return  True if the change was redone.
+   */
+  static bool redo(const LogRecord& record, Page* page);
+
+  /**
+   * Logs a checkpoint, makes it durable and records its LSN in the log header,
+   * where checkpointLsn() finds it after a restart.  The checkpoint record
+   * holds <redo_lsn> and the last LSN of every transaction active, taken as
+   * the record is appended.
+   *
+   * @param redo_lsn  LSN before which every change is on disk; see
+   *                  BufMgr::minRecLsn().
+   * @return  LSN of the checkpoint record.
+   * @throws  IoException  If the log or its header cannot be written.
+   */
+  Lsn logCheckpoint(const Lsn redo_lsn);
+
+  /**
+   * Returns the LSN of the last checkpoint recorded in the log header, or 0 if
+   * there is none.
+   */
+  Lsn checkpointLsn() const;
+
+  /**
+   * Makes the record with the given LSN, and every record before it, durable:
+   * writes the log buffer and syncs the log file unless a sync in progress or
+   * done already covers it.
+   *
+   * @param lsn   LSN of a record; LSNs past the end flush everything.
+   * @throws  IoException  If the log cannot be written or synced.
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Returns the LSN below which every record is on stable storage.
+   */
+  Lsn flushedLsn() const;
+
+  /**
+   * Returns the LSN the next record appended gets.
+   */
+  Lsn endLsn() const;
+
+  /**
+   * Returns the LSN of the first record in any log.
+   */
+  static Lsn firstLsn();
+
+  /**
+   * Reads the record with the given LSN, flushing the log first if the record
+   * is not durable yet.
+   *
+   * @param lsn       LSN of the record, firstLsn() or the <next> of another.
+   * @param record    Record read.
+   * @param next      LSN of the record after it.
+   * @return  False if <lsn> is the end of the log.
+   * @throws  IoException  If the record cannot be read or is damaged.
+   */
+  bool readRecord(const Lsn lsn, LogRecord& record, Lsn& next);
+
+  /**
+   * Makes flush() wait the given time before writing, so that more commits
+   * join the sync.  0 (the default) writes right away.
+   */
+  void setGroupCommitDelay(const unsigned microseconds);
+
+  /**
+   * Returns the counters of the log.
+   */
+  WalStats stats() const;
+
+ private:
+  Wal(const Wal&);
+  Wal& operator=(const Wal&);
+
+  /**
+   * Appends a record to the log buffer and links it to the previous record of
+   * its transaction.  If <image> is given, its page LSN is set to the LSN of
+   * the record and the whole page is the after image.  If <undone> is given,
+   * the record is the compensation record for it.  Checkpoint records get the
+   * table of active transactions appended to <after>; commit and abort
+   * records take their transaction out of it.
+   *
+   * @return  LSN of the record.
+   */
+  Lsn append(const TxnId txn, const LogRecordType type, const File* file,
+             const PageId page_number, const SlotId slot_number,
+             const std::string& before, const std::string& after,
+             Page* image = NULL, const LogRecord* undone = NULL);
+
+  /**
+   * Reads and checks the record at <lsn>, which must end by <limit>.
+   *
+   * @return  False if there is no complete, intact record there.
+   */
+  bool readAt(const Lsn lsn, const Lsn limit, LogRecord& record) const;
+
+  /**
+   * Checks the records of an existing log from the start, cutting off a
+   * damaged tail, and finds the end of the log, the highest transaction and
+   * the last records of transactions neither committed nor rolled back.
+   */
+  void recover(const Lsn file_size);
+
+  /**
+   * Name of the log file and its descriptor.
+   */
+  std::string filename_;
+  int fd_;
+
+  /**
+   * Guards everything below.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Signalled when a write of the log buffer ends.
+   */
+  std::condition_variable flushed_;
+
+  /**
+   * Records appended but not yet written, starting at LSN <buffer_lsn_>.
+   */
+  std::vector<char> buffer_;
+  Lsn buffer_lsn_;
+
+  /**
+   * LSN the next record gets, and LSN below which records are durable.
+   */
+  Lsn end_lsn_;
+  Lsn flushed_lsn_;
+
+  /**
+   * True while a thread writes and syncs the log.
+   */
+  bool flushing_;
+
+  /**
+   * Time flush() waits for more commits before writing, in microseconds.
+   */
+  unsigned group_commit_delay_;
+
+  /**
+   * Identifier the next transaction gets.
+   */
+  TxnId next_txn_;
+
+  /**
+   * LSN of the last record of every transaction neither committed nor rolled
+   * back.
+   */
+  std::map<TxnId, Lsn> last_lsn_;
+
+  /**
+   * LSN of the last checkpoint recorded in the log header.
+   */
+  Lsn checkpoint_lsn_;
+
+  WalStats stats_;
+
+  /**
+   * Serializes writes of the log header, outside <mutex_>.
+   */
+  std::mutex header_mutex_;
+};
+
+}